@@ -537,6 +537,19 @@
 #define dg_configRETAIN_GPADC                   (1)
 #endif
 
+/**
+ * \brief Size of the lookup table used by crc16_update()
+ *
+ * - 256: byte-wise lookup, 512 bytes of constant data
+ * - 16: nibble-wise lookup, 32 bytes of constant data, about half as fast as byte-wise lookup
+ * - 0: bit-wise calculation, no lookup table
+ *
+ * \bsp_default_note{\bsp_config_option_app,}
+ */
+#ifndef dg_configCRC16_TABLE_SIZE
+#define dg_configCRC16_TABLE_SIZE                       (256)
+#endif
+
 
 /**
  * \}
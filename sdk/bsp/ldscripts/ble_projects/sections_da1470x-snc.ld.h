@@ -16,6 +16,8 @@
  *   __copy_table_end__
  *   __zero_table_start__
  *   __zero_table_end__
+ *   __start_log_fmt
+ *   __stop_log_fmt
  *   __etext
  *   __data_start__
  *   __preinit_array_start
@@ -105,6 +107,18 @@ SECTIONS
                 KEEP(*(.eh_frame*))
         } > SNC
 
+        /*
+         * Format strings of deferred logging. Records refer to them by offset from
+         * __start_log_fmt, which host decoder reads from this section of ELF file. They stay in
+         * flash, since arguments are encoded according to format on target.
+         */
+        log_fmt :
+        {
+                __start_log_fmt = .;
+                KEEP(*(log_fmt))
+                __stop_log_fmt = .;
+        } > SNC
+
         .ARM.extab :
         {
                 *(.ARM.extab* .gnu.linkonce.armextab.*)
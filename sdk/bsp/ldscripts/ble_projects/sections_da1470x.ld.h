@@ -15,6 +15,8 @@
  *   __copy_table_end__
  *   __zero_table_start__
  *   __zero_table_end__
+ *   __start_log_fmt
+ *   __stop_log_fmt
  *   __etext
  *   __preinit_array_start
  *   __preinit_array_end
@@ -263,6 +265,18 @@ SECTIONS
                 KEEP(*(.eh_frame*))
         } > TEXT __TEXT_LMA__
 
+        /*
+         * Format strings of deferred logging. Records refer to them by offset from
+         * __start_log_fmt, which host decoder reads from this section of ELF file. They stay in
+         * flash, since arguments are encoded according to format on target.
+         */
+        log_fmt :
+        {
+                __start_log_fmt = .;
+                KEEP(*(log_fmt))
+                __stop_log_fmt = .;
+        } > TEXT __TEXT_LMA__
+
         .ARM.extab :
         {
                 *(.ARM.extab* .gnu.linkonce.armextab.*)
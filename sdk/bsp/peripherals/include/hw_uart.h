@@ -1426,6 +1426,23 @@ void hw_uart_enable_rx_circular_dma(HW_UART_ID uart);
  */
 void hw_uart_copy_rx_circular_dma_buffer(HW_UART_ID uart, uint8_t *buf, uint16_t len);
 
+/**
+ * \brief Get number of bytes available in circular RX DMA buffer
+ *
+ * This function returns number of bytes already received to intermediate buffer, which were not
+ * read yet using hw_uart_copy_rx_circular_dma_buffer(). It allows to read all received data
+ * without calling hw_uart_receive() for each part of it.
+ *
+ * \note
+ * This function shall not be called while read started by hw_uart_receive() is in progress.
+ *
+ * \param [in] uart identifies UART to use
+ *
+ * \return number of bytes available in buffer
+ *
+ */
+uint16_t hw_uart_get_rx_circular_dma_data_len(HW_UART_ID uart);
+
 #endif /* dg_configUART_RX_CIRCULAR_DMA */
 
 #endif /* dg_configUSE_HW_UART */
@@ -1225,6 +1225,23 @@ void hw_uart_copy_rx_circular_dma_buffer(HW_UART_ID uart, uint8_t *buf, uint16_t
         GLOBAL_INT_RESTORE();
 }
 
+uint16_t hw_uart_get_rx_circular_dma_data_len(HW_UART_ID uart)
+{
+        UART_Data *ud = UARTDATA(uart);
+        uint16_t cur_idx;
+
+        ASSERT_ERROR(ud->rx_dma_active == false);
+
+        cur_idx = hw_dma_transfered_bytes(ud->rx_dma.channel_number);
+
+        /* cur_idx is lower than rx_head only if it wrapped-around - fix it */
+        if (cur_idx < ud->rx_dma_head) {
+                cur_idx += ud->rx_dma_buf_size;
+        }
+
+        return cur_idx - ud->rx_dma_head;
+}
+
 #endif /* dg_configUART_RX_CIRCULAR_DMA */
 
 #endif /* HW_UART_DMA_SUPPORT */
@@ -15,6 +15,27 @@
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
 
+#include <stdint.h>
+
+/**************************************************************************************************
+ * uartboot version
+ *************************************************************************************************/
+
+/**
+ * \brief uartboot version (BCD)
+ *
+ * Sent in the 'Hello message'. Shared by uartboot and its host simulator, so both report the same
+ * version. Must be related to UARTBOOT_VERSION_STR.
+ */
+#define UARTBOOT_VERSION        (0x0008)
+
+/**
+ * \brief uartboot version string
+ *
+ * Sent in response to CMD_GET_VERSION.
+ */
+#define UARTBOOT_VERSION_STR    "0.0.0.8"
+
 /**************************************************************************************************
  * Special characters used by protocol
  *************************************************************************************************/
@@ -225,6 +246,41 @@
  */
 #define CMD_GET_PRODUCT_INFO       0x1B
 
+/**
+ * \brief Write a window of data chunks to RAM, QSPI or OQSPI FLASH
+ *
+ * Several chunks are streamed back-to-back as frames (see \ref window_frame_hdr_t) and only the
+ * missing or corrupted ones are retransmitted. This command is available only after windowed mode
+ * has been negotiated with CMD_GET_VERSION.
+ *
+ */
+#define CMD_WINDOW_WRITE           0x1C
+
+/**
+ * \brief Get CRC32 digests of QSPI or OQSPI FLASH range
+ *
+ * One digest is returned for each FLASH_DIGEST_SECTOR_SIZE sector touched by the range, computed
+ * only over the part of the sector which belongs to the range. It allows to skip writing sectors
+ * whose contents wouldn't change.
+ *
+ */
+#define CMD_GET_FLASH_DIGESTS      0x1D
+
+/**
+ * \brief Size of FLASH sector covered by a single CMD_GET_FLASH_DIGESTS digest
+ *
+ */
+#define FLASH_DIGEST_SECTOR_SIZE   0x1000
+
+/**
+ * \brief Write LZ4 block compressed data to QSPI or OQSPI FLASH
+ *
+ * Payload is decompressed by uartboot in its input buffer and written like with
+ * CMD_DIRECT_WRITE_TO_QSPI. Decompressed length must match the one given in command header.
+ *
+ */
+#define CMD_WRITE_COMPRESSED       0x1E
+
 /**
  * \brief Change communication UART's baudrate
  *
@@ -237,4 +293,96 @@
  */
 #define CMD_DUMMY                  0xFF
 
+/**
+ * \brief Memory identifiers used by CMD_WINDOW_WRITE, CMD_GET_FLASH_DIGESTS and
+ * CMD_WRITE_COMPRESSED
+ *
+ */
+#define PROTOCOL_MEM_RAM           0x00
+#define PROTOCOL_MEM_QSPI          0x01
+#define PROTOCOL_MEM_OQSPI         0x02
+
+/**************************************************************************************************
+ * Windowed transfer definitions
+ *************************************************************************************************/
+
+/**
+ * \brief Maximum number of chunks which can be in flight in a single window
+ *
+ * Limited by the width of the received chunks bitmap in \ref window_status_t.
+ */
+#define WINDOW_MAX_CHUNKS          16
+
+/**
+ * \brief Flag of chunk frame sequence number: chunk data is compressed (see CMD_WRITE_COMPRESSED)
+ *
+ * Used only if uartboot reported WINDOW_CAP_COMPRESSION capability.
+ */
+#define WINDOW_SEQ_COMPRESSED      0x80
+
+/**
+ * \brief uartboot windowed mode capability: compressed chunk frames are supported
+ *
+ */
+#define WINDOW_CAP_COMPRESSION     0x01
+
+/**
+ * \brief Flag of CMD_WINDOW_WRITE which starts a new window (drops chunks of the previous one)
+ *
+ */
+#define WINDOW_FLAG_NEW            0x01
+
+/* structures below are transmitted as they are, pragma is understood by both GCC and MSVC */
+#pragma pack(push, 1)
+
+/**
+ * \brief Windowed mode request sent as CMD_GET_VERSION payload
+ *
+ * uartboot which doesn't support windowed mode rejects CMD_GET_VERSION with payload. Otherwise
+ * the version string is followed by '\0', the number of granted chunks (1 byte) and capabilities
+ * (1 byte, \sa WINDOW_CAP_COMPRESSION). Capabilities byte is missing in uartboot 0.0.0.5.
+ *
+ */
+typedef struct {
+        uint8_t  window;                /**< Requested number of chunks in flight */
+        uint16_t chunk_size;            /**< Maximum size of a single chunk in bytes */
+} window_request_t;
+
+/**
+ * \brief CMD_WINDOW_WRITE parameters
+ *
+ */
+typedef struct {
+        uint8_t  mem;                   /**< Destination memory \sa PROTOCOL_MEM_RAM */
+        uint8_t  flags;                 /**< Window flags \sa WINDOW_FLAG_NEW */
+        uint8_t  verify;                /**< Verify written data (value other than 0) */
+        uint8_t  total;                 /**< Number of chunks in the window */
+        uint8_t  count;                 /**< Number of frames following this command */
+} window_write_hdr_t;
+
+/**
+ * \brief Header of a single chunk frame
+ *
+ * Frame is followed by \p len bytes of data and CRC16 (lsb-first) calculated over the frame
+ * header fields following \p soh and the data.
+ *
+ */
+typedef struct {
+        uint8_t  soh;                   /**< Always SOH, used to detect lost synchronization */
+        uint8_t  seq;                   /**< Chunk sequence number, \sa WINDOW_SEQ_COMPRESSED */
+        uint16_t len;                   /**< Chunk data length in bytes (as transmitted) */
+        uint32_t addr;                  /**< Destination address of the chunk */
+} window_frame_hdr_t;
+
+/**
+ * \brief CMD_WINDOW_WRITE response
+ *
+ */
+typedef struct {
+        uint16_t received;              /**< Bitmap of chunks received with correct CRC */
+        uint8_t  done;                  /**< Non-zero if the whole window has been written */
+} window_status_t;
+
+#pragma pack(pop)
+
 #endif /* PROTOCOL_H */
@@ -54,10 +54,6 @@
 #       define CFG_GPIO_BOOTUART_RX_PORT       HW_GPIO_PORT_2
 #       define CFG_GPIO_BOOTUART_RX_PIN        HW_GPIO_PIN_1
 
-/* These two values should always be related */
-#define VERSION         (0x0004) // BCD
-#define VERSION_STR     "0.0.0.4"
-
 #define TMO_COMMAND     (2)
 #define TMO_DATA        (5)
 #define TMO_ACK         (3)
@@ -78,6 +74,9 @@
 
 #define IS_EMPTY_CHECK_SIZE     2048
 
+/* Size of a window slot - chunk data followed by its CRC, word aligned */
+#define WINDOW_SLOT_SIZE(chunk_size)    (((chunk_size) + sizeof(uint16_t) + 3) & ~3)
+
 /* Convert GPIO pad (1 byte) to GPIO port/pin */
 #define GPIO_PAD_TO_PORT(pad)   (((pad) & 0xE0) >> 5)
 #define GPIO_PAD_TO_PIN(pad)    ((pad) & 0x1F)
@@ -120,6 +119,16 @@ uint32_t input_buffer_size;
  *      <= <ACK> / <NAK>
  *
  * If NAK has been sent at some step, next steps shouldn't be performed.
+ *
+ * CMD_WINDOW_WRITE receives chunk frames during HOP_EXEC, right after the host has ACKed the CRC:
+ *
+ * => (frame header) (data...) (crc1) (crc2)    repeated 'count' times
+ * <= <ACK> / <NAK>
+ * <= (len1) (len2)
+ * ...
+ *
+ * Frames with bad CRC are dropped and reported as missing in the response, so that only those are
+ * retransmitted. The window is written to memory once all of its chunks have been received.
  */
 
 /* call type for command handler */
@@ -389,6 +398,27 @@ __PACKED_STRUCT cmdhdr_gpio_wd {
         uint8_t gpio_lvl;               /**< GPIO power source */
 };
 
+/**
+ * \brief Get FLASH digests command's parameters
+ *
+ */
+__PACKED_STRUCT cmdhdr_get_flash_digests {
+        uint8_t mem;                    /**< FLASH memory, \sa PROTOCOL_MEM_QSPI */
+        uint32_t addr;                  /**< Start address in FLASH; zero-based */
+        uint32_t size;                  /**< Size of the range in bytes */
+};
+
+/**
+ * \brief Compressed write command's parameters
+ *
+ */
+__PACKED_STRUCT cmdhdr_write_compressed {
+        uint8_t mem;                    /**< FLASH memory, \sa PROTOCOL_MEM_QSPI */
+        uint8_t read_back_verify;       /**< Verify written data (value other than 0 ) */
+        uint32_t addr;                  /**< FLASH address, zero-based */
+        uint16_t len;                   /**< Length of decompressed data */
+};
+
 /*
  * union of all cmdhdr structures, this is used to create buffer to which command header will be
  * loaded so we can safely use payload buffer to keep data between commands
@@ -419,6 +449,9 @@ union cmdhdr {
         struct cmdhdr_direct_write_oqspi direct_write_oqspi;
         struct cmdhdr_change_baudrate change_baudrate;
         struct cmdhdr_gpio_wd gpio_wd;
+        window_write_hdr_t window_write;
+        struct cmdhdr_get_flash_digests get_flash_digests;
+        struct cmdhdr_write_compressed write_compressed;
 };
 
 /* state of incoming command handler */
@@ -434,6 +467,17 @@ static struct cmd_state {
         uint16_t crc;                           // CRC of transmitted data;
 } cmd_state;
 
+/* state of windowed transfer, kept between commands */
+static struct window_state {
+        uint8_t max;                            // number of chunks granted by CMD_GET_VERSION
+        uint16_t chunk_size;                    // negotiated maximum chunk size
+        uint8_t mem;                            // destination memory of current window
+        uint8_t total;                          // number of chunks in current window
+        uint16_t received;                      // bitmap of chunks received with correct CRC
+        window_frame_hdr_t frame[WINDOW_MAX_CHUNKS]; // headers of frames stored in slots
+        window_status_t status;                 // response for the last CMD_WINDOW_WRITE
+} window;
+
 typedef struct {
         char magic[4];
         volatile uint32_t run_swd;     /* This is set to 1 by debugger to enter SWD mode */
@@ -552,7 +596,7 @@ __STATIC_INLINE void xmit_hello(void)
 {
         static const uint8_t msg[] = {
                         STX, SOH,
-                        (VERSION & 0xFF00) >> 8, VERSION & 0x00FF };
+                        (UARTBOOT_VERSION & 0xFF00) >> 8, UARTBOOT_VERSION & 0x00FF };
 
         hw_uart_send(BOOTUART, msg, sizeof(msg), NULL, NULL);
 }
@@ -1520,16 +1564,47 @@ static bool cmd_read_qspi(HANDLER_OP hop)
         return false;
 }
 
+__STATIC_INLINE uint8_t *window_slot(uint8_t seq)
+{
+        return &__inputbuffer_start + seq * WINDOW_SLOT_SIZE(window.chunk_size);
+}
+
+static void window_negotiate(const window_request_t *req)
+{
+        uint32_t slots;
+
+        memset(&window, 0, sizeof(window));
+
+        if (req->chunk_size == 0) {
+                return;
+        }
+
+        /*
+         * Two last slots are used as read back buffer for verification and as buffer for
+         * decompressed chunk
+         */
+        slots = input_buffer_size / WINDOW_SLOT_SIZE(req->chunk_size);
+        if (slots < 3) {
+                return;
+        }
+
+        window.max = MIN(MIN(req->window, WINDOW_MAX_CHUNKS), slots - 2);
+        window.chunk_size = req->chunk_size;
+}
+
 /* handler for 'get_version on device' */
 static bool cmd_get_version(HANDLER_OP hop)
 {
         /* Send without the last character '\0' */
-        const uint16_t msg_len = sizeof(VERSION_STR) - 1;
+        const uint16_t msg_len = sizeof(UARTBOOT_VERSION_STR) - 1;
+        /* Send with the last character '\0', number of granted chunks and capabilities */
+        const uint16_t window_msg_len = sizeof(UARTBOOT_VERSION_STR) + sizeof(window.max) + 1;
+        static const uint8_t window_caps = WINDOW_CAP_COMPRESSION;
 
         switch (hop) {
         case HOP_INIT:
-                /* no payload is expected */
-                return cmd_state.data_len == 0;
+                /* no payload is expected, unless windowed mode is requested */
+                return cmd_state.data_len == 0 || cmd_state.data_len == sizeof(window_request_t);
 
         case HOP_HEADER:
                 return true;
@@ -1539,17 +1614,29 @@ static bool cmd_get_version(HANDLER_OP hop)
                 return true;
 
         case HOP_EXEC:
-                /* nothing to do */
+                if (cmd_state.data_len) {
+                        window_negotiate(cmd_state.data);
+                }
                 return true;
 
         case HOP_SEND_LEN:
                 /* send length */
-                xmit_data(&msg_len , sizeof(msg_len));
+                if (cmd_state.data_len) {
+                        xmit_data(&window_msg_len, sizeof(window_msg_len));
+                } else {
+                        xmit_data(&msg_len , sizeof(msg_len));
+                }
                 return true;
 
         case HOP_SEND_DATA:
                 /* send data */
-                xmit_data(VERSION_STR, msg_len);
+                if (cmd_state.data_len) {
+                        xmit_data(UARTBOOT_VERSION_STR, sizeof(UARTBOOT_VERSION_STR));
+                        xmit_data(&window.max, sizeof(window.max));
+                        xmit_data(&window_caps, sizeof(window_caps));
+                } else {
+                        xmit_data(UARTBOOT_VERSION_STR, msg_len);
+                }
                 return true;
         }
 
@@ -2164,6 +2251,422 @@ static bool cmd_direct_write_to_oqspi(HANDLER_OP hop)
         return false;
 }
 
+/*
+ * Decompress LZ4 block, returns length of decompressed data or -1 if data is corrupted or doesn't
+ * fit in destination buffer.
+ */
+static int lz_block_decompress(const uint8_t *src, uint32_t src_len, uint8_t *dst,
+                                                                                uint32_t dst_size)
+{
+        uint32_t ip = 0;
+        uint32_t op = 0;
+
+        while (ip < src_len) {
+                const uint8_t token = src[ip++];
+                uint32_t len = token >> 4;
+                uint32_t offset;
+
+                if (len == 0x0F) {
+                        do {
+                                if (ip >= src_len) {
+                                        return -1;
+                                }
+                                len += src[ip];
+                        } while (src[ip++] == 0xFF);
+                }
+
+                if (src_len - ip < len || dst_size - op < len) {
+                        return -1;
+                }
+                memcpy(dst + op, src + ip, len);
+                ip += len;
+                op += len;
+
+                /* last sequence has no match */
+                if (ip == src_len) {
+                        break;
+                }
+
+                if (src_len - ip < 2) {
+                        return -1;
+                }
+                offset = src[ip] | (src[ip + 1] << 8);
+                ip += 2;
+
+                if (offset == 0 || offset > op) {
+                        return -1;
+                }
+
+                len = token & 0x0F;
+                if (len == 0x0F) {
+                        do {
+                                if (ip >= src_len) {
+                                        return -1;
+                                }
+                                len += src[ip];
+                        } while (src[ip++] == 0xFF);
+                }
+                len += 4; // minimal match length
+
+                if (dst_size - op < len) {
+                        return -1;
+                }
+
+                /* byte by byte, match may overlap with data being produced */
+                while (len--) {
+                        dst[op] = dst[op - offset];
+                        op++;
+                }
+        }
+
+        return op;
+}
+
+/* handler for 'write compressed data to FLASH' */
+static bool cmd_write_compressed(HANDLER_OP hop)
+{
+        struct cmdhdr_write_compressed *hdr = &cmd_state.hdr.write_compressed;
+        uint8_t *unpack_buf;
+        uint8_t *read_buffer;
+
+        /* Decompressed data and read back buffer are placed just after payload, word aligned */
+        unpack_buf = (uint8_t *) (((uint32_t) cmd_state.data + cmd_state.data_len + 3) & ~3);
+        read_buffer = unpack_buf + hdr->len;
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len > 0;
+
+        case HOP_HEADER:
+                return true;
+
+        case HOP_DATA:
+                if (hdr->mem != PROTOCOL_MEM_QSPI && hdr->mem != PROTOCOL_MEM_OQSPI) {
+                        return false;
+                }
+
+                return (read_buffer + (hdr->read_back_verify ? hdr->len : 0)) <=
+                                                        (&__inputbuffer_start + input_buffer_size);
+
+        case HOP_EXEC:
+                if (lz_block_decompress(cmd_state.data, cmd_state.data_len, unpack_buf,
+                                                                        hdr->len) != hdr->len) {
+                        return false;
+                }
+
+                if (hdr->mem == PROTOCOL_MEM_QSPI) {
+                        return flash_write(hdr->addr + QSPI_MEM1_VIRTUAL_BASE_ADDR, unpack_buf,
+                                        hdr->len, hdr->read_back_verify ? read_buffer : NULL);
+                }
+
+                return oqspi_write(hdr->addr, unpack_buf, hdr->len,
+                                                hdr->read_back_verify ? read_buffer : NULL);
+
+        case HOP_SEND_LEN:
+        case HOP_SEND_DATA:
+                /* nothing to send back */
+                return false;
+        }
+
+        return false;
+}
+
+/*
+ * Receive single chunk frame of the window, returns false if synchronization was lost.
+ *
+ * CRC is not checked here, host sends frames back-to-back and there is no time for it between
+ * frames. Slots written during current burst are marked in \p burst and checked afterwards.
+ */
+static bool window_recv_frame(uint16_t *burst)
+{
+        window_frame_hdr_t frame;
+        uint8_t seq;
+
+        if (!recv_with_tmo((uint8_t *) &frame, sizeof(frame), TMO_DATA)) {
+                return false;
+        }
+
+        seq = frame.seq & ~WINDOW_SEQ_COMPRESSED;
+
+        if (frame.soh != SOH || seq >= window.total || frame.len == 0 ||
+                                                                frame.len > window.chunk_size) {
+                return false;
+        }
+
+        /* slot contents are about to change, its chunk can't be treated as received anymore */
+        window.received &= ~(1 << seq);
+        window.frame[seq] = frame;
+        *burst |= 1 << seq;
+
+        /* chunk data is followed by its CRC, slot has room for both */
+        return recv_with_tmo(window_slot(seq), frame.len + sizeof(uint16_t),
+                                                1 + frame.len * (UART_INIT.baud_rate / 10));
+}
+
+/* check CRC of frames received in last burst and mark correct ones as received */
+static void window_check_burst(uint16_t burst)
+{
+        uint8_t seq;
+
+        for (seq = 0; seq < window.total; seq++) {
+                const window_frame_hdr_t *frame = &window.frame[seq];
+                const uint8_t *slot = window_slot(seq);
+                uint16_t crc;
+
+                if (!(burst & (1 << seq))) {
+                        continue;
+                }
+
+                crc16_init(&crc);
+                crc16_update(&crc, &frame->seq, sizeof(*frame) - sizeof(frame->soh));
+                crc16_update(&crc, slot, frame->len);
+
+                /* corrupted chunk is not marked as received, host will send it again */
+                if (!memcmp(slot + frame->len, &crc, sizeof(crc))) { // CRC is sent lsb-first
+                        window.received |= 1 << seq;
+                }
+        }
+}
+
+/* write all chunks of the complete window to destination memory */
+static bool window_commit(bool verify)
+{
+        uint8_t *read_buf = verify ? window_slot(window.max) : NULL;
+        uint8_t *unpack_buf = window_slot(window.max + 1);
+        uint8_t seq;
+
+        for (seq = 0; seq < window.total; seq++) {
+                const uint8_t *slot = window_slot(seq);
+                uint32_t addr = window.frame[seq].addr;
+                int len = window.frame[seq].len;
+
+                if (window.frame[seq].seq & WINDOW_SEQ_COMPRESSED) {
+                        len = lz_block_decompress(slot, len, unpack_buf, window.chunk_size);
+                        if (len <= 0) {
+                                return false;
+                        }
+                        slot = unpack_buf;
+                }
+
+                switch (window.mem) {
+                case PROTOCOL_MEM_RAM:
+                        if (!check_ram_addr(addr, len)) {
+                                return false;
+                        }
+
+                        addr = translate_ram_addr(addr);
+
+                        /* chunks are stored in input buffer, they must not be overwritten */
+                        if (is_valid_ptr_in_inputbuffer(addr) ||
+                                                is_valid_ptr_in_inputbuffer(addr + len - 1)) {
+                                return false;
+                        }
+
+                        memcpy((void *) addr, slot, len);
+                        break;
+                case PROTOCOL_MEM_QSPI:
+                        if (!flash_write(addr + QSPI_MEM1_VIRTUAL_BASE_ADDR, slot, len, read_buf)) {
+                                return false;
+                        }
+                        break;
+                case PROTOCOL_MEM_OQSPI:
+                        if (!oqspi_write(addr, slot, len, read_buf)) {
+                                return false;
+                        }
+                        break;
+                default:
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+/* handler for 'write window of chunks' */
+static bool cmd_window_write(HANDLER_OP hop)
+{
+        window_write_hdr_t *hdr = &cmd_state.hdr.window_write;
+        const uint16_t status_len = sizeof(window.status);
+        const uint16_t all_received = (1 << window.total) - 1;
+        uint16_t burst = 0;
+        uint8_t i;
+
+        switch (hop) {
+        case HOP_INIT:
+                /*
+                 * No payload is expected - frames are received in HOP_EXEC. Windowed mode must be
+                 * negotiated first and it is not available over SWD.
+                 */
+                return cmd_state.data_len == 0 && window.max > 0 && !swd_interface.run_swd;
+
+        case HOP_HEADER:
+                return true;
+
+        case HOP_DATA:
+                if (hdr->total == 0 || hdr->total > window.max || hdr->count > hdr->total) {
+                        return false;
+                }
+
+                if (hdr->flags & WINDOW_FLAG_NEW) {
+                        window.mem = hdr->mem;
+                        window.total = hdr->total;
+                        window.received = 0;
+                        return true;
+                }
+
+                /* retransmission must refer to the current window */
+                return window.total == hdr->total && window.mem == hdr->mem;
+
+        case HOP_EXEC:
+                for (i = 0; i < hdr->count; i++) {
+                        if (!window_recv_frame(&burst)) {
+                                /* drop the rest of the burst, missing chunks will be reported */
+                                while (recv_with_tmo(uart_buf, 1, 1)) {
+                                }
+                                break;
+                        }
+                }
+
+                window_check_burst(burst);
+
+                window.status.received = window.received;
+                window.status.done = 0;
+
+                if (window.received != all_received) {
+                        return true;
+                }
+
+                window.status.done = window_commit(hdr->verify);
+
+                /* window is consumed regardless of the result, failed one must be sent again */
+                window.received = 0;
+                window.total = 0;
+
+                return window.status.done;
+
+        case HOP_SEND_LEN:
+                xmit_data(&status_len, sizeof(status_len));
+                return true;
+
+        case HOP_SEND_DATA:
+                xmit_data(&window.status, sizeof(window.status));
+                return true;
+        }
+
+        return false;
+}
+
+/* CRC32 (IEEE 802.3) lookup table for 4-bit chunks, the smallest one which is still fast enough */
+static const uint32_t crc32_tab[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158,
+        0x5005713c, 0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4,
+        0xa00ae278, 0xbdbdf21c,
+};
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *buf, size_t len)
+{
+        while (len--) {
+                crc = crc32_tab[(crc ^ *buf) & 0x0F] ^ (crc >> 4);
+                crc = crc32_tab[(crc ^ (*buf >> 4)) & 0x0F] ^ (crc >> 4);
+                buf++;
+        }
+
+        return crc;
+}
+
+/* calculate CRC32 of FLASH range, it's read to 'array' buffer in pieces */
+static bool flash_crc32(uint32_t flash_addr, uint32_t len, uint32_t *crc)
+{
+        *crc = ~0;
+
+        while (len > 0) {
+                const uint32_t read_len = MIN(len, sizeof(array));
+
+                if (ad_flash_read(flash_addr, array, read_len) != read_len) {
+                        return false;
+                }
+
+                *crc = crc32_update(*crc, array, read_len);
+                flash_addr += read_len;
+                len -= read_len;
+        }
+
+        *crc = ~*crc;
+
+        return true;
+}
+
+/* number of digests returned for FLASH range, each sector touched by the range has its own */
+__STATIC_INLINE uint32_t flash_digests_count(uint32_t addr, uint32_t size)
+{
+        return (addr + size - 1) / FLASH_DIGEST_SECTOR_SIZE - addr / FLASH_DIGEST_SECTOR_SIZE + 1;
+}
+
+/* handler for 'get FLASH digests' */
+static bool cmd_get_flash_digests(HANDLER_OP hop)
+{
+        struct cmdhdr_get_flash_digests *hdr = &cmd_state.hdr.get_flash_digests;
+        uint32_t *digest = cmd_state.data;
+        uint32_t addr;
+        uint32_t end;
+
+        switch (hop) {
+        case HOP_INIT:
+                /* no payload is expected */
+                return cmd_state.data_len == 0;
+
+        case HOP_HEADER:
+                return true;
+
+        case HOP_DATA:
+                if (hdr->mem != PROTOCOL_MEM_QSPI && hdr->mem != PROTOCOL_MEM_OQSPI) {
+                        return false;
+                }
+
+                if (hdr->size == 0 || hdr->addr + hdr->size < hdr->addr) {
+                        return false;
+                }
+
+                /* digests are returned in input buffer, response length is 16-bit */
+                return flash_digests_count(hdr->addr, hdr->size) * sizeof(uint32_t) <=
+                                                        MIN(input_buffer_size, UINT16_MAX);
+
+        case HOP_EXEC:
+                addr = hdr->addr;
+                end = hdr->addr + hdr->size;
+
+                while (addr < end) {
+                        const uint32_t len = MIN(end - addr, FLASH_DIGEST_SECTOR_SIZE -
+                                                        (addr & (FLASH_DIGEST_SECTOR_SIZE - 1)));
+                        uint32_t flash_addr = addr;
+
+                        if (hdr->mem == PROTOCOL_MEM_QSPI) {
+                                flash_addr += QSPI_MEM1_VIRTUAL_BASE_ADDR;
+                        }
+
+                        if (!flash_crc32(flash_addr, len, digest)) {
+                                return false;
+                        }
+
+                        digest++;
+                        addr += len;
+                }
+
+                cmd_state.data_len = (uint8_t *) digest - (uint8_t *) cmd_state.data;
+                return true;
+
+        case HOP_SEND_LEN:
+                xmit_data(&cmd_state.data_len, sizeof(cmd_state.data_len));
+                return true;
+
+        case HOP_SEND_DATA:
+                xmit_data(cmd_state.data, cmd_state.data_len);
+                return true;
+        }
+
+        return false;
+}
+
 /* handler for 'get_product_info on device' */
 static bool cmd_get_product_info(HANDLER_OP hop)
 {
@@ -2228,9 +2731,19 @@ static bool convert_baudrate(uint32_t value, HW_UART_BAUDRATE *baudrate)
         case 500000:
                 *baudrate = HW_UART_BAUDRATE_500000;
                 break;
+        case 921600:
+                *baudrate = HW_UART_BAUDRATE_921600;
+                break;
         case 1000000:
                 *baudrate = HW_UART_BAUDRATE_1000000;
                 break;
+        case 2000000:
+                *baudrate = HW_UART_BAUDRATE_2000000;
+                break;
+        case 3000000:
+                /* uartboot runs from RCHS@96MHz which this rate requires */
+                *baudrate = HW_UART_BAUDRATE_3000000;
+                break;
         default:
                 return false;
         }
@@ -2477,6 +2990,21 @@ static void process_header(void)
                 cmd_state.handler = cmd_get_product_info;
                 break;
 
+        case CMD_WINDOW_WRITE:
+                cmd_state.hdr_len = sizeof(cmd_state.hdr.window_write);
+                cmd_state.handler = cmd_window_write;
+                break;
+
+        case CMD_GET_FLASH_DIGESTS:
+                cmd_state.hdr_len = sizeof(cmd_state.hdr.get_flash_digests);
+                cmd_state.handler = cmd_get_flash_digests;
+                break;
+
+        case CMD_WRITE_COMPRESSED:
+                cmd_state.hdr_len = sizeof(cmd_state.hdr.write_compressed);
+                cmd_state.handler = cmd_write_compressed;
+                break;
+
         case CMD_CHANGE_BAUDRATE:
                 cmd_state.hdr_len = sizeof(cmd_state.hdr.change_baudrate);
                 cmd_state.handler = cmd_change_baudrate;
@@ -2488,6 +3016,15 @@ static void process_header(void)
                 break;
         }
 
+        /*
+         * Any other command may store its payload in input buffer, over slots of partially
+         * received window, so the window can't be completed by retransmission any more.
+         */
+        if (cmd_state.type != CMD_WINDOW_WRITE) {
+                window.total = 0;
+                window.received = 0;
+        }
+
         /* store length of payload (command data excluding command header) */
         cmd_state.data_len = cmd_state.len - cmd_state.hdr_len;
 }
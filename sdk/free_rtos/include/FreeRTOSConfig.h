@@ -216,6 +216,8 @@ to exclude the API function. */
         #undef configUSE_TRACE_FACILITY
         #define configUSE_TRACE_FACILITY                1
     #endif
+
+    #include "task_monitoring_hooks.h"
 #endif /*dg_configENABLE_TASK_MONITORING */
 
 /* ================================ ASSERT config =============================== */
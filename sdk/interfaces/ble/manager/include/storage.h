@@ -38,8 +38,20 @@ enum {
         STORAGE_KEY_SVC_CHANGED_CCC = 0xF0000000,
 };
 
+/*
+ * Number of buckets of hash tables used to find devices by address and app values by key
+ */
+#ifndef STORAGE_DEVICE_HASH_SIZE
+#define STORAGE_DEVICE_HASH_SIZE        (16)
+#endif
+
+#ifndef STORAGE_APP_VALUE_HASH_SIZE
+#define STORAGE_APP_VALUE_HASH_SIZE     (8)
+#endif
+
 typedef struct {
         void     *next;
+        void     *hash_next;
 
         ble_storage_key_t key;
 
@@ -75,6 +87,7 @@ typedef struct {
 
 typedef struct {
         void            *next;
+        void            *hash_next;
 
         bd_address_t    addr;
         uint16_t        conn_idx;
@@ -116,10 +129,15 @@ typedef struct {
 
         // custom values set from application
         queue_t         app_value;
+        app_value_t     *app_value_hash[STORAGE_APP_VALUE_HASH_SIZE];
         queue_t         pending_events;
 
         // disconnection status (disconnection event is pending if other than zero)
         uint8_t         discon_reason;
+
+        // changes not yet written to flash storage
+        bool            keys_dirty:1;
+        bool            apv_dirty:1;
 } device_t;
 
 typedef void (* device_cb_t) (device_t *dev, void *ud);
@@ -142,6 +160,12 @@ void storage_release(void);
 
 void storage_mark_dirty(bool flush_now);
 
+/*
+ * Mark pairing data (keys, address or security flags) of device as changed. Only devices marked
+ * this way, devices with changed app values and removed devices are written on next flush.
+ */
+void storage_mark_device_dirty(device_t *dev, bool flush_now);
+
 void device_foreach(device_cb_t cb, void *ud);
 
 void device_move_front(device_t *dev);
@@ -150,6 +174,16 @@ void device_remove(device_t *dev);
 
 void device_remove_pairing(device_t *dev);
 
+/*
+ * Connection state and address of device must be changed using these functions, since devices
+ * are looked up by connection index and address using tables updated by them.
+ */
+void device_set_connected(device_t *dev, uint16_t conn_idx);
+
+void device_set_disconnected(device_t *dev);
+
+void device_set_addr(device_t *dev, const bd_address_t *addr);
+
 void app_value_put(device_t *dev, ble_storage_key_t key, uint16_t length, void *ptr,
                                                 ble_storage_free_cb_t free_cb, bool persistent);
 
@@ -159,6 +193,8 @@ void app_value_remove(device_t *dev, ble_storage_key_t key);
 
 void app_value_remove_np(device_t *dev);
 
+void app_value_remove_all(device_t *dev);
+
 void pending_events_put_handle(device_t *dev, uint16_t handle);
 
 void pending_events_remove_handle(device_t *dev, uint16_t handle);
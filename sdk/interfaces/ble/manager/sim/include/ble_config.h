@@ -0,0 +1,33 @@
+/**
+ ****************************************************************************************
+ *
+ * @file ble_config.h
+ *
+ * @brief Host replacement of BLE configuration, for BLE storage built on host
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef BLE_CONFIG_H_
+#define BLE_CONFIG_H_
+
+#define CONFIG_BLE_STORAGE
+
+#ifndef dg_configBLE_SECURE_CONNECTIONS
+#define dg_configBLE_SECURE_CONNECTIONS         (1)
+#endif
+
+/* Same defaults as BLE configuration of DA1470x */
+#ifndef defaultBLE_MAX_CONNECTIONS
+#define defaultBLE_MAX_CONNECTIONS              (8)
+#endif
+
+#ifndef defaultBLE_MAX_BONDED
+#define defaultBLE_MAX_BONDED                   (8)
+#endif
+
+#endif /* BLE_CONFIG_H_ */
@@ -0,0 +1,32 @@
+/**
+ ****************************************************************************************
+ *
+ * @file ble_gap.h
+ *
+ * @brief Host replacement of BLE GAP API, only definitions used by BLE storage
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef BLE_GAP_H_
+#define BLE_GAP_H_
+
+#include "ble_common.h"
+#include "ble_config.h"
+
+/** Invalid connection index */
+#define BLE_CONN_IDX_INVALID    (0xFFFF)
+
+/** GAP security levels */
+typedef enum {
+        GAP_SEC_LEVEL_1         = 0x00, ///< No security
+        GAP_SEC_LEVEL_2         = 0x01, ///< Unauthenticated pairing with encryption
+        GAP_SEC_LEVEL_3         = 0x02, ///< Authenticated pairing with encryption
+        GAP_SEC_LEVEL_4         = 0x03, ///< Authenticated LE Secure Connections pairing
+} gap_sec_level_t;
+
+#endif /* BLE_GAP_H_ */
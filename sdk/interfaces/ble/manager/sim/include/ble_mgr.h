@@ -0,0 +1,32 @@
+/**
+ ****************************************************************************************
+ *
+ * @file ble_mgr.h
+ *
+ * @brief Host replacement of BLE manager API used by BLE storage
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef BLE_MGR_H_
+#define BLE_MGR_H_
+
+#include <stdbool.h>
+#include "ble_config.h"
+
+/* Storage is used from one thread only, which acts as BLE manager task */
+static inline bool ble_mgr_is_own_task(void)
+{
+        return true;
+}
+
+/* Not called, since ble_mgr_is_own_task() is always true */
+static inline void ble_mgr_notify_commit_storage(void)
+{
+}
+
+#endif /* BLE_MGR_H_ */
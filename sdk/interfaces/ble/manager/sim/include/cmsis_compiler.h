@@ -0,0 +1,21 @@
+/**
+ ****************************************************************************************
+ *
+ * @file cmsis_compiler.h
+ *
+ * @brief Host replacement of CMSIS compiler definitions, needed by ble_common.h
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef CMSIS_COMPILER_H_
+#define CMSIS_COMPILER_H_
+
+/* __STATIC_INLINE and friends come from sdk_defs.h of flash adapter simulator */
+#include "sdk_defs.h"
+
+#endif /* CMSIS_COMPILER_H_ */
@@ -0,0 +1,190 @@
+/**
+ ****************************************************************************************
+ *
+ * @file storage_bench.c
+ *
+ * @brief Host microbenchmark of BLE storage lookups
+ *
+ * Storage is filled up to its limits: defaultBLE_MAX_BONDED bonded devices and
+ * defaultBLE_MAX_CONNECTIONS more devices which are connected but not bonded, each of them with
+ * given number of app values. Then lookups done by BLE manager for nearly every GAP and GATT
+ * event are timed: device by address (existing and unknown one), device by connection index,
+ * app value get and app value put which replaces existing value. Results of lookups are checked
+ * before timing.
+ *
+ * Storage runs on flash adapter simulator, headers in sim/include replace BLE manager and
+ * configuration ones. Storage keeps integer app values in pointers, which is lossless but warned
+ * about on 64-bit host. Build and run from top of SDK:
+ *
+ *     gcc -Wall -O2 -Wno-int-to-pointer-cast -Wno-pointer-to-int-cast -include sdk_defs.h \
+ *             -Isdk/interfaces/ble/manager/sim/include \
+ *             -Isdk/middleware/adapters/sim/include -Isdk/middleware/adapters/sim \
+ *             -Isdk/interfaces/ble/manager/include -Isdk/interfaces/ble/api/include \
+ *             -Isdk/middleware/adapters/include -Isdk/bsp/util/include -Isdk/bsp/config \
+ *             sdk/middleware/adapters/sim/ad_flash_sim.c sdk/middleware/adapters/src/ad_nvms.c \
+ *             sdk/middleware/adapters/src/ad_nvms_direct.c \
+ *             sdk/middleware/adapters/src/ad_nvms_ves.c sdk/bsp/util/src/sdk_crc16.c \
+ *             sdk/bsp/util/src/sdk_queue.c sdk/interfaces/ble/manager/src/storage.c \
+ *             sdk/interfaces/ble/manager/src/storage_flash.c \
+ *             sdk/interfaces/ble/manager/sim/storage_bench.c -o storage_bench
+ *     ./storage_bench [operations [app values per device]]
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ad_nvms.h"
+#include "storage.h"
+
+#define DEVICES                 (defaultBLE_MAX_BONDED + defaultBLE_MAX_CONNECTIONS)
+/* App values of applications are usually in vendor range, e.g. CCC descriptors of services */
+#define APP_VALUE_KEY(i)        (0x10000000 | (0x20 + (i) * 3))
+
+static device_t *devices[DEVICES];
+static bd_address_t addrs[DEVICES];
+static volatile uintptr_t sink;
+
+static double now_ns(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void report(const char *name, uint32_t ops, double start)
+{
+        printf("%-28s %8.1f ns\n", name, (now_ns() - start) / ops);
+}
+
+static void fill(uint32_t app_values)
+{
+        uint32_t i, j;
+
+        for (i = 0; i < DEVICES; i++) {
+                addrs[i].addr_type = i & 1 ? PRIVATE_ADDRESS : PUBLIC_ADDRESS;
+                for (j = 0; j < sizeof(addrs[i].addr); j++) {
+                        addrs[i].addr[j] = 0x10 * i + j * 7;
+                }
+                devices[i] = find_device_by_addr(&addrs[i], true);
+                devices[i]->bonded = i < defaultBLE_MAX_BONDED;
+                if (i >= defaultBLE_MAX_BONDED) {
+                        device_set_connected(devices[i], i - defaultBLE_MAX_BONDED);
+                }
+                for (j = 0; j < app_values; j++) {
+                        app_value_put(devices[i], APP_VALUE_KEY(j), 0, (void *) (uintptr_t) j,
+                                                                                NULL, j & 1);
+                }
+        }
+}
+
+static bool check(uint32_t app_values)
+{
+        bd_address_t unknown = addrs[0];
+        uint16_t length;
+        void *ptr;
+        uint32_t i, j;
+
+        for (i = 0; i < DEVICES; i++) {
+                if (find_device_by_addr(&addrs[i], false) != devices[i]) {
+                        printf("FAIL: device %u not found by address\n", i);
+                        return false;
+                }
+                if (i >= defaultBLE_MAX_BONDED &&
+                                find_device_by_conn_idx(i - defaultBLE_MAX_BONDED) != devices[i]) {
+                        printf("FAIL: device %u not found by connection index\n", i);
+                        return false;
+                }
+                for (j = 0; j < app_values; j++) {
+                        if (!app_value_get(devices[i], APP_VALUE_KEY(j), &length, &ptr) ||
+                                                                (uintptr_t) ptr != j) {
+                                printf("FAIL: app value %u of device %u not found\n", j, i);
+                                return false;
+                        }
+                }
+        }
+
+        unknown.addr[5] ^= 0xFF;
+        if (find_device_by_addr(&unknown, false) != NULL) {
+                printf("FAIL: unknown device found\n");
+                return false;
+        }
+
+        return true;
+}
+
+int main(int argc, char **argv)
+{
+        const uint32_t ops = argc > 1 ? strtoul(argv[1], NULL, 0) : 2000000;
+        const uint32_t app_values = argc > 2 ? strtoul(argv[2], NULL, 0) : 32;
+        bd_address_t unknown;
+        uint16_t length;
+        void *ptr;
+        double start;
+        uint32_t i;
+
+        if (ops == 0 || app_values == 0) {
+                printf("usage: %s [operations [app values per device]]\n", argv[0]);
+                return 1;
+        }
+
+        ad_nvms_init();
+        storage_init();
+        storage_acquire();
+
+        fill(app_values);
+        if (!check(app_values)) {
+                return 1;
+        }
+
+        printf("%d bonded and %d connected devices, %u app values each\n", defaultBLE_MAX_BONDED,
+                                                        defaultBLE_MAX_CONNECTIONS, app_values);
+
+        start = now_ns();
+        for (i = 0; i < ops; i++) {
+                sink += (uintptr_t) find_device_by_addr(&addrs[i % DEVICES], false);
+        }
+        report("find_device_by_addr", ops, start);
+
+        unknown = addrs[0];
+        unknown.addr[5] ^= 0xFF;
+        start = now_ns();
+        for (i = 0; i < ops; i++) {
+                unknown.addr[0] = i;
+                sink += (uintptr_t) find_device_by_addr(&unknown, false);
+        }
+        report("find_device_by_addr (miss)", ops, start);
+
+        start = now_ns();
+        for (i = 0; i < ops; i++) {
+                sink += (uintptr_t) find_device_by_conn_idx(i % defaultBLE_MAX_CONNECTIONS);
+        }
+        report("find_device_by_conn_idx", ops, start);
+
+        start = now_ns();
+        for (i = 0; i < ops; i++) {
+                app_value_get(devices[i % DEVICES], APP_VALUE_KEY(i % app_values), &length, &ptr);
+                sink += (uintptr_t) ptr;
+        }
+        report("app_value_get", ops, start);
+
+        start = now_ns();
+        for (i = 0; i < ops; i++) {
+                app_value_put(devices[i % DEVICES], APP_VALUE_KEY(i % app_values), 0,
+                                                        (void *) (uintptr_t) i, NULL, false);
+        }
+        report("app_value_put (replace)", ops, start);
+
+        /* app values were replaced by non-persistent ones, nothing to flush */
+        storage_release();
+
+        return 0;
+}
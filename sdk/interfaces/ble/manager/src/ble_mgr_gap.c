@@ -256,8 +256,7 @@ static void ble_mgr_gap_conn_cleanup(uint16_t conn_idx, uint8_t reason)
                  * connected; otherwise remove device from storage
                  */
                 if (dev->bonded) {
-                        dev->connected = false;
-                        dev->conn_idx = BLE_CONN_IDX_INVALID;
+                        device_set_disconnected(dev);
                         dev->encrypted = false;
                         dev->updating = false;
                         dev->sec_level = GAP_SEC_LEVEL_1;
@@ -458,9 +457,8 @@ void ble_mgr_gap_addr_solved_evt_handler(ble_gtl_msg_t *gtl)
                         goto done;
                 }
 
-                dev->conn_idx = temp_dev->conn_idx;
+                device_set_connected(dev, temp_dev->conn_idx);
                 dev->master = temp_dev->master;
-                dev->connected = true;
                 dev->discon_reason = temp_dev->discon_reason;
 
                 device_remove(temp_dev);
@@ -669,8 +667,7 @@ void ble_mgr_gap_connected_evt_handler(ble_gtl_msg_t *gtl)
                 OS_FREE(evt);
                 goto done;
         }
-        dev->conn_idx = evt->conn_idx;
-        dev->connected = true;
+        device_set_connected(dev, evt->conn_idx);
         dev->mtu = ATT_DEFAULT_MTU;
 #if (dg_configBLE_2MBIT_PHY == 1)
         dev->tx_phy = BLE_GAP_PHY_1M;
@@ -2666,6 +2663,7 @@ void ble_mgr_gap_bond_req_evt_handler(ble_gtl_msg_t *gtl)
                         dev = find_device_by_conn_idx(TASK_2_CONNIDX(gtl->src_id));
                         if (dev) {
                                 dev->secure = true;
+                                storage_mark_device_dirty(dev, false);
                         }
                         storage_release();
                 }
@@ -2717,7 +2715,7 @@ void ble_mgr_gap_bond_req_evt_handler(ble_gtl_msg_t *gtl)
 
 
                         /* Storage will be written back to flash on pairing complete */
-                        storage_mark_dirty(false);
+                        storage_mark_device_dirty(dev, false);
                 }
                 storage_release();
 
@@ -2756,7 +2754,7 @@ void ble_mgr_gap_bond_req_evt_handler(ble_gtl_msg_t *gtl)
 
 
                         /* Storage will be written back to flash on pairing complete */
-                        storage_mark_dirty(false);
+                        storage_mark_device_dirty(dev, false);
                 }
                 storage_release();
 
@@ -3020,10 +3018,10 @@ void ble_mgr_gap_bond_ind_evt_handler(ble_gtl_msg_t *gtl)
                         }
                         ble_mgr_dev_params_release();
 #endif /* (dg_configBLE_PRIVACY_1_2 == 1) */
-                }
 
-                /* Write storage back to flash immediately */
-                storage_mark_dirty(true);
+                        /* Write storage back to flash immediately */
+                        storage_mark_device_dirty(dev, true);
+                }
 
                 storage_release();
 
@@ -3042,10 +3040,10 @@ void ble_mgr_gap_bond_ind_evt_handler(ble_gtl_msg_t *gtl)
                 if (dev) {
                         /* Reset secure flag */
                         dev->secure = false;
-                }
 
-                /* Write storage back to flash immediately */
-                storage_mark_dirty(true);
+                        /* Write storage back to flash immediately */
+                        storage_mark_device_dirty(dev, true);
+                }
 
                 storage_release();
 #endif /* (dg_configBLE_SECURE_CONNECTIONS == 1) */
@@ -3095,7 +3093,7 @@ void ble_mgr_gap_bond_ind_evt_handler(ble_gtl_msg_t *gtl)
 
 
                         /* Storage will be written back to flash on pairing complete */
-                        storage_mark_dirty(false);
+                        storage_mark_device_dirty(dev, false);
                 }
                 storage_release();
                 break;
@@ -3115,7 +3113,7 @@ void ble_mgr_gap_bond_ind_evt_handler(ble_gtl_msg_t *gtl)
 
 
                         /* Storage will be written back to flash on pairing complete */
-                        storage_mark_dirty(false);
+                        storage_mark_device_dirty(dev, false);
                 }
                 storage_release();
                 break;
@@ -3149,8 +3147,7 @@ void ble_mgr_gap_bond_ind_evt_handler(ble_gtl_msg_t *gtl)
                         memcpy(irk->key, ind->data.irk.irk.key, sizeof(irk->key));
 
                         memcpy(&evt->address, &dev->addr, sizeof(evt->address));
-                        dev->addr.addr_type = ind->data.irk.addr.addr_type;
-                        memcpy(&dev->addr, &addr, sizeof(dev->addr));
+                        device_set_addr(dev, &addr);
                         memcpy(&evt->resolved_address, &dev->addr, sizeof(evt->resolved_address));
                         evt->conn_idx = TASK_2_CONNIDX(gtl->src_id);
 
@@ -3158,7 +3155,7 @@ void ble_mgr_gap_bond_ind_evt_handler(ble_gtl_msg_t *gtl)
                         ble_mgr_event_queue_send(&evt, OS_QUEUE_FOREVER);
 
                         /* Storage will be written back to flash on pairing complete */
-                        storage_mark_dirty(false);
+                        storage_mark_device_dirty(dev, false);
                 }
                 storage_release();
                 break;
@@ -3307,6 +3304,9 @@ void ble_mgr_gap_sign_counter_ind_evt_handler(ble_gtl_msg_t *gtl)
 
                 dev->csrk->sign_cnt = ind->local_sign_counter;
                 dev->remote_csrk->sign_cnt = ind->peer_sign_counter;
+
+                /* Counters are written to flash with next storage flush */
+                storage_mark_device_dirty(dev, false);
         }
         storage_release();
 }
@@ -30,10 +30,60 @@ __RETAINED static uint8_t state;
 
 __RETAINED static queue_t device_list;
 
-static void app_value_destroy(void *elem)
+/* Devices hashed by address, chained with hash_next */
+__RETAINED static device_t *device_hash[STORAGE_DEVICE_HASH_SIZE];
+
+/* Connected devices indexed by conn_idx */
+__RETAINED static device_t *conn_devices[defaultBLE_MAX_CONNECTIONS];
+
+static uint32_t addr_hash(const bd_address_t *addr)
 {
-        app_value_t *appval = elem;
+        uint32_t hash = addr->addr_type;
+        int i;
+
+        for (i = 0; i < sizeof(addr->addr); i++) {
+                hash = hash * 31 + addr->addr[i];
+        }
+
+        return hash % STORAGE_DEVICE_HASH_SIZE;
+}
+
+static uint32_t key_hash(ble_storage_key_t key)
+{
+        return (key ^ (key >> 8) ^ (key >> 16) ^ (key >> 24)) % STORAGE_APP_VALUE_HASH_SIZE;
+}
+
+static void device_hash_add(device_t *dev)
+{
+        device_t **bucket = &device_hash[addr_hash(&dev->addr)];
+
+        dev->hash_next = *bucket;
+        *bucket = dev;
+}
+
+static void device_hash_remove(device_t *dev)
+{
+        device_t **pdev = &device_hash[addr_hash(&dev->addr)];
+
+        while (*pdev) {
+                if (*pdev == dev) {
+                        *pdev = dev->hash_next;
+                        return;
+                }
+
+                pdev = (device_t **) &(*pdev)->hash_next;
+        }
+}
+
+static void device_conn_remove(device_t *dev)
+{
+        if (dev->conn_idx < defaultBLE_MAX_CONNECTIONS && conn_devices[dev->conn_idx] == dev) {
+                conn_devices[dev->conn_idx] = NULL;
+        }
+}
 
+static void app_value_free_data(app_value_t *appval)
+{
         /*
          * length is non-zero in case there's actual pointer stored in ptr which should be
          * freed when removing appval. otherwise ptr keeps scalar value and should not be
@@ -46,29 +96,20 @@ static void app_value_destroy(void *elem)
                         OS_FREE(appval->ptr);
                 }
         }
-
-        OS_FREE(appval);
 }
 
-static bool device_match(const void *elem, const void *ud)
+static void app_value_destroy(void *elem)
 {
-        return elem == ud;
-}
+        app_value_t *appval = elem;
 
-static bool device_addr_match(const void *elem, const void *ud)
-{
-        const device_t *dev = elem;
-        const bd_address_t *addr = ud;
+        app_value_free_data(appval);
 
-        return !memcmp(&dev->addr, addr, sizeof(*addr));
+        OS_FREE(appval);
 }
 
-static bool device_conn_idx_match(const void *elem, const void *ud)
+static bool device_match(const void *elem, const void *ud)
 {
-        const device_t *dev = elem;
-
-        // matching by conn_idx makes sense only when device is connected
-        return dev->connected && (dev->conn_idx == (uint32_t) ud);
+        return elem == ud;
 }
 
 struct device_find_data {
@@ -99,6 +140,11 @@ static bool app_value_match_free_np(const void *elem, const void *ud)
         return !appval->persistent;
 }
 
+static app_value_t **app_value_bucket(device_t *dev, ble_storage_key_t key)
+{
+        return &dev->app_value_hash[key_hash(key)];
+}
+
 static void device_free_pairing(device_t *dev)
 {
         if (dev->ltk) {
@@ -137,6 +183,8 @@ static void device_free(device_t *dev)
 void storage_init(void)
 {
         queue_init(&device_list);
+        memset(device_hash, 0, sizeof(device_hash));
+        memset(conn_devices, 0, sizeof(conn_devices));
 
         if (!lock) {
                 (void)OS_MUTEX_CREATE(lock);
@@ -146,6 +194,9 @@ void storage_init(void)
 
         storage_flash_init();
         storage_flash_load();
+
+        /* Data was just loaded from flash, nothing needs to be written back */
+        state = STATE_CLEAN;
 }
 
 static void device_cleanup(void *data)
@@ -163,6 +214,8 @@ void storage_cleanup(void)
         storage_flash_save();
 
         queue_remove_all(&device_list, device_cleanup);
+        memset(device_hash, 0, sizeof(device_hash));
+        memset(conn_devices, 0, sizeof(conn_devices));
 }
 
 void storage_acquire(void)
@@ -199,11 +252,23 @@ void storage_mark_dirty(bool flush_now)
         }
 }
 
+void storage_mark_device_dirty(device_t *dev, bool flush_now)
+{
+        dev->keys_dirty = true;
+
+        storage_mark_dirty(flush_now);
+}
+
 device_t *find_device_by_addr(const bd_address_t *addr, bool create)
 {
+        device_t **bucket = &device_hash[addr_hash(addr)];
         device_t *dev;
 
-        dev = queue_find(&device_list, device_addr_match, addr);
+        for (dev = *bucket; dev; dev = dev->hash_next) {
+                if (!memcmp(&dev->addr, addr, sizeof(*addr))) {
+                        break;
+                }
+        }
 
         if (!dev && create) {
                 dev = OS_MALLOC(sizeof(*dev));
@@ -220,6 +285,9 @@ device_t *find_device_by_addr(const bd_address_t *addr, bool create)
                 dev->mtu = 23;
 
                 queue_push_back(&device_list, dev);
+
+                dev->hash_next = *bucket;
+                *bucket = dev;
         }
 
         return dev;
@@ -227,7 +295,40 @@ device_t *find_device_by_addr(const bd_address_t *addr, bool create)
 
 device_t *find_device_by_conn_idx(uint16_t conn_idx)
 {
-        return queue_find(&device_list, device_conn_idx_match, (void *) (uint32_t) conn_idx);
+        if (conn_idx >= defaultBLE_MAX_CONNECTIONS) {
+                return NULL;
+        }
+
+        return conn_devices[conn_idx];
+}
+
+void device_set_connected(device_t *dev, uint16_t conn_idx)
+{
+        OS_ASSERT(conn_idx < defaultBLE_MAX_CONNECTIONS);
+
+        device_conn_remove(dev);
+
+        dev->conn_idx = conn_idx;
+        dev->connected = true;
+
+        if (conn_idx < defaultBLE_MAX_CONNECTIONS) {
+                conn_devices[conn_idx] = dev;
+        }
+}
+
+void device_set_disconnected(device_t *dev)
+{
+        device_conn_remove(dev);
+
+        dev->connected = false;
+        dev->conn_idx = BLE_CONN_IDX_INVALID;
+}
+
+void device_set_addr(device_t *dev, const bd_address_t *addr)
+{
+        device_hash_remove(dev);
+        memcpy(&dev->addr, addr, sizeof(*addr));
+        device_hash_add(dev);
 }
 
 device_t *find_device(device_match_cb_t cb, void *ud)
@@ -242,9 +343,14 @@ device_t *find_device(device_match_cb_t cb, void *ud)
 
 static app_value_t *find_app_value(device_t *dev, ble_storage_key_t key, bool create)
 {
+        app_value_t **bucket = app_value_bucket(dev, key);
         app_value_t *appval;
 
-        appval = queue_find(&dev->app_value, app_value_match, (void *) (uint32_t) key);
+        for (appval = *bucket; appval; appval = appval->hash_next) {
+                if (appval->key == key) {
+                        break;
+                }
+        }
 
         if (!appval && create) {
                 appval = OS_MALLOC(sizeof(*appval));
@@ -253,6 +359,9 @@ static app_value_t *find_app_value(device_t *dev, ble_storage_key_t key, bool cr
                 appval->key = key;
 
                 queue_push_back(&dev->app_value, appval);
+
+                appval->hash_next = *bucket;
+                *bucket = appval;
         }
 
         return appval;
@@ -298,6 +407,9 @@ void device_remove(device_t *dev)
                 return; // should not happen! ;)
         }
 
+        device_hash_remove(dev);
+        device_conn_remove(dev);
+
         queue_remove_all(&dev->app_value, app_value_destroy);
         pending_events_clear_handles(dev);
 
@@ -314,7 +426,7 @@ void device_remove_pairing(device_t *dev)
 
         device_free_pairing(dev);
 
-        storage_mark_dirty(true);
+        storage_mark_device_dirty(dev, true);
 }
 
 void app_value_put(device_t *dev, ble_storage_key_t key, uint16_t length, void *ptr,
@@ -322,14 +434,20 @@ void app_value_put(device_t *dev, ble_storage_key_t key, uint16_t length, void *
 {
         app_value_t *appval;
 
-        app_value_remove(dev, key);
+        /* Existing value is replaced in place, so it doesn't have to be unlinked */
+        appval = find_app_value(dev, key, false);
+        if (appval) {
+                app_value_free_data(appval);
+        } else {
+                appval = find_app_value(dev, key, true);
+        }
 
-        appval = find_app_value(dev, key, true);
         appval->persistent = persistent;
         appval->length = length;
         appval->ptr = ptr;
         appval->free_cb = free_cb;
 
+        dev->apv_dirty = true;
         storage_mark_dirty(true);
 }
 
@@ -351,17 +469,57 @@ bool app_value_get(device_t *dev, ble_storage_key_t key, uint16_t *length, void
 
 void app_value_remove(device_t *dev, ble_storage_key_t key)
 {
+        app_value_t **pappval = app_value_bucket(dev, key);
         app_value_t *appval;
 
+        while (*pappval && (*pappval)->key != key) {
+                pappval = (app_value_t **) &(*pappval)->hash_next;
+        }
+
+        if (!*pappval) {
+                return;
+        }
+
+        *pappval = (*pappval)->hash_next;
+
         appval = queue_remove(&dev->app_value, app_value_match, (void *) (uint32_t) key);
         if (appval) {
                 app_value_destroy(appval);
+                dev->apv_dirty = true;
         }
 }
 
 void app_value_remove_np(device_t *dev)
 {
+        bool found = false;
+        int i;
+
+        for (i = 0; i < STORAGE_APP_VALUE_HASH_SIZE; i++) {
+                app_value_t **pappval = &dev->app_value_hash[i];
+
+                while (*pappval) {
+                        if ((*pappval)->persistent) {
+                                pappval = (app_value_t **) &(*pappval)->hash_next;
+                        } else {
+                                *pappval = (*pappval)->hash_next;
+                                found = true;
+                        }
+                }
+        }
+
+        if (!found) {
+                return;
+        }
+
         queue_filter(&dev->app_value, app_value_match_free_np, NULL, app_value_destroy);
+        dev->apv_dirty = true;
+}
+
+void app_value_remove_all(device_t *dev)
+{
+        queue_remove_all(&dev->app_value, app_value_destroy);
+        memset(dev->app_value_hash, 0, sizeof(dev->app_value_hash));
+        dev->apv_dirty = true;
 }
 
 static bool pending_events_match_elem(const void *elem, const void *handle)
@@ -18,6 +18,7 @@
 #include "storage.h"
 #include "storage_flash.h"
 #include "ad_nvms.h"
+#include "sdk_crc16.h"
 
 #ifdef CONFIG_BLE_STORAGE
 
@@ -45,9 +46,38 @@
 #define CONFIG_BLE_STORAGE_APV_PART_LENGTH (1024)
 #endif
 
+/*
+ * Journal of changes made since keys and app values areas were last written. Each flush appends
+ * records of changed devices only, areas are rewritten when journal is full.
+ *
+ * Journal is disabled by default since it takes CONFIG_BLE_STORAGE_JOURNAL_PART_LENGTH bytes at
+ * CONFIG_BLE_STORAGE_JOURNAL_PART_OFFSET of generic partition (0x900-0xCFF by default), right
+ * after app values area, which application may use for its own data. When it is enabled:
+ * - this range must not be used by anything else and generic partition must cover it, otherwise
+ *   journal is not used and areas are rewritten on each flush as without it
+ * - data stored by firmware without journal is loaded as before, first flush starts journal
+ * - changes made since areas were last rewritten are kept only in journal, they are lost if
+ *   journal is disabled again
+ */
+#ifndef CONFIG_BLE_STORAGE_JOURNAL
+#define CONFIG_BLE_STORAGE_JOURNAL (0)
+#endif
+
+#ifndef CONFIG_BLE_STORAGE_JOURNAL_PART_OFFSET
+#define CONFIG_BLE_STORAGE_JOURNAL_PART_OFFSET (0x900)
+#endif
+
+#ifndef CONFIG_BLE_STORAGE_JOURNAL_PART_LENGTH
+#define CONFIG_BLE_STORAGE_JOURNAL_PART_LENGTH (1024)
+#endif
+
 #define PART_KEY_DATA_OFFSET        (CONFIG_BLE_STORAGE_KEY_PART_OFFSET)
 #define PART_APV_DATA_OFFSET        (CONFIG_BLE_STORAGE_APV_PART_OFFSET)
 #define PART_APV_DATA_LENGTH        (CONFIG_BLE_STORAGE_APV_PART_LENGTH)
+#define PART_JNL_DATA_OFFSET        (CONFIG_BLE_STORAGE_JOURNAL_PART_OFFSET)
+#define PART_JNL_DATA_LENGTH        (CONFIG_BLE_STORAGE_JOURNAL_PART_LENGTH)
+#define PART_JNL_RECORDS_OFFSET     (PART_JNL_DATA_OFFSET + sizeof(STORAGE_MAGIC_JNL) + \
+                                                                        sizeof(uint16_t))
 
 #define PART_KEY_LENGTH             (sizeof(STORAGE_MAGIC_KEY) + sizeof(uint8_t) + \
                                      sizeof(stored_device_t) * defaultBLE_MAX_BONDED)
@@ -63,6 +93,9 @@
  */
 static const uint8_t STORAGE_MAGIC_KEY[8] = { 'B', 'L', 'E', '_', 'K', 'E', 'Y', 0x01 };
 static const uint8_t STORAGE_MAGIC_APV[8] = { 'B', 'L', 'E', '_', 'A', 'P', 'V', 0x01 };
+#if CONFIG_BLE_STORAGE_JOURNAL
+static const uint8_t STORAGE_MAGIC_JNL[8] = { 'B', 'L', 'E', '_', 'J', 'N', 'L', 0x01 };
+#endif
 
 enum {
         DEV_FLAG_FREE                   = 0x0001,
@@ -105,8 +138,43 @@ typedef struct {
         key_csrk_t      remote_csrk;
 } stored_device_t;
 
+#if CONFIG_BLE_STORAGE_JOURNAL
+enum {
+        JNL_TYPE_DEVICE         = 1,    // stored_device_t, replaces pairing data of device
+        JNL_TYPE_REMOVE         = 2,    // bd_address_t of device removed from storage
+        JNL_TYPE_APV            = 3,    // bd_address_t followed by all app values of device
+        JNL_TYPE_ORDER          = 4,    // bd_address_t of all stored devices in list order
+};
+
+enum {
+        JNL_FLAG_COMMIT         = 0x01, // last record written by save
+};
+
+/*
+ * Journal record header, followed by 'length' bytes of payload. Journal header holds generation
+ * which is incremented each time areas are rewritten, records of older generation which are still
+ * on flash are not valid. Records written by one save are applied only if all of them are valid.
+ */
+typedef struct {
+        uint16_t        crc;    // CRC of remaining header fields and payload
+        uint16_t        gen;
+        uint8_t         type;
+        uint8_t         flags;
+        uint16_t        length;
+} jnl_record_t;
+#endif /* CONFIG_BLE_STORAGE_JOURNAL */
+
 __RETAINED static nvms_t part;     // partition handle
 
+#if CONFIG_BLE_STORAGE_JOURNAL
+__RETAINED static uint16_t jnl_gen;        // current journal generation
+__RETAINED static uint32_t jnl_addr;       // offset of next record, 0 if journal is not valid
+
+/* Addresses of devices which are stored on flash (in areas or in journal), in list order */
+__RETAINED static bd_address_t stored_addr[defaultBLE_MAX_BONDED];
+__RETAINED static uint8_t stored_count;
+#endif /* CONFIG_BLE_STORAGE_JOURNAL */
+
 /* Calculates partition offset for device at index */
 __STATIC_INLINE uint32_t get_addr(uint32_t index)
 {
@@ -525,6 +593,580 @@ static void save_part_apv(void)
         apv_type = APV_TYPE_EMPTY;
         ad_nvms_write(part, addr, &apv_type, sizeof(apv_type));
 }
+
+static void clear_dirty_func(device_t *dev, void *ud)
+{
+        dev->keys_dirty = false;
+        dev->apv_dirty = false;
+}
+
+#if CONFIG_BLE_STORAGE_JOURNAL
+/* Records written by single save, they are written to flash at once */
+struct jnl_batch {
+        uint8_t         *buf;
+        uint16_t        size;
+        uint16_t        len;
+        uint16_t        last;   // offset of last record
+};
+
+/* Helper to copy data to buffer and advance pointer */
+__STATIC_INLINE uint8_t *buf_put_inc(uint8_t *pos, const void *ptr, size_t length)
+{
+        memcpy(pos, ptr, length);
+
+        return pos + length;
+}
+
+static uint16_t jnl_record_crc(const jnl_record_t *rec, const uint8_t *payload)
+{
+        uint16_t crc;
+
+        crc16_init(&crc);
+        crc16_update(&crc, (const uint8_t *) &rec->gen, sizeof(*rec) - sizeof(rec->crc));
+        crc16_update(&crc, payload, rec->length);
+
+        return crc;
+}
+
+static void replay_apv(device_t *dev, const uint8_t *buf, size_t length)
+{
+        const uint8_t *end = buf + length;
+
+        app_value_remove_all(dev);
+
+        while (buf < end) {
+                uint8_t apv_type = *buf++;
+                ble_storage_key_t key;
+
+                switch (apv_type) {
+                case APV_TYPE_INTEGER:
+                {
+                        uint32_t val;
+
+                        if (end - buf < (int) (sizeof(key) + sizeof(val))) {
+                                return;
+                        }
+
+                        memcpy(&key, buf, sizeof(key));
+                        memcpy(&val, buf + sizeof(key), sizeof(val));
+                        buf += sizeof(key) + sizeof(val);
+
+                        app_value_put(dev, key, 0, (void *) val, NULL, true);
+
+                        break;
+                }
+                case APV_TYPE_BUFFER:
+                {
+                        uint16_t len;
+                        void *ptr;
+
+                        if (end - buf < (int) (sizeof(key) + sizeof(len))) {
+                                return;
+                        }
+
+                        memcpy(&key, buf, sizeof(key));
+                        memcpy(&len, buf + sizeof(key), sizeof(len));
+                        buf += sizeof(key) + sizeof(len);
+
+                        if (end - buf < len) {
+                                return;
+                        }
+
+                        ptr = OS_MALLOC_NORET(len);
+                        if (!ptr) {
+                                return;
+                        }
+
+                        memcpy(ptr, buf, len);
+                        buf += len;
+
+                        app_value_put(dev, key, len, ptr, OS_FREE_NORET_FUNC, true);
+
+                        break;
+                }
+                default:
+                        OS_ASSERT(0);
+                        return;
+                }
+        }
+}
+
+static void replay_record(const jnl_record_t *rec, const uint8_t *payload)
+{
+        const bd_address_t *addr = (const bd_address_t *) payload;
+        device_t *dev;
+
+        switch (rec->type) {
+        case JNL_TYPE_DEVICE:
+        {
+                static stored_device_t s_dev;
+
+                if (rec->length != sizeof(s_dev)) {
+                        break;
+                }
+
+                // payload in journal is not aligned
+                memcpy(&s_dev, payload, sizeof(s_dev));
+
+                dev = find_device_by_addr(&s_dev.addr, true);
+                if (!dev) {
+                        OS_ASSERT(0);
+                        break;
+                }
+
+                device_remove_pairing(dev);
+                convert_stored_dev_to_dev(&s_dev, dev);
+                break;
+        }
+        case JNL_TYPE_REMOVE:
+                if (rec->length != sizeof(*addr)) {
+                        break;
+                }
+
+                dev = find_device_by_addr(addr, false);
+                if (dev) {
+                        device_remove(dev);
+                }
+                break;
+        case JNL_TYPE_APV:
+                if (rec->length < sizeof(*addr)) {
+                        break;
+                }
+
+                // app values of device which is not stored anymore are ignored
+                dev = find_device_by_addr(addr, false);
+                if (dev) {
+                        replay_apv(dev, payload + sizeof(*addr), rec->length - sizeof(*addr));
+                }
+                break;
+        case JNL_TYPE_ORDER:
+        {
+                int i;
+
+                // last device is moved to front first
+                for (i = rec->length / sizeof(*addr) - 1; i >= 0; i--) {
+                        dev = find_device_by_addr(&addr[i], false);
+                        if (dev) {
+                                device_move_front(dev);
+                        }
+                }
+                break;
+        }
+        default:
+                break;
+        }
+}
+
+/*
+ * Returns length of valid records at beginning of buf, i.e. up to last record with commit flag.
+ * Records after it were written before areas were rewritten last time, or were written by save
+ * interrupted by power loss.
+ */
+static uint32_t jnl_committed_length(const uint8_t *buf, uint32_t size)
+{
+        uint32_t pos = 0;
+        uint32_t committed = 0;
+
+        while (pos + sizeof(jnl_record_t) <= size) {
+                jnl_record_t rec;
+
+                memcpy(&rec, &buf[pos], sizeof(rec));
+
+                if (rec.gen != jnl_gen || rec.length > size - pos - sizeof(rec) ||
+                                jnl_record_crc(&rec, &buf[pos + sizeof(rec)]) != rec.crc) {
+                        break;
+                }
+
+                pos += sizeof(rec) + rec.length;
+
+                if (rec.flags & JNL_FLAG_COMMIT) {
+                        committed = pos;
+                }
+        }
+
+        return committed;
+}
+
+/* Checks that journal area is inside partition */
+static bool jnl_fits(void)
+{
+        return ad_nvms_get_size(part) >= PART_JNL_DATA_OFFSET + PART_JNL_DATA_LENGTH;
+}
+
+static void load_journal(void)
+{
+        const uint32_t size = PART_JNL_DATA_OFFSET + PART_JNL_DATA_LENGTH - PART_JNL_RECORDS_OFFSET;
+        uint8_t magic[ sizeof(STORAGE_MAGIC_JNL) ];
+        uint8_t *buf;
+        uint32_t committed;
+        uint32_t pos;
+
+        jnl_addr = 0;
+
+        if (!jnl_fits()) {
+                return;
+        }
+
+        ad_nvms_read(part, PART_JNL_DATA_OFFSET, magic, sizeof(magic));
+
+        if (memcmp(magic, STORAGE_MAGIC_JNL, sizeof(magic))) {
+                return;
+        }
+
+        ad_nvms_read(part, PART_JNL_DATA_OFFSET + sizeof(magic), (uint8_t *) &jnl_gen,
+                                                                        sizeof(jnl_gen));
+
+        // journal is small, so it's read at once; if it can't be, it's started anew on next save
+        buf = OS_MALLOC_NORET(size);
+        if (!buf) {
+                return;
+        }
+
+        ad_nvms_read(part, PART_JNL_RECORDS_OFFSET, buf, size);
+
+        committed = jnl_committed_length(buf, size);
+
+        for (pos = 0; pos < committed; ) {
+                jnl_record_t rec;
+
+                memcpy(&rec, &buf[pos], sizeof(rec));
+
+                replay_record(&rec, &buf[pos + sizeof(rec)]);
+
+                pos += sizeof(rec) + rec.length;
+        }
+
+        OS_FREE_NORET(buf);
+
+        jnl_addr = PART_JNL_RECORDS_OFFSET + committed;
+}
+
+/* Adds record to batch, returns pointer to its payload or NULL if journal has no space for it */
+static uint8_t *jnl_add(struct jnl_batch *batch, uint8_t type, uint16_t length)
+{
+        jnl_record_t rec;
+
+        if (batch->size - batch->len < sizeof(rec) + length) {
+                return NULL;
+        }
+
+        rec.crc = 0;
+        rec.gen = jnl_gen;
+        rec.type = type;
+        rec.flags = 0;
+        rec.length = length;
+
+        memcpy(&batch->buf[batch->len], &rec, sizeof(rec));
+
+        batch->last = batch->len;
+        batch->len += sizeof(rec) + length;
+
+        return &batch->buf[batch->last + sizeof(rec)];
+}
+
+/* Marks last record of batch and writes whole batch after records already in journal */
+static bool jnl_commit(struct jnl_batch *batch)
+{
+        uint16_t pos;
+
+        if (batch->len == 0) {
+                return true;
+        }
+
+        for (pos = 0; pos < batch->len; ) {
+                jnl_record_t rec;
+
+                memcpy(&rec, &batch->buf[pos], sizeof(rec));
+
+                if (pos == batch->last) {
+                        rec.flags |= JNL_FLAG_COMMIT;
+                }
+                rec.crc = jnl_record_crc(&rec, &batch->buf[pos + sizeof(rec)]);
+
+                memcpy(&batch->buf[pos], &rec, sizeof(rec));
+
+                pos += sizeof(rec) + rec.length;
+        }
+
+        // single write, so records take as few VES containers as possible
+        if (ad_nvms_write(part, jnl_addr, batch->buf, batch->len) != batch->len) {
+                return false;
+        }
+
+        jnl_addr += batch->len;
+
+        return true;
+}
+
+static bool jnl_write_device(struct jnl_batch *batch, const device_t *dev)
+{
+        /*
+         * saving data to flash is synchronized using mutex so it's safe to save some stack space
+         * by making this variable static - structure is quite big.
+         */
+        static stored_device_t s_dev;
+        uint8_t *payload;
+
+        payload = jnl_add(batch, JNL_TYPE_DEVICE, sizeof(s_dev));
+        if (!payload) {
+                return false;
+        }
+
+        memset(&s_dev, 0, sizeof(s_dev));
+        convert_dev_to_stored_dev(dev, &s_dev);
+        memcpy(payload, &s_dev, sizeof(s_dev));
+
+        return true;
+}
+
+static bool jnl_write_remove(struct jnl_batch *batch, const bd_address_t *addr)
+{
+        uint8_t *payload;
+
+        payload = jnl_add(batch, JNL_TYPE_REMOVE, sizeof(*addr));
+        if (!payload) {
+                return false;
+        }
+
+        memcpy(payload, addr, sizeof(*addr));
+
+        return true;
+}
+
+static void apv_size_func(void *data, void *ud)
+{
+        const app_value_t *appval = data;
+        size_t *size = ud;
+
+        *size += sizeof(uint8_t) + sizeof(appval->key);
+
+        if (appval->length) {
+                *size += sizeof(appval->length) + appval->length;
+        } else {
+                *size += sizeof(uint32_t);
+        }
+}
+
+static void apv_copy_func(void *data, void *ud)
+{
+        const app_value_t *appval = data;
+        uint8_t **pos = ud;
+        uint8_t apv_type;
+
+        if (appval->length) {
+                apv_type = APV_TYPE_BUFFER;
+                *pos = buf_put_inc(*pos, &apv_type, sizeof(apv_type));
+                *pos = buf_put_inc(*pos, &appval->key, sizeof(appval->key));
+                *pos = buf_put_inc(*pos, &appval->length, sizeof(appval->length));
+                *pos = buf_put_inc(*pos, appval->ptr, appval->length);
+        } else {
+                uint32_t val = (uint32_t) appval->ptr;
+
+                apv_type = APV_TYPE_INTEGER;
+                *pos = buf_put_inc(*pos, &apv_type, sizeof(apv_type));
+                *pos = buf_put_inc(*pos, &appval->key, sizeof(appval->key));
+                *pos = buf_put_inc(*pos, &val, sizeof(val));
+        }
+}
+
+static bool jnl_write_apv(struct jnl_batch *batch, const device_t *dev)
+{
+        size_t length = sizeof(dev->addr);
+        uint8_t *pos;
+
+        queue_foreach(&dev->app_value, apv_size_func, &length);
+
+        if (length > batch->size) {
+                return false;
+        }
+
+        pos = jnl_add(batch, JNL_TYPE_APV, length);
+        if (!pos) {
+                return false;
+        }
+
+        pos = buf_put_inc(pos, &dev->addr, sizeof(dev->addr));
+        queue_foreach(&dev->app_value, apv_copy_func, &pos);
+
+        return true;
+}
+
+struct bonded_list {
+        device_t *dev[defaultBLE_MAX_BONDED];
+        uint8_t count;
+        bool overflow;
+};
+
+static void bonded_list_func(device_t *dev, void *ud)
+{
+        struct bonded_list *list = ud;
+
+        if (!dev->bonded) {
+                return;
+        }
+
+        if (list->count < defaultBLE_MAX_BONDED) {
+                list->dev[list->count++] = dev;
+        } else {
+                list->overflow = true;
+        }
+}
+
+static bool jnl_write_order(struct jnl_batch *batch, const struct bonded_list *list)
+{
+        uint8_t *pos;
+        int i;
+
+        pos = jnl_add(batch, JNL_TYPE_ORDER, list->count * sizeof(bd_address_t));
+        if (!pos) {
+                return false;
+        }
+
+        for (i = 0; i < list->count; i++) {
+                pos = buf_put_inc(pos, &list->dev[i]->addr, sizeof(bd_address_t));
+        }
+
+        return true;
+}
+
+static int addr_find(const bd_address_t *list, int count, const bd_address_t *addr)
+{
+        int i;
+
+        for (i = 0; i < count; i++) {
+                if (!memcmp(&list[i], addr, sizeof(*addr))) {
+                        return i;
+                }
+        }
+
+        return -1;
+}
+
+static void stored_add_func(device_t *dev, void *ud)
+{
+        if (dev->bonded && stored_count < defaultBLE_MAX_BONDED) {
+                memcpy(&stored_addr[stored_count++], &dev->addr, sizeof(dev->addr));
+        }
+}
+
+/* Adds records of changes since last save to batch */
+static bool jnl_write_changes(struct jnl_batch *batch)
+{
+        struct bonded_list list = { .count = 0 };
+        bd_address_t order[defaultBLE_MAX_BONDED];
+        int order_count = 0;
+        bool reorder = false;
+        int i;
+
+        device_foreach(bonded_list_func, &list);
+        if (list.overflow) {
+                return false;
+        }
+
+        // devices which are not bonded anymore (or changed address)
+        for (i = 0; i < stored_count; i++) {
+                device_t *dev = find_device_by_addr(&stored_addr[i], false);
+
+                if (dev && dev->bonded) {
+                        // order of devices when records are replayed
+                        memcpy(&order[order_count++], &stored_addr[i], sizeof(order[0]));
+                } else if (!jnl_write_remove(batch, &stored_addr[i])) {
+                        return false;
+                }
+        }
+
+        for (i = 0; i < list.count; i++) {
+                device_t *dev = list.dev[i];
+                bool stored = addr_find(order, order_count, &dev->addr) >= 0;
+
+                if (!stored) {
+                        // new devices are added at the end of list when records are replayed
+                        memcpy(&order[order_count++], &dev->addr, sizeof(order[0]));
+                }
+
+                if (!stored || dev->keys_dirty) {
+                        /*
+                         * App values are written again after new pairing data, since they may
+                         * belong to other device which was stored with the same address before.
+                         */
+                        if (!jnl_write_device(batch, dev) || !jnl_write_apv(batch, dev)) {
+                                return false;
+                        }
+                } else if (dev->apv_dirty) {
+                        if (!jnl_write_apv(batch, dev)) {
+                                return false;
+                        }
+                }
+        }
+
+        for (i = 0; i < list.count; i++) {
+                if (memcmp(&order[i], &list.dev[i]->addr, sizeof(order[0]))) {
+                        reorder = true;
+                }
+        }
+
+        if (reorder) {
+                return jnl_write_order(batch, &list);
+        }
+
+        return true;
+}
+
+/* Appends changes since last save to journal, returns false if areas must be rewritten instead */
+static bool jnl_save(void)
+{
+        struct jnl_batch batch = { 0 };
+        bool ret;
+
+        if (!jnl_addr) {
+                return false;
+        }
+
+        batch.size = PART_JNL_DATA_OFFSET + PART_JNL_DATA_LENGTH - jnl_addr;
+        batch.buf = OS_MALLOC_NORET(batch.size);
+        if (!batch.buf) {
+                return false;
+        }
+
+        ret = jnl_write_changes(&batch) && jnl_commit(&batch);
+
+        OS_FREE_NORET(batch.buf);
+
+        if (ret) {
+                stored_count = 0;
+                device_foreach(stored_add_func, NULL);
+        }
+
+        return ret;
+}
+
+/* Starts new, empty journal - called after areas were rewritten */
+static void jnl_reset(void)
+{
+        uint8_t hdr[ sizeof(STORAGE_MAGIC_JNL) + sizeof(jnl_gen) ];
+
+        if (!jnl_fits()) {
+                return;
+        }
+
+        /*
+         * If power is lost before new generation is written, records of previous generation are
+         * replayed on top of rewritten areas. Each record holds complete state of device, so this
+         * only reverts devices changed since last journal write to their previously saved state.
+         */
+        jnl_gen++;
+
+        memcpy(hdr, STORAGE_MAGIC_JNL, sizeof(STORAGE_MAGIC_JNL));
+        memcpy(&hdr[sizeof(STORAGE_MAGIC_JNL)], &jnl_gen, sizeof(jnl_gen));
+
+        ad_nvms_write(part, PART_JNL_DATA_OFFSET, hdr, sizeof(hdr));
+
+        jnl_addr = PART_JNL_RECORDS_OFFSET;
+
+        stored_count = 0;
+        device_foreach(stored_add_func, NULL);
+}
+#endif /* CONFIG_BLE_STORAGE_JOURNAL */
 #endif // CONFIG_BLE_STORAGE
 
 void storage_flash_init(void)
@@ -532,6 +1174,10 @@ void storage_flash_init(void)
 #ifdef CONFIG_BLE_STORAGE
         /* compile-time assertion in APV area overlaps KEY area (assuming APV is placed after KEY) */
         C_ASSERT(PART_KEY_DATA_OFFSET + PART_KEY_LENGTH < PART_APV_DATA_OFFSET);
+#if CONFIG_BLE_STORAGE_JOURNAL
+        /* compile-time assertion in journal overlaps APV area (assuming it is placed after APV) */
+        C_ASSERT(PART_APV_DATA_OFFSET + PART_APV_DATA_LENGTH <= PART_JNL_DATA_OFFSET);
+#endif
 
         part = ad_nvms_open(NVMS_GENERIC_PART);
         if (!part) {
@@ -550,6 +1196,14 @@ void storage_flash_load(void)
 
         load_part_key();
         load_part_apv();
+#if CONFIG_BLE_STORAGE_JOURNAL
+        load_journal();
+
+        stored_count = 0;
+        device_foreach(stored_add_func, NULL);
+#endif
+
+        device_foreach(clear_dirty_func, NULL);
 #endif // CONFIG_BLE_STORAGE
 }
 
@@ -560,7 +1214,19 @@ void storage_flash_save(void)
                 return;
         }
 
+#if CONFIG_BLE_STORAGE_JOURNAL
+        if (jnl_save()) {
+                device_foreach(clear_dirty_func, NULL);
+                return;
+        }
+#endif
+
         save_part_key();
         save_part_apv();
+#if CONFIG_BLE_STORAGE_JOURNAL
+        jnl_reset();
+#endif
+
+        device_foreach(clear_dirty_func, NULL);
 #endif // CONFIG_BLE_STORAGE
 }
@@ -46,6 +46,55 @@
 #define AD_FLASH_GET_SECTOR_SIZE(addr)  (FLASH_SECTOR_SIZE)
 #define AD_FLASH_MAX_SECTOR_SIZE        (FLASH_SECTOR_SIZE)
 
+/**
+ * \brief Asynchronous flash read
+ *
+ * When set to 1, ad_flash_read_async() is available. It reads flash with DMA channel
+ * AD_FLASH_ASYNC_DMA_CHANNEL, so calling task is not blocked for the duration of the copy.
+ */
+#ifndef AD_FLASH_ASYNC_READ
+#define AD_FLASH_ASYNC_READ             0
+#endif
+
+/**
+ * \brief DMA channel used by asynchronous flash read
+ *
+ * Channel is acquired with resource manager for the duration of each asynchronous read.
+ */
+#ifndef AD_FLASH_ASYNC_DMA_CHANNEL
+#define AD_FLASH_ASYNC_DMA_CHANNEL      HW_DMA_CHANNEL_6
+#endif
+
+/**
+ * \brief Maximum number of bytes read by one DMA transfer of asynchronous read
+ *
+ * Other flash users that call ad_flash_lock() wait at most for one such transfer to finish.
+ */
+#ifndef AD_FLASH_ASYNC_SEGMENT_SIZE
+#define AD_FLASH_ASYNC_SEGMENT_SIZE     4096
+#endif
+
+#if AD_FLASH_ASYNC_READ
+/**
+ * \brief Scatter-gather list entry of asynchronous read
+ */
+typedef struct {
+        uint32_t addr;                  /**< Flash offset to read from */
+        uint8_t *buf;                   /**< Buffer in RAM to read data to */
+        size_t len;                     /**< Number of bytes to read */
+} ad_flash_sg_entry_t;
+
+/**
+ * \brief Asynchronous read completion callback
+ *
+ * Called from DMA interrupt when all entries were read.
+ *
+ * \param [in] user_data user data passed to ad_flash_read_async()
+ * \param [in] read total number of bytes read
+ */
+typedef void (*ad_flash_read_cb)(void *user_data, size_t read);
+#endif
+
 /**
  * \brief Initialize flash access.
  *
@@ -64,6 +113,31 @@ void ad_flash_init(void);
  */
 size_t ad_flash_read(uint32_t addr, uint8_t *buf, size_t len);
 
+#if AD_FLASH_ASYNC_READ
+/**
+ * \brief Read flash memory asynchronously
+ *
+ * Entries of scatter-gather list are read in order with DMA, in transfers of at most
+ * AD_FLASH_ASYNC_SEGMENT_SIZE bytes. Flash is not locked between transfers, task calling
+ * ad_flash_lock() (e.g. to write or erase) suspends the read after current transfer until
+ * ad_flash_unlock().
+ *
+ * Only one asynchronous read is done at a time, function waits for DMA channel if previous
+ * read did not finish yet.
+ *
+ * \param [in] sg scatter-gather list, it must stay valid until \p cb is called
+ * \param [in] count number of entries in \p sg
+ * \param [in] cb function called when read is finished
+ * \param [in] user_data argument passed to \p cb
+ *
+ * \return true if read was started, false if some entry is not in flash memory
+ *
+ * \note If there is nothing to read, \p cb is called before function returns.
+ */
+bool ad_flash_read_async(const ad_flash_sg_entry_t *sg, size_t count, ad_flash_read_cb cb,
+                                                                                void *user_data);
+#endif
+
 /**
  * \brief Write flash memory
  *
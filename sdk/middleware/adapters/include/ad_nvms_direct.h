@@ -48,6 +48,29 @@
 #define DIRECT_DRIVER_STATIC_SECTOR_BUF  2
 #define DIRECT_DRIVER_NO_SECTOR_BUF      3
 
+/**
+ * \brief Number of flash sectors cached in RAM
+ *
+ * Used when dg_configNVMS_FLASH_CACHE is enabled. Sectors that need erase are kept in RAM until
+ * ad_nvms_flush() is called, or until other sector needs place in cache. Then least recently
+ * written sector is written back to flash. With DIRECT_DRIVER_STATIC_SECTOR_BUF strategy this
+ * many sector buffers are allocated statically.
+ */
+#ifndef AD_NVMS_DIRECT_CACHE_SECTORS
+#define AD_NVMS_DIRECT_CACHE_SECTORS    1
+#endif
+
+/**
+ * \brief Time in ms after which modified cached sectors are written to flash
+ *
+ * When set to value greater than 0, OS timer is started on first modification of cached sector
+ * and all modified sectors are written to flash when it expires. Write back is done from timer
+ * task. When set to 0, sectors are written only by ad_nvms_flush() or when evicted from cache.
+ */
+#ifndef AD_NVMS_DIRECT_CACHE_FLUSH_MS
+#define AD_NVMS_DIRECT_CACHE_FLUSH_MS   0
+#endif
+
 extern const partition_driver_t ad_nvms_direct_driver;
 
 /**
@@ -56,6 +79,28 @@ extern const partition_driver_t ad_nvms_direct_driver;
  */
 void ad_nvms_direct_init(void);
 
+#if dg_configNVMS_FLASH_CACHE
+/**
+ * \brief Flash cache statistics
+ */
+typedef struct {
+        uint32_t hits;          /**< Writes to sector that was already in cache */
+        uint32_t misses;        /**< Writes that required sector to be read to cache */
+        uint32_t evictions;     /**< Sectors removed from cache to make place for other one */
+        uint32_t erases;        /**< Sector erases done to write data */
+        uint32_t timed_flushes; /**< Write backs done after AD_NVMS_DIRECT_CACHE_FLUSH_MS */
+} ad_nvms_direct_cache_stats_t;
+
+/**
+ * \brief Get flash cache statistics
+ *
+ * Counters are collected for all partitions handled by direct driver since startup.
+ *
+ * \param [out] stats statistics
+ */
+void ad_nvms_direct_get_cache_stats(ad_nvms_direct_cache_stats_t *stats);
+#endif
+
 #endif /* dg_configNVMS_ADAPTER */
 
 #endif /* AD_NVMS_DIRECT_H_ */
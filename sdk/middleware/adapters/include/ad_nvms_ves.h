@@ -101,6 +101,164 @@ void ad_nvms_ves_init(void);
 #define AD_NVMS_VES_GC_THRESHOLD                -1
 #endif
 
+/**
+ * \brief Boot-time CAT checkpoint
+ *
+ * When set to 1, the Container Allocation Table is stored on flash together with sector
+ * bookkeeping, in one of two checkpoint slots reserved at the end of each VES partition.
+ * Every sector allocation and erase done afterwards is appended to a replay log kept after the
+ * checkpoint. On bind only sectors listed in the log are scanned, instead of every container of
+ * the partition. If no valid checkpoint is found, full scan is done and new checkpoint is written.
+ *
+ * Reserved slots reduce address space available on partition. Enabling this option changes
+ * partition layout, so partitions written without it must be erased.
+ */
+#ifndef AD_NVMS_VES_CHECKPOINT
+#define AD_NVMS_VES_CHECKPOINT                  0
+#endif
+
+/**
+ * \brief Replay log size of CAT checkpoint
+ *
+ * Number of sector allocations and erases logged before new checkpoint is written. Bigger log
+ * means less frequent checkpoint slot erases but more sectors to scan on bind.
+ */
+#ifndef AD_NVMS_VES_CHECKPOINT_LOG_SIZE
+#define AD_NVMS_VES_CHECKPOINT_LOG_SIZE         64
+#endif
+
+/**
+ * \brief Incremental garbage collection
+ *
+ * When set to 1, sectors are recycled in background by ad_nvms_ves_gc_step() before free
+ * sectors run out, so writes don't have to wait for containers to be moved and sectors erased.
+ * Sector to recycle is chosen by cost-benefit policy which takes into account dirty container
+ * count, age of data in sector and erase count of sector, instead of AD_NVMS_VES_GC_THRESHOLD.
+ * Garbage collection done from write is still used if background one doesn't keep up.
+ *
+ * Erase counts and ages of sectors are kept in RAM and stored with CAT checkpoint when
+ * AD_NVMS_VES_CHECKPOINT is set. Otherwise (or if partition is too small for checkpoint) they
+ * start from zero on each bind, so wear leveling covers only current power cycle.
+ */
+#ifndef AD_NVMS_VES_INCREMENTAL_GC
+#define AD_NVMS_VES_INCREMENTAL_GC              0
+#endif
+
+/**
+ * \brief Number of free sectors kept by incremental garbage collection
+ *
+ * Background garbage collection works on partition while it has less free sectors than this.
+ * One free sector is always left for writes, so value must be at least 2.
+ */
+#ifndef AD_NVMS_VES_GC_RESERVE
+#define AD_NVMS_VES_GC_RESERVE                  3
+#endif
+
+/**
+ * \brief Maximum number of containers moved in one step of incremental garbage collection
+ */
+#ifndef AD_NVMS_VES_GC_STEP
+#define AD_NVMS_VES_GC_STEP                     8
+#endif
+
+#if AD_NVMS_VES_INCREMENTAL_GC
+/**
+ * \brief Do one step of background garbage collection
+ *
+ * On each VES partition that has less than AD_NVMS_VES_GC_RESERVE free sectors, step either moves
+ * up to AD_NVMS_VES_GC_STEP valid containers out of sector being recycled, or erases it. Partition
+ * is locked only for the duration of one step.
+ *
+ * Function accesses flash and may block, it should be called from low priority task, e.g.:
+ * \code
+ * for (;;) {
+ *         while (ad_nvms_ves_gc_step()) {
+ *         }
+ *         OS_DELAY_MS(100);
+ * }
+ * \endcode
+ *
+ * \return true if more steps are needed, false if all partitions have enough free sectors
+ */
+bool ad_nvms_ves_gc_step(void);
+#endif
+
+/**
+ * \brief Atomic multi-container writes
+ *
+ * When set to 1, ad_nvms_ves_txn_begin(), ad_nvms_ves_txn_write() and ad_nvms_ves_txn_commit()
+ * allow to write data spanning several containers so that after power failure either all or
+ * none of it is visible. Containers of transaction are written to flash with single write after
+ * transaction record, and are made current after record is marked as committed.
+ */
+#ifndef AD_NVMS_VES_TRANSACTIONS
+#define AD_NVMS_VES_TRANSACTIONS                0
+#endif
+
+/**
+ * \brief Maximum number of containers written by one transaction
+ *
+ * Each container takes AD_NVMS_VES_CONTAINER_SIZE bytes of RAM while transaction is staged.
+ * Number is also limited by size of transaction record, which holds 2 bytes per container in
+ * data of single container.
+ */
+#ifndef AD_NVMS_VES_TXN_SIZE
+#define AD_NVMS_VES_TXN_SIZE                    8
+#endif
+
+#if AD_NVMS_VES_TRANSACTIONS
+/**
+ * \brief VES transaction handle
+ */
+typedef struct ad_nvms_ves_txn *ad_nvms_ves_txn_t;
+
+/**
+ * \brief Start transaction on VES partition
+ *
+ * \param [in] handle partition handle returned by ad_nvms_open()
+ *
+ * \return transaction handle, NULL if partition is not VES partition or there is no memory
+ */
+ad_nvms_ves_txn_t ad_nvms_ves_txn_begin(nvms_t handle);
+
+/**
+ * \brief Stage data to be written by transaction
+ *
+ * Data is kept in RAM until ad_nvms_ves_txn_commit() is called. Writes to the same container
+ * are combined, later write overrides earlier one.
+ *
+ * \param [in] txn transaction handle
+ * \param [in] addr partition offset
+ * \param [in] buf data to write
+ * \param [in] size size of data
+ *
+ * \return number of bytes staged, -1 if transaction would exceed AD_NVMS_VES_TXN_SIZE
+ *         containers, nothing is staged then
+ */
+int ad_nvms_ves_txn_write(ad_nvms_ves_txn_t txn, uint32_t addr, const uint8_t *buf,
+                                                                                uint32_t size);
+
+/**
+ * \brief Write data staged by transaction to flash
+ *
+ * Transaction handle is freed.
+ *
+ * \param [in] txn transaction handle
+ *
+ * \return true if transaction was committed
+ */
+bool ad_nvms_ves_txn_commit(ad_nvms_ves_txn_t txn);
+
+/**
+ * \brief Drop data staged by transaction
+ *
+ * Transaction handle is freed.
+ *
+ * \param [in] txn transaction handle
+ */
+void ad_nvms_ves_txn_abort(ad_nvms_ves_txn_t txn);
+#endif
+
 #endif /* dg_configNVMS_VES */
 
 #endif /* AD_NVMS_VES_H_ */
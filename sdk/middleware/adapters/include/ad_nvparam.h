@@ -43,6 +43,27 @@ extern "C" {
  ****************************************************************************************
  */
 
+/**
+ * \brief Tag indexed parameter lookup
+ *
+ * When set to 1, table mapping tags to parameters is built by ad_nvparam_open(), so parameter
+ * is found without searching area configuration. Table takes 256 bytes of RAM per open area.
+ */
+#ifndef AD_NVPARAM_INDEX
+#define AD_NVPARAM_INDEX        1
+#endif
+
+/**
+ * \brief Cache of parameter values
+ *
+ * When set to 1, ad_nvparam_open() reads contents of whole area to RAM with single NVMS read.
+ * Values and lengths of parameters are read from RAM afterwards, writes go to NVMS and update
+ * RAM copy. Area must not be modified other way than through the same handle while it's open.
+ */
+#ifndef AD_NVPARAM_CACHE
+#define AD_NVPARAM_CACHE        0
+#endif
+
 /**
  * \brief NV-Parameters area handle
  *
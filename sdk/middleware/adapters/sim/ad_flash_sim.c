@@ -0,0 +1,527 @@
+/**
+ ****************************************************************************************
+ *
+ * @file ad_flash_sim.c
+ *
+ * @brief Flash adapter implementation for host, backed by RAM or file
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <sys/stat.h>
+#ifdef OS_PRESENT
+#include <pthread.h>
+#endif
+
+#include "sdk_defs.h"
+#include "ad_flash.h"
+#include "ad_flash_sim.h"
+
+#define FLASH_PAGE_SIZE   0x0100
+/* Shorter real time waits are done without sleeping */
+#define SIM_SLEEP_MIN_NS  100000
+
+#define DEFAULT_TIMING { \
+        .read_setup_ns = 200, \
+        .read_byte_ns = 20, \
+        .page_program_us = 250, \
+        .sector_erase_us = 30000, \
+        .chip_erase_ms = 40000, \
+}
+
+static const ad_flash_sim_timing_t default_timing = DEFAULT_TIMING;
+
+static uint8_t *flash;
+static size_t flash_size;
+static int flash_fd = -1;
+static uint32_t *erase_count;
+static ad_flash_sim_timing_t timing = DEFAULT_TIMING;
+static ad_flash_sim_stats_t stats;
+static uint64_t op_count;
+static uint32_t power_loss_op;
+static ad_flash_sim_power_loss_cb_t power_loss_cb;
+static uint32_t rand_state = 1;
+static bool unstable_byte = true;
+static bool realtime;
+
+#ifdef OS_PRESENT
+/* Critical section of host OSAL */
+pthread_mutex_t os_sim_critical = PTHREAD_MUTEX_INITIALIZER;
+
+/* Held during each operation like ad_flash lock on target, recursive for ad_flash_lock() */
+static pthread_mutex_t flash_lock;
+static pthread_once_t flash_lock_once = PTHREAD_ONCE_INIT;
+
+static void sim_lock_init(void)
+{
+        pthread_mutexattr_t attr;
+
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&flash_lock, &attr);
+        pthread_mutexattr_destroy(&attr);
+}
+#endif
+
+static void sim_lock(void)
+{
+#ifdef OS_PRESENT
+        pthread_once(&flash_lock_once, sim_lock_init);
+        pthread_mutex_lock(&flash_lock);
+#endif
+}
+
+static void sim_unlock(void)
+{
+#ifdef OS_PRESENT
+        pthread_mutex_unlock(&flash_lock);
+#endif
+}
+
+/* Account simulated time of operation, in real time mode wait for it with flash locked */
+static void sim_busy(uint64_t ns)
+{
+        struct timespec ts, end;
+
+        stats.busy_ns += ns;
+
+        if (!realtime) {
+                return;
+        }
+
+        if (ns >= SIM_SLEEP_MIN_NS) {
+                ts.tv_sec = ns / 1000000000;
+                ts.tv_nsec = ns % 1000000000;
+                while (nanosleep(&ts, &ts) != 0) {
+                }
+                return;
+        }
+
+        /* sleep takes tens of microseconds more than requested, short waits are busy loops */
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        end.tv_nsec += ns;
+        if (end.tv_nsec >= 1000000000) {
+                end.tv_sec++;
+                end.tv_nsec -= 1000000000;
+        }
+        do {
+                clock_gettime(CLOCK_MONOTONIC, &ts);
+        } while (ts.tv_sec < end.tv_sec || (ts.tv_sec == end.tv_sec && ts.tv_nsec < end.tv_nsec));
+}
+
+static uint32_t sim_rand(void)
+{
+        /* xorshift32 */
+        rand_state ^= rand_state << 13;
+        rand_state ^= rand_state >> 17;
+        rand_state ^= rand_state << 5;
+
+        return rand_state;
+}
+
+/* Flash is opened with default size if ad_flash_* is used before ad_flash_sim_open() */
+static void sim_check_open(void)
+{
+        if (flash == NULL && !ad_flash_sim_open(NULL, AD_FLASH_SIM_DEFAULT_SIZE)) {
+                fprintf(stderr, "ad_flash_sim: cannot allocate flash\n");
+                abort();
+        }
+}
+
+static bool sim_valid_range(uint32_t addr, size_t size)
+{
+        return addr <= flash_size && size <= flash_size - addr;
+}
+
+/* Returns true if this operation is the one to be interrupted */
+static bool sim_next_op(void)
+{
+        op_count++;
+
+        if (power_loss_op == 0 || --power_loss_op > 0) {
+                return false;
+        }
+
+        return true;
+}
+
+static void sim_power_loss(void)
+{
+        ad_flash_sim_power_loss_cb_t cb = power_loss_cb;
+
+        power_loss_cb = NULL;
+        if (cb) {
+                cb();
+        }
+
+        fprintf(stderr, "ad_flash_sim: power loss callback returned\n");
+        abort();
+}
+
+/* Program one page or part of it */
+static void sim_program(uint32_t addr, const uint8_t *buf, size_t size)
+{
+        const bool interrupted = sim_next_op();
+        size_t done = size;
+        size_t i;
+
+        sim_busy((uint64_t) timing.page_program_us * 1000);
+
+        if (interrupted) {
+                done = sim_rand() % (size + 1);
+        }
+
+        for (i = 0; i < done; ++i) {
+                if (buf[i] & ~flash[addr + i]) {
+                        stats.bit_set_attempts++;
+                        break;
+                }
+        }
+        for (i = 0; i < done; ++i) {
+                flash[addr + i] &= buf[i];
+        }
+        stats.page_programs++;
+        stats.programmed_bytes += done;
+
+        if (interrupted) {
+                /* Byte being programmed when power was lost has only some bits cleared */
+                if (unstable_byte && done < size) {
+                        flash[addr + done] &= buf[done] | (uint8_t) sim_rand();
+                }
+                sim_power_loss();
+        }
+}
+
+static void sim_erase_sector(uint32_t sector)
+{
+        const bool interrupted = sim_next_op();
+        size_t done = FLASH_SECTOR_SIZE;
+
+        sim_busy((uint64_t) timing.sector_erase_us * 1000);
+
+        if (interrupted) {
+                done = sim_rand() % FLASH_SECTOR_SIZE;
+        }
+
+        memset(flash + sector, 0xFF, done);
+        erase_count[sector / FLASH_SECTOR_SIZE]++;
+        stats.sector_erases++;
+
+        if (interrupted) {
+                /* Erase was interrupted, part of sector is erased and one byte is unstable */
+                if (unstable_byte) {
+                        flash[sector + done] |= (uint8_t) sim_rand();
+                }
+                sim_power_loss();
+        }
+}
+
+bool ad_flash_sim_open(const char *path, size_t size)
+{
+        struct stat st;
+        void *mem;
+
+        if (size == 0 || size % FLASH_SECTOR_SIZE) {
+                return false;
+        }
+
+        ad_flash_sim_close();
+
+        erase_count = calloc(size / FLASH_SECTOR_SIZE, sizeof(erase_count[0]));
+        if (erase_count == NULL) {
+                return false;
+        }
+
+        if (path == NULL) {
+                mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (mem == MAP_FAILED) {
+                        goto fail;
+                }
+                memset(mem, 0xFF, size);
+        } else {
+                flash_fd = open(path, O_RDWR | O_CREAT, 0644);
+                if (flash_fd < 0 || fstat(flash_fd, &st) < 0 || ftruncate(flash_fd, size) < 0) {
+                        goto fail;
+                }
+                mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, flash_fd, 0);
+                if (mem == MAP_FAILED) {
+                        goto fail;
+                }
+                /* ftruncate() fills new part of file with 0, it must look erased */
+                if ((size_t) st.st_size < size) {
+                        memset((uint8_t *) mem + st.st_size, 0xFF, size - st.st_size);
+                }
+        }
+
+        flash = mem;
+        flash_size = size;
+        memset(&stats, 0, sizeof(stats));
+
+        return true;
+
+fail:
+        if (flash_fd >= 0) {
+                close(flash_fd);
+                flash_fd = -1;
+        }
+        free(erase_count);
+        erase_count = NULL;
+
+        return false;
+}
+
+void ad_flash_sim_close(void)
+{
+        if (flash == NULL) {
+                return;
+        }
+
+        if (flash_fd >= 0) {
+                msync(flash, flash_size, MS_SYNC);
+                close(flash_fd);
+                flash_fd = -1;
+        }
+        munmap(flash, flash_size);
+        free(erase_count);
+        flash = NULL;
+        flash_size = 0;
+        erase_count = NULL;
+}
+
+size_t ad_flash_sim_size(void)
+{
+        return flash_size;
+}
+
+void ad_flash_sim_set_timing(const ad_flash_sim_timing_t *new_timing)
+{
+        timing = new_timing ? *new_timing : default_timing;
+}
+
+void ad_flash_sim_get_stats(ad_flash_sim_stats_t *out)
+{
+        sim_lock();
+        *out = stats;
+        sim_unlock();
+}
+
+void ad_flash_sim_reset_stats(void)
+{
+        sim_lock();
+        memset(&stats, 0, sizeof(stats));
+        if (erase_count) {
+                memset(erase_count, 0, flash_size / FLASH_SECTOR_SIZE * sizeof(erase_count[0]));
+        }
+        sim_unlock();
+}
+
+uint32_t ad_flash_sim_erase_count(uint32_t addr)
+{
+        if (addr >= flash_size) {
+                return 0;
+        }
+
+        return erase_count[addr / FLASH_SECTOR_SIZE];
+}
+
+uint64_t ad_flash_sim_op_count(void)
+{
+        return op_count;
+}
+
+void ad_flash_sim_power_loss_at(uint32_t op, ad_flash_sim_power_loss_cb_t cb)
+{
+        power_loss_op = op;
+        power_loss_cb = cb;
+}
+
+void ad_flash_sim_set_unstable_byte(bool enable)
+{
+        unstable_byte = enable;
+}
+
+void ad_flash_sim_set_realtime(bool enable)
+{
+        realtime = enable;
+}
+
+void ad_flash_sim_set_seed(uint32_t seed)
+{
+        /* xorshift state must not be 0 */
+        rand_state = seed ? seed : 1;
+}
+
+const void *oqspi_automode_get_physical_addr(uint32_t virtual_addr)
+{
+        sim_check_open();
+
+        if (virtual_addr >= flash_size) {
+                return NULL;
+        }
+        sim_lock();
+        stats.pointer_reads++;
+        sim_unlock();
+
+        return flash + virtual_addr;
+}
+
+void ad_flash_init(void)
+{
+        sim_check_open();
+}
+
+size_t ad_flash_read(uint32_t addr, uint8_t *buf, size_t len)
+{
+        sim_check_open();
+
+        if (!sim_valid_range(addr, len)) {
+                return 0;
+        }
+
+        sim_lock();
+        memcpy(buf, flash + addr, len);
+        stats.read_bytes += len;
+        sim_busy(timing.read_setup_ns + (uint64_t) len * timing.read_byte_ns);
+        sim_unlock();
+
+        return len;
+}
+
+size_t ad_flash_write(uint32_t addr, const uint8_t *buf, size_t size)
+{
+        size_t written = 0;
+        uint8_t page[FLASH_PAGE_SIZE];
+
+        sim_check_open();
+
+        if (!sim_valid_range(addr, size)) {
+                return 0;
+        }
+
+        /* Program page by page, as the real driver does */
+        sim_lock();
+        while (written < size) {
+                size_t chunk = FLASH_PAGE_SIZE - ((addr + written) & (FLASH_PAGE_SIZE - 1));
+
+                if (chunk > size - written) {
+                        chunk = size - written;
+                }
+                /* buf may point to flash itself */
+                memcpy(page, buf + written, chunk);
+                sim_program(addr + written, page, chunk);
+                written += chunk;
+        }
+        sim_unlock();
+
+        return written;
+}
+
+bool ad_flash_erase_region(uint32_t addr, size_t size)
+{
+        uint32_t flash_offset = addr & ~(AD_FLASH_GET_SECTOR_SIZE(addr) - 1);
+
+        sim_check_open();
+
+        if (!sim_valid_range(addr, size)) {
+                return false;
+        }
+
+        sim_lock();
+        while (flash_offset < addr + size) {
+                sim_erase_sector(flash_offset);
+                flash_offset += AD_FLASH_GET_SECTOR_SIZE(addr);
+        }
+        sim_unlock();
+
+        return true;
+}
+
+bool ad_flash_chip_erase_by_addr(uint32_t addr)
+{
+        size_t i;
+
+        sim_check_open();
+
+        if (addr != OQSPI_MEM1_VIRTUAL_BASE_ADDR) {
+                /* Wrong start address */
+                return false;
+        }
+
+        sim_lock();
+        memset(flash, 0xFF, flash_size);
+        for (i = 0; i < flash_size / FLASH_SECTOR_SIZE; ++i) {
+                erase_count[i]++;
+        }
+        stats.chip_erases++;
+        sim_busy((uint64_t) timing.chip_erase_ms * 1000000);
+        sim_unlock();
+
+        return true;
+}
+
+int ad_flash_update_possible(uint32_t addr, const uint8_t *data_to_write, size_t size)
+{
+        size_t i;
+        size_t same;
+        const uint8_t *old;
+
+        sim_check_open();
+
+        if (!sim_valid_range(addr, size)) {
+                return -1;
+        }
+        old = flash + addr;
+
+        /* Check if new data is same as old one, in which case no write will be needed */
+        for (i = 0; i < size && old[i] == data_to_write[i]; ++i) {
+        }
+
+        /* This much did not change */
+        same = i;
+
+        /* Check if new data can be stored by clearing bits only */
+        for (; i < size ; ++i) {
+                if ((old[i] & data_to_write[i]) != data_to_write[i])
+                        /*
+                         * Found byte that needs to have at least one bit set and it was cleared,
+                         * erase will be needed.
+                         */
+                        return -1;
+        }
+        return (int) same;
+}
+
+size_t ad_flash_erase_size(uint32_t addr)
+{
+        (void) addr;
+
+        return AD_FLASH_GET_SECTOR_SIZE(addr);
+}
+
+void ad_flash_lock(void)
+{
+        sim_lock();
+}
+
+void ad_flash_unlock(void)
+{
+        sim_unlock();
+}
+
+void ad_flash_skip_cache_flushing(uint32_t base, uint32_t size)
+{
+        /* no cache on host */
+        (void) base;
+        (void) size;
+}
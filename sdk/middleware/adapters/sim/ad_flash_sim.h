@@ -0,0 +1,204 @@
+/**
+ * \addtogroup MID_SYS_ADAPTERS
+ * \{
+ * \addtogroup FLASH_ADAPTER_SIM Flash Adapter Simulator
+ *
+ * \brief Host implementation of the flash adapter
+ *
+ * ad_flash_sim.c implements ad_flash.h API on Linux, so NVMS drivers and other ad_flash users
+ * can be built and run on host. Flash is kept in RAM or in a file mapped to memory, and behaves
+ * like NOR flash: writes can only clear bits, erase sets whole sectors to 0xFF. Each page program
+ * and sector erase advances simulated time according to a timing model, and power loss can be
+ * injected at any of them.
+ *
+ * Headers in sim/include replace the target ones. Like configuration header on target,
+ * sdk_defs.h must be included before sources are compiled, e.g.:
+ * \code
+ * gcc -include sdk_defs.h -Isdk/middleware/adapters/sim/include -Isdk/middleware/adapters/sim \
+ *     -Isdk/middleware/adapters/include -Isdk/bsp/util/include \
+ *     sdk/middleware/adapters/sim/ad_flash_sim.c sdk/middleware/adapters/src/ad_nvms_ves.c \
+ *     sdk/bsp/util/src/sdk_crc16.c test.c
+ * \endcode
+ * To use partition table with ad_nvms.c and ad_nvms_direct.c, add -Isdk/bsp/config.
+ *
+ * Built with -DOS_PRESENT -pthread, each ad_flash operation holds a lock like on target, so
+ * drivers can be used from several threads (see osal.h in sim/include). Power loss injection is
+ * meant for single thread use.
+ *
+ * \{
+ */
+
+/**
+ ****************************************************************************************
+ *
+ * @file ad_flash_sim.h
+ *
+ * @brief Flash adapter simulator control API
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef AD_FLASH_SIM_H_
+#define AD_FLASH_SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * \brief Flash size used when ad_flash_* is called before ad_flash_sim_open()
+ */
+#ifndef AD_FLASH_SIM_DEFAULT_SIZE
+#define AD_FLASH_SIM_DEFAULT_SIZE       (8 * 1024 * 1024)
+#endif
+
+/**
+ * \brief Timing model
+ *
+ * Default values are close to QSPI NOR flash used with DA1470x.
+ */
+typedef struct {
+        uint32_t read_setup_ns;         /**< Time of each read access */
+        uint32_t read_byte_ns;          /**< Time to read one byte */
+        uint32_t page_program_us;       /**< Time to program one page (or part of it) */
+        uint32_t sector_erase_us;       /**< Time to erase one sector */
+        uint32_t chip_erase_ms;         /**< Time to erase whole chip */
+} ad_flash_sim_timing_t;
+
+/**
+ * \brief Access statistics
+ */
+typedef struct {
+        uint64_t read_bytes;            /**< Bytes read by ad_flash_read() */
+        uint64_t pointer_reads;         /**< Pointers returned by ad_flash_get_ptr(), read time
+                                             of data accessed through them is not simulated */
+        uint64_t programmed_bytes;      /**< Bytes written by page programs */
+        uint32_t page_programs;         /**< Page program operations */
+        uint32_t sector_erases;         /**< Sector erase operations, chip erase not included */
+        uint32_t chip_erases;           /**< Chip erase operations */
+        uint32_t bit_set_attempts;      /**< Programs that tried to change 0 bits to 1 */
+        uint64_t busy_ns;               /**< Simulated time spent in flash operations */
+} ad_flash_sim_stats_t;
+
+/**
+ * \brief Power loss callback
+ *
+ * Called when operation selected by ad_flash_sim_power_loss_at() was interrupted. It must not
+ * return, usually it does longjmp() to code which simulates reboot, if it returns program is
+ * aborted.
+ */
+typedef void (*ad_flash_sim_power_loss_cb_t)(void);
+
+/**
+ * \brief Open simulated flash
+ *
+ * \param [in] path file that keeps flash contents between runs, NULL to keep it in RAM only;
+ *                  new file or part of file beyond its current end is filled with 0xFF
+ * \param [in] size flash size, multiple of FLASH_SECTOR_SIZE
+ *
+ * \return true on success
+ */
+bool ad_flash_sim_open(const char *path, size_t size);
+
+/**
+ * \brief Close simulated flash
+ *
+ * Contents of file opened by ad_flash_sim_open() are synced to disk.
+ */
+void ad_flash_sim_close(void);
+
+/**
+ * \brief Get simulated flash size
+ *
+ * \return size of flash, 0 if it is not open
+ */
+size_t ad_flash_sim_size(void);
+
+/**
+ * \brief Set timing model
+ *
+ * \param [in] timing new timing, NULL restores default one
+ */
+void ad_flash_sim_set_timing(const ad_flash_sim_timing_t *timing);
+
+/**
+ * \brief Get access statistics
+ *
+ * \param [out] stats statistics collected since open or last ad_flash_sim_reset_stats()
+ */
+void ad_flash_sim_get_stats(ad_flash_sim_stats_t *stats);
+
+/**
+ * \brief Clear access statistics and erase counters of sectors
+ */
+void ad_flash_sim_reset_stats(void);
+
+/**
+ * \brief Get number of erases of sector
+ *
+ * \param [in] addr address in sector
+ *
+ * \return number of times sector was erased, chip erases included
+ */
+uint32_t ad_flash_sim_erase_count(uint32_t addr);
+
+/**
+ * \brief Get number of program and erase operations done
+ *
+ * Counter is never reset, it can be used to find range of operations for power loss injection.
+ *
+ * \return number of page programs and sector erases since open
+ */
+uint64_t ad_flash_sim_op_count(void);
+
+/**
+ * \brief Inject power loss
+ *
+ * Program or erase operation number op, counting from 1 for the next one, is interrupted.
+ * Interrupted page program programs random number of bytes, interrupted sector erase erases
+ * random part of sector. One more byte is left unstable, see ad_flash_sim_set_unstable_byte().
+ * Then callback is called. Injection is disarmed once it happens.
+ *
+ * \param [in] op operation to interrupt, 0 disarms injection
+ * \param [in] cb function called after interrupted operation
+ */
+void ad_flash_sim_power_loss_at(uint32_t op, ad_flash_sim_power_loss_cb_t cb);
+
+/**
+ * \brief Enable unstable byte after interrupted operation
+ *
+ * When enabled (default), byte being programmed when power was lost gets only some of its bits
+ * cleared and byte being erased gets only some of its bits set. When disabled, operations are
+ * interrupted at byte boundary.
+ *
+ * \param [in] enable true to leave unstable byte
+ */
+void ad_flash_sim_set_unstable_byte(bool enable);
+
+/**
+ * \brief Enable real time mode
+ *
+ * When enabled, each operation takes its simulated time in real time too, flash stays locked
+ * meanwhile. Together with OS_PRESENT it shows how tasks using flash delay each other.
+ *
+ * \param [in] enable true to wait for simulated time of each operation
+ */
+void ad_flash_sim_set_realtime(bool enable);
+
+/**
+ * \brief Seed random generator used for interrupted operations
+ *
+ * \param [in] seed seed, same seed gives same results
+ */
+void ad_flash_sim_set_seed(uint32_t seed);
+
+#endif /* AD_FLASH_SIM_H_ */
+
+/**
+ \}
+ \}
+ */
@@ -0,0 +1,29 @@
+/**
+ ****************************************************************************************
+ *
+ * @file oqspi_automode.h
+ *
+ * @brief Host replacement of OQSPI automode API, implemented by ad_flash_sim.c
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef OQSPI_AUTOMODE_H_
+#define OQSPI_AUTOMODE_H_
+
+#include <stdint.h>
+
+/**
+ * \brief Get pointer to simulated flash contents
+ *
+ * \param [in] virtual_addr flash address
+ *
+ * \return pointer to flash contents, NULL if address is outside of flash
+ */
+const void *oqspi_automode_get_physical_addr(uint32_t virtual_addr);
+
+#endif /* OQSPI_AUTOMODE_H_ */
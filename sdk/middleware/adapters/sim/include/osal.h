@@ -0,0 +1,105 @@
+/**
+ ****************************************************************************************
+ *
+ * @file osal.h
+ *
+ * @brief Host replacement of OSAL
+ *
+ * Without OS_PRESENT nothing needs locking and mutexes do nothing. With OS_PRESENT tasks are
+ * pthreads, mutexes are pthread mutexes, events are binary semaphores and critical section is
+ * one global mutex defined in ad_flash_sim.c. Only primitives used by VES driver are provided in
+ * this mode. Build with -DOS_PRESENT -pthread.
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef OSAL_H_
+#define OSAL_H_
+
+#include <stdlib.h>
+#include <assert.h>
+
+#define OS_MALLOC                       malloc
+#define OS_MALLOC_NORET                 malloc
+#define OS_FREE                         free
+#define OS_FREE_NORET                   free
+#define OS_FREE_FUNC                    free
+#define OS_FREE_NORET_FUNC              free
+#define OS_ASSERT(a)                    assert(a)
+
+#ifdef OS_PRESENT
+
+#include <pthread.h>
+
+typedef struct {
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+        int signaled;
+} os_sim_event_t;
+
+extern pthread_mutex_t os_sim_critical;
+
+static inline int os_sim_event_create(os_sim_event_t *event)
+{
+        event->signaled = 0;
+        if (pthread_mutex_init(&event->mutex, NULL)) {
+                return -1;
+        }
+
+        return pthread_cond_init(&event->cond, NULL) ? -1 : 0;
+}
+
+static inline void os_sim_event_signal(os_sim_event_t *event)
+{
+        pthread_mutex_lock(&event->mutex);
+        event->signaled = 1;
+        pthread_cond_signal(&event->cond);
+        pthread_mutex_unlock(&event->mutex);
+}
+
+static inline void os_sim_event_wait(os_sim_event_t *event)
+{
+        pthread_mutex_lock(&event->mutex);
+        while (!event->signaled) {
+                pthread_cond_wait(&event->cond, &event->mutex);
+        }
+        event->signaled = 0;
+        pthread_mutex_unlock(&event->mutex);
+}
+
+#define OS_MUTEX                        pthread_mutex_t
+#define OS_MUTEX_CREATE_SUCCESS         0
+#define OS_MUTEX_FOREVER                0
+#define OS_MUTEX_CREATE(mutex)          pthread_mutex_init(&(mutex), NULL)
+#define OS_MUTEX_GET(mutex, timeout)    pthread_mutex_lock(&(mutex))
+#define OS_MUTEX_PUT(mutex)             pthread_mutex_unlock(&(mutex))
+
+#define OS_EVENT                        os_sim_event_t
+#define OS_EVENT_CREATE_SUCCESS         0
+#define OS_EVENT_FOREVER                0
+#define OS_EVENT_CREATE(event)          os_sim_event_create(&(event))
+#define OS_EVENT_SIGNAL(event)          os_sim_event_signal(&(event))
+#define OS_EVENT_WAIT(event, timeout)   os_sim_event_wait(&(event))
+
+#define OS_ENTER_CRITICAL_SECTION()     pthread_mutex_lock(&os_sim_critical)
+#define OS_LEAVE_CRITICAL_SECTION()     pthread_mutex_unlock(&os_sim_critical)
+
+#else
+
+#define OS_MUTEX                        int
+#define OS_MUTEX_CREATE_SUCCESS         0
+#define OS_MUTEX_FOREVER                0
+#define OS_MUTEX_CREATE(mutex)          ((mutex) = 1)
+#define OS_MUTEX_GET(mutex, timeout)    ((void) (mutex))
+#define OS_MUTEX_PUT(mutex)             ((void) (mutex))
+
+#define OS_ENTER_CRITICAL_SECTION()     do {} while (0)
+#define OS_LEAVE_CRITICAL_SECTION()     do {} while (0)
+
+#endif /* OS_PRESENT */
+
+#endif /* OSAL_H_ */
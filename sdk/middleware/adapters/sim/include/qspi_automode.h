@@ -0,0 +1,18 @@
+/**
+ ****************************************************************************************
+ *
+ * @file qspi_automode.h
+ *
+ * @brief Host replacement of QSPI automode API, QSPI controller is not simulated
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef QSPI_AUTOMODE_H_
+#define QSPI_AUTOMODE_H_
+
+#endif /* QSPI_AUTOMODE_H_ */
@@ -0,0 +1,55 @@
+/**
+ ****************************************************************************************
+ *
+ * @file sdk_defs.h
+ *
+ * @brief Host replacement of SDK definitions used by ad_flash simulator and its users
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef SDK_DEFS_H_
+#define SDK_DEFS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <assert.h>
+
+#define __STATIC_INLINE                 static inline
+#define __RETAINED
+#define __RETAINED_RW
+#define __RETAINED_CODE
+#define __UNUSED                        __attribute__((unused))
+
+#define ASSERT_WARNING(a)               assert(a)
+#define ASSERT_ERROR(a)                 assert(a)
+
+#define FLASH_SECTOR_SIZE               (0x1000)
+#define OQSPI_MEM1_VIRTUAL_BASE_ADDR    (0x00000000)
+
+#ifndef dg_configFLASH_ADAPTER
+#define dg_configFLASH_ADAPTER          (1)
+#endif
+
+#ifndef dg_configNVMS_ADAPTER
+#define dg_configNVMS_ADAPTER           (1)
+#endif
+
+#ifndef dg_configNVMS_VES
+#define dg_configNVMS_VES               (1)
+#endif
+
+#ifndef dg_configNVMS_FLASH_CACHE
+#define dg_configNVMS_FLASH_CACHE       (0)
+#endif
+
+#define dg_configUSE_HW_QSPI            (0)
+#define dg_configUSE_HW_QSPI2           (0)
+#define dg_configUSE_HW_OQSPI           (1)
+
+#endif /* SDK_DEFS_H_ */
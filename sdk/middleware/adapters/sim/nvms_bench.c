@@ -0,0 +1,186 @@
+/**
+ ****************************************************************************************
+ *
+ * @file nvms_bench.c
+ *
+ * @brief NVMS benchmark on flash simulator
+ *
+ * Typical access patterns are run through ad_nvms API on partitions of SDK partition table:
+ * small random and sequential writes and reads of VES generic partition, appends and small
+ * updates of log partition handled by direct driver. For each pattern simulated flash time,
+ * page programs, sector erases, write amplification (programmed bytes per byte written by
+ * user) and host CPU time are reported, so drivers and their options can be compared.
+ *
+ * Build and run from top of SDK, e.g. with direct driver cache of 4 sectors:
+ *
+ *     gcc -Wall -O2 -Ddg_configNVMS_FLASH_CACHE=1 -DAD_NVMS_DIRECT_CACHE_SECTORS=4 \
+ *             -include sdk_defs.h -Isdk/middleware/adapters/sim/include \
+ *             -Isdk/middleware/adapters/sim -Isdk/middleware/adapters/include \
+ *             -Isdk/bsp/util/include -Isdk/bsp/config \
+ *             sdk/middleware/adapters/sim/ad_flash_sim.c sdk/middleware/adapters/src/ad_nvms.c \
+ *             sdk/middleware/adapters/src/ad_nvms_direct.c \
+ *             sdk/middleware/adapters/src/ad_nvms_ves.c sdk/bsp/util/src/sdk_crc16.c \
+ *             sdk/middleware/adapters/sim/nvms_bench.c -o nvms_bench
+ *     ./nvms_bench [operations]
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ad_nvms.h"
+#include "ad_flash_sim.h"
+
+#define FLASH_SIZE              (8 * 1024 * 1024)
+/* Random VES writes go to this many bytes at start of partition, like settings do */
+#define VES_HOT_SIZE            0x4000
+#define VES_SMALL_WRITE         32
+#define BLOCK_SIZE              256
+#define LOG_UPDATE_SIZE         16
+#define LOG_SIZE                0x10000
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+        /* xorshift32, fixed seed keeps results comparable */
+        rnd_state ^= rnd_state << 13;
+        rnd_state ^= rnd_state >> 17;
+        rnd_state ^= rnd_state << 5;
+        return rnd_state;
+}
+
+static struct {
+        ad_flash_sim_stats_t stats;
+        clock_t cpu;
+} start;
+
+static void bench_start(void)
+{
+        ad_flash_sim_get_stats(&start.stats);
+        start.cpu = clock();
+}
+
+static void bench_report(const char *name, uint32_t ops, uint64_t bytes, bool write)
+{
+        ad_flash_sim_stats_t stats;
+        double cpu = (double) (clock() - start.cpu) / CLOCKS_PER_SEC;
+        double busy;
+
+        ad_flash_sim_get_stats(&stats);
+        busy = (stats.busy_ns - start.stats.busy_ns) / 1e9;
+
+        printf("%-20s %7u %9.1f %9.0f %7u %6u ", name, ops, busy * 1e6 / ops,
+                                        busy > 0 ? bytes / busy : 0,
+                                        stats.page_programs - start.stats.page_programs,
+                                        stats.sector_erases - start.stats.sector_erases);
+        if (write) {
+                printf("%6.2f ", (double) (stats.programmed_bytes -
+                                                start.stats.programmed_bytes) / bytes);
+        } else {
+                printf("%6s ", "-");
+        }
+        printf("%8.3f\n", cpu);
+}
+
+static void bench_ves(nvms_t part, uint32_t ops)
+{
+        uint8_t buf[BLOCK_SIZE];
+        const size_t size = ad_nvms_get_size(part);
+        uint32_t i, addr;
+
+        bench_start();
+        for (i = 0; i < ops; i++) {
+                addr = rnd() % (VES_HOT_SIZE - VES_SMALL_WRITE);
+                memset(buf, (uint8_t) rnd(), VES_SMALL_WRITE);
+                ad_nvms_write(part, addr, buf, VES_SMALL_WRITE);
+        }
+        bench_report("ves random write", ops, (uint64_t) ops * VES_SMALL_WRITE, true);
+
+        bench_start();
+        for (i = 0; i < ops; i++) {
+                addr = rnd() % (VES_HOT_SIZE - VES_SMALL_WRITE);
+                ad_nvms_read(part, addr, buf, VES_SMALL_WRITE);
+        }
+        bench_report("ves random read", ops, (uint64_t) ops * VES_SMALL_WRITE, false);
+
+        bench_start();
+        for (addr = 0, i = 0; addr + BLOCK_SIZE <= size; addr += BLOCK_SIZE, i++) {
+                memset(buf, (uint8_t) i, sizeof(buf));
+                ad_nvms_write(part, addr, buf, BLOCK_SIZE);
+        }
+        bench_report("ves sequential write", i, (uint64_t) i * BLOCK_SIZE, true);
+
+        bench_start();
+        for (addr = 0, i = 0; addr + BLOCK_SIZE <= size; addr += BLOCK_SIZE, i++) {
+                ad_nvms_read(part, addr, buf, BLOCK_SIZE);
+        }
+        bench_report("ves sequential read", i, (uint64_t) i * BLOCK_SIZE, false);
+}
+
+static void bench_direct(nvms_t part, uint32_t ops)
+{
+        uint8_t buf[BLOCK_SIZE];
+        uint32_t i, addr;
+
+        ad_nvms_erase_region(part, 0, LOG_SIZE);
+
+        /* log records appended to erased area */
+        bench_start();
+        for (addr = 0, i = 0; addr + BLOCK_SIZE <= LOG_SIZE; addr += BLOCK_SIZE, i++) {
+                memset(buf, (uint8_t) i, sizeof(buf));
+                ad_nvms_write(part, addr, buf, BLOCK_SIZE);
+        }
+        ad_nvms_flush(part, false);
+        bench_report("direct append", i, (uint64_t) i * BLOCK_SIZE, true);
+
+        /* small updates of written area need sector erase */
+        bench_start();
+        for (i = 0; i < ops; i++) {
+                addr = rnd() % (LOG_SIZE - LOG_UPDATE_SIZE);
+                memset(buf, (uint8_t) rnd(), LOG_UPDATE_SIZE);
+                ad_nvms_write(part, addr, buf, LOG_UPDATE_SIZE);
+        }
+        ad_nvms_flush(part, false);
+        bench_report("direct random update", ops, (uint64_t) ops * LOG_UPDATE_SIZE, true);
+
+        bench_start();
+        for (addr = 0, i = 0; addr + BLOCK_SIZE <= LOG_SIZE; addr += BLOCK_SIZE, i++) {
+                ad_nvms_read(part, addr, buf, BLOCK_SIZE);
+        }
+        bench_report("direct read", i, (uint64_t) i * BLOCK_SIZE, false);
+}
+
+int main(int argc, char **argv)
+{
+        const uint32_t ops = argc > 1 ? strtoul(argv[1], NULL, 0) : 10000;
+        nvms_t generic, log;
+
+        if (ops == 0 || !ad_flash_sim_open(NULL, FLASH_SIZE)) {
+                printf("usage: %s [operations]\n", argv[0]);
+                return 1;
+        }
+
+        ad_nvms_init();
+        generic = ad_nvms_open(NVMS_GENERIC_PART);
+        log = ad_nvms_open(NVMS_LOG_PART);
+        if (generic == NULL || log == NULL) {
+                printf("Generic or log partition missing in partition table\n");
+                return 1;
+        }
+
+        printf("%-20s %7s %9s %9s %7s %6s %6s %8s\n", "pattern", "ops", "us/op", "bytes/s",
+                                                "progs", "erases", "w-amp", "cpu s");
+        bench_ves(generic, ops);
+        bench_direct(log, ops);
+
+        ad_flash_sim_close();
+
+        return 0;
+}
@@ -0,0 +1,172 @@
+/**
+ ****************************************************************************************
+ *
+ * @file ves_bind_bench.c
+ *
+ * @brief Benchmark of VES partition bind on flash simulator
+ *
+ * VES partition is filled by random writes, then it is bound again many times, as on each boot.
+ * Average of each bind is reported: host time, flash accesses through ad_flash_get_ptr() (mostly
+ * container headers read by scan), bytes read through ad_flash_read() and simulated time of
+ * flash operations. Contents read after each bind is checked against data written.
+ *
+ * Bind with CAT checkpoint is compared with full scan of partition by building the benchmark
+ * with AD_NVMS_VES_CHECKPOINT set to 1 and 0. Driver is included in this file, so its state can
+ * be released between binds. Build and run from top of SDK:
+ *
+ *     for ckpt in 0 1; do
+ *             gcc -Wall -O2 -DAD_NVMS_VES_CHECKPOINT=$ckpt \
+ *                     -include sdk_defs.h -Isdk/middleware/adapters/sim/include \
+ *                     -Isdk/middleware/adapters/sim -Isdk/middleware/adapters/include \
+ *                     -Isdk/middleware/adapters/src -Isdk/bsp/util/include \
+ *                     sdk/middleware/adapters/sim/ad_flash_sim.c \
+ *                     sdk/middleware/adapters/sim/ves_bind_bench.c \
+ *                     sdk/bsp/util/src/sdk_crc16.c -o ves_bind_bench && ./ves_bind_bench
+ *     done
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ad_nvms_ves.c"
+#include "ad_flash_sim.h"
+
+#define FLASH_SIZE              (2 * 1024 * 1024)
+#define PART_START              0x10000
+#define MAX_PART_SIZE           0x100000
+#define WRITE_SIZE              32
+#define BINDS                   200
+
+static partition_t part;
+static uint8_t written[MAX_PART_SIZE];
+static uint8_t read_back[MAX_PART_SIZE];
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+        /* xorshift32, fixed seed keeps results comparable between builds */
+        rnd_state ^= rnd_state << 13;
+        rnd_state ^= rnd_state >> 17;
+        rnd_state ^= rnd_state << 5;
+        return rnd_state;
+}
+
+static double now_us(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Forget everything driver kept in RAM, as on reboot */
+static void unbind(void)
+{
+        ves_driver_data_t *ves = (ves_driver_data_t *) part.driver_data;
+
+        if (ves != NULL) {
+                OS_FREE(ves->cat);
+                OS_FREE(ves->free_sector_map);
+                OS_FREE(ves->sector_dirty_count);
+#if AD_NVMS_VES_INCREMENTAL_GC
+                OS_FREE(ves->sector_stamp);
+                OS_FREE(ves->sector_erase_count);
+#endif
+                OS_FREE(ves);
+        }
+#if AD_NVMS_VES_INCREMENTAL_GC
+        gc_partitions = NULL;
+#endif
+        memset(&part, 0, sizeof(part));
+}
+
+static void bind(uint32_t part_size)
+{
+        unbind();
+        part.data.type = NVMS_GENERIC_PART;
+        part.data.start_address = PART_START;
+        part.data.size = part_size;
+        ad_nvms_ves_driver.bind(&part);
+}
+
+static bool bench(uint32_t part_size, uint32_t writes)
+{
+        ad_flash_sim_stats_t before, after;
+        double start, elapsed = 0;
+        uint64_t read_bytes = 0, pointer_reads = 0, busy_ns = 0;
+        size_t size;
+        uint32_t i, addr;
+        int b;
+
+        ad_flash_erase_region(PART_START, part_size);
+        bind(part_size);
+        size = ad_nvms_ves_driver.get_size(&part);
+        memset(written, 0xFF, size);
+
+        /* settings-like workload: small writes, so sectors hold a mix of valid and dirty data */
+        for (i = 0; i < writes; i++) {
+                addr = rnd() % (size - WRITE_SIZE);
+                memset(written + addr, (uint8_t) rnd(), WRITE_SIZE);
+                ad_nvms_ves_driver.write(&part, addr, written + addr, WRITE_SIZE);
+        }
+
+        /* first bind after writes may recycle sectors left dirty, it's not counted */
+        bind(part_size);
+
+        for (b = 0; b < BINDS; b++) {
+                unbind();
+                ad_flash_sim_get_stats(&before);
+                start = now_us();
+                bind(part_size);
+                elapsed += now_us() - start;
+                ad_flash_sim_get_stats(&after);
+                read_bytes += after.read_bytes - before.read_bytes;
+                busy_ns += after.busy_ns - before.busy_ns;
+                pointer_reads += after.pointer_reads - before.pointer_reads;
+
+                ad_nvms_ves_driver.read(&part, 0, read_back, size);
+                if (memcmp(read_back, written, size)) {
+                        printf("FAIL: partition contents differ after bind %d\n", b);
+                        return false;
+                }
+        }
+
+        printf("%4u KB %7u %8zu %10.1f %10.0f %10.0f %10.1f\n", part_size / 1024, writes, size,
+                        elapsed / BINDS, (double) pointer_reads / BINDS,
+                        (double) read_bytes / BINDS, busy_ns / 1e3 / BINDS);
+
+        return true;
+}
+
+int main(void)
+{
+        static const uint32_t part_sizes[] = { 0x20000, 0x80000, MAX_PART_SIZE };
+        unsigned int i;
+        bool ok = true;
+
+        if (!ad_flash_sim_open(NULL, FLASH_SIZE)) {
+                printf("Can't open simulated flash\n");
+                return 1;
+        }
+
+        printf("AD_NVMS_VES_CHECKPOINT %d, average of %d binds\n", AD_NVMS_VES_CHECKPOINT, BINDS);
+        printf("%7s %7s %8s %10s %10s %10s %10s\n", "part", "writes", "size", "bind us",
+                                                        "ptr reads", "read B", "flash us");
+        for (i = 0; ok && i < sizeof(part_sizes) / sizeof(part_sizes[0]); i++) {
+                ok = bench(part_sizes[i], 20000);
+        }
+
+        unbind();
+        ad_flash_sim_close();
+
+        return ok ? 0 : 1;
+}
@@ -0,0 +1,280 @@
+/**
+ ****************************************************************************************
+ *
+ * @file ves_contend_bench.c
+ *
+ * @brief Benchmark of VES partitions used by several tasks on flash simulator
+ *
+ * Tasks are pthreads and flash operations take their simulated time in real time, flash is
+ * locked meanwhile as on target. Reader tasks do small reads of partition A at fixed interval,
+ * like tasks reading settings, while another task writes or reads a lot:
+ *
+ * - writes to partition B, garbage collection of B erases sectors now and then
+ * - writes to partition A
+ * - reads whole partition A again and again
+ *
+ * Latency of small reads (p50, p99, max) and number of operations per second done by the busy
+ * task are reported. With -g all driver calls take one mutex, as VES driver did before each
+ * partition got its own reader/writer lock, so both can be compared. Build and run from top of
+ * SDK:
+ *
+ *     gcc -Wall -O2 -DOS_PRESENT -pthread -include sdk_defs.h \
+ *             -Isdk/middleware/adapters/sim/include -Isdk/middleware/adapters/sim \
+ *             -Isdk/middleware/adapters/include -Isdk/bsp/util/include \
+ *             sdk/middleware/adapters/sim/ad_flash_sim.c \
+ *             sdk/middleware/adapters/src/ad_nvms_ves.c sdk/bsp/util/src/sdk_crc16.c \
+ *             sdk/middleware/adapters/sim/ves_contend_bench.c -o ves_contend_bench
+ *     ./ves_contend_bench [-g] [-r readers] [-t seconds]
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ad_nvms.h"
+#include "ad_nvms_ves.h"
+#include "ad_flash_sim.h"
+
+#define FLASH_SIZE              (2 * 1024 * 1024)
+#define PART_A_START            0x10000
+#define PART_B_START            0x30000
+#define PART_SIZE               0x20000
+#define SMALL_SIZE              64
+#define READ_INTERVAL_US        500
+#define MAX_READERS             8
+#define MAX_SAMPLES             100000
+
+typedef enum {
+        BUSY_WRITE_OTHER,
+        BUSY_WRITE_SAME,
+        BUSY_READ_ALL,
+} busy_t;
+
+typedef struct {
+        pthread_t thread;
+        unsigned int seed;
+        uint32_t count;
+        uint32_t *samples;              /* latency of each small read in us */
+} task_t;
+
+static struct {
+        bool global_lock;               /* emulate one driver mutex for all partitions */
+        int readers;
+        int seconds;
+} cfg = {
+        /* .global_lock = */            false,
+        /* .readers = */                2,
+        /* .seconds = */                3,
+};
+
+static partition_t part_a, part_b;
+static size_t part_a_size;
+static volatile bool stop;
+static busy_t busy;
+static pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static double now_us(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void bench_read(partition_t *part, uint32_t addr, uint8_t *buf, uint32_t size)
+{
+        if (cfg.global_lock) {
+                pthread_mutex_lock(&global_lock);
+        }
+        ad_nvms_ves_driver.read(part, addr, buf, size);
+        if (cfg.global_lock) {
+                pthread_mutex_unlock(&global_lock);
+        }
+}
+
+static void bench_write(partition_t *part, uint32_t addr, const uint8_t *buf, uint32_t size)
+{
+        if (cfg.global_lock) {
+                pthread_mutex_lock(&global_lock);
+        }
+        ad_nvms_ves_driver.write(part, addr, buf, size);
+        if (cfg.global_lock) {
+                pthread_mutex_unlock(&global_lock);
+        }
+}
+
+static void *reader_task(void *arg)
+{
+        task_t *task = arg;
+        uint8_t buf[SMALL_SIZE];
+        double start;
+        uint32_t addr;
+
+        while (!stop && task->count < MAX_SAMPLES) {
+                addr = rand_r(&task->seed) % (part_a_size - SMALL_SIZE);
+                start = now_us();
+                bench_read(&part_a, addr, buf, SMALL_SIZE);
+                task->samples[task->count++] = (uint32_t) (now_us() - start);
+                usleep(READ_INTERVAL_US);
+        }
+
+        return NULL;
+}
+
+static void *busy_task(void *arg)
+{
+        task_t *task = arg;
+        static uint8_t buf[PART_SIZE];
+        partition_t *part = busy == BUSY_WRITE_OTHER ? &part_b : &part_a;
+        const size_t size = ad_nvms_ves_driver.get_size(part);
+        uint32_t addr;
+
+        while (!stop) {
+                if (busy == BUSY_READ_ALL) {
+                        bench_read(part, 0, buf, size);
+                } else {
+                        addr = rand_r(&task->seed) % (size - SMALL_SIZE);
+                        memset(buf, rand_r(&task->seed), SMALL_SIZE);
+                        bench_write(part, addr, buf, SMALL_SIZE);
+                }
+                task->count++;
+        }
+
+        return NULL;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+        const uint32_t x = *(const uint32_t *) a;
+        const uint32_t y = *(const uint32_t *) b;
+
+        return x < y ? -1 : x > y;
+}
+
+static bool bench(const char *name, busy_t what)
+{
+        task_t tasks[MAX_READERS + 1];
+        uint32_t *all;
+        uint32_t n = 0;
+        int i;
+
+        memset(tasks, 0, sizeof(tasks));
+        all = malloc((size_t) cfg.readers * MAX_SAMPLES * sizeof(*all));
+        if (all == NULL) {
+                return false;
+        }
+
+        busy = what;
+        stop = false;
+        for (i = 0; i <= cfg.readers; i++) {
+                tasks[i].seed = i + 1;
+                tasks[i].samples = all + (size_t) i * MAX_SAMPLES;
+                pthread_create(&tasks[i].thread, NULL, i < cfg.readers ? reader_task : busy_task,
+                                                                                &tasks[i]);
+        }
+        sleep(cfg.seconds);
+        stop = true;
+
+        /* samples of readers are moved together to sort them */
+        for (i = 0; i <= cfg.readers; i++) {
+                pthread_join(tasks[i].thread, NULL);
+                if (i < cfg.readers) {
+                        memmove(all + n, tasks[i].samples, tasks[i].count * sizeof(*all));
+                        n += tasks[i].count;
+                }
+        }
+        qsort(all, n, sizeof(*all), cmp_u32);
+
+        printf("%-24s %8u %8u %8u %8u %10.1f\n", name, n, n ? all[n / 2] : 0,
+                                n ? all[n * 99 / 100] : 0, n ? all[n - 1] : 0,
+                                (double) tasks[cfg.readers].count / cfg.seconds);
+        free(all);
+
+        return true;
+}
+
+static void bind(partition_t *part, uint32_t start)
+{
+        part->data.type = NVMS_GENERIC_PART;
+        part->data.start_address = start;
+        part->data.size = PART_SIZE;
+        ad_nvms_ves_driver.bind(part);
+}
+
+static void usage(const char *name)
+{
+        printf("usage: %s [-g] [-r readers] [-t seconds]\n"
+                "    -g          one lock for all partitions\n"
+                "    -r readers  tasks doing small reads, 1..%d (default %d)\n"
+                "    -t seconds  duration of each pattern (default %d)\n",
+                name, MAX_READERS, cfg.readers, cfg.seconds);
+}
+
+int main(int argc, char **argv)
+{
+        uint8_t buf[SMALL_SIZE];
+        uint32_t addr;
+        bool ok;
+        int opt;
+
+        while ((opt = getopt(argc, argv, "gr:t:")) != -1) {
+                switch (opt) {
+                case 'g':
+                        cfg.global_lock = true;
+                        break;
+                case 'r':
+                        cfg.readers = atoi(optarg);
+                        break;
+                case 't':
+                        cfg.seconds = atoi(optarg);
+                        break;
+                default:
+                        usage(argv[0]);
+                        return 1;
+                }
+        }
+        if (cfg.readers < 1 || cfg.readers > MAX_READERS || cfg.seconds < 1) {
+                usage(argv[0]);
+                return 1;
+        }
+
+        if (!ad_flash_sim_open(NULL, FLASH_SIZE)) {
+                printf("Can't open simulated flash\n");
+                return 1;
+        }
+
+        ad_nvms_ves_init();
+        bind(&part_a, PART_A_START);
+        bind(&part_b, PART_B_START);
+        part_a_size = ad_nvms_ves_driver.get_size(&part_a);
+
+        /* partition A is filled, so small reads get data from flash */
+        for (addr = 0; addr + SMALL_SIZE <= part_a_size; addr += SMALL_SIZE) {
+                memset(buf, (uint8_t) addr, sizeof(buf));
+                ad_nvms_ves_driver.write(&part_a, addr, buf, sizeof(buf));
+        }
+
+        ad_flash_sim_set_realtime(true);
+
+        printf("%s, %d readers every %d us, %d s per pattern\n",
+                                cfg.global_lock ? "one lock for all partitions" :
+                                "lock per partition", cfg.readers, READ_INTERVAL_US, cfg.seconds);
+        printf("%-24s %8s %8s %8s %8s %10s\n", "busy task", "reads", "p50 us", "p99 us",
+                                                                        "max us", "busy ops/s");
+        ok = bench("write other partition", BUSY_WRITE_OTHER) &&
+                bench("write same partition", BUSY_WRITE_SAME) &&
+                bench("read whole partition", BUSY_READ_ALL);
+
+        ad_flash_sim_close();
+
+        return ok ? 0 : 1;
+}
@@ -0,0 +1,412 @@
+/**
+ ****************************************************************************************
+ *
+ * @file ves_fuzz.c
+ *
+ * @brief Power loss fuzz test of NVMS VES driver on flash simulator
+ *
+ * Random writes are done to VES partition while power loss is injected at random page program
+ * or sector erase. After each power loss partition is bound again, as after reboot, and its
+ * contents are compared with what was written before:
+ * - each container touched by interrupted write holds either old or new data; without
+ *   CONFIG_NVMS_USE_CRC, container updated in place may also hold data between old and new,
+ * - interrupted transaction (AD_NVMS_VES_TRANSACTIONS) is either fully applied or not at all,
+ * - interrupted step of background garbage collection (AD_NVMS_VES_INCREMENTAL_GC) doesn't
+ *   change data,
+ * - containers not touched by interrupted operation are unchanged.
+ * With AD_NVMS_VES_INCREMENTAL_GC and AD_NVMS_VES_CHECKPOINT, sector erase counts must not go
+ * back after reboot.
+ *
+ * Interrupted operation stops at byte boundary. When third argument is 1, byte being programmed
+ * gets only some of its bits programmed. Interrupted write of container index may then leave
+ * index of other container, which VES can't detect, so failures in this mode are expected.
+ *
+ * Driver is included in this file, so its state can be released on simulated reboot. Build and
+ * run from top of SDK with any combination of VES options, e.g.:
+ *
+ *     gcc -Wall -O2 -DCONFIG_NVMS_USE_CRC -DAD_NVMS_VES_TRANSACTIONS=1 \
+ *             -DAD_NVMS_VES_INCREMENTAL_GC=1 -DAD_NVMS_VES_CHECKPOINT=1 \
+ *             -include sdk_defs.h -Isdk/middleware/adapters/sim/include \
+ *             -Isdk/middleware/adapters/sim -Isdk/middleware/adapters/include \
+ *             -Isdk/middleware/adapters/src -Isdk/bsp/util/include \
+ *             sdk/middleware/adapters/sim/ad_flash_sim.c sdk/middleware/adapters/sim/ves_fuzz.c \
+ *             sdk/bsp/util/src/sdk_crc16.c -o ves_fuzz
+ *     ./ves_fuzz [seed [iterations [unstable]]]
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ad_nvms_ves.c"
+#include "ad_flash_sim.h"
+
+#define FLASH_SIZE              (1024 * 1024)
+#define PART_START              0x10000
+#define PART_SIZE               0x10000
+#define MAX_WRITE_SIZE          200
+/* Power loss is injected at one of that many next program or erase operations */
+#define MAX_LOSS_OP             40
+
+typedef enum {
+        OP_WRITE,
+        OP_TXN,
+        OP_GC,
+} op_t;
+
+static partition_t part;
+static size_t part_size;
+static jmp_buf power_loss;
+static int failures;
+
+/* Data written before current operation, expected after it and read back */
+static uint8_t old_data[PART_SIZE];
+static uint8_t new_data[PART_SIZE];
+static uint8_t read_data[PART_SIZE];
+
+static struct {
+        uint32_t writes;
+        uint32_t txns;
+        uint32_t gc_steps;
+        uint32_t power_losses;
+        uint32_t old_state;
+        uint32_t new_state;
+        uint32_t partial_in_place;
+} counters;
+
+#define CHECK(cond, ...) \
+        do { \
+                if (!(cond)) { \
+                        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+                        printf(__VA_ARGS__); \
+                        printf("\n"); \
+                        failures++; \
+                        return false; \
+                } \
+        } while (0)
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+        /* xorshift32, seed from command line keeps failure reproducible */
+        rnd_state ^= rnd_state << 13;
+        rnd_state ^= rnd_state >> 17;
+        rnd_state ^= rnd_state << 5;
+        return rnd_state;
+}
+
+static void lose_power(void)
+{
+        longjmp(power_loss, 1);
+}
+
+/* Simulate reboot: forget everything driver kept in RAM and bind partition again */
+static void reboot(void)
+{
+        ves_driver_data_t *ves = (ves_driver_data_t *) part.driver_data;
+
+        if (ves != NULL) {
+                OS_FREE(ves->cat);
+                OS_FREE(ves->free_sector_map);
+                OS_FREE(ves->sector_dirty_count);
+#if AD_NVMS_VES_INCREMENTAL_GC
+                OS_FREE(ves->sector_stamp);
+                OS_FREE(ves->sector_erase_count);
+#endif
+                OS_FREE(ves);
+        }
+#if AD_NVMS_VES_INCREMENTAL_GC
+        gc_partitions = NULL;
+#endif
+
+        memset(&part, 0, sizeof(part));
+        part.data.type = NVMS_GENERIC_PART;
+        part.data.start_address = PART_START;
+        part.data.size = PART_SIZE;
+        ad_nvms_ves_driver.bind(&part);
+        part_size = ad_nvms_ves_driver.get_size(&part);
+}
+
+static void random_write(uint32_t *addr, uint8_t *buf, uint32_t *len)
+{
+        uint32_t i;
+
+        *addr = rnd() % part_size;
+        *len = 1 + rnd() % MAX_WRITE_SIZE;
+        if (*addr + *len > part_size) {
+                *len = part_size - *addr;
+        }
+
+        for (i = 0; i < *len; i++) {
+                /* some writes only clear bits, so they can be done in place */
+                buf[i] = (rnd() & 3) ? (uint8_t) rnd() : old_data[*addr + i] & (uint8_t) rnd();
+        }
+}
+
+static void do_write(void)
+{
+        uint8_t buf[MAX_WRITE_SIZE];
+        uint32_t addr, len;
+
+        random_write(&addr, buf, &len);
+        memcpy(new_data + addr, buf, len);
+        ad_nvms_ves_driver.write(&part, addr, buf, len);
+        counters.writes++;
+}
+
+#if AD_NVMS_VES_TRANSACTIONS
+static ad_nvms_ves_txn_t txn;
+
+static void do_txn(void)
+{
+        uint8_t buf[MAX_WRITE_SIZE];
+        uint32_t addr, len;
+        int n;
+
+        txn = ad_nvms_ves_txn_begin((nvms_t) &part);
+        for (n = 1 + rnd() % 4; n > 0; n--) {
+                random_write(&addr, buf, &len);
+                if (ad_nvms_ves_txn_write(txn, addr, buf, len) >= 0) {
+                        memcpy(new_data + addr, buf, len);
+                }
+        }
+        /* commit frees transaction */
+        ad_nvms_ves_txn_commit(txn);
+        txn = NULL;
+        counters.txns++;
+}
+#endif
+
+#if AD_NVMS_VES_INCREMENTAL_GC
+static void do_gc(void)
+{
+        while (ad_nvms_ves_gc_step() && (rnd() & 3)) {
+                counters.gc_steps++;
+        }
+}
+#endif
+
+static void do_op(op_t op)
+{
+        switch (op) {
+#if AD_NVMS_VES_TRANSACTIONS
+        case OP_TXN:
+                do_txn();
+                break;
+#endif
+#if AD_NVMS_VES_INCREMENTAL_GC
+        case OP_GC:
+                do_gc();
+                break;
+#endif
+        default:
+                do_write();
+                break;
+        }
+}
+
+/* Bits of each byte are between old and new value, as when in place program is interrupted */
+static bool between(const uint8_t *got, const uint8_t *old, const uint8_t *new, size_t len)
+{
+#ifdef CONFIG_NVMS_USE_CRC
+        /* container with partially programmed data fails CRC check and is not used */
+        (void) got;
+        (void) old;
+        (void) new;
+        (void) len;
+        return false;
+#else
+        size_t i;
+
+        for (i = 0; i < len; i++) {
+                if ((got[i] & new[i]) != new[i] || (got[i] & ~old[i])) {
+                        return false;
+                }
+        }
+
+        return true;
+#endif
+}
+
+static bool check_after_power_loss(int iteration, op_t op)
+{
+        const size_t data_size = ((ves_driver_data_t *) part.driver_data)->container_data_size;
+        size_t off, len;
+
+        CHECK(ad_nvms_ves_driver.read(&part, 0, read_data, part_size) == (int) part_size,
+                                        "iteration %d: read failed after power loss", iteration);
+
+        if (op == OP_TXN) {
+                if (!memcmp(read_data, old_data, part_size)) {
+                        counters.old_state++;
+                        return true;
+                }
+                CHECK(!memcmp(read_data, new_data, part_size),
+                                        "iteration %d: transaction partially applied", iteration);
+                counters.new_state++;
+                return true;
+        }
+
+        for (off = 0; off < part_size; off += len) {
+                len = part_size - off < data_size ? part_size - off : data_size;
+                if (!memcmp(read_data + off, old_data + off, len)) {
+                        continue;
+                }
+                if (!memcmp(read_data + off, new_data + off, len)) {
+                        counters.new_state++;
+                        continue;
+                }
+                CHECK(op == OP_WRITE && between(read_data + off, old_data + off, new_data + off,
+                                                                                        len),
+                                "iteration %d: container at %zu holds neither old nor new data",
+                                                                                iteration, off);
+                counters.partial_in_place++;
+        }
+
+        return true;
+}
+
+static bool check_contents(int iteration)
+{
+        size_t i;
+
+        CHECK(ad_nvms_ves_driver.read(&part, 0, read_data, part_size) == (int) part_size,
+                                                        "iteration %d: read failed", iteration);
+        for (i = 0; i < part_size && read_data[i] == old_data[i]; i++) {
+        }
+        CHECK(i == part_size, "iteration %d: data at %zu is %02X, expected %02X", iteration, i,
+                                                                read_data[i], old_data[i]);
+
+        return true;
+}
+
+/* Reboot without power loss, wear leveling data stored in checkpoint must survive it */
+static bool reboot_and_check_wear(int iteration)
+{
+#if AD_NVMS_VES_INCREMENTAL_GC && AD_NVMS_VES_CHECKPOINT
+        ves_driver_data_t *ves = (ves_driver_data_t *) part.driver_data;
+        uint16_t erase_count[PART_SIZE / FLASH_SECTOR_SIZE];
+        sec_cnt_t i;
+
+        memcpy(erase_count, ves->sector_erase_count, ves->sector_count * sizeof(uint16_t));
+        reboot();
+        ves = (ves_driver_data_t *) part.driver_data;
+        for (i = 0; ves->ckpt_slot_sectors && i < ves->sector_count; i++) {
+                CHECK(ves->sector_erase_count[i] >= erase_count[i],
+                                "iteration %d: erase count of sector %u is %u, was %u",
+                                iteration, i, ves->sector_erase_count[i], erase_count[i]);
+        }
+#else
+        (void) iteration;
+        reboot();
+#endif
+
+        return true;
+}
+
+/* Do one random operation, possibly interrupted by power loss, and check data after it */
+static bool fuzz_iteration(int iteration)
+{
+        volatile op_t op = OP_WRITE;
+
+#if AD_NVMS_VES_TRANSACTIONS
+        if (rnd() % 4 == 0) {
+                op = OP_TXN;
+        }
+#endif
+#if AD_NVMS_VES_INCREMENTAL_GC
+        if (rnd() % 4 == 0) {
+                op = OP_GC;
+        }
+#endif
+        memcpy(new_data, old_data, part_size);
+
+        if (rnd() % 3 == 0) {
+                ad_flash_sim_power_loss_at(1 + rnd() % MAX_LOSS_OP, lose_power);
+        }
+
+        if (setjmp(power_loss) == 0) {
+                do_op(op);
+                ad_flash_sim_power_loss_at(0, NULL);
+                memcpy(old_data, new_data, part_size);
+        } else {
+#if AD_NVMS_VES_TRANSACTIONS
+                OS_FREE(txn);
+                txn = NULL;
+#endif
+                counters.power_losses++;
+                reboot();
+                if (!check_after_power_loss(iteration, op)) {
+                        return false;
+                }
+                /* whatever survived is the base for next writes */
+                memcpy(old_data, read_data, part_size);
+        }
+
+        if (rnd() % 50 == 0 && !reboot_and_check_wear(iteration)) {
+                return false;
+        }
+
+        return rnd() % 10 != 0 || check_contents(iteration);
+}
+
+int main(int argc, char **argv)
+{
+        const uint32_t seed = argc > 1 ? strtoul(argv[1], NULL, 0) : 1;
+        const int iterations = argc > 2 ? atoi(argv[2]) : 20000;
+        ad_flash_sim_stats_t stats;
+        uint32_t addr, count, min_erases = UINT32_MAX, max_erases = 0;
+        int i;
+
+        rnd_state = seed ? seed : 1;
+        if (!ad_flash_sim_open(NULL, FLASH_SIZE)) {
+                printf("Can't open simulated flash\n");
+                return 1;
+        }
+        ad_flash_sim_set_seed(seed);
+        ad_flash_sim_set_unstable_byte(argc > 3 && atoi(argv[3]));
+        ad_nvms_ves_init();
+        reboot();
+        memset(old_data, 0xFF, sizeof(old_data));
+
+        printf("seed %u, partition size %zu, container data size %u\n", (unsigned) seed,
+                        part_size, ((ves_driver_data_t *) part.driver_data)->container_data_size);
+
+        for (i = 0; i < iterations && fuzz_iteration(i); i++) {
+        }
+        if (i == iterations) {
+                check_contents(i);
+        }
+
+        ad_flash_sim_get_stats(&stats);
+        for (addr = PART_START; addr < PART_START + PART_SIZE; addr += FLASH_SECTOR_SIZE) {
+                count = ad_flash_sim_erase_count(addr);
+                min_erases = count < min_erases ? count : min_erases;
+                max_erases = count > max_erases ? count : max_erases;
+        }
+        printf("%u writes, %u transactions, %u GC steps\n", counters.writes, counters.txns,
+                                                                        counters.gc_steps);
+        printf("%u power losses: %u containers new, %u partial in place, %u transactions old\n",
+                        counters.power_losses, counters.new_state, counters.partial_in_place,
+                        counters.old_state);
+        printf("%u programs, %u erases (%u..%u per sector), simulated busy %.1f s\n",
+                        stats.page_programs, stats.sector_erases, min_erases, max_erases,
+                        stats.busy_ns / 1e9);
+
+        ad_flash_sim_close();
+
+        if (failures) {
+                printf("%d test(s) failed\n", failures);
+                return 1;
+        }
+
+        printf("All tests passed\n");
+        return 0;
+}
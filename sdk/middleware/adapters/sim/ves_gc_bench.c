@@ -0,0 +1,182 @@
+/**
+ ****************************************************************************************
+ *
+ * @file ves_gc_bench.c
+ *
+ * @brief Benchmark of VES write latency caused by garbage collection on flash simulator
+ *
+ * VES partition is filled with records of one container each, then records are rewritten at
+ * random, 80% of writes going to 10% of records. Simulated flash time of each write is recorded
+ * and mean, percentiles and maximum are reported, together with number of sector erases and
+ * spread of erase counts of partition sectors (wear).
+ *
+ * Garbage collection done inside writes is compared with incremental one by building the
+ * benchmark with AD_NVMS_VES_INCREMENTAL_GC set to 0 and 1. In the latter case after each write
+ * ad_nvms_ves_gc_step() is called, as background task would do while application is idle, up to
+ * given number of times (until no more steps are needed by default) and longest step is reported.
+ * Driver is included in this file to get container size. Build and run from top of SDK:
+ *
+ *     for gc in 0 1; do
+ *             gcc -Wall -O2 -DAD_NVMS_VES_INCREMENTAL_GC=$gc \
+ *                     -include sdk_defs.h -Isdk/middleware/adapters/sim/include \
+ *                     -Isdk/middleware/adapters/sim -Isdk/middleware/adapters/include \
+ *                     -Isdk/middleware/adapters/src -Isdk/bsp/util/include \
+ *                     sdk/middleware/adapters/sim/ad_flash_sim.c \
+ *                     sdk/middleware/adapters/sim/ves_gc_bench.c \
+ *                     sdk/bsp/util/src/sdk_crc16.c -o ves_gc_bench && ./ves_gc_bench
+ *     done
+ *     ./ves_gc_bench [writes [steps per write]]
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ad_nvms_ves.c"
+#include "ad_flash_sim.h"
+
+#define FLASH_SIZE              (2 * 1024 * 1024)
+#define PART_START              0x10000
+#define PART_SIZE               0x40000
+/* Percentage of writes that go to hot records, and percentage of records that are hot */
+#define HOT_WRITES              80
+#define HOT_RECORDS             10
+
+static partition_t part;
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+        /* xorshift32, fixed seed keeps results comparable between builds */
+        rnd_state ^= rnd_state << 13;
+        rnd_state ^= rnd_state >> 17;
+        rnd_state ^= rnd_state << 5;
+        return rnd_state;
+}
+
+static uint64_t busy_ns(void)
+{
+        ad_flash_sim_stats_t stats;
+
+        ad_flash_sim_get_stats(&stats);
+
+        return stats.busy_ns;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+        const uint64_t x = *(const uint64_t *) a;
+        const uint64_t y = *(const uint64_t *) b;
+
+        return x < y ? -1 : x > y;
+}
+
+#if AD_NVMS_VES_INCREMENTAL_GC
+/* Background task has time for this many steps after each write, returns longest one */
+static uint64_t idle_gc(uint32_t steps)
+{
+        uint64_t start, step_ns, max_ns = 0;
+        bool more = true;
+        uint32_t i;
+
+        for (i = 0; more && (steps == 0 || i < steps); i++) {
+                start = busy_ns();
+                more = ad_nvms_ves_gc_step();
+                step_ns = busy_ns() - start;
+                if (step_ns > max_ns) {
+                        max_ns = step_ns;
+                }
+        }
+
+        return max_ns;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+        const uint32_t writes = argc > 1 ? strtoul(argv[1], NULL, 0) : 300000;
+        const uint32_t steps = argc > 2 ? strtoul(argv[2], NULL, 0) : 0;
+        ad_flash_sim_stats_t stats;
+        ves_driver_data_t *ves;
+        uint8_t buf[AD_NVMS_VES_CONTAINER_SIZE];
+        uint64_t *latency;
+        uint64_t start, total = 0, max_step = 0;
+        uint32_t records, record, erase_count, wear_min = UINT32_MAX, wear_max = 0;
+        uint32_t i;
+
+        latency = malloc(writes * sizeof(*latency));
+        if (writes == 0 || latency == NULL || !ad_flash_sim_open(NULL, FLASH_SIZE)) {
+                printf("usage: %s [writes [steps per write]]\n", argv[0]);
+                return 1;
+        }
+
+        part.data.type = NVMS_GENERIC_PART;
+        part.data.start_address = PART_START;
+        part.data.size = PART_SIZE;
+        ad_nvms_ves_init();
+        ad_nvms_ves_driver.bind(&part);
+        ves = (ves_driver_data_t *) part.driver_data;
+
+        records = ad_nvms_ves_driver.get_size(&part) / ves->container_data_size;
+        for (record = 0; record < records; record++) {
+                memset(buf, (uint8_t) record, ves->container_data_size);
+                ad_nvms_ves_driver.write(&part, record * ves->container_data_size, buf,
+                                                                        ves->container_data_size);
+        }
+        ad_flash_sim_reset_stats();
+
+        for (i = 0; i < writes; i++) {
+                if (rnd() % 100 < HOT_WRITES) {
+                        record = rnd() % (records * HOT_RECORDS / 100);
+                } else {
+                        record = rnd() % records;
+                }
+                memset(buf, (uint8_t) rnd(), ves->container_data_size);
+
+                start = busy_ns();
+                ad_nvms_ves_driver.write(&part, record * ves->container_data_size, buf,
+                                                                        ves->container_data_size);
+                latency[i] = busy_ns() - start;
+                total += latency[i];
+#if AD_NVMS_VES_INCREMENTAL_GC
+                start = idle_gc(steps);
+                if (start > max_step) {
+                        max_step = start;
+                }
+#else
+                (void) steps;
+#endif
+        }
+
+        for (i = 0; i < ves->sector_count; i++) {
+                erase_count = ad_flash_sim_erase_count(PART_START + i * FLASH_SECTOR_SIZE);
+                if (erase_count < wear_min) {
+                        wear_min = erase_count;
+                }
+                if (erase_count > wear_max) {
+                        wear_max = erase_count;
+                }
+        }
+        ad_flash_sim_get_stats(&stats);
+        qsort(latency, writes, sizeof(*latency), cmp_u64);
+
+        printf("AD_NVMS_VES_INCREMENTAL_GC %d, %u writes of %u records, %u KB partition\n",
+                        AD_NVMS_VES_INCREMENTAL_GC, writes, records, PART_SIZE / 1024);
+        printf("%10s %10s %10s %10s %10s %8s %12s %10s\n", "mean us", "p50 us", "p99 us",
+                        "p99.9 us", "max us", "erases", "max step us", "wear");
+        printf("%10.0f %10.0f %10.0f %10.0f %10.0f %8u %12.0f %5u..%u\n", total / 1e3 / writes,
+                        latency[writes / 2] / 1e3, latency[writes / 100 * 99] / 1e3,
+                        latency[writes / 1000 * 999] / 1e3, latency[writes - 1] / 1e3,
+                        stats.sector_erases, max_step / 1e3, wear_min, wear_max);
+
+        free(latency);
+        ad_flash_sim_close();
+
+        return 0;
+}
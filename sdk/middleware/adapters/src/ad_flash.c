@@ -35,6 +35,17 @@
 #include "hw_cache.h"
 #include "hw_sys.h"
 
+#if AD_FLASH_ASYNC_READ
+#if !dg_configUSE_HW_DMA
+#error "AD_FLASH_ASYNC_READ requires dg_configUSE_HW_DMA"
+#endif
+#if AD_FLASH_ASYNC_SEGMENT_SIZE > 0x10000
+#error "AD_FLASH_ASYNC_SEGMENT_SIZE exceeds maximum DMA transfer length"
+#endif
+#include "hw_dma.h"
+#include "resmgmt.h"
+#endif
+
 /**
  * Enable/Disable run-time checks for possible cache incoherence:
  *  - 1 to enable
@@ -59,6 +70,32 @@ __RETAINED static OS_MUTEX flash_mutex;
 __RETAINED static uint32_t no_cache_flush_base;
 __RETAINED static uint32_t no_cache_flush_end;
 
+#if AD_FLASH_ASYNC_READ
+/* State of asynchronous read, fields are shared with DMA interrupt */
+typedef struct {
+        const ad_flash_sg_entry_t *sg;
+        size_t count;
+        size_t entry;           /* Entry being read */
+        size_t offset;          /* Offset in entry being read */
+        size_t segment;         /* Size of DMA transfer in progress */
+        size_t read;            /* Bytes read so far */
+        ad_flash_read_cb cb;
+        void *user_data;
+        bool pending;           /* Read started and not finished */
+        bool active;            /* DMA transfer in progress */
+        bool paused;            /* Flash is locked, next transfer can't be started */
+} async_read_t;
+
+__RETAINED static volatile async_read_t async_read;
+/* Nesting level of ad_flash_lock(), only accessed by task holding flash_mutex */
+__RETAINED static uint32_t lock_depth;
+#ifdef OS_PRESENT
+__RETAINED static OS_EVENT async_read_idle;
+#endif
+
+#define ASYNC_READ_RES_MASK     RES_MASK(RES_ID_DMA_CH0 + AD_FLASH_ASYNC_DMA_CHANNEL)
+#endif /* AD_FLASH_ASYNC_READ */
+
 __STATIC_INLINE bool is_flash_addr_cached(uint32_t addr)
 {
         uint32_t cache_len;
@@ -96,6 +133,10 @@ void ad_flash_init(void)
 #ifdef OS_PRESENT
                 OS_MUTEX_CREATE(flash_mutex);
                 OS_ASSERT(flash_mutex);
+#if AD_FLASH_ASYNC_READ
+                OS_EVENT_CREATE(async_read_idle);
+                OS_ASSERT(async_read_idle);
+#endif
 #endif
 
                 ad_flash_lock();
@@ -431,6 +472,184 @@ static bool get_automode_addr(uint32_t addr, const uint8_t **automode_addr)
         return false;
 }
 
+#if AD_FLASH_ASYNC_READ
+/* Skip entries that are fully read, returns false if there is nothing more to read */
+static bool async_read_advance(size_t len)
+{
+        async_read.read += len;
+        async_read.offset += len;
+
+        while (async_read.entry < async_read.count &&
+                                async_read.offset >= async_read.sg[async_read.entry].len) {
+                async_read.entry++;
+                async_read.offset = 0;
+        }
+
+        return async_read.entry < async_read.count;
+}
+
+static void async_read_start_transfer(void);
+
+static void async_read_finish(void)
+{
+        ad_flash_read_cb cb = async_read.cb;
+        void *user_data = async_read.user_data;
+        size_t read = async_read.read;
+
+        async_read.pending = false;
+#ifdef OS_PRESENT
+        pm_sleep_mode_release(pm_mode_idle);
+#endif
+        resource_release(ASYNC_READ_RES_MASK);
+
+        if (cb) {
+                cb(user_data, read);
+        }
+}
+
+static void async_read_dma_cb(void *user_data, dma_size_t len)
+{
+        async_read.active = false;
+
+        if (!async_read_advance(async_read.segment)) {
+                async_read_finish();
+        } else if (!async_read.paused) {
+                async_read_start_transfer();
+        }
+
+        /* Task in ad_flash_lock() waits for transfer to finish */
+        if (async_read.paused) {
+#ifdef OS_PRESENT
+                OS_EVENT_SIGNAL_FROM_ISR(async_read_idle);
+#endif
+        }
+}
+
+static void async_read_start_transfer(void)
+{
+        const ad_flash_sg_entry_t *entry = &async_read.sg[async_read.entry];
+        uint8_t *dst = entry->buf + async_read.offset;
+        const uint8_t *src = NULL;
+        size_t len = entry->len - async_read.offset;
+        DMA_setup setup;
+
+        if (len > AD_FLASH_ASYNC_SEGMENT_SIZE) {
+                len = AD_FLASH_ASYNC_SEGMENT_SIZE;
+        }
+        get_automode_addr(entry->addr + async_read.offset, &src);
+
+        /* Word transfers when possible, they need 4 times less bus cycles */
+        if ((((uint32_t) src | (uint32_t) dst | len) & 3) == 0) {
+                setup.bus_width = HW_DMA_BW_WORD;
+                setup.length = len / 4;
+        } else {
+                setup.bus_width = HW_DMA_BW_BYTE;
+                setup.length = len;
+        }
+        setup.channel_number = AD_FLASH_ASYNC_DMA_CHANNEL;
+        setup.irq_enable = HW_DMA_IRQ_STATE_ENABLED;
+        setup.irq_nr_of_trans = 0;
+        setup.dreq_mode = HW_DMA_DREQ_START;
+        setup.burst_mode = HW_DMA_BURST_MODE_DISABLED;
+        setup.a_inc = HW_DMA_AINC_TRUE;
+        setup.b_inc = HW_DMA_BINC_TRUE;
+        setup.circular = HW_DMA_MODE_NORMAL;
+        setup.dma_prio = HW_DMA_PRIO_2;
+        setup.dma_idle = HW_DMA_IDLE_INTERRUPTING_MODE;
+        setup.dma_init = HW_DMA_INIT_AX_BX_AY_BY;
+        setup.dma_req_mux = HW_DMA_TRIG_NONE;
+        setup.src_address = (uint32_t) src;
+        setup.dest_address = (uint32_t) dst;
+        setup.callback = async_read_dma_cb;
+        setup.user_data = NULL;
+
+        async_read.segment = len;
+        async_read.active = true;
+        hw_dma_channel_initialization(&setup);
+        hw_dma_channel_enable(AD_FLASH_ASYNC_DMA_CHANNEL, HW_DMA_STATE_ENABLED);
+}
+
+/* Called when flash gets locked, waits for DMA transfer in progress */
+static void async_read_pause(void)
+{
+        bool active;
+
+        OS_ENTER_CRITICAL_SECTION();
+        async_read.paused = true;
+        active = async_read.active;
+        OS_LEAVE_CRITICAL_SECTION();
+
+        if (active) {
+#ifdef OS_PRESENT
+                OS_EVENT_WAIT(async_read_idle, OS_EVENT_FOREVER);
+#else
+                while (async_read.active) {
+                }
+#endif
+        }
+}
+
+/* Called when flash gets unlocked, starts next transfer of pending read */
+static void async_read_resume(void)
+{
+        async_read.paused = false;
+
+        if (async_read.pending) {
+                async_read_start_transfer();
+        }
+}
+
+bool ad_flash_read_async(const ad_flash_sg_entry_t *sg, size_t count, ad_flash_read_cb cb,
+                                                                                void *user_data)
+{
+        const uint8_t *start;
+        const uint8_t *end;
+        size_t i;
+
+        ASSERT_WARNING(sg || count == 0);
+
+        /* Each entry must be in one memory device */
+        for (i = 0; i < count; ++i) {
+                if (sg[i].len == 0) {
+                        continue;
+                }
+                ASSERT_WARNING(sg[i].buf);
+                if (!get_automode_addr(sg[i].addr, &start) ||
+                                !get_automode_addr(sg[i].addr + sg[i].len - 1, &end) ||
+                                end - start != sg[i].len - 1) {
+                        return false;
+                }
+        }
+
+        resource_acquire(ASYNC_READ_RES_MASK, RES_WAIT_FOREVER);
+#ifdef OS_PRESENT
+        /* DMA interrupt must not be lost in sleep */
+        pm_sleep_mode_request(pm_mode_idle);
+#endif
+
+        /* With flash locked, first transfer is started by ad_flash_unlock() */
+        ad_flash_lock();
+
+        async_read.sg = sg;
+        async_read.count = count;
+        async_read.entry = 0;
+        async_read.offset = 0;
+        async_read.read = 0;
+        async_read.cb = cb;
+        async_read.user_data = user_data;
+        async_read.pending = async_read_advance(0);
+        if (!async_read.pending) {
+                ad_flash_unlock();
+                async_read_finish();
+                return true;
+        }
+
+        ad_flash_unlock();
+
+        return true;
+}
+#endif /* AD_FLASH_ASYNC_READ */
+
 int ad_flash_update_possible(uint32_t addr, const uint8_t *data_to_write, size_t size)
 {
         int i;
@@ -473,10 +692,20 @@ void ad_flash_lock(void)
 #ifdef OS_PRESENT
         OS_MUTEX_GET(flash_mutex, OS_MUTEX_FOREVER);
 #endif
+#if AD_FLASH_ASYNC_READ
+        if (lock_depth++ == 0) {
+                async_read_pause();
+        }
+#endif
 }
 
 void ad_flash_unlock(void)
 {
+#if AD_FLASH_ASYNC_READ
+        if (--lock_depth == 0) {
+                async_read_resume();
+        }
+#endif
 #ifdef OS_PRESENT
         OS_MUTEX_PUT(flash_mutex);
 #endif
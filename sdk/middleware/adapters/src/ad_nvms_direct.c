@@ -36,10 +36,28 @@
 #define DIRECT_DRIVER_STRATEGY          (DIRECT_DRIVER_STATIC_SECTOR_BUF)
 #endif
 
+#if dg_configNVMS_FLASH_CACHE
+#define CACHED_SECTOR_COUNT             AD_NVMS_DIRECT_CACHE_SECTORS
+#else
+#define CACHED_SECTOR_COUNT             1
+#endif
+
+#if dg_configNVMS_FLASH_CACHE && defined(OS_PRESENT) && (AD_NVMS_DIRECT_CACHE_FLUSH_MS > 0)
+#define CACHE_TIMED_FLUSH               1
+#else
+#define CACHE_TIMED_FLUSH               0
+#endif
+
 #ifdef OS_PRESENT
 static __RETAINED OS_MUTEX lock;
 #endif
 
+#if CACHE_TIMED_FLUSH
+static __RETAINED OS_TIMER flush_timer;
+
+static void flush_timer_cb(OS_TIMER timer);
+#endif
+
 static int ad_nvms_direct_read(struct partition_t *part, uint32_t addr, uint8_t *buf,
                                                                                 uint32_t size);
 static int ad_nvms_direct_write(struct partition_t *part, uint32_t addr, const uint8_t *buf,
@@ -81,6 +99,11 @@ void ad_nvms_direct_init(void)
                 OS_ASSERT(0);
         }
 #endif
+#if CACHE_TIMED_FLUSH
+        flush_timer = OS_TIMER_CREATE("nvms_flush", OS_MS_2_TICKS(AD_NVMS_DIRECT_CACHE_FLUSH_MS),
+                                                        OS_TIMER_FAIL, NULL, flush_timer_cb);
+        OS_ASSERT(flush_timer);
+#endif
 }
 
 #if DIRECT_DRIVER_STRATEGY == DIRECT_DRIVER_DYNAMIC_SECTOR_BUF
@@ -110,21 +133,38 @@ void ad_nvms_direct_sector_release(void *p)
 
 #elif DIRECT_DRIVER_STRATEGY == DIRECT_DRIVER_STATIC_SECTOR_BUF
 
-static uint8_t flash_sector[AD_FLASH_MAX_SECTOR_SIZE];
+static uint8_t flash_sector[CACHED_SECTOR_COUNT][AD_FLASH_MAX_SECTOR_SIZE];
+static bool flash_sector_taken[CACHED_SECTOR_COUNT];
 
 void *ad_nvms_direct_sector_get(void)
 {
+        int i;
+
+        for (i = 0; i < CACHED_SECTOR_COUNT; ++i) {
+                if (!flash_sector_taken[i]) {
+                        flash_sector_taken[i] = true;
 #ifdef OS_PRESENT
-        pm_sleep_mode_request(pm_mode_active);
+                        pm_sleep_mode_request(pm_mode_active);
 #endif
-        return flash_sector;
+                        return flash_sector[i];
+                }
+        }
+
+        return NULL;
 }
 
 void ad_nvms_direct_sector_release(void *p)
 {
+        int i;
+
+        for (i = 0; i < CACHED_SECTOR_COUNT; ++i) {
+                if (p == flash_sector[i] && flash_sector_taken[i]) {
+                        flash_sector_taken[i] = false;
 #ifdef OS_PRESENT
-        pm_sleep_mode_release(pm_mode_active);
+                        pm_sleep_mode_release(pm_mode_active);
 #endif
+                }
+        }
 }
 
 #elif DIRECT_DRIVER_STRATEGY == DIRECT_DRIVER_NO_SECTOR_BUF
@@ -167,14 +207,21 @@ __STATIC_INLINE void part_unlock(struct partition_t *part)
 typedef struct {
         uint32_t flash_address;
         uint8_t *buf;
+        uint32_t last_use;      /* Value of cache_clock when sector was last written */
         bool in_use;
+        bool dirty;             /* Buffer has data not written to flash yet */
 } cached_sector;
 
-static __RETAINED cached_sector sector_buff = {
-        .flash_address = 0,
-        .buf           = NULL,
-        .in_use        = false
-};
+static __RETAINED cached_sector sector_buff[CACHED_SECTOR_COUNT];
+
+#if dg_configNVMS_FLASH_CACHE
+static __RETAINED uint32_t cache_clock;
+static __RETAINED ad_nvms_direct_cache_stats_t cache_stats;
+
+#define CACHE_STAT_INC(field)   (cache_stats.field++)
+#else
+#define CACHE_STAT_INC(field)
+#endif
 
 __STATIC_INLINE int alloc_sector(cached_sector *sec)
 {
@@ -202,25 +249,107 @@ __STATIC_INLINE void read_sector(cached_sector *sec, uint32_t flash_addr)
         ad_flash_read(flash_addr, sec->buf, AD_FLASH_GET_SECTOR_SIZE(flash_addr));
         sec->flash_address = flash_addr;
         sec->in_use = true;
+        sec->dirty = false;
 }
 
 __STATIC_INLINE void flush_sector(cached_sector *sec, bool erase_cache)
 {
-        if (sec->in_use) {
+        if (sec->in_use && sec->dirty) {
                 /* Flush sector from RAM buffer to flash memory*/
                 ad_flash_erase_region(sec->flash_address, AD_FLASH_GET_SECTOR_SIZE(sec->flash_address));
                 ad_flash_write(sec->flash_address, sec->buf, AD_FLASH_GET_SECTOR_SIZE(sec->flash_address));
-                if (erase_cache) {
-                        /*
-                         * No real erase is needed - in next read cycle the old data
-                         * will be overwritten by new. Only set casched_sector as unused.
-                         */
-                        sec->flash_address = 0;
-                        sec->in_use = false;
+                sec->dirty = false;
+                CACHE_STAT_INC(erases);
+        }
+        if (erase_cache) {
+                /*
+                 * No real erase is needed - in next read cycle the old data
+                 * will be overwritten by new. Only set casched_sector as unused.
+                 */
+                sec->flash_address = 0;
+                sec->in_use = false;
+        }
+}
+
+/* Find sector in cache, NULL if it's not there */
+static cached_sector *find_sector(uint32_t flash_addr)
+{
+        int i;
+
+        for (i = 0; i < CACHED_SECTOR_COUNT; ++i) {
+                if (sector_buff[i].in_use && sector_buff[i].flash_address == flash_addr) {
+                        return &sector_buff[i];
                 }
         }
+
+        return NULL;
 }
 
+/*
+ * Get cache entry for sector that is not cached yet. Unused entry is taken if its buffer can be
+ * allocated, otherwise least recently used sector is written back and its buffer is reused.
+ */
+static cached_sector *get_free_sector(void)
+{
+        cached_sector *lru = NULL;
+        int i;
+
+        for (i = 0; i < CACHED_SECTOR_COUNT; ++i) {
+                cached_sector *sec = &sector_buff[i];
+
+                if (!sec->in_use) {
+                        if (alloc_sector(sec) == 0) {
+                                return sec;
+                        }
+                } else if (lru == NULL || (int32_t) (sec->last_use - lru->last_use) < 0) {
+                        lru = sec;
+                }
+        }
+
+        if (lru) {
+                flush_sector(lru, true);
+                CACHE_STAT_INC(evictions);
+        }
+
+        return lru;
+}
+
+__STATIC_INLINE void mark_sector_dirty(cached_sector *sec)
+{
+        sec->dirty = true;
+#if dg_configNVMS_FLASH_CACHE
+        sec->last_use = ++cache_clock;
+#endif
+#if CACHE_TIMED_FLUSH
+        if (!OS_TIMER_IS_ACTIVE(flush_timer)) {
+                OS_TIMER_START(flush_timer, OS_TIMER_FOREVER);
+        }
+#endif
+}
+
+#if CACHE_TIMED_FLUSH
+/*
+ * Write back sectors modified since timer was started. Timer task must not block on the lock,
+ * if it's taken, the flush is retried later.
+ */
+static void flush_timer_cb(OS_TIMER timer)
+{
+        int i;
+
+        if (OS_MUTEX_GET(lock, OS_MUTEX_NO_WAIT) != OS_MUTEX_TAKEN) {
+                OS_TIMER_START(flush_timer, OS_TIMER_NO_WAIT);
+                return;
+        }
+
+        for (i = 0; i < CACHED_SECTOR_COUNT; ++i) {
+                flush_sector(&sector_buff[i], false);
+        }
+        CACHE_STAT_INC(timed_flushes);
+
+        OS_MUTEX_PUT(lock);
+}
+#endif
+
 static int ad_nvms_direct_read(struct partition_t *part, uint32_t addr, uint8_t *buf,
                                                                                 uint32_t size)
 {
@@ -240,14 +369,19 @@ static int ad_nvms_direct_read(struct partition_t *part, uint32_t addr, uint8_t
 
         size_t len = ad_flash_read(read_address, buf, size);
 
-        part_unlock(part);
-
 #if dg_configNVMS_FLASH_CACHE
-        if (sector_buff.in_use) {
+        for (int i = 0; i < CACHED_SECTOR_COUNT; ++i) {
+                const cached_sector *sec = &sector_buff[i];
+
+                if (!sec->in_use) {
+                        continue;
+                }
+
                 /* Find common part of buffers */
-                uint32_t start = MAX(sector_buff.flash_address, read_address);
-                uint32_t end = MIN(sector_buff.flash_address + AD_FLASH_GET_SECTOR_SIZE(sector_buff.flash_address),
-                                                                read_address + size);
+                uint32_t start = MAX(sec->flash_address, read_address);
+                uint32_t end = MIN(sec->flash_address +
+                                        AD_FLASH_GET_SECTOR_SIZE(sec->flash_address),
+                                        read_address + size);
 
                 if (start < end) {
                         /*
@@ -255,14 +389,15 @@ static int ad_nvms_direct_read(struct partition_t *part, uint32_t addr, uint8_t
                          * from cached sector
                          */
                         uint32_t partition_offset = start - read_address;
-                        uint32_t cache_offset = start - sector_buff.flash_address;
+                        uint32_t cache_offset = start - sec->flash_address;
 
-                        memmove(buf + partition_offset, sector_buff.buf + cache_offset,
-                                                                                end - start);
+                        memmove(buf + partition_offset, sec->buf + cache_offset, end - start);
                 }
         }
 #endif /* dg_configNVMS_FLASH_CACHE */
 
+        part_unlock(part);
+
         return len;
 }
 
@@ -276,6 +411,7 @@ static int ad_nvms_direct_write(struct partition_t *part, uint32_t addr, const u
         uint32_t sector_size;
         int written = 0;
         size_t w;
+        cached_sector *sec;
 
         /* Make sure write is not outside partition */
         if (addr > part->data.size - 1) {
@@ -303,20 +439,17 @@ static int ad_nvms_direct_write(struct partition_t *part, uint32_t addr, const u
                 }
 
 #if dg_configNVMS_FLASH_CACHE
-                if (sector_buff.in_use && part_addr(part, sector_start)
-                            == sector_buff.flash_address) {
+                sec = find_sector(part_addr(part, sector_start));
+                if (sec) {
                         /*
                          * This sector is buffered in RAM - only modify data in RAM
                          * without content checking
                          */
-                        memmove(sector_buff.buf + sector_offset, buf, chunk_size);
+                        memmove(sec->buf + sector_offset, buf, chunk_size);
+                        mark_sector_dirty(sec);
+                        CACHE_STAT_INC(hits);
                         goto advance;
                 }
-
-                /* Sector in RAM is no more needed - the current sector is different */
-                if (sector_buff.in_use) {
-                        flush_sector(&sector_buff, true);
-                }
 #endif /* dg_configNVMS_FLASH_CACHE */
 
                 off = ad_flash_update_possible(part_addr(part, addr), buf, chunk_size);
@@ -339,26 +472,28 @@ static int ad_nvms_direct_write(struct partition_t *part, uint32_t addr, const u
                 if (addr == sector_start && chunk_size == sector_size) {
                         ad_flash_erase_region(part_addr(part, sector_start), sector_size);
                         ad_flash_write(part_addr(part, sector_start), buf, sector_size);
+                        CACHE_STAT_INC(erases);
                 } else {
                         /*
                          * The sector modification is needed. Get this sector to RAM,
                          * modify and keep it to the next write cycle.
                          */
 
-                        /* Alloc sector buffer to read old content to RAM */
-                        if (sector_buff.buf == NULL) {
-                                if (alloc_sector(&sector_buff) == -1) {
-                                        break;
-                                }
+                        /* Get sector buffer to read old content to RAM */
+                        sec = get_free_sector();
+                        if (sec == NULL) {
+                                break;
                         }
 
-                        read_sector(&sector_buff, part_addr(part, sector_start));
+                        read_sector(sec, part_addr(part, sector_start));
+                        CACHE_STAT_INC(misses);
 
                         /* Modify */
-                        memmove(sector_buff.buf + addr - sector_start, buf, chunk_size);
+                        memmove(sec->buf + addr - sector_start, buf, chunk_size);
+                        mark_sector_dirty(sec);
 #if !dg_configNVMS_FLASH_CACHE
                         /* Erase and write back to flash */
-                        flush_sector(&sector_buff, true);
+                        flush_sector(sec, true);
 #endif /* dg_configNVMS_FLASH_CACHE */
                 }
 advance:
@@ -368,7 +503,7 @@ advance:
         }
 
 #if !dg_configNVMS_FLASH_CACHE
-        dealloc_sector(&sector_buff);
+        dealloc_sector(&sector_buff[0]);
 #endif /* dg_configNVMS_FLASH_CACHE */
 
         part_unlock(part);
@@ -388,7 +523,22 @@ static bool ad_nvms_direct_erase(struct partition_t *part, uint32_t addr, uint32
         }
 
         if (size != 0) {
+                part_lock(part);
+#if dg_configNVMS_FLASH_CACHE
+                /* Cached copy of erased sector must not be written back later */
+                for (int i = 0; i < CACHED_SECTOR_COUNT; ++i) {
+                        cached_sector *sec = &sector_buff[i];
+                        uint32_t sec_size = AD_FLASH_GET_SECTOR_SIZE(sec->flash_address);
+
+                        if (sec->in_use && sec->flash_address + sec_size > part_addr(part, addr) &&
+                                        sec->flash_address < part_addr(part, addr + size)) {
+                                sec->dirty = false;
+                                flush_sector(sec, true);
+                        }
+                }
+#endif /* dg_configNVMS_FLASH_CACHE */
                 result = ad_flash_erase_region(part_addr(part, addr), size);
+                part_unlock(part);
         }
 
         return result;
@@ -455,12 +605,35 @@ static bool ad_nvms_direct_bind(struct partition_t *part)
 static void ad_nvms_direct_flush(struct partition_t *part, bool free_mem)
 {
 #if dg_configNVMS_FLASH_CACHE
-        flush_sector(&sector_buff, free_mem);
+        part_lock(part);
+
+        for (int i = 0; i < CACHED_SECTOR_COUNT; ++i) {
+                cached_sector *sec = &sector_buff[i];
 
-        if (free_mem) {
-                dealloc_sector(&sector_buff);
+                /* Only sectors of this partition are written, unused buffers are freed anyway */
+                if (sec->in_use && (sec->flash_address < part_addr(part, 0) ||
+                                sec->flash_address >= part_addr(part, part->data.size))) {
+                        continue;
+                }
+
+                flush_sector(sec, free_mem);
+
+                if (free_mem) {
+                        dealloc_sector(sec);
+                }
         }
+
+        part_unlock(part);
 #endif /* dg_configNVMS_FLASH_CACHE */
 }
 
+#if dg_configNVMS_FLASH_CACHE
+void ad_nvms_direct_get_cache_stats(ad_nvms_direct_cache_stats_t *stats)
+{
+        part_lock(NULL);
+        *stats = cache_stats;
+        part_unlock(NULL);
+}
+#endif /* dg_configNVMS_FLASH_CACHE */
+
 #endif /* dg_configNVMS_ADAPTER */
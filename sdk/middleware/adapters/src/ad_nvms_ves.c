@@ -19,7 +19,7 @@
 #include <osal.h>
 #include <ad_flash.h>
 #include <ad_nvms_ves.h>
-#ifdef CONFIG_NVMS_USE_CRC
+#if defined(CONFIG_NVMS_USE_CRC) || AD_NVMS_VES_CHECKPOINT || AD_NVMS_VES_TRANSACTIONS
 #include "sdk_crc16.h"
 #endif
 
@@ -53,10 +53,6 @@ typedef uint16_t sec_cnt_t;
 
 typedef uint16_t cat_ix_t;
 
-#ifdef OS_PRESENT
-static __RETAINED OS_MUTEX lock;
-#endif
-
 static int ad_nvms_ves_read(struct partition_t *part, uint32_t addr, uint8_t *buf,
                                                                                 uint32_t size);
 static int ad_nvms_ves_write(struct partition_t *part, uint32_t addr, const uint8_t *buf,
@@ -79,28 +75,9 @@ const partition_driver_t ad_nvms_ves_driver = {
 
 void ad_nvms_ves_init(void)
 {
-#ifdef OS_PRESENT
-        if (OS_MUTEX_CREATE_SUCCESS != OS_MUTEX_CREATE(lock)) {
-                OS_ASSERT(0);
-        }
-#endif
-}
-
-__STATIC_INLINE void part_lock(struct partition_t *part)
-{
-#ifdef OS_PRESENT
-        OS_MUTEX_GET(lock, OS_MUTEX_FOREVER);
-#endif
-}
-
-__STATIC_INLINE void part_unlock(struct partition_t *part)
-{
-#ifdef OS_PRESENT
-        OS_MUTEX_PUT(lock);
-#endif
+        /* Locks are created for each partition when it is bound */
 }
 
-
 /*
  * CAT - Container Allocation Table provides virtual address translation.
  * It maps virtual address used when addressing reads and writes on partition to proper container.
@@ -130,6 +107,32 @@ typedef struct {
         con_cnt_t free_container;       /**< Free container in current sector */
         sec_ix_t current_sector;        /**< Current sector with free containers */
         sec_ix_t last_erased_sector;    /**< Sector that was erased last */
+#if AD_NVMS_VES_CHECKPOINT
+        uint32_t ckpt_sequence;         /**< Sequence number of active checkpoint */
+        uint16_t ckpt_data_size;        /**< Size of checkpoint, replay log starts after it */
+        uint16_t ckpt_log_count;        /**< Number of entries in replay log */
+        uint8_t ckpt_slot_sectors;      /**< Sectors in checkpoint slot, 0 no checkpoint */
+        uint8_t ckpt_slot;              /**< Active checkpoint slot */
+        bool ckpt_log_enabled;          /**< Sector allocations and erases are logged */
+#endif
+#if AD_NVMS_VES_INCREMENTAL_GC
+        struct partition_t *gc_next;    /**< Next VES partition processed by background GC */
+        uint16_t *sector_stamp;         /**< Value of gc_clock when sector became current */
+        uint16_t *sector_erase_count;   /**< Sector erase count, kept in checkpoint if enabled */
+        uint16_t gc_clock;              /**< Incremented each time new sector becomes current */
+        uint16_t gc_sector;             /**< Sector being recycled by background GC */
+        con_cnt_t gc_container;         /**< Next container of gc_sector to move */
+#endif
+#if AD_NVMS_VES_TRANSACTIONS
+        uint16_t txn_sector;            /**< Sector of transaction record found during scan */
+        con_ix_t txn_container;         /**< Container of transaction record found during scan */
+#endif
+#ifdef OS_PRESENT
+        OS_MUTEX lock;                  /**< Held by writer, readers hold it only to enter */
+        OS_EVENT readers_done;          /**< Signaled to waiting writer when last reader leaves */
+        uint16_t readers;               /**< Number of readers accessing partition */
+        bool writer_waiting;            /**< Writer waits for readers to leave */
+#endif
 } ves_driver_data_t;
 
 /* When this bit is set container is invalid whole sector should be erased */
@@ -150,6 +153,14 @@ typedef struct {
 
 #define CAT_ENTRY_NONE          ((con_ix_t) 0xFFFF)
 
+#if AD_NVMS_VES_INCREMENTAL_GC
+/* No sector is being recycled by background GC */
+#define VES_GC_NONE             0xFFFFU
+
+/* VES partitions in bind order, background GC goes through them */
+static __RETAINED struct partition_t *gc_partitions;
+#endif
+
 typedef struct {
         uint16_t index;
 #ifdef CONFIG_NVMS_USE_CRC
@@ -160,6 +171,134 @@ typedef struct {
 #endif
 } container_t;
 
+#if AD_NVMS_VES_TRANSACTIONS
+/*
+ * Transaction record - container with index VES_TXN_INDEX. It is followed in the same sector by
+ * containers of the transaction, written with index left unused. Once all of them are written,
+ * state is cleared to VES_TXN_COMMITTED, which is the commit point. Afterwards containers get
+ * their index just like in ves_container_write() and record is cleared. If record is found on
+ * bind, transaction is completed if it was committed and its containers are discarded if not.
+ */
+#define VES_TXN_INDEX           CONTAINER_CURRENT
+#define VES_TXN_COMMITTED       0x0000U
+#define VES_TXN_NONE            0xFFFFU
+
+typedef struct {
+        uint16_t state;                 /**< Erased until transaction is committed */
+        uint16_t crc16;                 /**< CRC of count and cat_ix */
+        uint16_t count;                 /**< Number of containers after record */
+        uint16_t cat_ix[];              /**< CAT index of each container after record */
+} ves_txn_record_t;
+
+/* Staged transaction */
+struct ad_nvms_ves_txn {
+        struct partition_t *part;
+        uint16_t count;
+        cat_ix_t cat_ix[AD_NVMS_VES_TXN_SIZE];
+        uint8_t mask[AD_NVMS_VES_TXN_SIZE][(AD_NVMS_VES_CONTAINER_SIZE + 7) / 8];
+        container_t cont[AD_NVMS_VES_TXN_SIZE]; /**< Images of containers, written at once */
+};
+#endif
+
+#if AD_NVMS_VES_CHECKPOINT
+/*
+ * CAT checkpoint - two slots at the end of partition, after sectors holding containers. Active
+ * slot holds checkpoint header, free sector map, sector dirty counts and CAT, followed by replay
+ * log. Each log entry is sector index, with VES_LOG_ALLOC set if sector was taken from free ones
+ * and cleared if it was erased. Entries are written before the sector is modified, so after
+ * power failure sector is scanned at most once more than needed.
+ *
+ * With incremental GC, sector erase counts and stamps follow CAT, so wear leveling takes into
+ * account erases done before partition was bound. Log replay updates them as it would be done
+ * at runtime, erase that was skipped because sector was clean or interrupted by power failure
+ * is counted too.
+ */
+#define VES_CHECKPOINT_MAGIC    0x43534556U     /* "VESC" */
+#define VES_LOG_ALLOC           0x8000U
+#define VES_LOG_EMPTY           0xFFFFU
+#define VES_CHECKPOINT_SLOTS    2
+
+typedef struct {
+        uint32_t magic;
+        uint32_t sequence;              /**< Incremented with each checkpoint */
+        uint16_t crc16;                 /**< CRC of rest of header and of tables that follow */
+        uint16_t cat_size;
+        uint16_t sector_count;
+        uint16_t free_sector_count;
+        uint16_t current_sector;
+        uint16_t free_container;
+        uint16_t last_erased_sector;
+        uint8_t container_size;
+        uint8_t cat_entry_size;         /**< Size of types stored in tables, they depend on */
+        uint8_t dirty_count_size;       /**< configuration */
+        uint8_t wear_entry_size;        /**< 0 if there are no erase counts and stamps */
+        uint16_t gc_clock;
+} ves_checkpoint_t;
+#endif
+
+/*
+ * Each partition has its own lock, so garbage collection on one partition doesn't delay
+ * access to the others. Reads don't modify driver data and are allowed to run concurrently.
+ * Writer takes the mutex and waits for readers that are already inside to leave. Readers take
+ * the mutex only to enter, so they can't enter while writer is waiting or writing.
+ */
+__STATIC_INLINE void part_lock(struct partition_t *part)
+{
+#ifdef OS_PRESENT
+        ves_driver_data_t *ves = (ves_driver_data_t *) part->driver_data;
+
+        OS_MUTEX_GET(ves->lock, OS_MUTEX_FOREVER);
+
+        OS_ENTER_CRITICAL_SECTION();
+        while (ves->readers > 0) {
+                ves->writer_waiting = true;
+                OS_LEAVE_CRITICAL_SECTION();
+                OS_EVENT_WAIT(ves->readers_done, OS_EVENT_FOREVER);
+                OS_ENTER_CRITICAL_SECTION();
+        }
+        ves->writer_waiting = false;
+        OS_LEAVE_CRITICAL_SECTION();
+#endif
+}
+
+__STATIC_INLINE void part_unlock(struct partition_t *part)
+{
+#ifdef OS_PRESENT
+        ves_driver_data_t *ves = (ves_driver_data_t *) part->driver_data;
+
+        OS_MUTEX_PUT(ves->lock);
+#endif
+}
+
+__STATIC_INLINE void part_read_lock(struct partition_t *part)
+{
+#ifdef OS_PRESENT
+        ves_driver_data_t *ves = (ves_driver_data_t *) part->driver_data;
+
+        OS_MUTEX_GET(ves->lock, OS_MUTEX_FOREVER);
+        OS_ENTER_CRITICAL_SECTION();
+        ves->readers++;
+        OS_LEAVE_CRITICAL_SECTION();
+        OS_MUTEX_PUT(ves->lock);
+#endif
+}
+
+__STATIC_INLINE void part_read_unlock(struct partition_t *part)
+{
+#ifdef OS_PRESENT
+        ves_driver_data_t *ves = (ves_driver_data_t *) part->driver_data;
+        bool wake_writer;
+
+        OS_ENTER_CRITICAL_SECTION();
+        wake_writer = --ves->readers == 0 && ves->writer_waiting;
+        OS_LEAVE_CRITICAL_SECTION();
+
+        if (wake_writer) {
+                OS_EVENT_SIGNAL(ves->readers_done);
+        }
+#endif
+}
+
 __STATIC_INLINE uint32_t container_addr(ves_driver_data_t *ves, sec_ix_t sector, con_ix_t container)
 {
         return ves->start_address + (sector * FLASH_SECTOR_SIZE) + container * ves->container_size;
@@ -172,12 +311,237 @@ __STATIC_INLINE uint32_t container_data_addr(ves_driver_data_t *ves, sec_ix_t se
                                 container * ves->container_size + offsetof(container_t, data);
 }
 
+/* Check that container with unused index has no data programmed */
+static bool container_blank(ves_driver_data_t *ves, sec_ix_t sector, con_ix_t container)
+{
+        const uint8_t *cont = ad_flash_get_ptr(container_addr(ves, sector, container));
+        size_t i;
+
+        for (i = sizeof(uint16_t); i < ves->container_size; ++i) {
+                if (cont[i] != 0xFF) {
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+#ifdef CONFIG_NVMS_USE_CRC
+/*
+ * Check if container is the last one written in sector, only its write could be interrupted.
+ * Containers are written in order, so next one is unused or there is none.
+ */
+static bool container_last_written(ves_driver_data_t *ves, sec_ix_t sector, con_cnt_t container)
+{
+        const container_t *next;
+
+        if (container + 1 >= ves->containers_per_sector) {
+                return true;
+        }
+        next = ad_flash_get_ptr(container_addr(ves, sector, container + 1));
+
+        return next->index == CONTAINER_UNUSED;
+}
+
+/* Check CRC of container data, it doesn't match if write of container was interrupted */
+static bool container_crc_valid(ves_driver_data_t *ves, sec_ix_t sector, con_ix_t container)
+{
+        const container_t *cont = ad_flash_get_ptr(container_addr(ves, sector, container));
+
+        return cont->crc16 == crc16_calculate(cont->data, ves->container_data_size);
+}
+#endif
+
 __STATIC_INLINE bool current_sector_full(ves_driver_data_t *ves)
 {
         return ves->free_container >= ves->containers_per_sector;
 }
 
+#if AD_NVMS_VES_CHECKPOINT
+__STATIC_INLINE uint32_t checkpoint_addr(ves_driver_data_t *ves, uint8_t slot)
+{
+        return ves->start_address +
+                        (ves->sector_count + slot * ves->ckpt_slot_sectors) * FLASH_SECTOR_SIZE;
+}
+
+__STATIC_INLINE uint16_t checkpoint_log_capacity(ves_driver_data_t *ves)
+{
+        return (ves->ckpt_slot_sectors * FLASH_SECTOR_SIZE - ves->ckpt_data_size) /
+                                                                                sizeof(uint16_t);
+}
+
+/* Size of sector erase counts and stamps stored in checkpoint after CAT */
+__STATIC_INLINE size_t checkpoint_wear_size(sec_cnt_t sector_count)
+{
+#if AD_NVMS_VES_INCREMENTAL_GC
+        return 2 * sector_count * sizeof(uint16_t);
+#else
+        return 0;
+#endif
+}
+
+/*
+ * Reserve checkpoint slots at the end of partition. Slot holds checkpoint and replay log, its size
+ * is calculated for CAT covering whole partition which is more than needed after reservation.
+ * Small partitions have no checkpoint.
+ */
+static void ves_checkpoint_reserve(ves_driver_data_t *ves)
+{
+        const size_t cat_size = (ves->container_data_size - 1 +
+                                        ves->sector_count * FLASH_SECTOR_SIZE) /
+                                        AD_NVMS_VES_MULTIPLIER / ves->container_data_size + 1;
+        const size_t size = sizeof(ves_checkpoint_t) + (ves->sector_count + 7) / 8 +
+                                ves->sector_count * sizeof(ves->sector_dirty_count[0]) +
+                                cat_size * sizeof(cat_entry_t) +
+                                checkpoint_wear_size(ves->sector_count) +
+                                (AD_NVMS_VES_CHECKPOINT_LOG_SIZE + 1) * sizeof(uint16_t);
+        const size_t slot_sectors = (size + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
+
+        ves->ckpt_slot_sectors = 0;
+        ves->ckpt_slot = 0;
+        ves->ckpt_sequence = 0;
+        ves->ckpt_log_count = 0;
+        ves->ckpt_log_enabled = false;
+
+        /* Keep at least two sectors for containers, one of them is always free */
+        if (VES_CHECKPOINT_SLOTS * slot_sectors + 2 > ves->sector_count) {
+                return;
+        }
+
+        ves->ckpt_slot_sectors = (uint8_t) slot_sectors;
+        ves->sector_count -= VES_CHECKPOINT_SLOTS * slot_sectors;
+}
+
+/* CRC of checkpoint header (without magic, sequence and crc) and of tables from RAM */
+static uint16_t ves_checkpoint_crc(ves_driver_data_t *ves, const ves_checkpoint_t *hdr)
+{
+        uint16_t crc;
+
+        crc16_init(&crc);
+        crc16_update(&crc, (const uint8_t *) &hdr->cat_size,
+                                        sizeof(*hdr) - offsetof(ves_checkpoint_t, cat_size));
+        crc16_update(&crc, ves->free_sector_map, (ves->sector_count + 7) / 8);
+        crc16_update(&crc, (const uint8_t *) ves->sector_dirty_count,
+                                        ves->sector_count * sizeof(ves->sector_dirty_count[0]));
+        crc16_update(&crc, (const uint8_t *) ves->cat, ves->cat_size * sizeof(cat_entry_t));
+#if AD_NVMS_VES_INCREMENTAL_GC
+        crc16_update(&crc, (const uint8_t *) ves->sector_erase_count,
+                                                        ves->sector_count * sizeof(uint16_t));
+        crc16_update(&crc, (const uint8_t *) ves->sector_stamp,
+                                                        ves->sector_count * sizeof(uint16_t));
+#endif
+
+        return crc;
+}
+
+static void ves_checkpoint_header(ves_driver_data_t *ves, ves_checkpoint_t *hdr)
+{
+        memset(hdr, 0, sizeof(*hdr));
+        hdr->magic = VES_CHECKPOINT_MAGIC;
+        hdr->cat_size = ves->cat_size;
+        hdr->sector_count = ves->sector_count;
+        hdr->free_sector_count = ves->free_sector_count;
+        hdr->current_sector = ves->current_sector;
+        hdr->free_container = ves->free_container;
+        hdr->last_erased_sector = ves->last_erased_sector;
+        hdr->container_size = ves->container_size;
+        hdr->cat_entry_size = sizeof(cat_entry_t);
+        hdr->dirty_count_size = sizeof(ves->sector_dirty_count[0]);
+#if AD_NVMS_VES_INCREMENTAL_GC
+        hdr->wear_entry_size = sizeof(uint16_t);
+        hdr->gc_clock = ves->gc_clock;
+#endif
+}
+
+/*
+ * Write current state of driver to checkpoint slot. Header is written last so slot is valid
+ * only when all tables are on flash, until then previous checkpoint and its log are used.
+ */
+static void ves_write_checkpoint(ves_driver_data_t *ves, uint8_t slot)
+{
+        ves_checkpoint_t hdr;
+        uint32_t addr = checkpoint_addr(ves, slot);
+        const size_t map_size = (ves->sector_count + 7) / 8;
+        const size_t dirty_size = ves->sector_count * sizeof(ves->sector_dirty_count[0]);
+
+        ves_checkpoint_header(ves, &hdr);
+        hdr.sequence = ves->ckpt_sequence + 1;
+        hdr.crc16 = ves_checkpoint_crc(ves, &hdr);
+
+        ad_flash_erase_region(addr, ves->ckpt_slot_sectors * FLASH_SECTOR_SIZE);
+
+        addr += sizeof(hdr);
+        ad_flash_write(addr, ves->free_sector_map, map_size);
+        addr += map_size;
+        ad_flash_write(addr, (const uint8_t *) ves->sector_dirty_count, dirty_size);
+        addr += dirty_size;
+        ad_flash_write(addr, (const uint8_t *) ves->cat, ves->cat_size * sizeof(cat_entry_t));
+#if AD_NVMS_VES_INCREMENTAL_GC
+        addr += ves->cat_size * sizeof(cat_entry_t);
+        ad_flash_write(addr, (const uint8_t *) ves->sector_erase_count,
+                                                        ves->sector_count * sizeof(uint16_t));
+        addr += ves->sector_count * sizeof(uint16_t);
+        ad_flash_write(addr, (const uint8_t *) ves->sector_stamp,
+                                                        ves->sector_count * sizeof(uint16_t));
+#endif
+
+        ad_flash_write(checkpoint_addr(ves, slot), (const uint8_t *) &hdr, sizeof(hdr));
+
+        ves->ckpt_sequence = hdr.sequence;
+        ves->ckpt_slot = slot;
+        ves->ckpt_log_count = 0;
+}
+
+/*
+ * Append entry to replay log, must be called before sector is modified. When log is full
+ * checkpoint is written to the other slot first.
+ */
+static void ves_checkpoint_log(ves_driver_data_t *ves, uint16_t entry)
+{
+        uint32_t addr;
+
+        if (!ves->ckpt_log_enabled) {
+                return;
+        }
+
+        if (ves->ckpt_log_count >= AD_NVMS_VES_CHECKPOINT_LOG_SIZE) {
+                ves_write_checkpoint(ves, (ves->ckpt_slot + 1) % VES_CHECKPOINT_SLOTS);
+        }
+
+        addr = checkpoint_addr(ves, ves->ckpt_slot) + ves->ckpt_data_size +
+                                                        ves->ckpt_log_count * sizeof(uint16_t);
+        ad_flash_write(addr, (const uint8_t *) &entry, sizeof(entry));
+        ves->ckpt_log_count++;
+}
+#endif
+
 /* Get free sector, implementation keeps at least one sector */
+#if AD_NVMS_VES_INCREMENTAL_GC
+/*
+ * Take least erased free sector. Background GC keeps several sectors free, taking always the
+ * first one would leave the others unused.
+ */
+static sec_ix_t ves_get_free_sector(ves_driver_data_t *ves)
+{
+        int sector = -1;
+        int i;
+
+        for (i = 0; i < ves->sector_count; ++i) {
+                if ((ves->free_sector_map[i / 8] & (1 << (i & 7))) && (sector < 0 ||
+                        ves->sector_erase_count[i] < ves->sector_erase_count[sector])) {
+                        sector = i;
+                }
+        }
+        OS_ASSERT(sector >= 0);
+#if AD_NVMS_VES_CHECKPOINT
+        ves_checkpoint_log(ves, (uint16_t) sector | VES_LOG_ALLOC);
+#endif
+        ves->free_sector_map[sector / 8] ^= (1 << (sector & 7));
+        ves->free_sector_count--;
+        ves->sector_stamp[sector] = ++ves->gc_clock;
+        return (sec_ix_t) sector;
+}
+#else
 static sec_ix_t ves_get_free_sector(ves_driver_data_t *ves)
 {
         const size_t sc = (ves->sector_count + 7) / 8;
@@ -196,10 +560,14 @@ static sec_ix_t ves_get_free_sector(ves_driver_data_t *ves)
         for (j = 0; (free_bits & 1) == 0; ++j) {
                 free_bits >>= 1;
         }
+#if AD_NVMS_VES_CHECKPOINT
+        ves_checkpoint_log(ves, (uint16_t) (i * 8 + j) | VES_LOG_ALLOC);
+#endif
         ves->free_sector_map[i] ^= (1 << j);
         ves->free_sector_count--;
         return (sec_ix_t) (i * 8 + j);
 }
+#endif
 
 /* Update container index filed on flash */
 static void ves_write_index(ves_driver_data_t *ves, sec_ix_t sector, con_ix_t container,
@@ -228,6 +596,7 @@ static void ves_mark_free_sector(ves_driver_data_t *ves, sec_ix_t sector)
         }
 }
 
+#if AD_NVMS_VES_CHECKPOINT
 static void ves_mark_used_sector(ves_driver_data_t *ves, sec_ix_t sector)
 {
         uint8_t mask = 1 << (sector & 7);
@@ -236,6 +605,7 @@ static void ves_mark_used_sector(ves_driver_data_t *ves, sec_ix_t sector)
                 ves->free_sector_count--;
         }
 }
+#endif
 
 /*
  * Erase sector on flash, prepare all containers.
@@ -250,6 +620,10 @@ static void ves_init_sector(ves_driver_data_t *ves, sec_ix_t sector, bool check_
         uint32_t addr = container_addr(ves, sector, 0);
         bool erase_needed = true;
 
+#if AD_NVMS_VES_CHECKPOINT
+        ves_checkpoint_log(ves, sector);
+#endif
+
         /* Check if sector can be initialized without erase */
         if (check_dirty) {
                 container_t *cont = (container_t *) ad_flash_get_ptr(addr);
@@ -282,7 +656,17 @@ static void ves_init_sector(ves_driver_data_t *ves, sec_ix_t sector, bool check_
         if (erase_needed) {
                 /* Erase whole sector */
                 ad_flash_erase_region(addr, FLASH_SECTOR_SIZE);
+#if AD_NVMS_VES_INCREMENTAL_GC
+                if (ves->sector_erase_count[sector] < UINT16_MAX) {
+                        ves->sector_erase_count[sector]++;
+                }
+#endif
+        }
+#if AD_NVMS_VES_INCREMENTAL_GC
+        if (sector == ves->gc_sector) {
+                ves->gc_sector = VES_GC_NONE;
         }
+#endif
 
         /* Set all containers valid flag to 0, index and current stay as 1s */
         for (i = 0; i < ves->containers_per_sector; ++i) {
@@ -358,6 +742,100 @@ static void ves_mark_unused_as_dirty(ves_driver_data_t *ves, sec_ix_t sector)
         }
 }
 
+__STATIC_INLINE bool container_in_use(ves_driver_data_t *ves, uint16_t index)
+{
+        /* Skip dirty, invalid and unused containers */
+        return index != CONTAINER_UNUSED && index != CONTAINER_CLEARED &&
+                (index & CONTAINER_INVALID) == 0 && (index & CONTAINER_INDEX_MASK) < ves->cat_size;
+}
+
+#if AD_NVMS_VES_INCREMENTAL_GC
+/*
+ * Choose sector to recycle using cost-benefit policy. Benefit of recycling sector is its dirty
+ * container count multiplied by age of sector's data, cost is number of containers read and
+ * written to move valid data out of it. Old data that is rarely rewritten is thus moved too, so
+ * sectors holding it take part in wear leveling. Score is divided by number of erases sector had
+ * over least erased sector of partition.
+ *
+ * Sector already being recycled by background GC is always chosen first. If no sector has
+ * dirty containers, sector after one erased last is returned.
+ */
+static sec_ix_t ves_gc_victim(ves_driver_data_t *ves)
+{
+        const uint32_t cps = ves->containers_per_sector;
+        sec_ix_t victim = (sec_ix_t) ((ves->last_erased_sector + 1) % ves->sector_count);
+        uint64_t best_score = 0;
+        uint16_t min_erase_count = UINT16_MAX;
+        int i;
+
+        if (ves->gc_sector != VES_GC_NONE) {
+                return (sec_ix_t) ves->gc_sector;
+        }
+
+        for (i = 0; i < ves->sector_count; ++i) {
+                if (min_erase_count > ves->sector_erase_count[i]) {
+                        min_erase_count = ves->sector_erase_count[i];
+                }
+        }
+
+        for (i = 0; i < ves->sector_count; ++i) {
+                const uint32_t dirty = ves->sector_dirty_count[i];
+                const uint32_t age = (uint16_t) (ves->gc_clock - ves->sector_stamp[i]) + 1;
+                const uint32_t wear = ves->sector_erase_count[i] - min_erase_count + 1;
+                uint64_t score;
+
+                /* Free sectors have no dirty containers */
+                if (dirty == 0 || i == ves->current_sector) {
+                        continue;
+                }
+
+                score = ((uint64_t) dirty * age << 16) / ((cps + cps - dirty) * wear);
+                if (score > best_score) {
+                        best_score = score;
+                        victim = (sec_ix_t) i;
+                }
+        }
+
+        return victim;
+}
+#else
+/*
+ * Choose most dirty sector or first sector with at least AD_NVMS_VES_GC_THRESHOLD dirty
+ * containers.
+ */
+static sec_ix_t ves_gc_victim(ves_driver_data_t *ves)
+{
+        int i;
+        /*
+         * Starting searching from sector after one that was erased last.
+         */
+        sec_ix_t ix = (sec_ix_t) ((ves->last_erased_sector + 1) % ves->sector_count);
+        sec_ix_t most_dirty_sector = ix;
+        con_cnt_t max_dirty_count = ves->sector_dirty_count[ix];
+
+        for (i = 1; i < ves->sector_count; ++i, ++ix) {
+                if (ix >= ves->sector_count) {
+                        ix = 0;
+                }
+#if AD_NVMS_VES_GC_THRESHOLD < 0
+                if (max_dirty_count < ves->sector_dirty_count[ix]) {
+                        max_dirty_count = ves->sector_dirty_count[ix];
+                        most_dirty_sector = ix;
+                }
+#else
+                if (ves->sector_dirty_count[ix] >= AD_NVMS_VES_GC_THRESHOLD &&
+                                                                ix != ves->current_sector) {
+                        max_dirty_count = ves->sector_dirty_count[ix];
+                        most_dirty_sector = ix;
+                        break;
+                }
+#endif
+        }
+
+        return most_dirty_sector;
+}
+#endif
+
 /*
  * Function clears most dirty sectors to leave desired_free_count of unused sectors.
  * This function sets current sector if current sector was full or not selected.
@@ -366,45 +844,16 @@ static void ves_gc(ves_driver_data_t *ves, size_t desired_free_count)
 {
         int i;
         const container_t *cont;
-        cat_ix_t cat_ix;
 
         while (desired_free_count > ves->free_sector_count) {
-                /*
-                 * Starting searching from sector after one that was erased last.
-                 */
-                sec_ix_t ix = (sec_ix_t) ((ves->last_erased_sector + 1) % ves->sector_count);
-                sec_ix_t most_dirty_sector = ix;
-                uint8_t max_dirty_count = ves->sector_dirty_count[ix];
-
-                for (i = 1; i < ves->sector_count; ++i, ++ix) {
-                        if (ix >= ves->sector_count) {
-                                ix = 0;
-                        }
-#if AD_NVMS_VES_GC_THRESHOLD < 0
-                        if (max_dirty_count < ves->sector_dirty_count[ix]) {
-                                max_dirty_count = ves->sector_dirty_count[ix];
-                                most_dirty_sector = ix;
-                        }
-#else
-                        if (ves->sector_dirty_count[ix] >= AD_NVMS_VES_GC_THRESHOLD &&
-                                                                        ix != ves->current_sector) {
-                                max_dirty_count = ves->sector_dirty_count[ix];
-                                most_dirty_sector = ix;
-                                break;
-                        }
-#endif
-                }
+                sec_ix_t most_dirty_sector = ves_gc_victim(ves);
 
                 /* Dirty but some containers are still valid */
-                if (max_dirty_count < ves->containers_per_sector) {
+                if (ves->sector_dirty_count[most_dirty_sector] < ves->containers_per_sector) {
                         cont = ad_flash_get_ptr(container_addr(ves, most_dirty_sector, 0));
 
                         for (i = 0; i < ves->containers_per_sector; ++i, ++cont) {
-                                cat_ix = cont->index;
-                                /* Skip dirty, invalid and unused containers */
-                                if ((cat_ix == CONTAINER_UNUSED) || (cat_ix == CONTAINER_CLEARED) ||
-                                        (cat_ix & CONTAINER_INVALID) ||
-                                        (cat_ix & CONTAINER_INDEX_MASK) >= ves->cat_size) {
+                                if (!container_in_use(ves, cont->index)) {
                                         continue;
                                 }
                                 /*
@@ -436,10 +885,71 @@ static void ves_gc(ves_driver_data_t *ves, size_t desired_free_count)
         }
 }
 
+#if AD_NVMS_VES_INCREMENTAL_GC
 /*
- * Read CAT structure from flash.
+ * Do one step of background garbage collection. Step either moves up to AD_NVMS_VES_GC_STEP
+ * valid containers out of sector being recycled or erases this sector, so time partition is
+ * locked for is bounded. Between steps flash is in the same state as after power failure during
+ * ves_gc(), so writes and ves_gc() may run in between.
  *
- * This function reads index field from all sectors on partition to fill CAT table.
+ * Last free sector is left for writes. If data can't be moved without it, recycling is left
+ * to ves_gc() called from write.
+ *
+ * Returns true if more steps are needed.
+ */
+static bool ves_gc_step(ves_driver_data_t *ves)
+{
+        const container_t *cont;
+        con_cnt_t moved = 0;
+
+        if (ves->gc_sector == VES_GC_NONE) {
+                if (ves->free_sector_count >= AD_NVMS_VES_GC_RESERVE) {
+                        return false;
+                }
+                ves->gc_sector = ves_gc_victim(ves);
+                ves->gc_container = 0;
+                if (ves->sector_dirty_count[ves->gc_sector] == 0) {
+                        ves->gc_sector = VES_GC_NONE;
+                        return false;
+                }
+        }
+
+        cont = ad_flash_get_ptr(container_addr(ves, ves->gc_sector, ves->gc_container));
+        for (; ves->gc_container < ves->containers_per_sector; ves->gc_container++, cont++) {
+                if (!container_in_use(ves, cont->index)) {
+                        continue;
+                }
+                if (moved == AD_NVMS_VES_GC_STEP) {
+                        return true;
+                }
+                if (current_sector_full(ves)) {
+                        if (ves->free_sector_count < 2) {
+                                return false;
+                        }
+                        ves->free_container = 0;
+                        ves->current_sector = ves_get_free_sector(ves);
+                }
+                ves_move_container(ves, ves->gc_sector, ves->gc_container,
+                                                ves->current_sector, ves->free_container++);
+                moved++;
+        }
+
+        /* Sector is erased in separate step */
+        if (moved > 0) {
+                return true;
+        }
+
+        ves->last_erased_sector = ves->gc_sector;
+        ves_init_sector(ves, ves->gc_sector, false);
+
+        return ves->free_sector_count < AD_NVMS_VES_GC_RESERVE;
+}
+#endif
+
+/*
+ * Scan sector to fill CAT structure.
+ *
+ * This function reads index field from all containers of sector to fill CAT table.
  * Index has following fields
  *   15 bit - Valid - must be zero
  *   14 bit - Current - 1 if data is current
@@ -450,13 +960,16 @@ static void ves_gc(ves_driver_data_t *ves, size_t desired_free_count)
  *                       to 0x7FFF by ves_init_sector()
  * 0000 0000 0000 0000 - All zeros mean that this container is no longer used, it's dirty.
  * 0100 0000 0000 0000 - This value is invalid and is not result of normal operation. If this
- *                       value is found container is treated as uninitialized.
+ *                       value is found container is treated as uninitialized. With
+ *                       AD_NVMS_VES_TRANSACTIONS it is index of transaction record.
  * 01xx xxxx xxxx xxxx - This is normal value for container with valid data, 14 bits hold index
  *                       to CAT table.
  * 00xx xxxx xxxx xxxx - This contents means power failure during writing new container. If this
  *                       value is found along with same index having current flag set (0x4000),
  *                       container index is cleared during ves_read_cat since new version is
  *                       available.
+ *                       With CONFIG_NVMS_USE_CRC, last container written in sector with CRC that
+ *                       doesn't match its data is cleared, its write was interrupted.
  *                       If there is no container with current flag, container will stay in cat
  *                       as long as there is not write to same virtual address, at which time
  *                       index of this container will be cleared.
@@ -468,137 +981,357 @@ static void ves_gc(ves_driver_data_t *ves, size_t desired_free_count)
  *
  * There may be many sectors with 0 or all unused containers but only one
  * with 0 < unused_count < containers_per_sector, this sector will be current sector and
- * will receive new data.
+ * will receive new data. current_sector is set to the first one found.
+ *
+ * rescan is bitmap of sectors scanned when CAT is restored from checkpoint, NULL on full scan.
  */
-static void ves_read_cat(ves_driver_data_t *ves)
+static void ves_scan_sector(ves_driver_data_t *ves, sec_ix_t i, int32_t *current_sector,
+                                                                        const uint8_t *rescan)
 {
-        int32_t first_free_sector = -1;
-        int32_t current_sector = -1;
-        ves->last_erased_sector = 0;
-        ves->free_container = ves->containers_per_sector;
-
-        for (sec_cnt_t i = 0; i < ves->sector_count; ++i) {
-                con_cnt_t uninitialized_count = 0;
-                con_ix_t old_container = 0;
-                con_cnt_t unused_count = 0;
-                con_cnt_t dirty_count = 0;
-                for (con_cnt_t j = 0; j < ves->containers_per_sector; ++j) {
-                        const container_t *cont = ad_flash_get_ptr(
-                                                        container_addr(ves, i, j));
-                        if (cont->index == CONTAINER_UNUSED) {
-                                unused_count++;
-                                continue;
+        con_cnt_t uninitialized_count = 0;
+        con_ix_t old_container = 0;
+        con_cnt_t unused_count = 0;
+        con_cnt_t dirty_count = 0;
+        for (con_cnt_t j = 0; j < ves->containers_per_sector; ++j) {
+                const container_t *cont = ad_flash_get_ptr(
+                                                container_addr(ves, i, j));
+                if (cont->index == CONTAINER_UNUSED) {
+                        unused_count++;
+                        continue;
+                }
+                cat_ix_t cat_ix = cont->index & CONTAINER_INDEX_MASK;
+                /*
+                 * Even if there were containers marked as unused but after them there are
+                 * some other (used, unused, invalid), flash is corrupted and those
+                 * unused containers should be treated as dirty ones. Unused containers
+                 * can only be at the end of a sector.
+                 */
+                dirty_count += unused_count;
+                unused_count = 0;
+#if AD_NVMS_VES_TRANSACTIONS
+                if (cont->index == VES_TXN_INDEX) {
+                        /* Only one record can exist, it is handled by ves_txn_recover() */
+                        if (ves->txn_sector == VES_TXN_NONE) {
+                                ves->txn_sector = i;
+                                ves->txn_container = j;
+                        } else {
+                                ves_write_index(ves, i, j, 0);
+                                dirty_count++;
                         }
-                        cat_ix_t cat_ix = cont->index & CONTAINER_INDEX_MASK;
+                        continue;
+                }
+#endif
+                if ((cont->index & CONTAINER_INVALID) || cont->index == CONTAINER_CURRENT) {
+                        /* Looks like uninitialized container */
+                        uninitialized_count++;
+                } else if ((cat_ix == CONTAINER_CLEARED) || (cat_ix >= ves->cat_size)) {
+                        dirty_count++;
+#ifdef CONFIG_NVMS_USE_CRC
+                } else if (container_last_written(ves, i, j) &&
+                                                        !container_crc_valid(ves, i, j)) {
                         /*
-                         * Even if there were containers marked as unused but after them there are
-                         * some other (used, unused, invalid), flash is corrupted and those
-                         * unused containers should be treated as dirty ones. Unused containers
-                         * can only be at the end of a sector.
+                         * Power failed after container was made current, before its CRC was
+                         * written. Old copy, if there is one, is still valid.
                          */
-                        dirty_count += unused_count;
-                        unused_count = 0;
-                        if ((cont->index & CONTAINER_INVALID) || cont->index == CONTAINER_CURRENT) {
-                                /* Looks like uninitialized container */
-                                uninitialized_count++;
-                        } else if ((cat_ix == CONTAINER_CLEARED) || (cat_ix >= ves->cat_size)) {
-                                dirty_count++;
+                        ves_write_index(ves, i, j, 0);
+                        dirty_count++;
+#endif
+                } else {
+                        sec_ix_t old_sector = ves->cat[cat_ix].sector;
+                        old_container = ves->cat[cat_ix].container;
+
+                        if (old_container == CAT_ENTRY_NONE) {
+                                /*
+                                 * First copy of container just store in cat, regardless
+                                 * if it is current or not.
+                                 */
+                                ves->cat[cat_ix].sector = i;
+                                ves->cat[cat_ix].container = j;
                         } else {
-                                sec_ix_t old_sector = ves->cat[cat_ix].sector;
-                                old_container = ves->cat[cat_ix].container;
+                                /*
+                                 * Found second copy of container. When only some sectors are
+                                 * scanned, copy found in them was written after the one that
+                                 * is in sector not scanned, even if it's not current.
+                                 */
+                                if ((cont->index & CONTAINER_CURRENT) || (rescan &&
+                                        !(rescan[old_sector / 8] & (1 << (old_sector & 7))))) {
+                                        const container_t *old = ad_flash_get_ptr(
+                                                container_addr(ves, old_sector, old_container));
 
-                                if (old_container == CAT_ENTRY_NONE) {
                                         /*
-                                         * First copy of container just store in cat, regardless
-                                         * if it is current or not.
+                                         * New one is current, mark old one as dirty. Copy from
+                                         * checkpoint was usually cleared when it was superseded,
+                                         * it's not programmed again on each bind.
                                          */
+                                        if (old->index != CONTAINER_CLEARED) {
+                                                ves_write_index(ves, old_sector, old_container, 0);
+                                        }
                                         ves->cat[cat_ix].sector = i;
                                         ves->cat[cat_ix].container = j;
-                                } else {
-                                        /* Found second copy of container */
-                                        if (cont->index & CONTAINER_CURRENT) {
-                                                /* New one is current, mark old one as dirty */
-                                                ves_write_index(ves, old_sector, old_container, 0);
-                                                ves->cat[cat_ix].sector = i;
-                                                ves->cat[cat_ix].container = j;
+                                        /*
+                                         * If old container was in other sector, increase
+                                         * dirty counter in old sector. If it was in
+                                         * current sector, just increase dirty_count.
+                                         */
+                                        if (i != old_sector) {
+                                                ves->sector_dirty_count[old_sector]++;
                                                 /*
-                                                 * If old container was in other sector, increase
-                                                 * dirty counter in old sector. If it was in
-                                                 * current sector, just increase dirty_count.
+                                                 * Dirty containers per sector cannot exceed
+                                                 * the max number of containers per sector.
                                                  */
-                                                if (i != old_sector) {
-                                                        ves->sector_dirty_count[old_sector]++;
-                                                        /*
-                                                         * Dirty containers per sector cannot exceed
-                                                         * the max number of containers per sector.
-                                                         */
-                                                        OS_ASSERT(ves->sector_dirty_count[old_sector]
-                                                                    <= ves->containers_per_sector);
-                                                } else {
-                                                        dirty_count++;
-                                                }
+                                                OS_ASSERT(ves->sector_dirty_count[old_sector]
+                                                            <= ves->containers_per_sector);
                                         } else {
-                                                /* This one is old mark as dirty */
-                                                ves_write_index(ves, i, j, 0);
                                                 dirty_count++;
                                         }
+                                } else {
+                                        /* This one is old mark as dirty */
+                                        ves_write_index(ves, i, j, 0);
+                                        dirty_count++;
                                 }
                         }
                 }
-                if (ves->containers_per_sector == unused_count) {
-                        /* All entries are unused whole sector is free */
+        }
+        if (ves->containers_per_sector == unused_count) {
+                /* All entries are unused whole sector is free */
+                if (container_blank(ves, i, 0)) {
                         ves_mark_free_sector(ves, i);
-                        if (first_free_sector < 0) {
-                                first_free_sector = i;
-                        }
-                } else if (ves->containers_per_sector == unused_count + uninitialized_count
-                                                                                + dirty_count) {
-                        /*
-                         * No free space on sector, init sector. If there were dirty containers
-                         * ves_init_sector will do erase. If there was not dirty containers
-                         * ves_init_sector will check if erase is really needed or just containers
-                         * initialization on clean sector will do.
-                         */
-                        ves_init_sector(ves, i, dirty_count == 0);
-                        if (first_free_sector < 0) {
-                                first_free_sector = i;
-                        }
                 } else {
-                        ves->sector_dirty_count[i] = dirty_count;
-                        /*
-                         * Dirty containers per sector cannot exceed
-                         * the max number of containers per sector.
-                         */
-                        OS_ASSERT(ves->sector_dirty_count[i] <= ves->containers_per_sector);
-                        /* Found sector that is partially used, this is current sector */
-                        if (unused_count > 0 && unused_count < ves->containers_per_sector) {
-                                if (current_sector < 0) {
-                                        current_sector = i;
-                                        ves->current_sector = (sec_ix_t) i;
-                                        ves->free_container = ves->containers_per_sector - unused_count;
-                                } else {
-                                        /*
-                                         * Flash corruption detected, there are two sectors with
-                                         * some unused containers, which can happen only if some
-                                         * data was put in flash outside of driver. To recover
-                                         * just mark unused sector as dirty on flash.
-                                         */
-                                        ves_mark_unused_as_dirty(ves, i);
-                                }
+                        /* First write to sector was interrupted by power failure */
+                        ves_init_sector(ves, i, false);
+                }
+        } else if (ves->containers_per_sector == unused_count + uninitialized_count
+                                                                        + dirty_count) {
+                /*
+                 * No free space on sector, init sector. If there were dirty containers
+                 * ves_init_sector will do erase. If there was not dirty containers
+                 * ves_init_sector will check if erase is really needed or just containers
+                 * initialization on clean sector will do.
+                 */
+                ves_init_sector(ves, i, dirty_count == 0);
+        } else {
+                ves->sector_dirty_count[i] = dirty_count;
+                /*
+                 * Dirty containers per sector cannot exceed
+                 * the max number of containers per sector.
+                 */
+                OS_ASSERT(ves->sector_dirty_count[i] <= ves->containers_per_sector);
+                /* Found sector that is partially used, this is current sector */
+                if (unused_count > 0 && unused_count < ves->containers_per_sector) {
+                        if (*current_sector < 0) {
+                                *current_sector = i;
+                                ves->current_sector = (sec_ix_t) i;
+                                ves->free_container = ves->containers_per_sector - unused_count;
+                        } else {
+                                /*
+                                 * Flash corruption detected, there are two sectors with
+                                 * some unused containers, which can happen only if some
+                                 * data was put in flash outside of driver. To recover
+                                 * just mark unused sector as dirty on flash.
+                                 */
+                                ves_mark_unused_as_dirty(ves, i);
                         }
                 }
         }
+}
+
+/* Set first free sector as current, if no partially used sector was found during scan */
+static void ves_select_current_sector(ves_driver_data_t *ves)
+{
+        if (current_sector_full(ves) && ves->free_sector_count > 0) {
+                ves->current_sector = ves_get_free_sector(ves);
+                ves->free_container = 0;
+        }
+}
+
+/* Read CAT structure from flash, all sectors on partition are scanned */
+static void ves_read_cat(ves_driver_data_t *ves)
+{
+        int32_t current_sector = -1;
+        ves->last_erased_sector = 0;
+        ves->free_container = ves->containers_per_sector;
+
+        for (sec_cnt_t i = 0; i < ves->sector_count; ++i) {
+                ves_scan_sector(ves, i, &current_sector, NULL);
+        }
         /* Current sector not found, set first free as current */
-        if (current_sector_full(ves)) {
-                if (first_free_sector >= 0) {
-                        ves->current_sector = first_free_sector;
-                        ves->free_container = 0;
-                        ves_mark_used_sector(ves, first_free_sector);
+        ves_select_current_sector(ves);
+}
+
+#if AD_NVMS_VES_CHECKPOINT
+/* Load tables of checkpoint which header was read from slot, false if checkpoint is not valid */
+static bool ves_read_checkpoint(ves_driver_data_t *ves, uint8_t slot, const ves_checkpoint_t *hdr)
+{
+        ves_checkpoint_t expected;
+        uint32_t addr = checkpoint_addr(ves, slot) + sizeof(*hdr);
+        const size_t map_size = (ves->sector_count + 7) / 8;
+        const size_t dirty_size = ves->sector_count * sizeof(ves->sector_dirty_count[0]);
+
+        ves_checkpoint_header(ves, &expected);
+        if (hdr->magic != VES_CHECKPOINT_MAGIC || hdr->cat_size != expected.cat_size ||
+                                hdr->sector_count != expected.sector_count ||
+                                hdr->container_size != expected.container_size ||
+                                hdr->cat_entry_size != expected.cat_entry_size ||
+                                hdr->dirty_count_size != expected.dirty_count_size ||
+                                hdr->wear_entry_size != expected.wear_entry_size ||
+                                hdr->current_sector >= ves->sector_count ||
+                                hdr->last_erased_sector >= ves->sector_count ||
+                                hdr->free_container > ves->containers_per_sector) {
+                return false;
+        }
+
+        ad_flash_read(addr, ves->free_sector_map, map_size);
+        addr += map_size;
+        ad_flash_read(addr, (uint8_t *) ves->sector_dirty_count, dirty_size);
+        addr += dirty_size;
+        ad_flash_read(addr, (uint8_t *) ves->cat, ves->cat_size * sizeof(cat_entry_t));
+#if AD_NVMS_VES_INCREMENTAL_GC
+        addr += ves->cat_size * sizeof(cat_entry_t);
+        ad_flash_read(addr, (uint8_t *) ves->sector_erase_count,
+                                                        ves->sector_count * sizeof(uint16_t));
+        addr += ves->sector_count * sizeof(uint16_t);
+        ad_flash_read(addr, (uint8_t *) ves->sector_stamp, ves->sector_count * sizeof(uint16_t));
+#endif
+
+        return ves_checkpoint_crc(ves, hdr) == hdr->crc16;
+}
+
+#if AD_NVMS_VES_INCREMENTAL_GC
+static uint32_t ves_total_erase_count(ves_driver_data_t *ves)
+{
+        uint32_t total = 0;
+
+        for (sec_cnt_t i = 0; i < ves->sector_count; ++i) {
+                total += ves->sector_erase_count[i];
+        }
+
+        return total;
+}
+#endif
+
+/*
+ * Restore CAT from the newest valid checkpoint and replay its log.
+ *
+ * Only sectors found in the log and the sector that was current when checkpoint was written
+ * can hold containers written after the checkpoint, so only those are scanned again. CAT entries
+ * pointing to them are dropped first and sectors are scanned the same way as on full scan. Copy of
+ * container found in scanned sector supersedes the one in sector that is not scanned, dirty count
+ * of that sector is updated accordingly. Sectors erased by the scan are not logged, so new
+ * checkpoint is written if there were any.
+ *
+ * Returns false if there is no valid checkpoint, tables must be cleared then.
+ */
+static bool ves_load_checkpoint(ves_driver_data_t *ves)
+{
+        ves_checkpoint_t hdr[VES_CHECKPOINT_SLOTS];
+        const size_t map_size = (ves->sector_count + 7) / 8;
+        const uint16_t *log;
+        uint16_t log_count;
+        uint8_t *rescan;
+        int32_t current_sector = -1;
+        uint8_t slot;
+        sec_ix_t sector;
+#if AD_NVMS_VES_INCREMENTAL_GC
+        uint32_t erase_count;
+#endif
+
+        for (slot = 0; slot < VES_CHECKPOINT_SLOTS; ++slot) {
+                ad_flash_read(checkpoint_addr(ves, slot), (uint8_t *) &hdr[slot], sizeof(hdr[0]));
+        }
+
+        /* Start with the newer one */
+        slot = hdr[1].magic == VES_CHECKPOINT_MAGIC && (hdr[0].magic != VES_CHECKPOINT_MAGIC ||
+                                                (int32_t) (hdr[1].sequence - hdr[0].sequence) > 0);
+        ves->ckpt_slot = slot;
+        ves->ckpt_sequence = hdr[slot].magic == VES_CHECKPOINT_MAGIC ? hdr[slot].sequence : 0;
+
+        if (!ves_read_checkpoint(ves, slot, &hdr[slot])) {
+                slot = (slot + 1) % VES_CHECKPOINT_SLOTS;
+                if (!ves_read_checkpoint(ves, slot, &hdr[slot])) {
+                        return false;
                 }
         }
-        /* Make sure that there is at least one free sector */
-        ves_gc(ves, 1);
+
+        ves->ckpt_slot = slot;
+        ves->ckpt_sequence = hdr[slot].sequence;
+        ves->free_sector_count = hdr[slot].free_sector_count;
+        ves->last_erased_sector = hdr[slot].last_erased_sector;
+#if AD_NVMS_VES_INCREMENTAL_GC
+        ves->gc_clock = hdr[slot].gc_clock;
+#endif
+
+        rescan = OS_MALLOC(map_size);
+        OS_ASSERT(rescan);
+        memset(rescan, 0, map_size);
+
+        log = ad_flash_get_ptr(checkpoint_addr(ves, slot) + ves->ckpt_data_size);
+        for (log_count = 0; log_count < checkpoint_log_capacity(ves) &&
+                                                log[log_count] != VES_LOG_EMPTY; ++log_count) {
+                sector = (sec_ix_t) (log[log_count] & ~VES_LOG_ALLOC);
+                /* Entry written partially during power failure */
+                if (sector >= ves->sector_count) {
+                        continue;
+                }
+                rescan[sector / 8] |= 1 << (sector & 7);
+                if ((log[log_count] & VES_LOG_ALLOC) == 0) {
+                        ves->last_erased_sector = sector;
+#if AD_NVMS_VES_INCREMENTAL_GC
+                        if (ves->sector_erase_count[sector] < UINT16_MAX) {
+                                ves->sector_erase_count[sector]++;
+                        }
+                } else {
+                        ves->sector_stamp[sector] = ++ves->gc_clock;
+#endif
+                }
+        }
+
+        ves->ckpt_log_count = log_count;
+
+        if (hdr[slot].free_container < ves->containers_per_sector) {
+                sector = hdr[slot].current_sector;
+                rescan[sector / 8] |= 1 << (sector & 7);
+        }
+
+        for (cat_ix_t i = 0; i < ves->cat_size; ++i) {
+                sector = ves->cat[i].sector;
+                if (ves->cat[i].container != CAT_ENTRY_NONE &&
+                                                (rescan[sector / 8] & (1 << (sector & 7)))) {
+                        ves->cat[i].container = CAT_ENTRY_NONE;
+                }
+        }
+
+        for (sec_cnt_t i = 0; i < ves->sector_count; ++i) {
+                if (rescan[i / 8] & (1 << (i & 7))) {
+                        ves_mark_used_sector(ves, i);
+                        ves->sector_dirty_count[i] = 0;
+                }
+        }
+
+#if AD_NVMS_VES_INCREMENTAL_GC
+        erase_count = ves_total_erase_count(ves);
+#endif
+        ves->free_container = ves->containers_per_sector;
+        for (sec_cnt_t i = 0; i < ves->sector_count; ++i) {
+                if (rescan[i / 8] & (1 << (i & 7))) {
+                        ves_scan_sector(ves, i, &current_sector, rescan);
+                }
+        }
+
+        OS_FREE(rescan);
+
+        /* From now on new current sector must be logged, it's not in checkpoint */
+        ves->ckpt_log_enabled = true;
+        ves_select_current_sector(ves);
+
+#if AD_NVMS_VES_INCREMENTAL_GC
+        if (erase_count != ves_total_erase_count(ves)) {
+                ves_write_checkpoint(ves, (ves->ckpt_slot + 1) % VES_CHECKPOINT_SLOTS);
+        }
+#endif
+
+        return true;
 }
+#endif
 
 /*
  * This function gets free container.
@@ -719,6 +1452,176 @@ static int ves_container_write(ves_driver_data_t *ves, cat_ix_t cat_ix,
         return size;
 }
 
+#if AD_NVMS_VES_TRANSACTIONS
+/* Maximum number of containers in transaction, limited by record and sector size */
+static uint16_t ves_txn_capacity(ves_driver_data_t *ves)
+{
+        uint16_t capacity = (ves->container_data_size - offsetof(ves_txn_record_t, cat_ix)) /
+                                                                        sizeof(uint16_t);
+
+        if (capacity > AD_NVMS_VES_TXN_SIZE) {
+                capacity = AD_NVMS_VES_TXN_SIZE;
+        }
+        if (capacity > ves->containers_per_sector - 1) {
+                capacity = ves->containers_per_sector - 1;
+        }
+
+        return capacity;
+}
+
+static uint16_t ves_txn_crc(const ves_txn_record_t *rec, uint16_t count)
+{
+        uint16_t crc;
+
+        crc16_init(&crc);
+        crc16_update(&crc, (const uint8_t *) &count, sizeof(count));
+        crc16_update(&crc, (const uint8_t *) rec->cat_ix, count * sizeof(rec->cat_ix[0]));
+
+        return crc;
+}
+
+/*
+ * Make current sector have count free containers. If it has less, they are marked as dirty and
+ * next free sector becomes current, so transaction doesn't span sectors.
+ */
+static void ves_txn_reserve(ves_driver_data_t *ves, con_cnt_t count)
+{
+        if (ves->containers_per_sector - ves->free_container >= count) {
+                return;
+        }
+
+        /* Taking free sector must leave one for ves_gc() */
+        if (ves->free_sector_count < 2) {
+                ves_gc(ves, 2);
+                if (ves->containers_per_sector - ves->free_container >= count) {
+                        return;
+                }
+        }
+
+        if (!current_sector_full(ves)) {
+                ves_mark_unused_as_dirty(ves, ves->current_sector);
+                ves->sector_dirty_count[ves->current_sector] +=
+                                        ves->containers_per_sector - ves->free_container;
+        }
+        ves->current_sector = ves_get_free_sector(ves);
+        ves->free_container = 0;
+}
+
+/*
+ * Make container written by transaction current, same steps as in ves_container_write() are
+ * used. Each step can be repeated after power failure.
+ */
+static void ves_txn_apply(ves_driver_data_t *ves, cat_ix_t cat_ix, sec_ix_t sector,
+                                                                        con_ix_t container)
+{
+        const sec_ix_t old_sector = ves->cat[cat_ix].sector;
+        const con_ix_t old_container = ves->cat[cat_ix].container;
+        const bool has_old = old_container != CAT_ENTRY_NONE &&
+                                        (old_sector != sector || old_container != container);
+
+        if (has_old) {
+                ves_write_index(ves, old_sector, old_container, cat_ix);
+        }
+        ves_write_index(ves, sector, container, cat_ix | CONTAINER_CURRENT);
+        if (has_old) {
+                ves_write_index(ves, old_sector, old_container, 0);
+                ves->sector_dirty_count[old_sector]++;
+                OS_ASSERT(ves->sector_dirty_count[old_sector] <= ves->containers_per_sector);
+        }
+
+        ves->cat[cat_ix].sector = sector;
+        ves->cat[cat_ix].container = container;
+}
+
+/*
+ * Complete or discard transaction which record was found during scan. Containers after record
+ * were counted as unused by scan, they are used or dirty now.
+ */
+static void ves_txn_recover(ves_driver_data_t *ves)
+{
+        const sec_ix_t sector = (sec_ix_t) ves->txn_sector;
+        const con_ix_t container = ves->txn_container;
+        const ves_txn_record_t *rec;
+        bool valid;
+        uint16_t i;
+
+        if (ves->txn_sector == VES_TXN_NONE) {
+                return;
+        }
+
+        rec = ad_flash_get_ptr(container_data_addr(ves, sector, container, 0));
+        valid = rec->count <= ves_txn_capacity(ves) &&
+                        container + rec->count < ves->containers_per_sector &&
+                        rec->crc16 == ves_txn_crc(rec, rec->count);
+        for (i = 0; valid && i < rec->count; ++i) {
+                valid = rec->cat_ix[i] > 0 && rec->cat_ix[i] < ves->cat_size;
+        }
+
+        /* Without valid record containers after it are left for ves_check_free() */
+        for (i = 0; valid && i < rec->count; ++i) {
+                if (rec->state == VES_TXN_COMMITTED) {
+                        const container_t *cont = ad_flash_get_ptr(container_addr(ves, sector,
+                                                                        container + 1 + i));
+                        const cat_ix_t cat_ix = cont->index & CONTAINER_INDEX_MASK;
+
+                        /* Index write interrupted by power failure was counted as dirty */
+                        if (cont->index != CONTAINER_UNUSED &&
+                                        !(cont->index & CONTAINER_INVALID) &&
+                                        (cat_ix == CONTAINER_CLEARED || cat_ix >= ves->cat_size)) {
+                                ves->sector_dirty_count[sector]--;
+                        }
+                        ves_txn_apply(ves, rec->cat_ix[i], sector, container + 1 + i);
+                } else {
+                        ves_write_index(ves, sector, container + 1 + i, 0);
+                        ves->sector_dirty_count[sector]++;
+                }
+        }
+
+        if (valid && sector == ves->current_sector &&
+                                                ves->free_container <= container + rec->count) {
+                ves->free_container = container + 1 + rec->count;
+        }
+
+        ves_write_index(ves, sector, container, 0);
+        ves->sector_dirty_count[sector]++;
+        ves->txn_sector = VES_TXN_NONE;
+}
+#endif
+
+/*
+ * Containers of current sector that look unused, but have data programmed by write interrupted
+ * by power failure, can't be written again. They are marked as dirty together with unused ones
+ * before them.
+ */
+static void ves_check_free(ves_driver_data_t *ves)
+{
+        con_cnt_t first_free = ves->free_container;
+        con_cnt_t i;
+
+        for (i = ves->free_container; i < ves->containers_per_sector; ++i) {
+                if (!container_blank(ves, ves->current_sector, i)) {
+                        first_free = i + 1;
+                }
+        }
+
+        for (i = ves->free_container; i < first_free; ++i) {
+                ves_write_index(ves, ves->current_sector, i, 0);
+                ves->sector_dirty_count[ves->current_sector]++;
+        }
+        ves->free_container = first_free;
+}
+
+static void ves_clear_tables(ves_driver_data_t *ves)
+{
+        memset(ves->cat, CAT_ENTRY_NONE, ves->cat_size * sizeof(cat_entry_t));
+        memset(ves->free_sector_map, 0, (ves->sector_count + 7) / 8);
+        memset(ves->sector_dirty_count, 0, ves->sector_count * sizeof(ves->sector_dirty_count[0]));
+        ves->free_sector_count = 0;
+#if AD_NVMS_VES_TRANSACTIONS
+        ves->txn_sector = VES_TXN_NONE;
+#endif
+}
+
 void ves_init(struct partition_t *part)
 {
         ves_driver_data_t *ves = (ves_driver_data_t *) part->driver_data;
@@ -732,22 +1635,79 @@ void ves_init(struct partition_t *part)
         ves->current_sector = 0;
         ves->free_container = 0;
         ves->free_sector_count = 0;
+#ifdef OS_PRESENT
+        if (OS_MUTEX_CREATE_SUCCESS != OS_MUTEX_CREATE(ves->lock)) {
+                OS_ASSERT(0);
+        }
+        if (OS_EVENT_CREATE_SUCCESS != OS_EVENT_CREATE(ves->readers_done)) {
+                OS_ASSERT(0);
+        }
+        ves->readers = 0;
+        ves->writer_waiting = false;
+#endif
+#if AD_NVMS_VES_CHECKPOINT
+        ves_checkpoint_reserve(ves);
+#endif
 
         /* Have enough entries to cover virtual address space + 1 (for index 0 which is not used) */
         ves->cat_size = (ves->container_data_size - 1 + ves->sector_count * FLASH_SECTOR_SIZE) /
                                         AD_NVMS_VES_MULTIPLIER / ves->container_data_size + 1;
         ves->cat = OS_MALLOC(ves->cat_size * sizeof(cat_entry_t));
         OS_ASSERT(ves->cat);
-        memset(ves->cat, CAT_ENTRY_NONE, ves->cat_size * sizeof(cat_entry_t));
 
         ves->free_sector_map = OS_MALLOC((ves->sector_count + 7) / 8);
         OS_ASSERT(ves->free_sector_map);
-        memset(ves->free_sector_map, 0, (ves->sector_count + 7) / 8);
 
         ves->sector_dirty_count = OS_MALLOC(ves->sector_count * sizeof(ves->sector_dirty_count[0]));
-        memset(ves->sector_dirty_count, 0, ves->sector_count);
+        OS_ASSERT(ves->sector_dirty_count);
+
+        ves_clear_tables(ves);
+
+#if AD_NVMS_VES_INCREMENTAL_GC
+        ves->sector_stamp = OS_MALLOC(ves->sector_count * sizeof(uint16_t));
+        OS_ASSERT(ves->sector_stamp);
+        memset(ves->sector_stamp, 0, ves->sector_count * sizeof(uint16_t));
+
+        ves->sector_erase_count = OS_MALLOC(ves->sector_count * sizeof(uint16_t));
+        OS_ASSERT(ves->sector_erase_count);
+        memset(ves->sector_erase_count, 0, ves->sector_count * sizeof(uint16_t));
 
+        ves->gc_clock = 0;
+        ves->gc_sector = VES_GC_NONE;
+#endif
+
+#if AD_NVMS_VES_CHECKPOINT
+        if (ves->ckpt_slot_sectors == 0) {
+                ves_read_cat(ves);
+        } else {
+                /* Checkpoint and log are 16-bit aligned */
+                ves->ckpt_data_size = (sizeof(ves_checkpoint_t) + (ves->sector_count + 7) / 8 +
+                                ves->sector_count * sizeof(ves->sector_dirty_count[0]) +
+                                ves->cat_size * sizeof(cat_entry_t) +
+                                checkpoint_wear_size(ves->sector_count) + 1) & ~1;
+
+                if (!ves_load_checkpoint(ves)) {
+                        ves_clear_tables(ves);
+#if AD_NVMS_VES_INCREMENTAL_GC
+                        /* Invalid checkpoint may have been loaded */
+                        memset(ves->sector_stamp, 0, ves->sector_count * sizeof(uint16_t));
+                        memset(ves->sector_erase_count, 0, ves->sector_count * sizeof(uint16_t));
+                        ves->gc_clock = 0;
+#endif
+                        ves_read_cat(ves);
+                        ves_write_checkpoint(ves, (ves->ckpt_slot + 1) % VES_CHECKPOINT_SLOTS);
+                        ves->ckpt_log_enabled = true;
+                }
+        }
+#else
         ves_read_cat(ves);
+#endif
+#if AD_NVMS_VES_TRANSACTIONS
+        ves_txn_recover(ves);
+#endif
+        ves_check_free(ves);
+        /* Make sure that there is at least one free sector */
+        ves_gc(ves, 1);
 }
 
 static int ad_nvms_ves_read(struct partition_t *part, uint32_t addr, uint8_t *buf,
@@ -759,6 +1719,7 @@ static int ad_nvms_ves_read(struct partition_t *part, uint32_t addr, uint8_t *bu
         sec_ix_t sector;
         size_t offset_in_container;
         size_t chunk;
+        int ret = 0;
         ves_driver_data_t *ves = (ves_driver_data_t *) part->driver_data;
         const size_t data_size = ves->container_data_size;
         const size_t part_size = ad_nvms_ves_get_size(part);
@@ -773,7 +1734,7 @@ static int ad_nvms_ves_read(struct partition_t *part, uint32_t addr, uint8_t *bu
                 size = part_size - addr;
         }
 
-        part_lock(part);
+        part_read_lock(part);
 
         while (offset < size) {
                 size_t read;
@@ -803,16 +1764,17 @@ static int ad_nvms_ves_read(struct partition_t *part, uint32_t addr, uint8_t *bu
                          * be checked.
                          */
                         if (crc != cont->crc16 && cont->crc16 != 0xFFFF) {
-                                return -1;
+                                ret = -1;
+                                break;
                         }
 #endif
                 }
                 offset += read;
         }
 
-        part_unlock(part);
+        part_read_unlock(part);
 
-        return (int) offset;
+        return ret < 0 ? ret : (int) offset;
 }
 
 static void ad_nvms_container_update(ves_driver_data_t *ves, cat_ix_t cat_ix, const uint8_t *buf,
@@ -884,6 +1846,220 @@ static int ad_nvms_ves_write(struct partition_t *part, uint32_t addr, const uint
         return (int) offset;
 }
 
+#if AD_NVMS_VES_TRANSACTIONS
+ad_nvms_ves_txn_t ad_nvms_ves_txn_begin(nvms_t handle)
+{
+        struct partition_t *part = (struct partition_t *) handle;
+        ad_nvms_ves_txn_t txn;
+
+        if (part == NULL || part->driver != &ad_nvms_ves_driver) {
+                return NULL;
+        }
+
+        txn = OS_MALLOC(sizeof(*txn));
+        if (txn != NULL) {
+                txn->part = part;
+                txn->count = 0;
+        }
+
+        return txn;
+}
+
+/* Index of staged container for cat_ix, count of staged containers if there is none */
+static uint16_t ves_txn_find(ad_nvms_ves_txn_t txn, cat_ix_t cat_ix)
+{
+        uint16_t i;
+
+        for (i = 0; i < txn->count && txn->cat_ix[i] != cat_ix; ++i) {
+        }
+
+        return i;
+}
+
+int ad_nvms_ves_txn_write(ad_nvms_ves_txn_t txn, uint32_t addr, const uint8_t *buf,
+                                                                                uint32_t size)
+{
+        size_t offset = 0;
+        ves_driver_data_t *ves;
+        size_t part_size;
+        cat_ix_t first;
+        cat_ix_t last;
+        cat_ix_t cat_ix;
+        uint16_t count;
+
+        if (txn == NULL) {
+                return -1;
+        }
+
+        ves = (ves_driver_data_t *) txn->part->driver_data;
+        part_size = ad_nvms_ves_get_size(txn->part);
+
+        /* Write outside virtual address space */
+        if (addr >= part_size) {
+                return 0;
+        }
+
+        /* Write outside virtual address space, reduce size */
+        if (addr + size > part_size) {
+                size = part_size - addr;
+        }
+
+        if (size == 0) {
+                return 0;
+        }
+
+        /* Check that new containers fit in transaction before anything is staged */
+        first = 1 + addr / ves->container_data_size;
+        last = 1 + (addr + size - 1) / ves->container_data_size;
+        count = txn->count;
+        for (cat_ix = first; cat_ix <= last; ++cat_ix) {
+                if (ves_txn_find(txn, cat_ix) == txn->count) {
+                        count++;
+                }
+        }
+        if (count > ves_txn_capacity(ves)) {
+                return -1;
+        }
+
+        while (offset < size) {
+                const size_t offset_in_container = (addr + offset) % ves->container_data_size;
+                size_t chunk = ves->container_data_size - offset_in_container;
+                uint16_t i;
+
+                cat_ix = 1 + (addr + offset) / ves->container_data_size;
+                if (chunk > size - offset) {
+                        chunk = size - offset;
+                }
+
+                i = ves_txn_find(txn, cat_ix);
+                if (i == txn->count) {
+                        txn->cat_ix[i] = cat_ix;
+                        memset(txn->mask[i], 0, sizeof(txn->mask[i]));
+                        txn->count++;
+                }
+
+                memcpy(txn->cont[i].data + offset_in_container, buf + offset, chunk);
+                for (size_t j = offset_in_container; j < offset_in_container + chunk; ++j) {
+                        txn->mask[i][j / 8] |= 1 << (j & 7);
+                }
+                offset += chunk;
+        }
+
+        return (int) offset;
+}
+
+/*
+ * Staged containers are completed with data currently stored on partition, containers that
+ * don't change are dropped. The rest is written with one flash write after transaction record.
+ */
+bool ad_nvms_ves_txn_commit(ad_nvms_ves_txn_t txn)
+{
+        struct partition_t *part;
+        ves_driver_data_t *ves;
+        size_t data_size;
+        const uint16_t state = VES_TXN_COMMITTED;
+        uint16_t rec_buf[AD_NVMS_VES_CONTAINER_SIZE / sizeof(uint16_t)];
+        ves_txn_record_t *rec = (ves_txn_record_t *) rec_buf;
+        uint16_t count = 0;
+        sec_ix_t sector;
+        con_ix_t container;
+        uint16_t i;
+
+        if (txn == NULL) {
+                return false;
+        }
+
+        part = txn->part;
+        ves = (ves_driver_data_t *) part->driver_data;
+        data_size = ves->container_data_size;
+
+        part_lock(part);
+
+        for (i = 0; i < txn->count; ++i) {
+                const cat_ix_t cat_ix = txn->cat_ix[i];
+                const uint8_t *old_data = NULL;
+                bool changed = false;
+
+                if (ves->cat[cat_ix].container != CAT_ENTRY_NONE) {
+                        old_data = ad_flash_get_ptr(container_data_addr(ves,
+                                        ves->cat[cat_ix].sector, ves->cat[cat_ix].container, 0));
+                }
+                for (size_t j = 0; j < data_size; ++j) {
+                        const uint8_t old = old_data ? old_data[j] : 0xFF;
+
+                        if ((txn->mask[i][j / 8] & (1 << (j & 7))) == 0) {
+                                txn->cont[i].data[j] = old;
+                        } else if (txn->cont[i].data[j] != old) {
+                                changed = true;
+                        }
+                }
+                if (!changed) {
+                        continue;
+                }
+
+                txn->cat_ix[count] = cat_ix;
+                if (count != i) {
+                        memcpy(&txn->cont[count], &txn->cont[i], sizeof(txn->cont[0]));
+                }
+                txn->cont[count].index = CONTAINER_UNINITIALIZED;
+#ifdef CONFIG_NVMS_USE_CRC
+                txn->cont[count].crc16 = crc16_calculate(txn->cont[count].data, data_size);
+#endif
+                count++;
+        }
+
+        if (count == 0) {
+                goto done;
+        }
+
+        ves_txn_reserve(ves, count + 1);
+        sector = ves->current_sector;
+        container = ves->free_container;
+        ves->free_container += count + 1;
+
+        rec->count = count;
+        memcpy(rec->cat_ix, txn->cat_ix, count * sizeof(rec->cat_ix[0]));
+        rec->crc16 = ves_txn_crc(rec, count);
+        /*
+         * Index goes first, so sector taken by ves_txn_reserve() is not found free after power
+         * failure with some data already programmed. Incomplete record fails CRC check.
+         */
+        ves_write_index(ves, sector, container, VES_TXN_INDEX);
+        ad_flash_write(container_data_addr(ves, sector, container,
+                                                        offsetof(ves_txn_record_t, crc16)),
+                        (const uint8_t *) &rec->crc16, sizeof(ves_txn_record_t) +
+                        count * sizeof(rec->cat_ix[0]) - offsetof(ves_txn_record_t, crc16));
+
+        /* Index fields are written with 0xFFFF so they stay unused */
+        ad_flash_write(container_addr(ves, sector, container + 1), (const uint8_t *) txn->cont,
+                                                        count * ves->container_size);
+
+        /* Commit point */
+        ad_flash_write(container_data_addr(ves, sector, container,
+                                                        offsetof(ves_txn_record_t, state)),
+                                                (const uint8_t *) &state, sizeof(state));
+
+        for (i = 0; i < count; ++i) {
+                ves_txn_apply(ves, txn->cat_ix[i], sector, container + 1 + i);
+        }
+
+        /* Record is no longer needed */
+        ves_write_index(ves, sector, container, 0);
+        ves->sector_dirty_count[sector]++;
+
+done:
+        part_unlock(part);
+        OS_FREE(txn);
+
+        return true;
+}
+
+void ad_nvms_ves_txn_abort(ad_nvms_ves_txn_t txn)
+{
+        OS_FREE(txn);
+}
+#endif
+
 static bool ad_nvms_ves_erase(struct partition_t *part, uint32_t addr, uint32_t size)
 {
         return false;
@@ -895,6 +2071,19 @@ static size_t ad_nvms_ves_get_ptr(struct partition_t *part, uint32_t addr, uint3
         return 0;
 }
 
+#if AD_NVMS_VES_INCREMENTAL_GC
+static void ves_gc_register(struct partition_t *part)
+{
+        struct partition_t **tail = &gc_partitions;
+
+        while (*tail != NULL) {
+                tail = &((ves_driver_data_t *) (*tail)->driver_data)->gc_next;
+        }
+        ((ves_driver_data_t *) part->driver_data)->gc_next = NULL;
+        *tail = part;
+}
+#endif
+
 static bool ad_nvms_ves_bind(struct partition_t *part)
 {
         bool ret = false;
@@ -905,6 +2094,9 @@ static bool ad_nvms_ves_bind(struct partition_t *part)
                 part->driver_data = OS_MALLOC(sizeof(ves_driver_data_t));
                 OS_ASSERT(part->driver_data);
                 ves_init(part);
+#if AD_NVMS_VES_INCREMENTAL_GC
+                ves_gc_register(part);
+#endif
                 ret = true;
                 break;
         default:
@@ -915,6 +2107,9 @@ static bool ad_nvms_ves_bind(struct partition_t *part)
                         OS_ASSERT(part->driver_data);
                         part->driver = &ad_nvms_ves_driver;
                         ves_init(part);
+#if AD_NVMS_VES_INCREMENTAL_GC
+                        ves_gc_register(part);
+#endif
                         ret = true;
                         break;
                 }
@@ -930,4 +2125,26 @@ static size_t ad_nvms_ves_get_size(struct partition_t *part)
         return (ves->cat_size - 1) * ves->container_data_size;
 }
 
+#if AD_NVMS_VES_INCREMENTAL_GC
+bool ad_nvms_ves_gc_step(void)
+{
+        struct partition_t *part;
+        bool pending = false;
+
+        for (part = gc_partitions; part != NULL;) {
+                ves_driver_data_t *ves = (ves_driver_data_t *) part->driver_data;
+
+                part_lock(part);
+                if (ves_gc_step(ves)) {
+                        pending = true;
+                }
+                part_unlock(part);
+
+                part = ves->gc_next;
+        }
+
+        return pending;
+}
+#endif
+
 #endif /* dg_configNVMS_VES */
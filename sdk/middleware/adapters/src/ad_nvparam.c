@@ -38,17 +38,32 @@ typedef struct {
         size_t num_parameters;          // number of area parameters
 } area_t;
 
+#define NO_INDEX        0xFF            // tag has no parameter in area
+
 typedef struct {
         const area_t *area;             // attached area configuration
         nvms_t nvms_h;                  // NVMS handle
+#if AD_NVPARAM_INDEX
+        uint8_t index[256];             // position of parameter in area, by tag
+#endif
+#if AD_NVPARAM_CACHE
+        uint8_t *cache;                 // copy of area contents, NULL if area could not be read
+        uint32_t cache_size;            // size of area contents
+#endif
 } nvparam_data_t;
 
 /* Create nvparam configuration from ad_nvparam_defs.h */
 #define IN_AD_NVPARAM_C
 #include <ad_nvparam_defs.h>
 
-static const parameter_t *find_parameter(const area_t *area, uint8_t tag)
+static const parameter_t *find_parameter(const nvparam_data_t *nv_data, uint8_t tag)
 {
+        const area_t *area = nv_data->area;
+#if AD_NVPARAM_INDEX
+        uint8_t i = nv_data->index[tag];
+
+        return i == NO_INDEX ? NULL : &area->parameters[i];
+#else
         int i;
 
         for (i = 0; i < area->num_parameters; i++) {
@@ -58,6 +73,74 @@ static const parameter_t *find_parameter(const area_t *area, uint8_t tag)
         }
 
         return NULL;
+#endif
+}
+
+#if AD_NVPARAM_INDEX
+static void build_index(nvparam_data_t *nv_data)
+{
+        const area_t *area = nv_data->area;
+        size_t i;
+
+        OS_ASSERT(area->num_parameters < NO_INDEX);
+
+        memset(nv_data->index, NO_INDEX, sizeof(nv_data->index));
+        for (i = 0; i < area->num_parameters; i++) {
+                /* Tags must be unique */
+                OS_ASSERT(nv_data->index[area->parameters[i].tag] == NO_INDEX);
+                nv_data->index[area->parameters[i].tag] = (uint8_t) i;
+        }
+}
+#endif
+
+#if AD_NVPARAM_CACHE
+/* Read whole area to RAM, parameters are read from there afterwards */
+static void fill_cache(nvparam_data_t *nv_data)
+{
+        const area_t *area = nv_data->area;
+        uint32_t size = 0;
+        size_t i;
+
+        for (i = 0; i < area->num_parameters; i++) {
+                if (size < area->parameters[i].offset + area->parameters[i].length) {
+                        size = area->parameters[i].offset + area->parameters[i].length;
+                }
+        }
+
+        nv_data->cache_size = size;
+        nv_data->cache = size ? OS_MALLOC(size) : NULL;
+        if (nv_data->cache &&
+                ad_nvms_read(nv_data->nvms_h, area->offset, nv_data->cache, size) != (int) size) {
+                /* Parameters will be read from flash */
+                OS_FREE(nv_data->cache);
+                nv_data->cache = NULL;
+        }
+}
+#endif
+
+/* Read from parameter area, offset is relative to area */
+static int area_read(nvparam_data_t *nv_data, uint32_t offset, uint8_t *buf, uint32_t len)
+{
+#if AD_NVPARAM_CACHE
+        if (nv_data->cache) {
+                memcpy(buf, nv_data->cache + offset, len);
+                return (int) len;
+        }
+#endif
+        return ad_nvms_read(nv_data->nvms_h, nv_data->area->offset + offset, buf, len);
+}
+
+/* Write to parameter area, offset is relative to area */
+static int area_write(nvparam_data_t *nv_data, uint32_t offset, const uint8_t *buf, uint32_t len)
+{
+        int written = ad_nvms_write(nv_data->nvms_h, nv_data->area->offset + offset, buf, len);
+
+#if AD_NVPARAM_CACHE
+        if (nv_data->cache && written > 0) {
+                memcpy(nv_data->cache + offset, buf, written);
+        }
+#endif
+        return written;
 }
 
 nvparam_t ad_nvparam_open(const char *area_name)
@@ -88,6 +171,12 @@ nvparam_t ad_nvparam_open(const char *area_name)
 
         nv_data->area = area;
         nv_data->nvms_h = nvms_h;
+#if AD_NVPARAM_INDEX
+        build_index(nv_data);
+#endif
+#if AD_NVPARAM_CACHE
+        fill_cache(nv_data);
+#endif
 
         return (nvparam_t) nv_data;
 }
@@ -95,6 +184,13 @@ nvparam_t ad_nvparam_open(const char *area_name)
 void ad_nvparam_close(nvparam_t nvparam)
 {
         if (nvparam) {
+#if AD_NVPARAM_CACHE
+                nvparam_data_t *nv_data = nvparam;
+
+                if (nv_data->cache) {
+                        OS_FREE(nv_data->cache);
+                }
+#endif
                 OS_FREE(nvparam);
         }
 }
@@ -108,13 +204,13 @@ void ad_nvparam_erase_all(nvparam_t nvparam)
         }
 
         for (uint8_t i = 0; i < nv_data->area->num_parameters; i++) {
-                uint32_t addr = nv_data->area->offset + nv_data->area->parameters[i].offset;
+                uint32_t addr = nv_data->area->parameters[i].offset;
                 size_t size = nv_data->area->parameters[i].length;
                 uint8_t *write_buf = OS_MALLOC(size * sizeof(uint8_t));
                 OS_ASSERT(write_buf);
                 memset(write_buf, 0xFF, size);
 
-                ad_nvms_write(nv_data->nvms_h, addr, write_buf, size);
+                area_write(nv_data, addr, write_buf, size);
 
                 OS_FREE(write_buf);
         }
@@ -131,7 +227,7 @@ void ad_nvparam_erase(nvparam_t nvparam, uint8_t tag)
                 return;
         }
 
-        param = find_parameter(nv_data->area, tag);
+        param = find_parameter(nv_data, tag);
         if (!param) {
                 return;
         }
@@ -141,7 +237,7 @@ void ad_nvparam_erase(nvparam_t nvparam, uint8_t tag)
         OS_ASSERT(write_buf);
         memset(write_buf, 0xFF, size);
 
-        ad_nvms_write(nv_data->nvms_h, nv_data->area->offset + param->offset, write_buf, size);
+        area_write(nv_data, param->offset, write_buf, size);
 
         OS_FREE(write_buf);
 }
@@ -158,12 +254,12 @@ uint16_t ad_nvparam_read_offset(nvparam_t nvparam, uint8_t tag, uint16_t offset,
                 return 0;
         }
 
-        param = find_parameter(nv_data->area, tag);
+        param = find_parameter(nv_data, tag);
         if (!param) {
                 return 0;
         }
 
-        param_offset = nv_data->area->offset + param->offset;
+        param_offset = param->offset;
         max_length = param->length;
 
         if (param->flags & FLAG_VARIABLE_LEN) {
@@ -171,7 +267,7 @@ uint16_t ad_nvparam_read_offset(nvparam_t nvparam, uint8_t tag, uint16_t offset,
                 int read_len;
 
                 /* read current parameter length first */
-                read_len = ad_nvms_read(nv_data->nvms_h, param_offset, (uint8_t *) &stored_len, 2);
+                read_len = area_read(nv_data, param_offset, (uint8_t *) &stored_len, 2);
 
                 /*
                  * 1) check if read was successful (2 bytes were read)
@@ -198,7 +294,7 @@ uint16_t ad_nvparam_read_offset(nvparam_t nvparam, uint8_t tag, uint16_t offset,
         }
 
         param_offset += offset;
-        return ad_nvms_read(nv_data->nvms_h, param_offset, (uint8_t *) data, length);
+        return area_read(nv_data, param_offset, (uint8_t *) data, length);
 }
 
 uint16_t ad_nvparam_write(nvparam_t nvparam, uint8_t tag, uint16_t length, const void *data)
@@ -211,12 +307,12 @@ uint16_t ad_nvparam_write(nvparam_t nvparam, uint8_t tag, uint16_t length, const
                 return 0;
         }
 
-        param = find_parameter(nv_data->area, tag);
+        param = find_parameter(nv_data, tag);
         if (!param) {
                 return 0;
         }
 
-        offset = nv_data->area->offset + param->offset;
+        offset = param->offset;
 
         /* truncate write to maximum length */
         if (length > param->length) {
@@ -232,7 +328,7 @@ uint16_t ad_nvparam_write(nvparam_t nvparam, uint8_t tag, uint16_t length, const
                 }
 
                 /* write parameter length first */
-                written = ad_nvms_write(nv_data->nvms_h, offset, (uint8_t *) &length, 2);
+                written = area_write(nv_data, offset, (uint8_t *) &length, 2);
                 if (written != 2) {
                         return 0;
                 }
@@ -240,7 +336,7 @@ uint16_t ad_nvparam_write(nvparam_t nvparam, uint8_t tag, uint16_t length, const
                 offset += 2;
         }
 
-        return ad_nvms_write(nv_data->nvms_h, offset, data, length);
+        return area_write(nv_data, offset, data, length);
 }
 
 uint16_t ad_nvparam_get_length(nvparam_t nvparam, uint8_t tag, uint16_t *max_length)
@@ -255,7 +351,7 @@ uint16_t ad_nvparam_get_length(nvparam_t nvparam, uint8_t tag, uint16_t *max_len
                 return 0;
         }
 
-        param = find_parameter(nv_data->area, tag);
+        param = find_parameter(nv_data, tag);
         if (!param) {
                 return 0;
         }
@@ -276,9 +372,9 @@ uint16_t ad_nvparam_get_length(nvparam_t nvparam, uint8_t tag, uint16_t *max_len
                 return param->length;
         }
 
-        offset = nv_data->area->offset + param->offset;
+        offset = param->offset;
 
-        read = ad_nvms_read(nv_data->nvms_h, offset, (uint8_t *) &length, 2);
+        read = area_read(nv_data, offset, (uint8_t *) &length, 2);
 
         /*
          * 1) check if read was successful (2 bytes were read)
@@ -231,7 +231,11 @@
  *
  * \brief Enable task monitoring.
  *
- * \note Task monitoring can only be enabled if RTT or RETARGET is enabled
+ * Per-task CPU load, scheduling latency, context switches and heap usage are collected by kernel
+ * trace hooks (see middleware/monitoring/task_monitoring.h).
+ *
+ * \note Task monitoring can only be enabled if RTT, RETARGET or DGTL is enabled, and can't be
+ * enabled together with dg_configSYSTEMVIEW
  * \bsp_default_note{\bsp_config_option_app,}
  */
 #if !defined(dg_configENABLE_TASK_MONITORING) || defined(RUNNING_DOXYGEN)
@@ -30,6 +30,10 @@
 #       define RINGBUF_SIZE 256
 #endif
 
+#if (RINGBUF_SIZE & (RINGBUF_SIZE - 1)) || (RINGBUF_SIZE > 0x4000)
+#error "CONFIG_CONSOLE_RINGBUF_SIZE must be a power of 2, not larger than 16384"
+#endif
+
 /**
  * Console write timeout defined in ticks
  */
@@ -48,11 +52,11 @@ typedef struct {
         OS_EVENT fifo_not_full;       /**< Event to wake up waiting writers */
         OS_EVENT read_finished;       /**< Event to wake up readers */
         uint16_t read_size;           /**< Number of requested bytes */
-        uint16_t fifo_wrix;           /**< write ring buffer index */
-        uint16_t fifo_rdix;           /**< read ring buffer index */
-        uint16_t fifo_free;           /**< number of free bytes in fifo */
+        volatile uint32_t fifo_wrstate; /**< reserved write position | writers count << 16 */
+        volatile uint16_t fifo_commit;  /**< position up to which data is written */
+        volatile uint16_t fifo_rdpos;   /**< read position, moved when UART write is done */
         uint32_t drop_count;          /**< number of bytes already dropped */
-        bool fifo_blocked;            /**< flag indicating that fifo is blocked */
+        volatile bool fifo_blocked;   /**< flag indicating that fifo is blocked */
         char ring_buf[RINGBUF_SIZE];  /**< ring buffer */
         char *read_buf;               /**< user buffer provided for read */
 } console_data_t;
@@ -65,31 +69,103 @@ static __RETAINED console_data_t console;
 #define CONSOLE_READ_DONE               0x08
 
 /*
- * Copy data to console ring buffer, caller must ensure that data will fit.
- * This function will be called inside critical section.
+ * Ring buffer positions are free running 16-bit counters. Writers (tasks and interrupts) don't
+ * disable interrupts: space is reserved by compare-and-swap of write position together with
+ * number of writers copying data, so when the last writer is done, all data up to reserved
+ * position is written and it can be committed for console task. Uncontended write takes a
+ * single compare-and-swap for reservation and one for commit. Writer interrupted during
+ * reservation (exception entry clears exclusive monitor) just retries it.
+ */
+#define FIFO_POS_MASK           0xFFFF
+#define FIFO_WRITER             0x10000
+
+/*
+ * Reserve up to len bytes in ring buffer, returns number of bytes reserved (0 if buffer is full)
+ * and their position in pos.
  */
-static void console_write_to_ring_buffer(const char *ptr, int len)
+static int console_reserve(int len, uint16_t *pos)
 {
-        console.fifo_free -= len;
-        if (console.fifo_wrix + len > sizeof(console.ring_buf)) {
+        uint32_t wrstate;
+        uint16_t head, used;
+
+        for (;;) {
+                /*
+                 * Read position is loaded first, so that it's never ahead of head. Space may
+                 * be freed and filled again between the loads, then they are just repeated.
+                 */
+                used = __atomic_load_n(&console.fifo_rdpos, __ATOMIC_ACQUIRE);
+                wrstate = __atomic_load_n(&console.fifo_wrstate, __ATOMIC_RELAXED);
+                head = wrstate & FIFO_POS_MASK;
+                used = head - used;
+
+                if (used > RINGBUF_SIZE) {
+                        continue;
+                }
+                if (len > RINGBUF_SIZE - used) {
+                        len = RINGBUF_SIZE - used;
+                }
+                if (len == 0) {
+                        return 0;
+                }
+
+                if (__atomic_compare_exchange_n(&console.fifo_wrstate, &wrstate,
+                        ((wrstate + FIFO_WRITER) & ~FIFO_POS_MASK) | ((head + len) & FIFO_POS_MASK),
+                        true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                        break;
+                }
+        }
+
+        *pos = head;
+
+        return len;
+}
+
+/*
+ * Copy data to reserved space of ring buffer, wrapping around its end if needed.
+ */
+static void console_write_to_ring_buffer(uint16_t pos, const char *ptr, int len)
+{
+        int ix = pos % RINGBUF_SIZE;
+
+        if (ix + len > RINGBUF_SIZE) {
                 /*
                  * This is case when some data must be written at the end of ring buffer.
                  * and some from the beginning.
                  */
-                int left;
-                memcpy(console.ring_buf + console.fifo_wrix, ptr,
-                                                        sizeof(console.ring_buf) - console.fifo_wrix);
-                left  = len - (sizeof(console.ring_buf) - console.fifo_wrix);
-                memcpy(console.ring_buf, ptr + sizeof(console.ring_buf) - console.fifo_wrix, left);
-                console.fifo_wrix = left;
+                memcpy(console.ring_buf + ix, ptr, RINGBUF_SIZE - ix);
+                memcpy(console.ring_buf, ptr + RINGBUF_SIZE - ix, len - (RINGBUF_SIZE - ix));
         } else {
                 /* Simple case without overlap */
-                memcpy(console.ring_buf + console.fifo_wrix, ptr, len);
-                console.fifo_wrix += len;
-                if (console.fifo_wrix >= sizeof(console.ring_buf)) {
-                        console.fifo_wrix = 0;
-                }
+                memcpy(console.ring_buf + ix, ptr, len);
+        }
+}
+
+/*
+ * Make data written by finished writer available to console task. Returns true if this was
+ * the last writer and data was committed.
+ */
+static bool console_commit(void)
+{
+        uint32_t wrstate = __atomic_sub_fetch(&console.fifo_wrstate, FIFO_WRITER, __ATOMIC_ACQ_REL);
+        uint16_t commit, head;
+
+        if (wrstate & ~FIFO_POS_MASK) {
+                /* Interrupted writer will commit this data too */
+                return false;
         }
+
+        head = wrstate & FIFO_POS_MASK;
+        commit = __atomic_load_n(&console.fifo_commit, __ATOMIC_RELAXED);
+
+        do {
+                /* Writer which reserved later may have committed further position already */
+                if ((uint16_t) (head - commit) == 0 || (uint16_t) (head - commit) > RINGBUF_SIZE) {
+                        return false;
+                }
+        } while (!__atomic_compare_exchange_n(&console.fifo_commit, &commit, head, true,
+                                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+        return true;
 }
 
 int console_write(const char *buf, int len)
@@ -97,37 +173,38 @@ int console_write(const char *buf, int len)
         int left = len;
 
         for (;;) {
-                int dropped = 0;
+                int dropped;
+                int written;
+                uint16_t pos;
+
                 /*
                  * Put as much as possible data into ring buffer.
                  */
-                OS_ENTER_CRITICAL_SECTION();
-                if (left > console.fifo_free) {
-                        /* not all can fit in ring buffer */
-                        dropped = left - console.fifo_free;
-                        left = console.fifo_free;
-                }
+                written = console_reserve(left, &pos);
+                dropped = left - written;
+
                 /* There was something to write this time, just put it in buffer */
-                if (left) {
-                        console_write_to_ring_buffer(buf, left);
+                if (written) {
+                        console_write_to_ring_buffer(pos, buf, written);
+
+                        /* If something was put in ring buffer notify task to take over printing */
+                        if (console_commit()) {
+                                OS_TASK_NOTIFY_FROM_ISR(console.task, CONSOLE_WRITE_REQUEST,
+                                                                                OS_NOTIFY_SET_BITS);
+                        }
                 }
+
                 /*
                  * If something was not fitting in ring buffer but we are in interrupt or
                  * FIFO is blocked, bad luck. Data will be just dropped forever.
                  */
-                if (dropped && (in_interrupt() || console.fifo_blocked)) {
-                        console.drop_count += dropped;
+                if (dropped && (in_interrupt() ||
+                                __atomic_load_n(&console.fifo_blocked, __ATOMIC_RELAXED))) {
+                        __atomic_fetch_add(&console.drop_count, dropped, __ATOMIC_RELAXED);
                         dropped = 0;
                 }
-                OS_LEAVE_CRITICAL_SECTION();
-
-                /* If something was put in ring buffer notify task to take over printing */
-                if (left) {
-                        OS_TASK_NOTIFY_FROM_ISR(console.task, CONSOLE_WRITE_REQUEST,
-                                                                                OS_NOTIFY_SET_BITS);
-                }
 
-                buf += left;
+                buf += written;
                 left = 0;
 
                 if (dropped) {
@@ -145,14 +222,14 @@ int console_write(const char *buf, int len)
                         /*
                          * Wait failed with timeout, don't try again. Just count dropped data.
                          */
-                        console.drop_count += left;
+                        __atomic_fetch_add(&console.drop_count, left, __ATOMIC_RELAXED);
 
                         /*
                          * Timeout is usually caused by flow control. Mark the FIFO as blocked and
                          * don't wait in next console_write attempts until there is no space in
                          * FIFO.
                          */
-                        console.fifo_blocked = true;
+                        __atomic_store_n(&console.fifo_blocked, true, __ATOMIC_RELAXED);
                 }
                 break;
         }
@@ -190,21 +267,37 @@ int console_read(char *ptr, int len)
 static void console_write_cb(void *user_data, uint16_t transferred)
 {
         console_data_t *console_data = (console_data_t *) user_data;
-        uint32_t critical_section_status = 0;
 
-        OS_ENTER_CRITICAL_SECTION_FROM_ISR(critical_section_status);
+        /* Move read position, only this callback changes it so no critical section is needed */
+        __atomic_store_n(&console_data->fifo_rdpos, console_data->fifo_rdpos + transferred,
+                                                                                __ATOMIC_RELEASE);
+        __atomic_store_n(&console_data->fifo_blocked, false, __ATOMIC_RELAXED);
+
+        OS_TASK_NOTIFY_FROM_ISR(console_data->task, CONSOLE_WRITE_DONE, OS_NOTIFY_SET_BITS);
+}
+
+/*
+ * Start UART write of committed data directly from ring buffer. Data wrapping around the end
+ * of ring buffer is written in two transfers, second one is started when first one is done.
+ * Returns false if there is nothing to write.
+ */
+static bool console_start_write(ad_uart_handle_t uart)
+{
+        uint16_t rdpos = console.fifo_rdpos;
+        uint16_t size = __atomic_load_n(&console.fifo_commit, __ATOMIC_ACQUIRE) - rdpos;
+        uint16_t ix = rdpos % RINGBUF_SIZE;
+
+        if (size == 0) {
+                return false;
+        }
 
-        /* Move read index and increase free FIFO counter */
-        console_data->fifo_rdix += transferred;
-        if (console_data->fifo_rdix >= sizeof(console_data->ring_buf)) {
-                console_data->fifo_rdix -= sizeof(console_data->ring_buf);
+        if (size > RINGBUF_SIZE - ix) {
+                size = RINGBUF_SIZE - ix;
         }
-        console_data->fifo_free += transferred;
-        console_data->fifo_blocked = false;
 
-        OS_LEAVE_CRITICAL_SECTION_FROM_ISR(critical_section_status);
+        ad_uart_write_async(uart, console.ring_buf + ix, size, console_write_cb, &console);
 
-        OS_TASK_NOTIFY_FROM_ISR(console_data->task, CONSOLE_WRITE_DONE, OS_NOTIFY_SET_BITS);
+        return true;
 }
 
 /*
@@ -271,49 +364,28 @@ static OS_TASK_FUNCTION(console_task_fun, param)
                          * Ring buffer has some new data that should go to UART.
                          */
                         if (0 != (current_requests & CONSOLE_WRITE_REQUEST) &&
-                                                                console.fifo_free < sizeof(console.ring_buf)) {
-                                uint16_t wx = console.fifo_wrix;
-                                uint16_t size = 0;
-                                if (console.fifo_rdix < wx) {
-                                        /*
-                                         * In case when data to write is in one block in ring buffer
-                                         * just print it in one run
-                                         */
-                                        size = wx - console.fifo_rdix;
-                                } else {
-                                        /*
-                                         * This time data to print starts at the end of ring buffer.
-                                         * UART will print this part first, and after writing that,
-                                         * data at the beginning will be printed.
-                                         */
-                                        size = sizeof(console.ring_buf) - console.fifo_rdix;
-                                        /*
-                                         * Write request was already cleared, but here asked for it again.
-                                         * This request will be masked till UART writes finishes.
-                                         */
-                                        pending_requests |= CONSOLE_WRITE_REQUEST;
-                                }
-
-                                if (size > 0) {
-                                        /*
-                                         * There was something to print, mask write request and wait for
-                                         * write done, then start sending data.
-                                         */
-                                        mask ^= CONSOLE_WRITE_REQUEST | CONSOLE_WRITE_DONE;
-
-                                        ad_uart_write_async(uart, console.ring_buf + console.fifo_rdix, size, console_write_cb, &console);
-                                }
-                        }
-
-                        if (0 != (current_requests & CONSOLE_WRITE_DONE)) {
+                                                                console_start_write(uart)) {
                                 /*
-                                 * UART finished printing, enable write request again, and notify clients.
+                                 * There was something to print, mask write request and wait for
+                                 * write done.
                                  */
                                 mask ^= CONSOLE_WRITE_REQUEST | CONSOLE_WRITE_DONE;
+                        }
+
+                        if (0 != (current_requests & CONSOLE_WRITE_DONE)) {
                                 /* Since we were notified by the UART adapter and via the console_write_cb() we must now
                                  * unblock the console_write() in case the message did not fit in the queue.
                                  */
                                 OS_EVENT_SIGNAL(console.fifo_not_full);
+
+                                /*
+                                 * Continue with the rest of ring buffer (data at its beginning or
+                                 * written meanwhile) without waiting for write request. If UART
+                                 * finished printing everything, enable write request again.
+                                 */
+                                if (!console_start_write(uart)) {
+                                        mask ^= CONSOLE_WRITE_REQUEST | CONSOLE_WRITE_DONE;
+                                }
                         }
 
                         if (0 != (current_requests & CONSOLE_READ_REQUEST)) {
@@ -347,7 +419,6 @@ void console_init(const ad_uart_controller_conf_t *ad_uart_ctrl_conf)
                 return;
         }
 
-        console.fifo_free = sizeof(console.ring_buf);
         OS_MUTEX_CREATE(console.mutex);
         OS_EVENT_CREATE(console.fifo_not_full);
         OS_EVENT_CREATE(console.read_finished);
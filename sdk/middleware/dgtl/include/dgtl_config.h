@@ -93,6 +93,24 @@
 #define DGTL_AUTO_FLOW_CONTROL          (1)
 #endif
 
+/**
+ * \brief Receive DGTL packets from circular RX DMA buffer
+ *
+ * When this macro is enabled, DGTL reads incoming packets from the circular RX DMA buffer of its
+ * UART (see \p dg_configUART_RX_CIRCULAR_DMA and \p dg_configUARTx_RX_CIRCULAR_DMA_BUF_SIZE).
+ * All packets already received are extracted at once and UART read is started only when the
+ * rest of a packet is still expected, so a single interrupt can deliver multiple packets.
+ * Otherwise each packet is received with separate reads of its type, header and parameters.
+ *
+ * \note DMA keeps reading the UART even if the buffer is full, so flow control does not stop
+ * the host then. The buffer shall be large enough to hold data received while DGTL task is
+ * blocked on full RX queue, otherwise the oldest data are overwritten.
+ *
+ */
+#ifndef DGTL_UART_RX_CIRCULAR_DMA
+#define DGTL_UART_RX_CIRCULAR_DMA       (0)
+#endif
+
 #endif /* DGTL_CONFIG_H_ */
 
 /**
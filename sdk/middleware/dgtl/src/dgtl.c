@@ -32,6 +32,10 @@
 #include "dgtl_msg.h"
 #include "dgtl_pkt.h"
 
+#if DGTL_UART_RX_CIRCULAR_DMA && (dg_configUART_RX_CIRCULAR_DMA == 0)
+#error "DGTL_UART_RX_CIRCULAR_DMA requires dg_configUART_RX_CIRCULAR_DMA to be enabled"
+#endif
+
 #define NOTIF_QUEUE_TX_DONE     0x00000001
 #define NOTIF_UART_RX_DONE      0x00000002
 #define NOTIF_CLOSE_UART        0x00000004
@@ -129,6 +133,16 @@ typedef struct {
 
         uint8_t resync_buf;
         uint8_t resync_idx;
+
+#if DGTL_UART_RX_CIRCULAR_DMA
+        HW_UART_ID rx_id;
+        uint16_t rx_dma_buf_size;
+        uint16_t rx_avail;      /* bytes available in circular RX DMA buffer */
+        uint8_t *rx_buf;        /* where to put rest of data requested by uart_read() */
+        size_t rx_left;         /* number of requested bytes not received yet */
+        uint16_t rx_pending;    /* number of bytes requested by UART read in progress */
+        bool rx_ready;          /* all requested data are received */
+#endif
         OS_EVENT data_ready;
         OS_EVENT uart_closed;
 } uart_state_t;
@@ -204,7 +218,71 @@ static void push_frame_to_queue(void)
 
 static void uart_read_cb(void *user_data, uint16_t transferred)
 {
-        OS_TASK_NOTIFY_FROM_ISR(dgtl.task, NOTIF_UART_RX_DONE, OS_NOTIFY_SET_BITS);
+        /* Called from task if data were already in circular DMA buffer when read was started */
+        if (in_interrupt()) {
+                OS_TASK_NOTIFY_FROM_ISR(dgtl.task, NOTIF_UART_RX_DONE, OS_NOTIFY_SET_BITS);
+        } else {
+                OS_TASK_NOTIFY(dgtl.task, NOTIF_UART_RX_DONE, OS_NOTIFY_SET_BITS);
+        }
+}
+
+#if DGTL_UART_RX_CIRCULAR_DMA
+static uint16_t uart_get_rx_dma_buf_size(HW_UART_ID id)
+{
+        if (id == HW_UART1) {
+                return dg_configUART1_RX_CIRCULAR_DMA_BUF_SIZE;
+        } else if (id == HW_UART2) {
+                return dg_configUART2_RX_CIRCULAR_DMA_BUF_SIZE;
+        }
+
+        return dg_configUART3_RX_CIRCULAR_DMA_BUF_SIZE;
+}
+
+/*
+ * Copy requested data which are already in circular DMA buffer. If some are still missing, start
+ * UART read which notifies DGTL task when they are received, otherwise set rx_ready.
+ */
+static void uart_read_continue(void)
+{
+        size_t len;
+
+        if (uart.rx_avail < uart.rx_left) {
+                uart.rx_avail = hw_uart_get_rx_circular_dma_data_len(uart.rx_id);
+        }
+
+        len = MIN(uart.rx_avail, uart.rx_left);
+        if (len) {
+                hw_uart_copy_rx_circular_dma_buffer(uart.rx_id, uart.rx_buf, len);
+                uart.rx_avail -= len;
+                uart.rx_buf += len;
+                uart.rx_left -= len;
+        }
+
+        if (uart.rx_left == 0) {
+                uart.rx_ready = true;
+                return;
+        }
+
+        /* Read at most half of buffer at once, so there's room for data received meanwhile */
+        uart.rx_pending = MIN(uart.rx_left, uart.rx_dma_buf_size / 2);
+        ad_uart_read_async(uart.dev, (char *) uart.rx_buf, uart.rx_pending, uart_read_cb, NULL);
+}
+#endif
+
+/*
+ * Receive len bytes to buf, uart_rx_done() handles them in current state. With circular DMA
+ * buffer, data already received are copied immediately and handled in a loop without waiting
+ * for UART interrupt.
+ */
+static void uart_read(void *buf, size_t len)
+{
+#if DGTL_UART_RX_CIRCULAR_DMA
+        uart.rx_buf = buf;
+        uart.rx_left = len;
+        uart_read_continue();
+#else
+        ad_uart_read_async(uart.dev, buf, len, uart_read_cb, NULL);
+#endif
 }
 
 static void uart_resync(bool cont)
@@ -214,7 +292,7 @@ static void uart_resync(bool cont)
                 uart.resync_idx = 0;
         }
 
-        ad_uart_read_async(uart.dev, (char *) &uart.resync_buf, 1, uart_read_cb, NULL);
+        uart_read(&uart.resync_buf, 1);
 }
 
 static void uart_start_packet(void)
@@ -224,7 +302,7 @@ static void uart_start_packet(void)
         uart.frame_header.pkt_type = 0;
 
         uart.rx_state = UART_STATE_W4_TYPE;
-        ad_uart_read_async(uart.dev, (char *) &uart.frame_header.pkt_type, 1, uart_read_cb, NULL);
+        uart_read(&uart.frame_header.pkt_type, 1);
 }
 
 static void uart_handle_rx_type(void)
@@ -241,9 +319,8 @@ static void uart_handle_rx_type(void)
 
         /* Packet type received, receive rest of the header of appropriate size */
         uart.rx_state = UART_STATE_W4_HEADER;
-        ad_uart_read_async(uart.dev,
-                                (char *) &uart.frame_header.pkt_type + sizeof(uart.frame_header.pkt_type),
-                                header_len - 1, uart_read_cb, NULL);
+        uart_read((uint8_t *) &uart.frame_header.pkt_type + sizeof(uart.frame_header.pkt_type),
+                                                                                header_len - 1);
 }
 
 static void uart_handle_rx_header(void)
@@ -268,7 +345,7 @@ static void uart_handle_rx_header(void)
 
         /* Packet header received, receive parameters of appropriate size */
         uart.rx_state = UART_STATE_W4_PARAMETERS;
-        ad_uart_read_async(uart.dev, (char *) &uart.msg->data[header_len], param_len, uart_read_cb, NULL);
+        uart_read(&uart.msg->data[header_len], param_len);
 }
 
 static void uart_handle_rx_parameters(void)
@@ -305,7 +382,7 @@ static void uart_handle_resync(void)
         uart_resync(true);
 }
 
-static void uart_rx_done(void)
+static void uart_handle_rx_data(void)
 {
         switch (uart.rx_state) {
         case UART_STATE_W4_TYPE:
@@ -326,6 +403,46 @@ static void uart_rx_done(void)
         }
 }
 
+#if DGTL_UART_RX_CIRCULAR_DMA
+/* Handle all packets already in circular DMA buffer */
+static void uart_handle_rx_ready(void)
+{
+        while (uart.rx_ready) {
+                uart.rx_ready = false;
+                uart_handle_rx_data();
+        }
+}
+#endif
+
+static void uart_rx_done(void)
+{
+#if DGTL_UART_RX_CIRCULAR_DMA
+        /* Data requested by UART read are in place now */
+        uart.rx_buf += uart.rx_pending;
+        uart.rx_left -= uart.rx_pending;
+        uart.rx_pending = 0;
+        uart_read_continue();
+        uart_handle_rx_ready();
+#else
+        uart_handle_rx_data();
+#endif
+}
+
+static void uart_open(void)
+{
+        uart.dev = ad_uart_open(&DGTL_UART_CONFIG);
+
+#if DGTL_UART_RX_CIRCULAR_DMA
+        /* Adapter has enabled circular DMA, its buffer is empty */
+        uart.rx_id = ad_uart_get_hw_uart_id(uart.dev);
+        uart.rx_dma_buf_size = uart_get_rx_dma_buf_size(uart.rx_id);
+        OS_ASSERT(uart.rx_dma_buf_size > 0);
+        uart.rx_avail = 0;
+        uart.rx_pending = 0;
+        uart.rx_ready = false;
+#endif
+}
+
 dgtl_send_data_t *send_data_create(dgtl_msg_t *msg, dgtl_sent_cb_t cb, void *user_data)
 {
         dgtl_send_data_t *send_data;
@@ -442,9 +559,13 @@ static OS_TASK_FUNCTION(dgtl_task_func, param)
         for (;;) {
                 OS_EVENT_WAIT(uart.data_ready, OS_EVENT_FOREVER);
 
-                uart.dev = ad_uart_open(&DGTL_UART_CONFIG);
+                uart_open();
                 /* Wait for first packet type indicator */
                 uart_start_packet();
+#if DGTL_UART_RX_CIRCULAR_DMA
+                /* First packet may be already received */
+                uart_handle_rx_ready();
+#endif
 
                 while (uart.dev) {
                         uint32_t notif;
@@ -49,22 +49,23 @@ typedef enum {
 
 /** @name CONFIGURATION
  *
- * The logging module can be configured in four distinct, mutually exclusive
+ * The logging module can be configured in five distinct, mutually exclusive
  * modes.
  *
- * The STANDALONE mode uses a queue into which messages are inserted. For each
- * message, a buffer is allocated. A logging-specific task is instantiated, that
- * dequeues the messages, one at a time, writes them to uart and then frees up
- * the buffer. The queue is used to provide 1. rate-decoupling, i.e. absorb
- * peaks of logging rate, and 2. to provide atomicity, i.e. each message will be
- * printed on its entirety on the UART; no messages will be mixed, even if
- * logged simultaneously by two different tasks.
+ * The STANDALONE mode formats messages into a preallocated ring buffer of
+ * LOGGING_BUFFER_SIZE bytes. A logging-specific task is instantiated, that
+ * writes the contents of the ring buffer to uart, one contiguous part of the
+ * buffer per transfer. The ring buffer is used to provide 1. rate-decoupling,
+ * i.e. absorb peaks of logging rate, and 2. to provide atomicity, i.e. each
+ * message will be printed on its entirety on the UART; no messages will be
+ * mixed, even if logged simultaneously by two different tasks. No heap is used
+ * and no critical sections are entered while logging.
  * Messages are ASCII-encoded, i.e. they can be viewed using a simple terminal.
  *
- * The QUEUE mode also uses a queue into which messages are inserted (with all
- * the benefits mentioned in the STANDALONE section). In this
- * case, however, messages are NOT dequeued and written to uart by a logging-
- * specific task, but by the generic serial-link communication task, used by
+ * The QUEUE mode uses a queue into which messages are inserted (with all
+ * the benefits mentioned in the STANDALONE section). For each message, a
+ * buffer is allocated. Messages are NOT dequeued and written to uart by a
+ * logging-specific task, but by the generic serial-link communication task, used by
  * the entire system. In this case, the log message will be encapsulated by the
  * serial link framework into the link-layer PDU (and, obviously, it may not
  * be able to be viewed by a simple terminal, depending on the encapsulating
@@ -80,6 +81,16 @@ typedef enum {
  * UART. CONFIG_RTT must be set system wide for this to work. The same
  * limitations as in RETARGET are applicable.
  *
+ * The DEFERRED mode does not format messages on the device. The address of the
+ * format string, the OS tick, severity, tag and raw values of the arguments are
+ * encoded in a binary record which is stored in the ring buffer of STANDALONE
+ * mode, so logging is much faster and takes less space. A logging-specific task
+ * writes records to the UART configured as in STANDALONE mode or, if
+ * LOGGING_DEFERRED_USE_RTT is set, records are written directly to RTT channel
+ * 0. Format strings are placed in log_fmt section and only their offsets in
+ * this section are stored. Messages are decoded on the host using the ELF file
+ * of the application (utilities/python_scripts/logging/decode_log.py).
+ *
  */
 ///@{
 
@@ -88,9 +99,11 @@ typedef enum {
         #undef LOGGING_MODE_QUEUE
         #undef LOGGING_MODE_RETARGET
         #undef LOGGING_MODE_RTT
+        #undef LOGGING_MODE_DEFERRED
 */
 
-#if defined(LOGGING_MODE_STANDALONE) || defined(LOGGING_MODE_QUEUE) || defined(LOGGING_MODE_RETARGET) || defined(LOGGING_MODE_RTT)
+#if defined(LOGGING_MODE_STANDALONE) || defined(LOGGING_MODE_QUEUE) || defined(LOGGING_MODE_RETARGET) || \
+        defined(LOGGING_MODE_RTT) || defined(LOGGING_MODE_DEFERRED)
 #define LOGGING_ENABLED
 #else
 #undef LOGGING_ENABLED
@@ -123,14 +136,88 @@ typedef enum {
  *
  * If the free system heap before calling malloc for the log message buffer is
  * less than this number (in bytes), the log will be suppressed. This ensures that
- * logs don't fill up the system memory.
+ * logs don't fill up the system memory. (QUEUE mode only)
  *
  */
 #ifndef LOGGING_MIN_ALLOWED_FREE_HEAP
 #define LOGGING_MIN_ALLOWED_FREE_HEAP 600
 #endif
 
-#ifdef LOGGING_MODE_STANDALONE
+#ifdef LOGGING_MODE_DEFERRED
+/**
+ * \brief Write deferred log records to RTT
+ *
+ * If set, records are written to RTT channel 0 by the caller and no logging task
+ * is created. CONFIG_RTT must be set system wide. Otherwise, records are written
+ * to the UART configured by LOGGING_STANDALONE_* macros. (DEFERRED mode only)
+ */
+#ifndef LOGGING_DEFERRED_USE_RTT
+#define LOGGING_DEFERRED_USE_RTT 0
+#endif
+
+/**
+ * \brief Maximum size of deferred log record
+ *
+ * Records are encoded on the caller's stack in a buffer of this size (at most
+ * 257 bytes). Arguments that don't fit are omitted and shown as "<?>" by the
+ * decoder. (DEFERRED mode only)
+ */
+#ifndef LOGGING_DEFERRED_MAX_RECORD_SIZE
+#define LOGGING_DEFERRED_MAX_RECORD_SIZE 64
+#endif
+
+/**
+ * \brief Maximum length of string argument of deferred log
+ *
+ * Strings passed for %s are copied to the record, since they may change before
+ * the record is decoded. Longer strings are truncated. (DEFERRED mode only)
+ */
+#ifndef LOGGING_DEFERRED_MAX_STRING
+#define LOGGING_DEFERRED_MAX_STRING 24
+#endif
+#endif /* LOGGING_MODE_DEFERRED */
+
+#if defined(LOGGING_MODE_STANDALONE) || defined(LOGGING_MODE_DEFERRED)
+/**
+ * \brief Size of log ring buffer
+ *
+ * Number of bytes of ring buffer in which messages wait to be written to the
+ * UART. Must be a power of 2, not larger than 16384. (STANDALONE and DEFERRED
+ * modes)
+ */
+#ifndef LOGGING_BUFFER_SIZE
+#define LOGGING_BUFFER_SIZE 1024
+#endif
+
+/**
+ * \brief Overwrite the oldest messages when the ring buffer is full
+ *
+ * If set to 1, the oldest messages which are not being written to the UART yet
+ * are discarded to make room for a new message. Otherwise, the new message is
+ * discarded. Discarded messages are counted as suppressed in both cases, but
+ * a report of suppressed messages may be discarded too, so less messages than
+ * actually suppressed may be reported. Messages are copied out of the ring
+ * buffer in chunks of LOGGING_TX_CHUNK_SIZE bytes before they are written to
+ * the UART, so the ring buffer stays usable during the transfer.
+ * This takes additional LOGGING_BUFFER_SIZE / 8 + LOGGING_TX_CHUNK_SIZE bytes
+ * of RAM. (STANDALONE and DEFERRED modes)
+ */
+#ifndef LOGGING_OVERWRITE_OLDEST
+#define LOGGING_OVERWRITE_OLDEST 0
+#endif
+
+/**
+ * \brief Size of chunk written to the UART at once with LOGGING_OVERWRITE_OLDEST
+ *
+ * A chunk ends at message boundary, unless a single message doesn't fit in it.
+ * Messages waiting after a partially written one can't be discarded until it
+ * is written entirely, so this should be larger than a typical message.
+ * (STANDALONE and DEFERRED modes)
+ */
+#ifndef LOGGING_TX_CHUNK_SIZE
+#define LOGGING_TX_CHUNK_SIZE 128
+#endif
+
 /**
  * \brief LOGGING_USE_DMA
  *
@@ -226,14 +313,14 @@ typedef enum {
 #define LOGGING_STANDALONE_UART_PARITY    HW_UART_PARITY_NONE
 #endif
 
-#endif /* STANDALONE_MODE */
+#endif /* STANDALONE_MODE || DEFERRED_MODE */
 
-#if defined(LOGGING_MODE_STANDALONE) || defined(LOGGING_MODE_QUEUE)
+#if defined(LOGGING_MODE_STANDALONE) || defined(LOGGING_MODE_QUEUE) || defined(LOGGING_MODE_DEFERRED)
 
 /**
  * \brief Logging queue length
  *
- * In Standalone or Queue mode, defines the number of log entries available in
+ * In Queue mode, defines the number of log entries available in
  * the logging queue. When the queue fills up, any additional entries will be
  * silently discarded.
  */
@@ -244,12 +331,16 @@ typedef enum {
 /**
  * \brief Minimum message size
  *
- * When in Standalone or Queue mode, the log_printf function will first
+ * When in Queue mode, the log_printf function will first
  * allocate a buffer of LOGGING_MIN_MSG_SIZE size and attempt to fill it with
  * the parsed log message. If the buffer doesn't fit the message, it will be
  * freed and a new buffer will be allocated with enough space to fill the, then
  * known, parsed message.
  *
+ * When in Standalone mode, the message is first formatted into a buffer of
+ * this size on the stack and then copied to the ring buffer. Longer messages
+ * are formatted again, directly into the ring buffer.
+ *
  * This value should be large enough to accomodate most messages with incurring
  * the extra processing, but also small enough to avoid unnecessary space waste.
  *
@@ -261,11 +352,12 @@ typedef enum {
 /**
  * \brief Enable suppressed logs counter
  *
- * If set to 1, suppressed logs (i.e. logs dropped because the log queue is
- * full) will be counted. When the queue gets empty, a log indicating the
- * number of suppressed messages will be sent to the queue.
+ * If set to 1, suppressed logs (i.e. logs dropped because the log queue or
+ * ring buffer is full) will be counted. When the queue gets empty, a log
+ * indicating the number of suppressed messages will be sent to the queue.
  *
- * NOTE: This involves a critical section, so it may incur an overhead, if set
+ * NOTE: In Queue mode this involves a critical section, so it may incur an
+ * overhead, if set
  *
  */
 #ifndef LOGGING_SUPPRESSED_COUNT_ENABLE
@@ -289,6 +381,8 @@ typedef enum {
  *
  * A printf-like template to be used for the message logged to
  * report suppressed messages. Must include a single %d
+ * In STANDALONE mode the report is built by the logging task without
+ * printf, so flags and width of the conversion are ignored.
  */
 #ifndef LOGGING_SUPPRESSED_MSG_TMPL
 #define LOGGING_SUPPRESSED_MSG_TMPL "%lu messages were suppressed\n\r"
@@ -315,7 +409,7 @@ typedef enum {
 #define LOGGING_SUPPRESSED_TAG 0
 #endif
 
-#endif /* defined(LOGGING_MODE_STANDALONE) || defined(LOGGING_MODE_QUEUE) */
+#endif /* defined(LOGGING_MODE_STANDALONE) || defined(LOGGING_MODE_QUEUE) || ... */
 ///@}
 
 /**
@@ -352,6 +446,10 @@ void log_printf_raw(const char *fmt, ...);
 #elif defined(LOGGING_MODE_RETARGET) || defined(LOGGING_MODE_RTT)
 #define LOG_FUNCTION printf
 
+#elif defined(LOGGING_MODE_DEFERRED)
+/* fmt must be located in log_fmt section, use log_printf() */
+void log_deferred(logging_severity_e severity, int tag, const char *fmt, ...);
+
 #else
 #define LOG_FUNCTION
 #endif
@@ -371,8 +469,13 @@ void log_printf_raw(const char *fmt, ...);
  *       \<T\>: The log tag. A small number (0, 1, etc...)
  *       \<message\>: The actual log message
  *
- * This function (in Standalone or Queue mode) allocates / frees memory. It
- * MUST NOT be used from an ISR.
+ * This function (in Standalone or Queue mode) MUST NOT be used from an ISR.
+ * In Queue mode it allocates / frees memory. In Standalone mode it reads the
+ * tick with OS_GET_TICK_COUNT() and formats the message with vsnprintf(),
+ * neither of which is ISR-safe, although the ring buffer itself is.
+ *
+ * In Deferred mode the message is not formatted, binary record described in
+ * logging.c is stored instead. Only this mode allows logging from an ISR.
  *
  * \param[in] severity - A logging_severity_e enum value. Represents the severity
  *            level for the log. If this is >= LOGGING_MIN_COMPILED_SEVERITY
@@ -384,7 +487,21 @@ void log_printf_raw(const char *fmt, ...);
  * \param[in] args - The list of arguments for the message, as in printf(3)
  *
  */
-#ifdef LOGGING_ENABLED
+#if defined(LOGGING_MODE_DEFERRED)
+#define log_printf(severity, tag, format, args...) \
+                do {\
+                        if ((severity) >= LOGGING_MIN_COMPILED_SEVERITY && \
+                                        (severity) >= logging_min_severity) { \
+                                static const char log_fmt[] __attribute__((section("log_fmt"))) = \
+                                                                                        format; \
+                                log_deferred((severity), (tag), log_fmt , ##args); \
+                        } \
+                        if (0) { \
+                                /* Lets compiler check arguments against format */ \
+                                printf(format , ##args); \
+                        } \
+                } while (0)
+#elif defined(LOGGING_ENABLED)
 #define log_printf(severity, tag, format, args...) \
                 do {\
                         if ((severity) >= LOGGING_MIN_COMPILED_SEVERITY && \
@@ -0,0 +1,336 @@
+/**
+ ****************************************************************************************
+ *
+ * @file log_ring.c
+ *
+ * @brief Lock-free multi-producer, single-consumer byte ring of logging module
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#include <string.h>
+
+#include "log_ring.h"
+
+/*
+ * Shared state is updated with compare-and-swap (LDREX/STREX on Cortex-M33), so producers
+ * never disable interrupts nor wait for each other. Exception entry clears exclusive monitor,
+ * so producer interrupted by ISR which logs too just retries its update.
+ *
+ * wstate:  reserved (head) position and number of producers which reserved space and didn't
+ *          commit yet. Both are changed together, so when the number drops to 0, all data up
+ *          to head is written and head can be published as committed position.
+ * tstate:  read position and length of span claimed by consumer. Space up to read position
+ *          is free. Records can be discarded only when no span is claimed, since both
+ *          consumer and discarding producer update tstate, it's never both. Consumer which
+ *          copies data out with log_ring_read() claims span only for the copy.
+ * commit:  position up to which consumer may send data.
+ */
+
+#define POS_MASK                0xFFFF
+#define WRITER                  0x10000
+
+static uint16_t ring_size(const log_ring_t *ring)
+{
+        return ring->mask + 1;
+}
+
+static bool is_start(const log_ring_t *ring, uint16_t pos)
+{
+        uint16_t idx = pos & ring->mask;
+
+        return (__atomic_load_n(&ring->starts[idx / 32], __ATOMIC_RELAXED) >> (idx % 32)) & 1;
+}
+
+/* Mark record start at pos, clear marks left from previous records in the rest of space */
+static void mark_start(log_ring_t *ring, uint16_t pos, uint16_t len)
+{
+        uint16_t idx = pos & ring->mask;
+        uint16_t n;
+        uint32_t bits;
+
+        while (len) {
+                n = 32 - idx % 32;
+                if (n > ring_size(ring) - idx) {
+                        n = ring_size(ring) - idx;
+                }
+                if (n > len) {
+                        n = len;
+                }
+
+                bits = (n == 32) ? 0xFFFFFFFF : ((1UL << n) - 1) << (idx % 32);
+                __atomic_fetch_and(&ring->starts[idx / 32], ~bits, __ATOMIC_RELAXED);
+
+                len -= n;
+                idx = (idx + n) & ring->mask;
+        }
+
+        idx = pos & ring->mask;
+        __atomic_fetch_or(&ring->starts[idx / 32], 1UL << (idx % 32), __ATOMIC_RELAXED);
+}
+
+/* Position of the first record start in [pos, end), end if there's none */
+static uint16_t next_start(const log_ring_t *ring, uint16_t pos, uint16_t end)
+{
+        uint16_t idx, n;
+        uint32_t bits;
+
+        while (pos != end) {
+                idx = pos & ring->mask;
+                n = 32 - idx % 32;
+                if (n > ring_size(ring) - idx) {
+                        n = ring_size(ring) - idx;
+                }
+                if (n > (uint16_t) (end - pos)) {
+                        n = end - pos;
+                }
+
+                bits = __atomic_load_n(&ring->starts[idx / 32], __ATOMIC_RELAXED) >> (idx % 32);
+                if (n < 32) {
+                        bits &= (1UL << n) - 1;
+                }
+                if (bits) {
+                        return pos + __builtin_ctz(bits);
+                }
+
+                pos += n;
+        }
+
+        return end;
+}
+
+/* Position of the last record start in (pos, end], pos if there's none */
+static uint16_t last_start(const log_ring_t *ring, uint16_t pos, uint16_t end)
+{
+        uint16_t last = pos;
+
+        for (;;) {
+                pos = next_start(ring, pos + 1, end + 1);
+                if (pos == (uint16_t) (end + 1)) {
+                        return last;
+                }
+                last = pos;
+        }
+}
+
+/*
+ * Discard the oldest committed records to free at least need bytes. Returns false if it's not
+ * possible now, true if records were discarded or another context changed tstate meanwhile.
+ */
+static bool discard(log_ring_t *ring, uint32_t tstate, uint32_t need, uint32_t *discarded)
+{
+        uint16_t read = tstate & POS_MASK;
+        uint16_t commit, pos;
+        uint32_t count = 0;
+
+        /* Data being sent can't be overwritten, part of record already sent can't be recalled */
+        if (!ring->starts || (tstate >> 16) || !is_start(ring, read)) {
+                return false;
+        }
+
+        commit = __atomic_load_n(&ring->commit, __ATOMIC_ACQUIRE);
+
+        for (pos = read; (uint16_t) (pos - read) < need; count++) {
+                if (pos == commit) {
+                        return false;
+                }
+                pos = next_start(ring, pos + 1, commit);
+        }
+
+        if (__atomic_compare_exchange_n(&ring->tstate, &tstate, pos, false, __ATOMIC_ACQ_REL,
+                                                                        __ATOMIC_RELAXED)) {
+                *discarded += count;
+        }
+
+        return true;
+}
+
+void log_ring_init(log_ring_t *ring, uint8_t *buf, uint16_t size, uint32_t *starts)
+{
+        ring->buf = buf;
+        ring->starts = starts;
+        ring->mask = size - 1;
+        ring->wstate = 0;
+        ring->tstate = 0;
+        ring->commit = 0;
+
+        if (starts) {
+                memset(starts, 0, LOG_RING_STARTS_WORDS(size) * sizeof(starts[0]));
+        }
+}
+
+bool log_ring_reserve(log_ring_t *ring, uint16_t len, bool contiguous, log_ring_res_t *res,
+                                                                        uint32_t *discarded)
+{
+        uint32_t wstate, tstate, used, total;
+        uint16_t head, pad;
+
+        if (len == 0 || len > ring_size(ring)) {
+                return false;
+        }
+
+        for (;;) {
+                /*
+                 * Read position is loaded first, so that it's never ahead of head. Space may be
+                 * freed and filled again between the loads, then they are just repeated.
+                 */
+                tstate = __atomic_load_n(&ring->tstate, __ATOMIC_ACQUIRE);
+                wstate = __atomic_load_n(&ring->wstate, __ATOMIC_RELAXED);
+
+                head = wstate & POS_MASK;
+                used = (uint16_t) (head - tstate);
+                if (used > ring_size(ring)) {
+                        continue;
+                }
+
+                pad = 0;
+                if (contiguous && (head & ring->mask) + len > ring_size(ring)) {
+                        pad = ring_size(ring) - (head & ring->mask);
+                }
+                total = pad + len;
+
+                if (used + total > ring_size(ring)) {
+                        if (!discard(ring, tstate, used + total - ring_size(ring), discarded)) {
+                                return false;
+                        }
+                        continue;
+                }
+
+                if (__atomic_compare_exchange_n(&ring->wstate, &wstate,
+                                ((wstate + WRITER) & ~POS_MASK) | ((head + total) & POS_MASK),
+                                true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                        break;
+                }
+        }
+
+        if (ring->starts) {
+                mark_start(ring, head, total);
+        }
+
+        if (pad) {
+                memset(&ring->buf[head & ring->mask], 0, pad);
+        }
+
+        res->start = head;
+        res->pos = head + pad;
+        res->len = len;
+
+        return true;
+}
+
+void log_ring_write(log_ring_t *ring, const log_ring_res_t *res, const void *data)
+{
+        uint16_t idx = res->pos & ring->mask;
+        uint16_t first = ring_size(ring) - idx;
+
+        if (first > res->len) {
+                first = res->len;
+        }
+
+        memcpy(&ring->buf[idx], data, first);
+        memcpy(ring->buf, (const uint8_t *) data + first, res->len - first);
+}
+
+bool log_ring_commit(log_ring_t *ring, const log_ring_res_t *res)
+{
+        uint32_t wstate, commit;
+        uint16_t head;
+
+        /* Records are published in order of reservation, position of this one is not needed */
+        (void) res;
+
+        wstate = __atomic_sub_fetch(&ring->wstate, WRITER, __ATOMIC_ACQ_REL);
+        if (wstate & ~POS_MASK) {
+                /* The last producer to commit publishes this record too */
+                return false;
+        }
+
+        head = wstate & POS_MASK;
+        commit = __atomic_load_n(&ring->commit, __ATOMIC_RELAXED);
+
+        do {
+                /* Another producer may have published further position meanwhile */
+                if ((uint16_t) (head - commit) == 0 ||
+                                        (uint16_t) (head - commit) > LOG_RING_MAX_SIZE) {
+                        return false;
+                }
+        } while (!__atomic_compare_exchange_n(&ring->commit, &commit, head, true,
+                                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+        /* Pairs with log_ring_release(), either consumer sees new data or it's woken up */
+        return commit == (__atomic_load_n(&ring->tstate, __ATOMIC_SEQ_CST) & POS_MASK);
+}
+
+uint16_t log_ring_peek(log_ring_t *ring, const uint8_t **data)
+{
+        uint32_t tstate = __atomic_load_n(&ring->tstate, __ATOMIC_RELAXED);
+        uint16_t read, len;
+
+        do {
+                read = tstate & POS_MASK;
+                len = __atomic_load_n(&ring->commit, __ATOMIC_SEQ_CST) - read;
+                if (len == 0) {
+                        return 0;
+                }
+
+                if (len > ring_size(ring) - (read & ring->mask)) {
+                        len = ring_size(ring) - (read & ring->mask);
+                }
+                /* Producers may discard records meanwhile, so claim span atomically */
+        } while (!__atomic_compare_exchange_n(&ring->tstate, &tstate, read | (uint32_t) len << 16,
+                                                false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+        *data = &ring->buf[read & ring->mask];
+
+        return len;
+}
+
+void log_ring_release(log_ring_t *ring, uint16_t len)
+{
+        uint16_t read = __atomic_load_n(&ring->tstate, __ATOMIC_RELAXED) & POS_MASK;
+
+        /* Only consumer changes tstate while span is claimed */
+        __atomic_store_n(&ring->tstate, (uint16_t) (read + len), __ATOMIC_SEQ_CST);
+}
+
+uint16_t log_ring_read(log_ring_t *ring, uint8_t *buf, uint16_t size)
+{
+        uint32_t tstate = __atomic_load_n(&ring->tstate, __ATOMIC_RELAXED);
+        uint16_t read, len, end, first;
+
+        do {
+                read = tstate & POS_MASK;
+                len = __atomic_load_n(&ring->commit, __ATOMIC_SEQ_CST) - read;
+                if (len == 0) {
+                        return 0;
+                }
+
+                if (len > size) {
+                        len = size;
+                        /* Stop at record start if possible, so that the rest can be discarded */
+                        if (ring->starts) {
+                                end = last_start(ring, read, read + len);
+                                if (end != read) {
+                                        len = end - read;
+                                }
+                        }
+                }
+                /* Claim span for the copy, as log_ring_peek() does */
+        } while (!__atomic_compare_exchange_n(&ring->tstate, &tstate, read | (uint32_t) len << 16,
+                                                false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+        first = ring_size(ring) - (read & ring->mask);
+        if (first > len) {
+                first = len;
+        }
+        memcpy(buf, &ring->buf[read & ring->mask], first);
+        memcpy(buf + first, ring->buf, len - first);
+
+        log_ring_release(ring, len);
+
+        return len;
+}
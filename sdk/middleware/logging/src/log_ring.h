@@ -0,0 +1,106 @@
+/**
+ ****************************************************************************************
+ *
+ * @file log_ring.h
+ *
+ * @brief Lock-free multi-producer, single-consumer byte ring of logging module
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sdk_defs.h"
+
+/*
+ * Producers (tasks and ISRs) reserve space for a record, write it and commit it. Records are
+ * stored back to back with no header, so consumer gets contiguous spans of committed data
+ * which can be written to the UART as they are.
+ *
+ * Positions are free running 16-bit counters, size of ring must be a power of 2, not larger
+ * than LOG_RING_MAX_SIZE. Committed position is advanced when the last producer which has
+ * reserved space completes, so a record becomes visible to consumer once all records
+ * reserved before it are written too.
+ *
+ * If ring is created with a bitmap of record starts (one bit per byte), producer which
+ * doesn't find enough space discards the oldest committed records which are not being sent.
+ * Otherwise (or if there's nothing to discard) the new record is dropped. Space of span which
+ * is being sent directly from ring can't be reused, and when ring is full the new record needs
+ * exactly that space, so consumer should copy data out with log_ring_read() instead. Then
+ * records are dropped only while they are copied.
+ */
+#define LOG_RING_MAX_SIZE               0x4000
+
+/* Number of words of bitmap of record starts needed by ring of given size */
+#define LOG_RING_STARTS_WORDS(size)     (((size) + 31) / 32)
+
+typedef struct {
+        uint8_t *buf;
+        uint32_t *starts;               /* bitmap of record starts, NULL to drop newest */
+        uint16_t mask;                  /* size - 1 */
+        volatile uint32_t wstate;       /* reserved position | producers writing << 16 */
+        volatile uint32_t tstate;       /* read position | length being sent << 16 */
+        volatile uint32_t commit;       /* committed position */
+} log_ring_t;
+
+/* Space reserved for a record */
+typedef struct {
+        uint16_t start;                 /* position of record */
+        uint16_t pos;                   /* position of data, after padding */
+        uint16_t len;                   /* length of data */
+} log_ring_res_t;
+
+/*
+ * Initialize empty ring. starts must have LOG_RING_STARTS_WORDS(size) words, or be NULL if
+ * new records should be dropped when ring is full.
+ */
+void log_ring_init(log_ring_t *ring, uint8_t *buf, uint16_t size, uint32_t *starts);
+
+/*
+ * Reserve len bytes. If contiguous is set, data won't wrap around the end of buffer, the space
+ * left up to the end is filled with zeros. Number of records discarded to make room is added
+ * to *discarded. Returns false if record is dropped.
+ */
+bool log_ring_reserve(log_ring_t *ring, uint16_t len, bool contiguous, log_ring_res_t *res,
+                                                                        uint32_t *discarded);
+
+/* Pointer to data of reservation made with contiguous flag set */
+__STATIC_INLINE uint8_t *log_ring_data(log_ring_t *ring, const log_ring_res_t *res)
+{
+        return &ring->buf[res->pos & ring->mask];
+}
+
+/* Copy res->len bytes to reserved space, wrapping around the end of buffer if needed */
+void log_ring_write(log_ring_t *ring, const log_ring_res_t *res, const void *data);
+
+/*
+ * Make record available to consumer. Returns true if ring was empty, i.e. consumer may be
+ * waiting and must be woken up.
+ */
+bool log_ring_commit(log_ring_t *ring, const log_ring_res_t *res);
+
+/*
+ * Get the first contiguous span of committed data, up to the end of buffer. Span can't be
+ * discarded until it is released. Returns length of span, 0 if there's no data.
+ */
+uint16_t log_ring_peek(log_ring_t *ring, const uint8_t **data);
+
+/* Free span returned by log_ring_peek() */
+void log_ring_release(log_ring_t *ring, uint16_t len);
+
+/*
+ * Copy up to size bytes of committed data to buf, wrapping around the end of buffer, and free
+ * them. If there's more data, copy ends at record start when possible, so that records which
+ * are left can be discarded. Returns number of bytes copied, 0 if there's no data.
+ */
+uint16_t log_ring_read(log_ring_t *ring, uint8_t *buf, uint16_t size);
+
+#endif /* LOG_RING_H */
@@ -15,6 +15,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stddef.h>
 
 #include "osal.h"
 #include "sys_power_mgr.h"
@@ -24,9 +25,17 @@
 #include "logging.h"
 
 #include "hw_sys.h"
+#include "interrupts.h"
 
-/* Internal FLAG */
+#if defined(LOGGING_MODE_DEFERRED) && (LOGGING_DEFERRED_USE_RTT == 1)
+#include "SEGGER_RTT.h"
+#endif
+
+#include "log_ring.h"
+
+/* Internal FLAGs */
 #undef USE_QUEUE
+#undef USE_LOG_TASK
 
 /**
  * \brief Basic configuration checks
@@ -35,7 +44,7 @@
 #if defined(LOGGING_MODE_QUEUE) || defined(LOGGING_MODE_RETARGET) || defined(LOGGING_MODE_RTT)
 #error Only one logging mode can be set
 #endif
-#define USE_QUEUE
+#define USE_LOG_TASK
 #endif
 
 #ifdef LOGGING_MODE_QUEUE
@@ -45,6 +54,23 @@
 #define USE_QUEUE
 #endif
 
+#ifdef LOGGING_MODE_DEFERRED
+#if defined(LOGGING_MODE_STANDALONE) || defined(LOGGING_MODE_QUEUE) || \
+        defined(LOGGING_MODE_RETARGET) || defined(LOGGING_MODE_RTT)
+#error Only one logging mode can be set
+#endif
+#if LOGGING_DEFERRED_MAX_RECORD_SIZE > 257
+#error "LOGGING_DEFERRED_MAX_RECORD_SIZE must not exceed 257 bytes"
+#endif
+#if LOGGING_DEFERRED_USE_RTT == 1
+#ifndef CONFIG_RTT
+#error "LOGGING_DEFERRED_USE_RTT requires system-wide CONFIG_RTT to be defined"
+#endif
+#else
+#define USE_LOG_TASK
+#endif
+#endif
+
 #if defined(LOGGING_MODE_RETARGET) && !defined(CONFIG_RETARGET)
 #error "Logging mode RETARGET requires system-wide CONFIG_RETARGET to be defined"
 #endif
@@ -53,8 +79,12 @@
 #error "Logging mode RTT requires system-wide CONFIG_RTT to be defined"
 #endif
 
-#ifdef LOGGING_MODE_STANDALONE
-/* Task stack size */
+#ifdef USE_LOG_TASK
+#if (LOGGING_BUFFER_SIZE & (LOGGING_BUFFER_SIZE - 1)) || (LOGGING_BUFFER_SIZE > LOG_RING_MAX_SIZE)
+#error "LOGGING_BUFFER_SIZE must be a power of 2, not larger than 16384"
+#endif
+
+/* Task stack size, the task doesn't format messages (see log_suppressed()) */
 #define mainTASK_STACK_SIZE 100
 
 /* Task priorities */
@@ -63,14 +93,33 @@
 #endif
 
 #ifdef USE_QUEUE
-
 __RETAINED static OS_QUEUE xLogQueue;
+#endif /* USE_QUEUE */
 
+#if defined(USE_QUEUE) || defined(LOGGING_MODE_STANDALONE) || defined(LOGGING_MODE_DEFERRED)
 #if LOGGING_SUPPRESSED_COUNT_ENABLE == 1
 __RETAINED static uint32_t suppressed_messages;
 #endif /* LOGGING_SUPPRESSED_COUNT_ENABLE == 1 */
+#endif
 
-#endif /* USE_QUEUE */
+#ifdef USE_LOG_TASK
+/*
+ * Messages (or deferred log records) waiting to be sent to UART by logging task. Producers
+ * don't allocate memory nor disable interrupts, see log_ring.c.
+ */
+__RETAINED static uint8_t log_buf[LOGGING_BUFFER_SIZE];
+#if LOGGING_OVERWRITE_OLDEST == 1
+__RETAINED static uint32_t log_starts[LOG_RING_STARTS_WORDS(LOGGING_BUFFER_SIZE)];
+#endif
+__RETAINED static log_ring_t log_ring;
+#if LOGGING_OVERWRITE_OLDEST == 1
+/* Data is sent from a copy, so that messages waiting in ring can be discarded meanwhile */
+__RETAINED static uint8_t log_tx_buf[LOGGING_TX_CHUNK_SIZE];
+#endif
+
+/* Signaled when message is added to empty ring buffer */
+__RETAINED static OS_EVENT log_event;
+#endif /* USE_LOG_TASK */
 
 #ifdef LOGGING_ENABLED
 const char logging_severity_chars[] = "DNWECCCC";
@@ -78,7 +127,7 @@ const char logging_severity_chars[] = "DNWECCCC";
 __RETAINED logging_severity_e logging_min_severity;
 #endif /* LOGGING_ENABLED */
 
-#ifdef LOGGING_MODE_STANDALONE
+#ifdef USE_LOG_TASK
 
 #ifndef LOGGING_STANDALONE_UART
 #       define LOGGING_STANDALONE_UART HW_UART2
@@ -175,35 +224,57 @@ static void uart_tx_cb(void *user_data, uint16_t written)
 }
 #endif /* LOGGING_USE_DMA == 1 */
 
-/**
- * @brief Main Logging task. Only used for standalone or queue
- * logging modes
- */
-static OS_TASK_FUNCTION(prvLogTask, pvParameters)
-{
-        struct mcif_message_s *current_message;
+#if LOGGING_SUPPRESSED_COUNT_ENABLE == 1
+static void log_suppressed(void);
+#endif
 
+static void log_uart_send(const uint8_t *data, uint16_t len)
+{
 #if LOGGING_USE_DMA == 1
         hw_uart_tx_callback cb = uart_tx_cb;
 #else
         hw_uart_tx_callback cb = NULL;
 #endif
 
+        hw_uart_send(LOGGING_STANDALONE_UART, data, len, cb, NULL);
+        while (hw_uart_is_busy(LOGGING_STANDALONE_UART)) {}
+
+#if LOGGING_USE_DMA == 1
+        OS_EVENT_WAIT(xSemaphore, OS_EVENT_FOREVER);
+#endif
+}
+
+/**
+ * @brief Main Logging task. Only used for standalone or deferred
+ * logging modes. Sends contents of ring buffer to UART, one contiguous
+ * part of buffer per transfer, or with LOGGING_OVERWRITE_OLDEST one
+ * copied chunk of up to LOGGING_TX_CHUNK_SIZE bytes per transfer.
+ */
+static OS_TASK_FUNCTION(prvLogTask, pvParameters)
+{
+        uint16_t len;
+#if LOGGING_OVERWRITE_OLDEST == 0
+        const uint8_t *data;
+#endif
+
         for (;;) {
                 is_active = false;
-                OS_QUEUE_GET(xLogQueue, &current_message, OS_QUEUE_FOREVER);
+                OS_EVENT_WAIT(log_event, OS_EVENT_FOREVER);
                 is_active = true;
 
+#if LOGGING_OVERWRITE_OLDEST == 1
+                while ((len = log_ring_read(&log_ring, log_tx_buf, sizeof(log_tx_buf))) != 0) {
+                        log_uart_send(log_tx_buf, len);
+#else
+                while ((len = log_ring_peek(&log_ring, &data)) != 0) {
+                        log_uart_send(data, len);
+                        log_ring_release(&log_ring, len);
+#endif
 
-                hw_uart_send(LOGGING_STANDALONE_UART, current_message->buffer, current_message->len,
-                        cb, NULL);
-                while (hw_uart_is_busy(LOGGING_STANDALONE_UART)) {}
-
-
-#if LOGGING_USE_DMA == 1
-                OS_EVENT_WAIT(xSemaphore, OS_EVENT_FOREVER);
+#if LOGGING_SUPPRESSED_COUNT_ENABLE == 1
+                        log_suppressed();
 #endif
-                OS_FREE(current_message);
+                }
         }
 }
 
@@ -212,7 +283,7 @@ static void standalone_init(void)
         pm_register_adapter(&sleep_cbs);
 }
 
-#endif /* LOGGING_MODE_STANDALONE == 1 */
+#endif /* USE_LOG_TASK */
 
 /**
  * @brief Initialization function of logging module
@@ -234,7 +305,20 @@ void log_init(void)
         OS_ASSERT(xLogQueue);
 #endif
 
-#ifdef LOGGING_MODE_STANDALONE
+#if defined(LOGGING_MODE_STANDALONE) || defined(LOGGING_MODE_DEFERRED)
+#if LOGGING_SUPPRESSED_COUNT_ENABLE == 1
+        suppressed_messages = 0;
+#endif
+#endif
+
+#ifdef USE_LOG_TASK
+#if LOGGING_OVERWRITE_OLDEST == 1
+        log_ring_init(&log_ring, log_buf, sizeof(log_buf), log_starts);
+#else
+        log_ring_init(&log_ring, log_buf, sizeof(log_buf), NULL);
+#endif
+        OS_EVENT_CREATE(log_event);
+
 
         standalone_init();
 
@@ -251,7 +335,7 @@ void log_init(void)
                        LoggingTaskHandle);                              // Task handle
         OS_ASSERT(LoggingTaskHandle);
 
-#endif /* LOGGING_MODE_STANDALONE == 1 */
+#endif /* USE_LOG_TASK */
 
 }
 
@@ -262,6 +346,185 @@ void log_set_severity(logging_severity_e severity)
 #endif
 }
 
+#ifdef USE_LOG_TASK
+
+/* Reserve space in ring buffer, messages discarded to make room are counted as suppressed */
+static bool log_reserve(uint16_t len, bool contiguous, log_ring_res_t *res)
+{
+        uint32_t discarded = 0;
+        bool ret;
+
+        ret = log_ring_reserve(&log_ring, len, contiguous, res, &discarded);
+
+#if LOGGING_SUPPRESSED_COUNT_ENABLE == 1
+        if (discarded) {
+                __atomic_fetch_add(&suppressed_messages, discarded, __ATOMIC_RELAXED);
+        }
+#endif
+
+        return ret;
+}
+
+static void log_commit(const log_ring_res_t *res)
+{
+        /* Logging task checks for more data after each transfer, wake it up only when idle */
+        if (log_ring_commit(&log_ring, res)) {
+                if (in_interrupt()) {
+                        OS_EVENT_SIGNAL_FROM_ISR(log_event);
+                } else {
+                        OS_EVENT_SIGNAL(log_event);
+                }
+        }
+}
+
+#endif /* USE_LOG_TASK */
+
+#ifdef LOGGING_MODE_STANDALONE
+
+static bool log_store_va(const char *fmt, va_list args)
+{
+        char msg[LOGGING_MIN_MSG_SIZE];
+        log_ring_res_t res;
+        va_list args_copy;
+        int n;
+
+        va_copy(args_copy, args);
+        n = vsnprintf(msg, sizeof(msg), fmt, args_copy);
+        va_end(args_copy);
+
+        /* Message is sent with its terminating null */
+        if (n < 0 || n >= LOGGING_BUFFER_SIZE) {
+                return false;
+        }
+
+        if (n < sizeof(msg)) {
+                if (!log_reserve(n + 1, false, &res)) {
+                        return false;
+                }
+                log_ring_write(&log_ring, &res, msg);
+        } else {
+                /* Format again, directly to ring buffer */
+                if (!log_reserve(n + 1, true, &res)) {
+                        return false;
+                }
+                vsnprintf((char *) log_ring_data(&log_ring, &res), n + 1, fmt, args);
+        }
+
+        log_commit(&res);
+
+        return true;
+}
+
+#if LOGGING_SUPPRESSED_COUNT_ENABLE == 1
+/* Decimal digits of unsigned long, with room to spare */
+#define SUPPRESSED_NUM_SZ       (3 * sizeof(unsigned long))
+/* Template with tick, tag and count, brackets, severity, sign of tag and spaces */
+#define SUPPRESSED_REPORT_SZ    (sizeof(LOGGING_SUPPRESSED_MSG_TMPL) + 3 * SUPPRESSED_NUM_SZ + 8)
+
+/* Write value in decimal, returns position after it */
+static char *log_put_number(char *p, unsigned long value)
+{
+        char digits[SUPPRESSED_NUM_SZ];
+        int n = 0;
+
+        do {
+                digits[n++] = '0' + value % 10;
+                value /= 10;
+        } while (value);
+
+        while (n) {
+                *p++ = digits[--n];
+        }
+
+        return p;
+}
+
+/*
+ * Report is built without vsnprintf(), so that the small stack of logging task which calls this
+ * is enough. Template must have a single conversion, its flags, width and length are ignored.
+ */
+static void log_suppressed(void)
+{
+        uint32_t suppressed_count = __atomic_load_n(&suppressed_messages, __ATOMIC_RELAXED);
+        char msg[SUPPRESSED_REPORT_SZ];
+        const char *t;
+        char *p = msg;
+        bool converted = false;
+        log_ring_res_t res;
+
+        if ((LOGGING_SUPPRESSED_SEVERITY < LOGGING_MIN_COMPILED_SEVERITY) ||
+                (LOGGING_SUPPRESSED_SEVERITY < logging_min_severity)) {
+                return;
+        }
+
+        if (suppressed_count < LOGGING_SUPPRESSED_MIN_COUNT) {
+                return;
+        }
+
+        /* Same as "[%lu] %c %d " LOGGING_SUPPRESSED_MSG_TMPL */
+        *p++ = '[';
+        p = log_put_number(p, OS_GET_TICK_COUNT());
+        *p++ = ']';
+        *p++ = ' ';
+        *p++ = logging_severity_chars[LOGGING_SUPPRESSED_SEVERITY];
+        *p++ = ' ';
+        if (LOGGING_SUPPRESSED_TAG < 0) {
+                *p++ = '-';
+        }
+        p = log_put_number(p, LOGGING_SUPPRESSED_TAG < 0 ? -(long) LOGGING_SUPPRESSED_TAG :
+                                                                        LOGGING_SUPPRESSED_TAG);
+        *p++ = ' ';
+
+        for (t = LOGGING_SUPPRESSED_MSG_TMPL; *t; t++) {
+                if (*t != '%') {
+                        *p++ = *t;
+                } else if (t[1] == '%' || converted) {
+                        *p++ = *t;
+                        t += t[1] == '%';
+                } else {
+                        t += strspn(t + 1, "-+ #0123456789.hlzjt");
+                        if (t[1] == '\0') {
+                                break;
+                        }
+                        t++;
+                        p = log_put_number(p, suppressed_count);
+                        converted = true;
+                }
+        }
+        /* Message is sent with its terminating null */
+        *p++ = '\0';
+
+        if (!log_reserve(p - msg, false, &res)) {
+                return;
+        }
+        log_ring_write(&log_ring, &res, msg);
+        log_commit(&res);
+
+        /* More messages may be suppressed in the meantime, subtract only reported ones */
+        __atomic_fetch_sub(&suppressed_messages, suppressed_count, __ATOMIC_RELAXED);
+}
+#endif /* LOGGING_SUPPRESSED_COUNT_ENABLE == 1 */
+
+void log_printf_raw(const char *fmt, ...)
+{
+        va_list args;
+        bool stored;
+
+        va_start(args, fmt);
+        stored = log_store_va(fmt, args);
+        va_end(args);
+
+#if LOGGING_SUPPRESSED_COUNT_ENABLE == 1
+        if (!stored) {
+                __atomic_fetch_add(&suppressed_messages, 1, __ATOMIC_RELAXED);
+        }
+#else
+        (void) stored;
+#endif
+}
+
+#endif /* LOGGING_MODE_STANDALONE */
+
 #ifdef USE_QUEUE
 
 #if LOGGING_SUPPRESSED_COUNT_ENABLE == 1
@@ -412,3 +675,360 @@ void log_printf_raw(const char *fmt, ...)
 
 #endif /* USE_QUEUE */
 
+
+#ifdef LOGGING_MODE_DEFERRED
+
+/*
+ * Deferred log record format:
+ *
+ *   sync (0xA5) | length | format offset | tick | tag and severity | arguments
+ *
+ * length is number of bytes following it. Format offset (in log_fmt section), tick and
+ * (tag << 3 | severity) are unsigned LEB128 varints. Arguments follow in order of conversions
+ * in format string (including '*' width and precision):
+ * - integers as LEB128 varints, signed conversions are zigzag encoded first,
+ * - floating point values as 8 bytes of little endian double,
+ * - strings as up to LOGGING_DEFERRED_MAX_STRING characters followed by 0.
+ * Arguments after the first one which doesn't fit in record are omitted.
+ */
+#define DEFERRED_SYNC           0xA5
+
+#define DEFERRED_HEADER_SIZE    (2 + 5 + 5 + 5)
+
+#if LOGGING_DEFERRED_MAX_RECORD_SIZE < DEFERRED_HEADER_SIZE
+#error "LOGGING_DEFERRED_MAX_RECORD_SIZE is too small"
+#endif
+
+/* Start of section with format strings, provided by linker */
+extern const char __start_log_fmt[];
+
+static uint8_t *put_varint(uint8_t *p, const uint8_t *end, uint32_t value)
+{
+        if (!p) {
+                return NULL;
+        }
+
+        while (value >= 0x80) {
+                if (p == end) {
+                        return NULL;
+                }
+                *p++ = (uint8_t) value | 0x80;
+                value >>= 7;
+        }
+
+        if (p == end) {
+                return NULL;
+        }
+        *p++ = value;
+
+        return p;
+}
+
+static uint8_t *put_varint64(uint8_t *p, const uint8_t *end, uint64_t value)
+{
+        /* Avoid 64-bit arithmetic for values which fit in 32 bits */
+        if ((value >> 32) == 0) {
+                return put_varint(p, end, (uint32_t) value);
+        }
+
+        if (!p) {
+                return NULL;
+        }
+
+        while (value >= 0x80) {
+                if (p == end) {
+                        return NULL;
+                }
+                *p++ = (uint8_t) value | 0x80;
+                value >>= 7;
+        }
+
+        if (p == end) {
+                return NULL;
+        }
+        *p++ = value;
+
+        return p;
+}
+
+static uint8_t *put_signed(uint8_t *p, const uint8_t *end, int64_t value)
+{
+        if (value >= INT32_MIN && value <= INT32_MAX) {
+                int32_t v = value;
+
+                return put_varint(p, end, ((uint32_t) v << 1) ^ (uint32_t) (v >> 31));
+        }
+
+        return put_varint64(p, end, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+static uint8_t *put_string(uint8_t *p, const uint8_t *end, const char *str)
+{
+        size_t len = 0;
+
+        if (!p || p == end) {
+                return NULL;
+        }
+
+        if (!str) {
+                str = "(null)";
+        }
+
+        /* Truncate string rather than omit it, so that at least its beginning is shown */
+        while (len < LOGGING_DEFERRED_MAX_STRING && len < end - p - 1 && str[len]) {
+                len++;
+        }
+
+        memcpy(p, str, len);
+        p += len;
+        *p++ = 0;
+
+        return p;
+}
+
+static uint8_t *put_double(uint8_t *p, const uint8_t *end, double value)
+{
+        if (!p || end - p < sizeof(value)) {
+                return NULL;
+        }
+
+        memcpy(p, &value, sizeof(value));
+
+        return p + sizeof(value);
+}
+
+/*
+ * Walk conversions of format string and store their arguments. Only types of arguments need
+ * to be known here, so this is much cheaper than formatting message.
+ */
+static uint8_t *put_args(uint8_t *p, const uint8_t *end, const char *fmt, va_list args)
+{
+        uint8_t *next;
+        int64_t sval;
+        uint64_t uval;
+        char len;
+
+        while ((fmt = strchr(fmt, '%')) != NULL) {
+                next = p;
+                fmt++;
+
+                while (*fmt == '-' || *fmt == '+' || *fmt == ' ' || *fmt == '#' || *fmt == '0') {
+                        fmt++;
+                }
+
+                while ((*fmt >= '0' && *fmt <= '9') || *fmt == '.' || *fmt == '*') {
+                        if (*fmt == '*') {
+                                next = put_signed(next, end, va_arg(args, int));
+                        }
+                        fmt++;
+                }
+
+                /* Length modifier, "hh" and "ll" are stored as 'H' and 'q' */
+                len = 0;
+                if (*fmt == 'h' || *fmt == 'l' || *fmt == 'j' || *fmt == 'z' || *fmt == 't' ||
+                                                                                *fmt == 'L') {
+                        len = *fmt++;
+                        if (len == 'h' && *fmt == 'h') {
+                                len = 'H';
+                                fmt++;
+                        } else if (len == 'l' && *fmt == 'l') {
+                                len = 'q';
+                                fmt++;
+                        }
+                }
+
+                switch (*fmt) {
+                case 'd':
+                case 'i':
+                        switch (len) {
+                        case 'l':
+                                sval = va_arg(args, long);
+                                break;
+                        case 'q':
+                                sval = va_arg(args, long long);
+                                break;
+                        case 'j':
+                                sval = va_arg(args, intmax_t);
+                                break;
+                        case 'z':
+                        case 't':
+                                sval = va_arg(args, ptrdiff_t);
+                                break;
+                        default:
+                                sval = va_arg(args, int);
+                                break;
+                        }
+                        next = put_signed(next, end, sval);
+                        break;
+                case 'u':
+                case 'x':
+                case 'X':
+                case 'o':
+                case 'c':
+                        switch (len) {
+                        case 'l':
+                                uval = va_arg(args, unsigned long);
+                                break;
+                        case 'q':
+                                uval = va_arg(args, unsigned long long);
+                                break;
+                        case 'j':
+                                uval = va_arg(args, uintmax_t);
+                                break;
+                        case 'z':
+                        case 't':
+                                uval = va_arg(args, size_t);
+                                break;
+                        default:
+                                uval = va_arg(args, unsigned int);
+                                break;
+                        }
+                        next = put_varint64(next, end, uval);
+                        break;
+                case 'p':
+                        next = put_varint64(next, end, (uintptr_t) va_arg(args, void *));
+                        break;
+                case 's':
+                        next = put_string(next, end, va_arg(args, const char *));
+                        break;
+                case 'f':
+                case 'F':
+                case 'e':
+                case 'E':
+                case 'g':
+                case 'G':
+                case 'a':
+                case 'A':
+                        if (len == 'L') {
+                                next = put_double(next, end, va_arg(args, long double));
+                        } else {
+                                next = put_double(next, end, va_arg(args, double));
+                        }
+                        break;
+                case 'n':
+                        (void) va_arg(args, void *);
+                        break;
+                case '\0':
+                        return p;
+                default:
+                        break;
+                }
+
+                if (!next) {
+                        break;
+                }
+
+                p = next;
+                fmt++;
+        }
+
+        return p;
+}
+
+#if LOGGING_DEFERRED_USE_RTT == 1
+static bool deferred_store(const uint8_t *rec, uint16_t len)
+{
+        /* RTT in non-blocking mode writes either whole record or nothing */
+        return SEGGER_RTT_Write(0, rec, len) == len;
+}
+#else
+static bool deferred_store(const uint8_t *rec, uint16_t len)
+{
+        log_ring_res_t res;
+
+        /* Records are decoded from byte stream, so they may wrap around end of buffer */
+        if (!log_reserve(len, false, &res)) {
+                return false;
+        }
+
+        log_ring_write(&log_ring, &res, rec);
+        log_commit(&res);
+
+        return true;
+}
+#endif /* LOGGING_DEFERRED_USE_RTT */
+
+static bool log_deferred_va(logging_severity_e severity, int tag, const char *fmt, va_list args)
+{
+        uint8_t rec[LOGGING_DEFERRED_MAX_RECORD_SIZE];
+        const uint8_t *end = rec + sizeof(rec);
+        uint32_t tick;
+        uint8_t *p;
+
+        tick = in_interrupt() ? OS_GET_TICK_COUNT_FROM_ISR() : OS_GET_TICK_COUNT();
+
+        rec[0] = DEFERRED_SYNC;
+
+        /* Header always fits, see DEFERRED_HEADER_SIZE */
+        p = put_varint(&rec[2], end, fmt - __start_log_fmt);
+        p = put_varint(p, end, tick);
+        p = put_varint(p, end, ((uint32_t) tag << 3) | (severity & 0x07));
+        p = put_args(p, end, fmt, args);
+
+        rec[1] = p - rec - 2;
+
+        return deferred_store(rec, p - rec);
+}
+
+#if LOGGING_SUPPRESSED_COUNT_ENABLE == 1
+static const char suppressed_fmt[] __attribute__((section("log_fmt"))) =
+                                                                LOGGING_SUPPRESSED_MSG_TMPL;
+
+static bool log_deferred_internal(logging_severity_e severity, int tag, const char *fmt, ...)
+{
+        va_list args;
+        bool ret;
+
+        va_start(args, fmt);
+        ret = log_deferred_va(severity, tag, fmt, args);
+        va_end(args);
+
+        return ret;
+}
+
+static void log_suppressed(void)
+{
+        uint32_t suppressed_count = __atomic_load_n(&suppressed_messages, __ATOMIC_RELAXED);
+
+        if ((LOGGING_SUPPRESSED_SEVERITY < LOGGING_MIN_COMPILED_SEVERITY) ||
+                (LOGGING_SUPPRESSED_SEVERITY < logging_min_severity)) {
+                return;
+        }
+
+        if (suppressed_count < LOGGING_SUPPRESSED_MIN_COUNT) {
+                return;
+        }
+
+        /* More messages may be suppressed in the meantime, subtract only reported ones */
+        if (log_deferred_internal(LOGGING_SUPPRESSED_SEVERITY, LOGGING_SUPPRESSED_TAG,
+                                suppressed_fmt, (unsigned long) suppressed_count)) {
+                __atomic_fetch_sub(&suppressed_messages, suppressed_count, __ATOMIC_RELAXED);
+        }
+}
+#endif /* LOGGING_SUPPRESSED_COUNT_ENABLE == 1 */
+
+void log_deferred(logging_severity_e severity, int tag, const char *fmt, ...)
+{
+        va_list args;
+        bool stored;
+
+        va_start(args, fmt);
+        stored = log_deferred_va(severity, tag, fmt, args);
+        va_end(args);
+
+#if LOGGING_SUPPRESSED_COUNT_ENABLE == 1
+        if (!stored) {
+                __atomic_fetch_add(&suppressed_messages, 1, __ATOMIC_RELAXED);
+        }
+#if LOGGING_DEFERRED_USE_RTT == 1
+        else if (suppressed_messages) {
+                /* There's no logging task in RTT mode, report as soon as there's space */
+                log_suppressed();
+        }
+#endif
+#else
+        (void) stored;
+#endif
+}
+
+#endif /* LOGGING_MODE_DEFERRED */
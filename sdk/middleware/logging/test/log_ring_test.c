@@ -0,0 +1,405 @@
+/**
+ ****************************************************************************************
+ *
+ * @file log_ring_test.c
+ *
+ * @brief Host stress test of logging ring buffer
+ *
+ * Many producer threads write numbered records of random length to log ring, half of them with
+ * contiguous reservations, while one consumer thread takes committed data as logging task does.
+ * When new records are dropped if ring is full, consumer takes spans and holds each of them for
+ * a while, as if it was being sent by DMA, and checks that it doesn't change meanwhile. When
+ * the oldest records are discarded, consumer copies chunks of TX_CHUNK_SIZE bytes out and sends
+ * them afterwards. At the end all received data is parsed and checked:
+ *
+ * - every record is intact, nothing else than records and padding is received
+ * - records of each producer are received in order
+ * - received, dropped and discarded records add up to produced ones
+ * - when the oldest records are discarded, new ones are rarely dropped, if ring can hold any
+ *   record with padding
+ *
+ * Both policies are tested with 16 and 32 producers and ring sizes from 64 bytes to
+ * LOG_RING_MAX_SIZE. Before that, one producer overflows ring while consumer is sending, to
+ * check that the newest records are kept or dropped, depending on policy. Host sdk_defs.h of
+ * ad_flash simulator is used. Build and run from top of SDK, add -fsanitize=thread to check for
+ * data races too:
+ *
+ *     gcc -Wall -Wextra -O2 -pthread -Isdk/middleware/adapters/sim/include \
+ *             -Isdk/middleware/logging/src sdk/middleware/logging/test/log_ring_test.c \
+ *             sdk/middleware/logging/src/log_ring.c -o log_ring_test
+ *     ./log_ring_test [records per producer]
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "log_ring.h"
+
+#define MAX_PRODUCERS           32
+#define MAX_PAYLOAD             60
+/* "<pp nnnnnnn ll " header, payload, ">" */
+#define MAX_RECORD              (15 + MAX_PAYLOAD + 1)
+/* Default LOGGING_TX_CHUNK_SIZE */
+#define TX_CHUNK_SIZE           128
+
+static int failures;
+
+#define CHECK(cond, ...) \
+        do { \
+                if (!(cond)) { \
+                        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+                        printf(__VA_ARGS__); \
+                        printf("\n"); \
+                        failures++; \
+                        return false; \
+                } \
+        } while (0)
+
+typedef struct {
+        pthread_t thread;
+        int id;
+        uint32_t dropped;
+        uint32_t discarded;
+} producer_t;
+
+static struct {
+        log_ring_t ring;
+        uint8_t buf[LOG_RING_MAX_SIZE];
+        uint32_t starts[LOG_RING_STARTS_WORDS(LOG_RING_MAX_SIZE)];
+        int records;                    /* records written by each producer */
+        volatile bool done;             /* all producers finished */
+        bool overwrite;                 /* oldest records are discarded when ring is full */
+        bool span_changed;              /* data of span changed before it was released */
+        uint8_t *out;                   /* data received by consumer */
+        size_t out_len;
+        size_t out_size;
+        int last[MAX_PRODUCERS];        /* last record received from each producer */
+} test;
+
+/* Payload byte k of record seq of producer id, so corrupted payload can be detected */
+static char payload_byte(int id, int seq, int k)
+{
+        return 'a' + (id + seq + k) % 26;
+}
+
+/* Write record seq of producer with len bytes of payload, false if it's dropped */
+static bool put_record(producer_t *p, int seq, int len, bool contiguous)
+{
+        char rec[MAX_RECORD + 1];
+        log_ring_res_t res;
+        uint32_t discarded = 0;
+        int k, n;
+
+        n = sprintf(rec, "<%02d %07d %02d ", p->id, seq, len);
+        for (k = 0; k < len; k++) {
+                rec[n++] = payload_byte(p->id, seq, k);
+        }
+        rec[n++] = '>';
+
+        if (!log_ring_reserve(&test.ring, n, contiguous, &res, &discarded)) {
+                p->dropped++;
+                p->discarded += discarded;
+                return false;
+        }
+        p->discarded += discarded;
+
+        if (contiguous) {
+                memcpy(log_ring_data(&test.ring, &res), rec, n);
+        } else {
+                log_ring_write(&test.ring, &res, rec);
+        }
+        log_ring_commit(&test.ring, &res);
+
+        return true;
+}
+
+static void *producer_task(void *arg)
+{
+        producer_t *p = arg;
+        /* rand_r() keeps producers independent of each other, seed differs per producer */
+        unsigned int seed = p->id * 7919 + 1;
+        int i;
+
+        for (i = 0; i < test.records; i++) {
+                put_record(p, i, 1 + rand_r(&seed) % MAX_PAYLOAD, i & 1);
+
+                /* producers wake up at random, ring overflows when many of them log at once */
+                usleep(rand_r(&seed) % 100);
+        }
+
+        return NULL;
+}
+
+static uint8_t *out_reserve(uint16_t len)
+{
+        if (test.out_len + len > test.out_size) {
+                test.out_size = (test.out_len + len) * 2;
+                test.out = realloc(test.out, test.out_size);
+                if (test.out == NULL) {
+                        abort();
+                }
+        }
+
+        return test.out + test.out_len;
+}
+
+/* Take committed data as logging task does, sending takes a while. Returns length taken. */
+static uint16_t consume(unsigned int *seed)
+{
+        const uint8_t *data;
+        uint16_t len;
+
+        if (test.overwrite) {
+                len = log_ring_read(&test.ring, out_reserve(TX_CHUNK_SIZE), TX_CHUNK_SIZE);
+        } else {
+                len = log_ring_peek(&test.ring, &data);
+                if (len) {
+                        memcpy(out_reserve(len), data, len);
+                }
+        }
+        if (len == 0) {
+                return 0;
+        }
+
+        /* span is being sent, producers must not reuse its space unless it was copied out */
+        if (rand_r(seed) % 32 == 0) {
+                usleep(rand_r(seed) % 20);
+        } else if (rand_r(seed) % 4 == 0) {
+                sched_yield();
+        }
+
+        if (!test.overwrite) {
+                if (memcmp(test.out + test.out_len, data, len)) {
+                        test.span_changed = true;
+                }
+                log_ring_release(&test.ring, len);
+        }
+        test.out_len += len;
+
+        return len;
+}
+
+static void *consumer_task(void *arg)
+{
+        unsigned int seed = 5;
+
+        (void) arg;
+
+        for (;;) {
+                if (consume(&seed) == 0) {
+                        if (__atomic_load_n(&test.done, __ATOMIC_ACQUIRE)) {
+                                /* producers committed everything before done was set */
+                                if (consume(&seed) == 0) {
+                                        break;
+                                }
+                        }
+                        sched_yield();
+                }
+        }
+
+        return NULL;
+}
+
+/* Parse received data and count records in it */
+static bool check_output(int producers, uint64_t *received)
+{
+        int *last = test.last;
+        size_t pos = 0;
+        int id, seq, len, n, k;
+
+        for (id = 0; id < producers; id++) {
+                last[id] = -1;
+        }
+        *received = 0;
+
+        while (pos < test.out_len) {
+                /* padding before contiguous record */
+                if (test.out[pos] == 0) {
+                        pos++;
+                        continue;
+                }
+
+                n = 0;
+                CHECK(test.out_len - pos >= 15 && sscanf((char *) test.out + pos,
+                                                "<%2d %7d %2d %n", &id, &seq, &len, &n) == 3 &&
+                                n == 15 && id >= 0 && id < producers && len > 0 &&
+                                len <= MAX_PAYLOAD && test.out_len - pos >= (size_t) n + len + 1,
+                                "garbage at offset %zu", pos);
+                pos += n;
+                for (k = 0; k < len; k++, pos++) {
+                        CHECK(test.out[pos] == payload_byte(id, seq, k),
+                                                "record %d of producer %d corrupted", seq, id);
+                }
+                CHECK(test.out[pos++] == '>', "record %d of producer %d not terminated", seq, id);
+                CHECK(seq > last[id], "record %d of producer %d received after %d", seq, id,
+                                                                                last[id]);
+                last[id] = seq;
+                (*received)++;
+        }
+
+        return true;
+}
+
+static void start(uint16_t size, bool overwrite)
+{
+        test.overwrite = overwrite;
+        test.done = false;
+        test.span_changed = false;
+        test.out_len = 0;
+        log_ring_init(&test.ring, test.buf, size, overwrite ? test.starts : NULL);
+}
+
+/*
+ * One producer writes records of equal size while consumer sends the first ones, ring
+ * overflows. Depending on policy, either the newest records or the oldest ones which were not
+ * taken by consumer yet must be lost.
+ */
+static bool overflow(bool overwrite)
+{
+        const int records = 100;
+        const uint16_t size = 256;
+        unsigned int seed = 5;
+        producer_t p;
+        uint64_t received;
+        const uint8_t *data;
+        uint16_t len = 0;
+        int i;
+
+        memset(&p, 0, sizeof(p));
+        start(size, overwrite);
+
+        for (i = 0; i < records; i++) {
+                put_record(&p, i, 10, false);
+                /* the first records are taken and being sent, next ones overflow ring */
+                if (i == 3) {
+                        if (overwrite) {
+                                len = log_ring_read(&test.ring, out_reserve(TX_CHUNK_SIZE),
+                                                                                TX_CHUNK_SIZE);
+                                test.out_len += len;
+                        } else {
+                                len = log_ring_peek(&test.ring, &data);
+                                memcpy(out_reserve(len), data, len);
+                                test.out_len += len;
+                        }
+                        CHECK(len > 0, "nothing to send");
+                }
+        }
+        if (!overwrite) {
+                log_ring_release(&test.ring, len);
+        }
+        while (consume(&seed)) {
+        }
+
+        if (!check_output(1, &received)) {
+                return false;
+        }
+        printf("overflow, %-9s: received %3llu dropped %3u discarded %3u, last received %d\n",
+                        overwrite ? "overwrite" : "drop", (unsigned long long) received,
+                        p.dropped, p.discarded, test.last[0]);
+        CHECK(received + p.dropped + p.discarded == records,
+                        "%d records produced, but received + dropped + discarded is %llu", records,
+                        (unsigned long long) (received + p.dropped + p.discarded));
+        if (overwrite) {
+                CHECK(p.dropped == 0, "%u records dropped with overwrite policy", p.dropped);
+                CHECK(test.last[0] == records - 1, "newest record %d not received", records - 1);
+        } else {
+                CHECK(p.discarded == 0, "records discarded with drop policy");
+                CHECK(test.last[0] < records - 1, "newest record %d received although ring was"
+                                                                " full", records - 1);
+        }
+
+        return true;
+}
+
+static bool stress(int producers, uint16_t size, bool overwrite)
+{
+        producer_t p[MAX_PRODUCERS];
+        pthread_t consumer;
+        uint64_t produced = (uint64_t) producers * test.records;
+        uint64_t received, dropped = 0, discarded = 0;
+        int i;
+
+        memset(p, 0, sizeof(p));
+        start(size, overwrite);
+
+        pthread_create(&consumer, NULL, consumer_task, NULL);
+        for (i = 0; i < producers; i++) {
+                p[i].id = i;
+                pthread_create(&p[i].thread, NULL, producer_task, &p[i]);
+        }
+        for (i = 0; i < producers; i++) {
+                pthread_join(p[i].thread, NULL);
+                dropped += p[i].dropped;
+                discarded += p[i].discarded;
+        }
+        __atomic_store_n(&test.done, true, __ATOMIC_RELEASE);
+        pthread_join(consumer, NULL);
+
+        CHECK(!test.span_changed, "span changed while it was being sent");
+        if (!check_output(producers, &received)) {
+                return false;
+        }
+        printf("%2d producers, %5u bytes, %-9s: received %7llu dropped %7llu discarded %7llu\n",
+                        producers, size, overwrite ? "overwrite" : "drop",
+                        (unsigned long long) received, (unsigned long long) dropped,
+                        (unsigned long long) discarded);
+        CHECK(received + dropped + discarded == produced,
+                        "%llu records produced, but received + dropped + discarded is %llu",
+                        (unsigned long long) produced,
+                        (unsigned long long) (received + dropped + discarded));
+        CHECK(overwrite || discarded == 0, "records discarded with drop policy");
+        /*
+         * Records that don't fit in small ring with padding are always dropped. Others are
+         * dropped only if ring is full while consumer copies data, or the oldest record is
+         * still being written by preempted producer, so allow a few of them.
+         */
+        CHECK(!overwrite || size < 2 * MAX_RECORD || dropped * 10 <= discarded + produced / 100,
+                        "%llu records dropped with overwrite policy, only %llu discarded",
+                        (unsigned long long) dropped, (unsigned long long) discarded);
+
+        return true;
+}
+
+int main(int argc, char **argv)
+{
+        static const int producers[] = { 16, 32 };
+        static const uint16_t sizes[] = { 64, 256, 1024, LOG_RING_MAX_SIZE };
+        unsigned int p, s;
+        int overwrite;
+
+        test.records = argc > 1 ? atoi(argv[1]) : 10000;
+        if (test.records <= 0 || test.records > 9999999) {
+                printf("usage: %s [records per producer]\n", argv[0]);
+                return 1;
+        }
+
+        for (overwrite = 0; overwrite <= 1; overwrite++) {
+                overflow(overwrite);
+        }
+        for (overwrite = 0; overwrite <= 1; overwrite++) {
+                for (p = 0; p < sizeof(producers) / sizeof(producers[0]); p++) {
+                        for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+                                stress(producers[p], sizes[s], overwrite);
+                        }
+                }
+        }
+
+        free(test.out);
+
+        if (failures) {
+                printf("%d tests failed\n", failures);
+                return 1;
+        }
+        printf("All tests passed\n");
+
+        return 0;
+}
@@ -15,12 +15,22 @@
 
 #include "osal.h"
 #include "task_monitoring.h"
+#include "sys_timer.h"
 #include <stdio.h>
+#include <string.h>
 
 #if (dg_configENABLE_TASK_MONITORING == 1)
 
-#if !(defined(CONFIG_RTT) || defined(CONFIG_RETARGET))
-#error dg_configENABLE_TASK_MONITORING must be used only when CONFIG_RTT or CONFIG_RETARGET are defined.
+#if !(defined(CONFIG_RTT) || defined(CONFIG_RETARGET) || (TM_SNAPSHOT_USE_DGTL == 1))
+#error dg_configENABLE_TASK_MONITORING must be used only when CONFIG_RTT or CONFIG_RETARGET are defined or TM_SNAPSHOT_USE_DGTL is set.
+#endif
+
+#if (TM_SNAPSHOT_USE_DGTL == 1)
+#include "dgtl.h"
+#include "dgtl_msg.h"
+#include "dgtl_pkt.h"
+#elif defined(CONFIG_RTT)
+#include "SEGGER_RTT.h"
 #endif
 
 #ifdef CONFIG_RETARGET
@@ -29,15 +39,75 @@
 #define NEWLINE "\n"
 #endif
 
+/* Packet type of DGTL application response, snapshot has the same format over RTT */
+#define TM_PKT_TYPE_APP_RSP     (0x07)
+#define TM_SNAPSHOT_VERSION     (1)
+#define TM_HEADER_SIZE          (4 + 24)
+#define TM_RECORD_SIZE          (27)
+
+/* Task number of task which has no statistics, 0 means task wasn't seen yet */
+#define TM_UNTRACKED            (0xFFFF)
+
 typedef struct {
         uint16_t used;
         uint16_t id;
         OS_TASK task;
 } mon_task_t;
 
+/* Statistics of one sampling period */
+typedef struct {
+        uint16_t load;                  /* CPU load in permille */
+        uint16_t latency_max;           /* maximum scheduling latency in OS timer ticks */
+} tm_window_t;
+
+/*
+ * Statistics of task, updated by kernel trace hooks. Times are in OS timer ticks. Slot of task
+ * is stored in its task number (slot + 1).
+ */
+typedef struct {
+        OS_TASK task;                   /* NULL if slot is free */
+        uint32_t run_time;              /* CPU time */
+        uint32_t run_time_sampled;      /* CPU time at last sample */
+        uint32_t ready_time;            /* time when task became ready */
+        uint32_t switches;              /* number of times task was switched in */
+        uint32_t latency_sum;           /* sum of latencies in current sampling period */
+        uint16_t latency_count;         /* number of latencies in current sampling period */
+        uint16_t latency_max;           /* maximum latency in current sampling period */
+        uint16_t latency_avg;           /* average latency in last sampling period */
+        bool ready;                     /* task is ready, ready_time is valid */
+        int32_t heap_used;              /* heap allocated minus heap freed by task */
+        int32_t heap_max;               /* maximum of heap_used */
+        tm_window_t window[TM_LOAD_WINDOWS];
+} tm_task_stats_t;
+
+/* Statistics of task as reported */
+typedef struct {
+        char name[configMAX_TASK_NAME_LEN + 1];
+        uint8_t state;
+        uint8_t priority;
+        uint16_t stack_watermark;
+        uint16_t load_last;
+        uint16_t load_avg;
+        uint16_t load_peak;
+        uint16_t latency_avg;
+        uint16_t latency_max;
+        uint32_t switches;
+        int32_t heap_used;
+        int32_t heap_max;
+} tm_task_info_t;
+
 /* array used to store information about monitored task*/
 __RETAINED static mon_task_t mon_stat[MAX_NUMBER_OF_MONITORED_TASKS];
 
+__RETAINED static tm_task_stats_t tm_stats[TM_MAX_TASKS];
+__RETAINED static OS_TASK tm_switched_out_task;
+__RETAINED static uint32_t tm_switch_time;
+__RETAINED static uint32_t tm_sample_time;
+__RETAINED static uint8_t tm_window_idx;        /* window written by next sample */
+__RETAINED static uint8_t tm_windows_used;
+__RETAINED static OS_TIMER tm_timer;
+
+#if defined(CONFIG_RTT) || defined(CONFIG_RETARGET)
 static char * task_state(OS_TASK_STATE state)
 {
         switch (state) {
@@ -55,6 +125,7 @@ static char * task_state(OS_TASK_STATE state)
                 return "Unknown";
         }
 }
+#endif
 
 void tm_register_monitor_task(uint16_t id)
 {
@@ -83,6 +154,421 @@ void tm_unregister_monitor_task(uint16_t id)
         }
 }
 
+/* OS timer is used since it can be read in any context, including kernel hooks */
+__STATIC_INLINE uint32_t tm_now(void)
+{
+        return (uint32_t) sys_timer_get_uptime_ticks_fromISR();
+}
+
+/* Statistics of task, slot is allocated when task is seen for the first time */
+static tm_task_stats_t *get_stats(OS_TASK task)
+{
+        UBaseType_t num;
+        uint32_t mask;
+        int i;
+
+        if (task == NULL) {
+                return NULL;
+        }
+
+        num = uxTaskGetTaskNumber(task);
+        if (num == 0) {
+                /* Hooks are called with interrupts enabled too, e.g. from pvPortMalloc() */
+                OS_ENTER_CRITICAL_SECTION_FROM_ISR(mask);
+
+                num = uxTaskGetTaskNumber(task);
+                if (num == 0) {
+                        num = TM_UNTRACKED;
+                        for (i = 0; i < TM_MAX_TASKS; i++) {
+                                if (tm_stats[i].task == NULL) {
+                                        memset(&tm_stats[i], 0, sizeof(tm_stats[i]));
+                                        tm_stats[i].task = task;
+                                        num = i + 1;
+                                        break;
+                                }
+                        }
+                        vTaskSetTaskNumber(task, num);
+                }
+
+                OS_LEAVE_CRITICAL_SECTION_FROM_ISR(mask);
+        }
+
+        return (num <= TM_MAX_TASKS) ? &tm_stats[num - 1] : NULL;
+}
+
+/* Add time of running task up to now to its CPU time, must be called in critical section */
+static uint32_t account_running_task(void)
+{
+        tm_task_stats_t *stats = get_stats(OS_GET_CURRENT_TASK());
+        uint32_t now = tm_now();
+
+        if (stats) {
+                stats->run_time += now - tm_switch_time;
+        }
+        tm_switch_time = now;
+
+        return now;
+}
+
+void tm_trace_task_create(void *task)
+{
+        /* Task number of new TCB isn't initialized by kernel */
+        vTaskSetTaskNumber(task, 0);
+        get_stats(task);
+}
+
+void tm_trace_task_switched_out(void *task)
+{
+        tm_task_stats_t *stats = get_stats(task);
+        uint32_t now = tm_now();
+
+        if (stats) {
+                stats->run_time += now - tm_switch_time;
+        }
+        tm_switch_time = now;
+        tm_switched_out_task = task;
+}
+
+void tm_trace_task_switched_in(void *task)
+{
+        tm_task_stats_t *stats;
+        uint32_t latency;
+
+        /* Scheduler may select the same task again */
+        if (task == tm_switched_out_task) {
+                return;
+        }
+
+        stats = get_stats(task);
+        if (!stats) {
+                return;
+        }
+
+        stats->switches++;
+
+        /* Task preempted while running is ready too, but its latency isn't measured */
+        if (stats->ready) {
+                stats->ready = false;
+                latency = tm_switch_time - stats->ready_time;
+                if (latency > UINT16_MAX) {
+                        latency = UINT16_MAX;
+                }
+                stats->latency_sum += latency;
+                if (stats->latency_count < UINT16_MAX) {
+                        stats->latency_count++;
+                }
+                if (latency > stats->latency_max) {
+                        stats->latency_max = latency;
+                }
+        }
+}
+
+void tm_trace_task_ready(void *task)
+{
+        tm_task_stats_t *stats;
+
+        /* Running task is added to ready list again e.g. when its priority changes */
+        if (task == OS_GET_CURRENT_TASK()) {
+                return;
+        }
+
+        stats = get_stats(task);
+        if (stats && !stats->ready) {
+                stats->ready_time = tm_now();
+                stats->ready = true;
+        }
+}
+
+void tm_trace_task_delete(void *task)
+{
+        UBaseType_t num = uxTaskGetTaskNumber(task);
+
+        if (num > 0 && num <= TM_MAX_TASKS) {
+                tm_stats[num - 1].task = NULL;
+        }
+        vTaskSetTaskNumber(task, TM_UNTRACKED);
+}
+
+/* Heap allocated before scheduler is started is not attributed to any task */
+static tm_task_stats_t *get_heap_stats(void *ptr)
+{
+        if (ptr == NULL || xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+                return NULL;
+        }
+
+        return get_stats(OS_GET_CURRENT_TASK());
+}
+
+void tm_trace_malloc(void *ptr, size_t size)
+{
+        tm_task_stats_t *stats = get_heap_stats(ptr);
+
+        if (stats) {
+                stats->heap_used += size;
+                if (stats->heap_used > stats->heap_max) {
+                        stats->heap_max = stats->heap_used;
+                }
+        }
+}
+
+void tm_trace_free(void *ptr, size_t size)
+{
+        tm_task_stats_t *stats = get_heap_stats(ptr);
+
+        if (stats) {
+                stats->heap_used -= size;
+        }
+}
+
+void tm_sample(void)
+{
+        tm_task_stats_t *stats;
+        uint32_t now, period, run;
+        uint16_t latency_max, latency_avg;
+        uint16_t load;
+        int i;
+
+        OS_ENTER_CRITICAL_SECTION();
+        now = account_running_task();
+        OS_LEAVE_CRITICAL_SECTION();
+
+        period = now - tm_sample_time;
+        tm_sample_time = now;
+
+        for (i = 0; i < TM_MAX_TASKS; i++) {
+                stats = &tm_stats[i];
+
+                OS_ENTER_CRITICAL_SECTION();
+
+                if (stats->task == NULL) {
+                        OS_LEAVE_CRITICAL_SECTION();
+                        continue;
+                }
+
+                run = stats->run_time - stats->run_time_sampled;
+                stats->run_time_sampled = stats->run_time;
+                latency_max = stats->latency_max;
+                latency_avg = stats->latency_count ? stats->latency_sum / stats->latency_count : 0;
+                stats->latency_sum = 0;
+                stats->latency_count = 0;
+                stats->latency_max = 0;
+
+                OS_LEAVE_CRITICAL_SECTION();
+
+                /* Windows are written only here, so they can be updated outside critical section */
+                load = 0;
+                if (period) {
+                        load = (run >= period) ? 1000 : (uint64_t) run * 1000 / period;
+                }
+                stats->window[tm_window_idx].load = load;
+                stats->window[tm_window_idx].latency_max = latency_max;
+                stats->latency_avg = latency_avg;
+        }
+
+        tm_window_idx = (tm_window_idx + 1) % TM_LOAD_WINDOWS;
+        if (tm_windows_used < TM_LOAD_WINDOWS) {
+                tm_windows_used++;
+        }
+}
+
+static void tm_timer_cb(OS_TIMER timer)
+{
+        tm_sample();
+}
+
+void tm_init(void)
+{
+        uint32_t now;
+        int i;
+
+        /* Start the first sampling period now */
+        OS_ENTER_CRITICAL_SECTION();
+        now = account_running_task();
+        for (i = 0; i < TM_MAX_TASKS; i++) {
+                tm_stats[i].run_time_sampled = tm_stats[i].run_time;
+                tm_stats[i].latency_sum = 0;
+                tm_stats[i].latency_count = 0;
+                tm_stats[i].latency_max = 0;
+        }
+        tm_sample_time = now;
+        OS_LEAVE_CRITICAL_SECTION();
+
+        if (tm_timer == NULL) {
+                tm_timer = OS_TIMER_CREATE("tm", OS_MS_2_TICKS(TM_SAMPLE_PERIOD_MS),
+                                                                OS_TIMER_RELOAD, NULL, tm_timer_cb);
+                OS_ASSERT(tm_timer);
+                OS_TIMER_START(tm_timer, OS_TIMER_FOREVER);
+        }
+}
+
+/*
+ * Get statistics of task in slot, returns false if slot is free. Must be called with scheduler
+ * suspended, so that task can't be deleted meanwhile.
+ */
+static bool get_task_info(const tm_task_stats_t *stats, tm_task_info_t *info)
+{
+        tm_task_stats_t copy;
+        uint32_t load_sum = 0;
+        int i;
+
+        OS_ENTER_CRITICAL_SECTION();
+        copy = *stats;
+        OS_LEAVE_CRITICAL_SECTION();
+
+        if (copy.task == NULL) {
+                return false;
+        }
+
+        memset(info, 0, sizeof(*info));
+        strncpy(info->name, OS_GET_TASK_NAME(copy.task), configMAX_TASK_NAME_LEN);
+        info->state = OS_GET_TASK_STATE(copy.task);
+        info->priority = OS_GET_TASK_PRIORITY(copy.task);
+        info->stack_watermark = OS_GET_TASK_STACK_WATERMARK(copy.task);
+        info->switches = copy.switches;
+        info->latency_avg = copy.latency_avg;
+        info->heap_used = copy.heap_used;
+        info->heap_max = copy.heap_max;
+
+        if (tm_windows_used) {
+                info->load_last = copy.window[(tm_window_idx + TM_LOAD_WINDOWS - 1) %
+                                                                        TM_LOAD_WINDOWS].load;
+        }
+        for (i = 0; i < tm_windows_used; i++) {
+                load_sum += copy.window[i].load;
+                if (copy.window[i].load > info->load_peak) {
+                        info->load_peak = copy.window[i].load;
+                }
+                if (copy.window[i].latency_max > info->latency_max) {
+                        info->latency_max = copy.window[i].latency_max;
+                }
+        }
+        if (tm_windows_used) {
+                info->load_avg = load_sum / tm_windows_used;
+        }
+
+        return true;
+}
+
+static uint8_t *put_u16(uint8_t *p, uint16_t v)
+{
+        p[0] = v;
+        p[1] = v >> 8;
+        return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+        p = put_u16(p, v);
+        return put_u16(p, v >> 16);
+}
+
+size_t tm_get_snapshot(uint8_t *buf, size_t size)
+{
+        tm_task_info_t info;
+        uint8_t *p = buf;
+        uint8_t count = 0;
+        size_t name_len;
+        int i;
+
+        if (size < TM_HEADER_SIZE) {
+                return 0;
+        }
+
+        /* Length and number of tasks are filled at the end */
+        *p++ = TM_PKT_TYPE_APP_RSP;
+        *p++ = TM_SNAPSHOT_DGTL_CODE;
+        p += 2;
+        *p++ = 'T';
+        *p++ = 'M';
+        *p++ = TM_SNAPSHOT_VERSION;
+        p++;
+        p = put_u16(p, TM_SAMPLE_PERIOD_MS);
+        *p++ = tm_windows_used;
+        *p++ = 0;
+        p = put_u32(p, OS_TICK_CLOCK_HZ);
+        p = put_u32(p, tm_now());
+        p = put_u32(p, OS_GET_FREE_HEAP_SIZE());
+        p = put_u32(p, OS_GET_HEAP_WATERMARK());
+
+        vTaskSuspendAll();
+
+        for (i = 0; i < TM_MAX_TASKS; i++) {
+                if (!get_task_info(&tm_stats[i], &info)) {
+                        continue;
+                }
+
+                name_len = strlen(info.name);
+                if ((size_t) (p - buf) + TM_RECORD_SIZE + name_len > size) {
+                        xTaskResumeAll();
+                        return 0;
+                }
+
+                *p++ = info.state;
+                *p++ = info.priority;
+                *p++ = name_len;
+                memcpy(p, info.name, name_len);
+                p += name_len;
+                p = put_u16(p, info.load_last);
+                p = put_u16(p, info.load_avg);
+                p = put_u16(p, info.load_peak);
+                p = put_u32(p, info.switches);
+                p = put_u16(p, info.latency_avg);
+                p = put_u16(p, info.latency_max);
+                p = put_u16(p, info.stack_watermark);
+                p = put_u32(p, info.heap_used);
+                p = put_u32(p, info.heap_max);
+                count++;
+        }
+
+        xTaskResumeAll();
+
+        put_u16(&buf[2], p - buf - 4);
+        buf[7] = count;
+
+        return p - buf;
+}
+
+bool tm_send_snapshot(void)
+{
+#if (TM_SNAPSHOT_USE_DGTL == 1)
+        dgtl_msg_t *msg;
+
+        msg = dgtl_msg_alloc(DGTL_PKT_TYPE_APP_RSP, TM_SNAPSHOT_MAX_SIZE);
+        if (!msg) {
+                return false;
+        }
+
+        /* Message starts with packet type, which is the same in snapshot */
+        if (!tm_get_snapshot(msg->data, TM_SNAPSHOT_MAX_SIZE)) {
+                dgtl_msg_free(msg);
+                return false;
+        }
+
+        return dgtl_send_ex(msg, NULL, NULL);
+#elif defined(CONFIG_RTT)
+        uint8_t *buf;
+        size_t len;
+        bool sent = false;
+
+        buf = OS_MALLOC(TM_SNAPSHOT_MAX_SIZE);
+        if (!buf) {
+                return false;
+        }
+
+        len = tm_get_snapshot(buf, TM_SNAPSHOT_MAX_SIZE);
+        if (len) {
+                sent = (SEGGER_RTT_Write(TM_SNAPSHOT_RTT_CHANNEL, buf, len) == len);
+        }
+
+        OS_FREE(buf);
+
+        return sent;
+#else
+        return false;
+#endif
+}
+
+#if defined(CONFIG_RTT) || defined(CONFIG_RETARGET)
 __STATIC_INLINE void print_task_status(OS_TASK task, uint16_t id )
 {
         printf(NEWLINE NEWLINE "id:%d Handler 0x%p",id, task);
@@ -107,29 +593,43 @@ void tm_print_registered_tasks()
         printf(NEWLINE "Available current heap %d" NEWLINE, OS_GET_FREE_HEAP_SIZE());
 }
 
-void tm_print_tasks_status()
+static unsigned long ticks_to_us(uint16_t ticks)
 {
+        return (uint64_t) ticks * 1000000 / OS_TICK_CLOCK_HZ;
+}
 
+void tm_print_tasks_status()
+{
+        tm_task_info_t info;
+        bool valid;
         uint16_t i = 0;
-        uint16_t tasks_num = OS_GET_TASKS_NUMBER();
-        OS_TASK_STATUS* TaskStatusArray = OS_MALLOC(tasks_num*(sizeof(OS_TASK_STATUS)));
-        uint16_t tracked_tasks = OS_GET_TASKS_STATUS(TaskStatusArray, tasks_num);
 
-        while (tracked_tasks - i) {
-                printf(NEWLINE "Monitored task %d", i);
-                printf(NEWLINE "Handler 0x%p", TaskStatusArray[i].xHandle);
-                printf(NEWLINE "Name \"%s\"", TaskStatusArray[i].pcTaskName);
-                printf(NEWLINE "State %s", task_state(TaskStatusArray[i].eCurrentState));
-                printf(NEWLINE "Current priority %ld", TaskStatusArray[i].uxCurrentPriority);
-                printf(NEWLINE "Main priority %ld", TaskStatusArray[i].uxBasePriority);
-                printf(NEWLINE "Elapsed time %ld", TaskStatusArray[i].ulRunTimeCounter);
-                printf(NEWLINE "Stack high water mark %d" NEWLINE, TaskStatusArray[i].usStackHighWaterMark);
+        for (i = 0; i < TM_MAX_TASKS; i++) {
+                /* Printing may block, so statistics are copied with scheduler suspended */
+                vTaskSuspendAll();
+                valid = get_task_info(&tm_stats[i], &info);
+                xTaskResumeAll();
+
+                if (!valid) {
+                        continue;
+                }
 
-                i++;
+                printf(NEWLINE "Monitored task %d", i);
+                printf(NEWLINE "Name \"%s\"", info.name);
+                printf(NEWLINE "State %s", task_state(info.state));
+                printf(NEWLINE "Priority %d", info.priority);
+                printf(NEWLINE "CPU load %d.%d%% (avg %d.%d%%, peak %d.%d%%)",
+                        info.load_last / 10, info.load_last % 10,
+                        info.load_avg / 10, info.load_avg % 10,
+                        info.load_peak / 10, info.load_peak % 10);
+                printf(NEWLINE "Context switches %lu", (unsigned long) info.switches);
+                printf(NEWLINE "Scheduling latency %lu us (max %lu us)",
+                        ticks_to_us(info.latency_avg), ticks_to_us(info.latency_max));
+                printf(NEWLINE "Heap %ld (max %ld)", (long) info.heap_used, (long) info.heap_max);
+                printf(NEWLINE "Stack high water mark %d" NEWLINE, info.stack_watermark);
         }
-        OS_FREE(TaskStatusArray);
         printf(NEWLINE "Available heap min watermark %d", OS_GET_HEAP_WATERMARK());
         printf(NEWLINE "Available current heap %d" NEWLINE, OS_GET_FREE_HEAP_SIZE());
 }
+#endif /* CONFIG_RTT || CONFIG_RETARGET */
 #endif /*dg_configENABLE_TASK_MONITORING*/
-
@@ -22,10 +22,71 @@
 #ifndef TASK_MONITORING_H
 #define TASK_MONITORING_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #if (dg_configENABLE_TASK_MONITORING == 1)
 /*Maximum number of monitored tasks*/
 #define MAX_NUMBER_OF_MONITORED_TASKS 5
 
+/**
+ * \brief Maximum number of tasks with collected statistics
+ *
+ * Statistics of each task take about 40 + 4 * TM_LOAD_WINDOWS bytes of retained RAM. Tasks
+ * created when the table is full are not tracked.
+ */
+#ifndef TM_MAX_TASKS
+#define TM_MAX_TASKS                    (12)
+#endif
+
+/**
+ * \brief Sampling period of statistics in ms
+ */
+#ifndef TM_SAMPLE_PERIOD_MS
+#define TM_SAMPLE_PERIOD_MS             (1000)
+#endif
+
+/**
+ * \brief Number of sampling periods of sliding window
+ *
+ * Average and peak CPU load and maximum scheduling latency are reported over this number of
+ * the last sampling periods.
+ */
+#ifndef TM_LOAD_WINDOWS
+#define TM_LOAD_WINDOWS                 (8)
+#endif
+
+/**
+ * \brief Send snapshots over DGTL
+ *
+ * If set, tm_send_snapshot() sends the snapshot as DGTL application response packet (requires
+ * dg_configUSE_DGTL and DGTL_QUEUE_ENABLE_APP). Otherwise, the same packet is written to RTT
+ * channel TM_SNAPSHOT_RTT_CHANNEL (requires CONFIG_RTT).
+ */
+#ifndef TM_SNAPSHOT_USE_DGTL
+#define TM_SNAPSHOT_USE_DGTL            (0)
+#endif
+
+/**
+ * \brief Code of DGTL application response packet with snapshot
+ */
+#ifndef TM_SNAPSHOT_DGTL_CODE
+#define TM_SNAPSHOT_DGTL_CODE           (0x54)
+#endif
+
+/**
+ * \brief RTT channel which snapshots are written to
+ */
+#ifndef TM_SNAPSHOT_RTT_CHANNEL
+#define TM_SNAPSHOT_RTT_CHANNEL         (0)
+#endif
+
+/**
+ * \brief Maximum size of snapshot, including DGTL packet header
+ */
+#define TM_SNAPSHOT_MAX_SIZE            (4 + 24 + TM_MAX_TASKS * (27 + configMAX_TASK_NAME_LEN))
+
 /**
  * \brief Register a task to be monitored.
  *
@@ -42,6 +103,57 @@ void tm_register_monitor_task(uint16_t id);
  */
 void tm_unregister_monitor_task(uint16_t id);
 
+/**
+ * \brief Start sampling of task statistics.
+ *
+ * Statistics are collected by kernel trace hooks for all tasks from system start in a fixed
+ * table: CPU time, context switches, scheduling latency (time from the moment a task becomes
+ * ready until it runs) and heap allocated by task (blocks allocated by task minus blocks freed
+ * by it, blocks freed by another task are subtracted from that task). This function starts a
+ * timer which computes CPU load and latency of each task every TM_SAMPLE_PERIOD_MS.
+ *
+ * \note Kernel trace hooks are used by SystemView too, so task monitoring can't be enabled
+ * together with dg_configSYSTEMVIEW.
+ *
+ */
+void tm_init(void);
+
+/**
+ * \brief Sample task statistics.
+ *
+ * This function is called periodically by timer started by tm_init(). It can be also called by
+ * application, e.g. if tm_init() is not used.
+ *
+ */
+void tm_sample(void);
+
+/**
+ * \brief Get snapshot of task statistics.
+ *
+ * The snapshot is a compact binary DGTL application response packet with TM_SNAPSHOT_DGTL_CODE,
+ * which can be decoded with utilities/python_scripts/monitoring/tm_view.py.
+ *
+ * \param [out] buf   buffer for snapshot
+ * \param [in]  size  size of buffer, TM_SNAPSHOT_MAX_SIZE is always enough
+ *
+ * \return length of snapshot, 0 if buffer is too small
+ *
+ */
+size_t tm_get_snapshot(uint8_t *buf, size_t size);
+
+/**
+ * \brief Send snapshot of task statistics.
+ *
+ * The snapshot returned by tm_get_snapshot() is sent over DGTL or written to RTT, depending on
+ * TM_SNAPSHOT_USE_DGTL.
+ *
+ * \return true if snapshot was sent, false if there's no memory for it or it doesn't fit in RTT
+ *         buffer
+ *
+ */
+bool tm_send_snapshot(void);
+
+#if defined(CONFIG_RTT) || defined(CONFIG_RETARGET)
 /**
  * \brief Print the status of registered a tasks.
  *
@@ -53,6 +165,7 @@ void tm_print_registered_tasks(void);
  *
  */
 void tm_print_tasks_status(void);
+#endif
 
 #endif /*dg_configENABLE_TASK_MONITORING*/
 
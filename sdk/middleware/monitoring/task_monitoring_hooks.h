@@ -0,0 +1,46 @@
+/**
+ ****************************************************************************************
+ *
+ * @file task_monitoring_hooks.h
+ *
+ * @brief Kernel trace hooks of task monitoring, included by FreeRTOSConfig.h
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef TASK_MONITORING_HOOKS_H
+#define TASK_MONITORING_HOOKS_H
+
+#include <stddef.h>
+
+#if (dg_configSYSTEMVIEW == 1)
+#error "dg_configENABLE_TASK_MONITORING can't be used together with dg_configSYSTEMVIEW"
+#endif
+
+void tm_trace_task_create(void *task);
+void tm_trace_task_switched_out(void *task);
+void tm_trace_task_switched_in(void *task);
+void tm_trace_task_ready(void *task);
+void tm_trace_task_delete(void *task);
+void tm_trace_malloc(void *ptr, size_t size);
+void tm_trace_free(void *ptr, size_t size);
+
+#define traceTASK_CREATE(pxNewTCB)              tm_trace_task_create(pxNewTCB)
+#define traceTASK_SWITCHED_OUT()                tm_trace_task_switched_out(pxCurrentTCB)
+#define traceTASK_SWITCHED_IN()                 tm_trace_task_switched_in(pxCurrentTCB)
+#define traceMOVED_TASK_TO_READY_STATE(pxTCB)   tm_trace_task_ready(pxTCB)
+#define traceTASK_DELETE(pxTCB)                 tm_trace_task_delete(pxTCB)
+
+/*
+ * heap_4/heap_5 pass requested size to traceMALLOC(), but block may be larger if the rest was
+ * too small to split it, so size of block (pxBlock) is used, as in traceFREE().
+ */
+#define traceMALLOC(pvAddress, uiSize) \
+        tm_trace_malloc((pvAddress), (pvAddress) ? (pxBlock->xBlockSize & ~xBlockAllocatedBit) : 0)
+#define traceFREE(pvAddress, uiSize)            tm_trace_free((pvAddress), (uiSize))
+
+#endif /* TASK_MONITORING_HOOKS_H */
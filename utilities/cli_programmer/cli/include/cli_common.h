@@ -64,6 +64,27 @@ struct cli_options {
          * Target reset command
          */
         char *target_reset_cmd;
+
+        /**
+         * Number of chunks in flight used for writing FLASH over UART, 0 or 1 disables
+         * windowed transfer
+         */
+        unsigned int window_size;
+
+        /**
+         * Write the whole FLASH range, even sectors which already contain requested data
+         */
+        bool full_write;
+
+        /**
+         * Don't compress data written to FLASH
+         */
+        bool no_compress;
+
+        /**
+         * Highest baud rate negotiated with uartboot after it is uploaded, 0 disables negotiation
+         */
+        unsigned int max_baudrate;
 };
 
 /**
@@ -0,0 +1,59 @@
+/**
+ ****************************************************************************************
+ *
+ * @file gang.h
+ *
+ * @brief Programming of several devices in parallel
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef GANG_H_
+#define GANG_H_
+
+#include <stdbool.h>
+
+/** Maximum number of serial ports handled in parallel */
+#define GANG_MAX_PORTS          32
+
+/** Separator of serial port names in interface parameter */
+#define GANG_PORT_SEPARATOR     ','
+
+/**
+ * \brief Check if interface parameter is a list of serial ports
+ *
+ * \param [in] interface interface parameter from command line
+ *
+ * \return true if more than one serial port is given
+ *
+ */
+bool gang_is_port_list(const char *interface);
+
+/**
+ * \brief Handle command on several devices in parallel
+ *
+ * Each serial port is served by its own thread with its own programmer context. Log messages are
+ * prefixed with serial port name and summary of results is printed when all threads finish.
+ * Global programmer configuration (uartboot binary, timeouts etc.) must be set before.
+ * Read commands write data of each device to its own file, named after serial port (e.g. out.bin
+ * read through /dev/ttyUSB0 is written to out_ttyUSB0.bin). Dumping read data to console is not
+ * allowed.
+ *
+ * \param [in] ports comma separated list of serial ports
+ * \param [in] baudrate serial ports baudrate
+ * \param [in] attach uartboot is already running on devices, don't check it
+ * \param [in] cmd command name
+ * \param [in] argc number of command arguments
+ * \param [in] argv command arguments
+ *
+ * \return 0 if command succeeded on all devices, error code otherwise
+ *
+ */
+int gang_handle_command(const char *ports, int baudrate, bool attach, char *cmd, int argc,
+                                                                                char *argv[]);
+
+#endif /* GANG_H_ */
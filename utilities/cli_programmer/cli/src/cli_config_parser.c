@@ -44,6 +44,9 @@
 #define PARAM_NAME_INITIAL_BAUDRATE     "initial_baudrate"
 #define PARAM_NAME_TIMEOUT              "timeout"
 #define PARAM_NAME_BOOTLOADER_FNAME     "bootloader_fname"
+#define PARAM_NAME_WINDOW_SIZE          "window_size"
+#define PARAM_NAME_FULL_WRITE           "full_write"
+#define PARAM_NAME_NO_COMPRESS          "no_compress"
 
 /* Parameter names in 'uartboot' section */
 #define PARAM_NAME_BAUDRATE             "baudrate"
@@ -51,6 +54,7 @@
 #define PARAM_NAME_TX_PIN               "tx_pin"
 #define PARAM_NAME_RX_PORT              "rx_port"
 #define PARAM_NAME_RX_PIN               "rx_pin"
+#define PARAM_NAME_MAX_BAUDRATE         "max_baudrate"
 
 /* Parameter names in 'gdb server' section */
 #define PARAM_NAME_PORT                 "port"
@@ -108,6 +112,11 @@ bool cli_config_save_to_ini_file(const char *file_path, const struct cli_options
         add_num_value(&sections_queue, SECTION_NAME_CLI, PARAM_NAME_TIMEOUT, opts->timeout);
         ini_queue_add(&sections_queue, SECTION_NAME_CLI, PARAM_NAME_BOOTLOADER_FNAME,
                                                                         opts->bootloader_fname);
+        add_num_value(&sections_queue, SECTION_NAME_CLI, PARAM_NAME_WINDOW_SIZE,
+                                                                        opts->window_size);
+        add_num_value(&sections_queue, SECTION_NAME_CLI, PARAM_NAME_FULL_WRITE, opts->full_write);
+        add_num_value(&sections_queue, SECTION_NAME_CLI, PARAM_NAME_NO_COMPRESS,
+                                                                        opts->no_compress);
 
         /* 'uartboot' section */
         add_num_value_flagged(&sections_queue, SECTION_NAME_UARTBOOT, PARAM_NAME_BAUDRATE,
@@ -120,6 +129,8 @@ bool cli_config_save_to_ini_file(const char *file_path, const struct cli_options
                         opts->uartboot_config.rx_port, opts->uartboot_config.rx_port_patch);
         add_num_value_flagged(&sections_queue, SECTION_NAME_UARTBOOT, PARAM_NAME_RX_PIN,
                         opts->uartboot_config.rx_pin, opts->uartboot_config.rx_pin_patch);
+        add_num_value(&sections_queue, SECTION_NAME_UARTBOOT, PARAM_NAME_MAX_BAUDRATE,
+                                                                        opts->max_baudrate);
 
         /* 'gdb server' section */
         add_num_value(&sections_queue, SECTION_NAME_GDB_SERVER, PARAM_NAME_PORT,
@@ -190,6 +201,18 @@ bool cli_config_load_from_ini_file(const char *file_path, struct cli_options *op
                                 }
 
                                 opts->bootloader_fname = strdup(elem.value);
+                        } else if (!strcmp(elem.key, PARAM_NAME_WINDOW_SIZE)) {
+                                if (get_number(elem.value, &tmp)) {
+                                        opts->window_size = tmp;
+                                }
+                        } else if (!strcmp(elem.key, PARAM_NAME_FULL_WRITE)) {
+                                if (get_number(elem.value, &tmp)) {
+                                        opts->full_write = tmp;
+                                }
+                        } else if (!strcmp(elem.key, PARAM_NAME_NO_COMPRESS)) {
+                                if (get_number(elem.value, &tmp)) {
+                                        opts->no_compress = tmp;
+                                }
                         }
                 } else if (!strcmp(elem.section, SECTION_NAME_UARTBOOT)) {
                         /* 'uartboot' section */
@@ -218,6 +241,10 @@ bool cli_config_load_from_ini_file(const char *file_path, struct cli_options *op
                                         opts->uartboot_config.rx_pin = tmp;
                                         opts->uartboot_config.rx_pin_patch = true;
                                 }
+                        } else if (!strcmp(elem.key, PARAM_NAME_MAX_BAUDRATE)) {
+                                if (get_number(elem.value, &tmp)) {
+                                        opts->max_baudrate = tmp;
+                                }
                         }
                 } else if (!strcmp(elem.section, SECTION_NAME_GDB_SERVER)) {
                         /* 'gdb server' section */
@@ -0,0 +1,356 @@
+/**
+ ****************************************************************************************
+ *
+ * @file gang.c
+ *
+ * @brief Programming of several devices in parallel
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <programmer.h>
+#include "cli_common.h"
+#include "gang.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/* Maximum length of serial port name */
+#define GANG_PORT_NAME_LEN      64
+
+/* Command to run on all devices */
+struct gang_job {
+        int baudrate;
+        bool attach;
+        char *cmd;
+        int argc;
+        char **argv;
+};
+
+/* Read commands and index of their output file argument */
+static const struct {
+        const char *cmd;
+        int file_arg;
+} read_cmds[] = {
+        { "read",               1 },
+        { "read_qspi",          1 },
+        { "read_oqspi",         1 },
+        { "read_partition",     2 },
+};
+
+/* Single device served by worker thread */
+struct gang_device {
+        char port[GANG_PORT_NAME_LEN];
+        const struct gang_job *job;
+        char **argv;            /* job arguments, output file name is unique per device */
+        prog_context_t *ctx;
+        bool started;
+        int ret;
+#ifdef WIN32
+        HANDLE thread;
+#else
+        pthread_t thread;
+#endif
+};
+
+bool gang_is_port_list(const char *interface)
+{
+        return strchr(interface, GANG_PORT_SEPARATOR) != NULL;
+}
+
+static int program_device(struct gang_device *dev)
+{
+        const struct gang_job *job = dev->job;
+        int ret;
+
+        prog_context_select(dev->ctx);
+
+        if (prog_serial_open(dev->port, job->baudrate)) {
+                prog_print_err("cannot open serial port\n");
+                ret = ERR_FILE_OPEN;
+                goto done;
+        }
+
+        if (!job->attach && prog_verify_connection() != CONN_ESTABLISHED) {
+                ret = prog_upload_bootloader();
+                if (ret < 0) {
+                        prog_print_err("uartboot upload failed: %s\n", prog_get_err_message(ret));
+                        goto end;
+                }
+        }
+
+        ret = handle_command(job->cmd, job->argc, dev->argv);
+        if (!ret) {
+                prog_print_log("done.\n");
+        }
+
+end:
+        prog_close_interface(0);
+done:
+        prog_context_select(NULL);
+
+        return ret;
+}
+
+#ifdef WIN32
+static DWORD WINAPI device_thread(LPVOID param)
+{
+        struct gang_device *dev = param;
+
+        dev->ret = program_device(dev);
+
+        return 0;
+}
+
+static bool start_thread(struct gang_device *dev)
+{
+        dev->thread = CreateThread(NULL, 0, device_thread, dev, 0, NULL);
+
+        return dev->thread != NULL;
+}
+
+static void join_thread(struct gang_device *dev)
+{
+        WaitForSingleObject(dev->thread, INFINITE);
+        CloseHandle(dev->thread);
+}
+#else
+static void *device_thread(void *param)
+{
+        struct gang_device *dev = param;
+
+        dev->ret = program_device(dev);
+
+        return NULL;
+}
+
+static bool start_thread(struct gang_device *dev)
+{
+        return pthread_create(&dev->thread, NULL, device_thread, dev) == 0;
+}
+
+static void join_thread(struct gang_device *dev)
+{
+        pthread_join(dev->thread, NULL);
+}
+#endif
+
+/* split comma separated list of ports, returns number of ports or -1 on error */
+static int parse_ports(const char *ports, struct gang_device *devs)
+{
+        const char *p = ports;
+        int count = 0;
+
+        while (*p != '\0') {
+                const char *sep = strchr(p, GANG_PORT_SEPARATOR);
+                size_t len = sep != NULL ? (size_t) (sep - p) : strlen(p);
+
+                if (len > 0) {
+                        if (count == GANG_MAX_PORTS || len >= GANG_PORT_NAME_LEN) {
+                                return -1;
+                        }
+
+                        memcpy(devs[count].port, p, len);
+                        devs[count].port[len] = '\0';
+                        count++;
+                }
+
+                if (sep == NULL) {
+                        break;
+                }
+                p = sep + 1;
+        }
+
+        return count;
+}
+
+/* index of output file argument of command, -1 if command doesn't write a file */
+static int output_file_arg(const char *cmd, int argc)
+{
+        size_t i;
+
+        for (i = 0; i < sizeof(read_cmds) / sizeof(read_cmds[0]); i++) {
+                if (!strcmp(cmd, read_cmds[i].cmd)) {
+                        return read_cmds[i].file_arg < argc ? read_cmds[i].file_arg : -1;
+                }
+        }
+
+        return -1;
+}
+
+/*
+ * File name with port name appended before extension, e.g. out.bin read from /dev/ttyUSB0 is
+ * written to out_ttyUSB0.bin
+ */
+static char *device_file_name(const char *fname, const char *port)
+{
+        const char *base = fname;
+        const char *ext;
+        const char *p;
+        size_t len;
+        char *name;
+
+        for (p = fname; *p != '\0'; p++) {
+                if (*p == '/' || *p == '\\') {
+                        base = p + 1;
+                }
+        }
+        ext = strrchr(base, '.');
+        if (ext == NULL || ext == base) {
+                ext = base + strlen(base);
+        }
+
+        for (p = port; *p != '\0'; p++) {
+                if (*p == '/' || *p == '\\') {
+                        port = p + 1;
+                }
+        }
+
+        len = strlen(fname) + strlen(port) + 2;
+        name = malloc(len);
+        if (name != NULL) {
+                snprintf(name, len, "%.*s_%s%s", (int) (ext - fname), fname, port, ext);
+        }
+
+        return name;
+}
+
+/* arguments of device, output file name of read command gets port name as suffix */
+static char **device_args(const struct gang_job *job, int file_arg, const char *port)
+{
+        char **argv;
+
+        argv = calloc(job->argc > 0 ? job->argc : 1, sizeof(*argv));
+        if (argv == NULL) {
+                return NULL;
+        }
+        memcpy(argv, job->argv, job->argc * sizeof(*argv));
+
+        if (file_arg >= 0) {
+                argv[file_arg] = device_file_name(job->argv[file_arg], port);
+                if (argv[file_arg] == NULL) {
+                        free(argv);
+                        return NULL;
+                }
+        }
+
+        return argv;
+}
+
+static void free_device_args(char **argv, int file_arg)
+{
+        if (argv != NULL && file_arg >= 0) {
+                free(argv[file_arg]);
+        }
+        free(argv);
+}
+
+int gang_handle_command(const char *ports, int baudrate, bool attach, char *cmd, int argc,
+                                                                                char *argv[])
+{
+        struct gang_device *devs;
+        struct gang_job job;
+        int failed = 0;
+        int file_arg;
+        int count;
+        int ret = 0;
+        int i;
+
+        /* these use executable buffer shared by all devices and ROM booter timing */
+        if (!strcmp(cmd, "boot") || !strcmp(cmd, "run")) {
+                prog_print_err("command %s can't be used with multiple serial ports\n", cmd);
+                return ERR_PROG_INVALID_ARGUMENT;
+        }
+
+        file_arg = output_file_arg(cmd, argc);
+        if (file_arg >= 0 && (!strcmp(argv[file_arg], "-") || !strcmp(argv[file_arg], "--"))) {
+                /* dumps of all devices would be mixed on console */
+                prog_print_err("command %s can't dump data to console with multiple serial "
+                                                                        "ports\n", cmd);
+                return ERR_PROG_INVALID_ARGUMENT;
+        }
+
+        devs = calloc(GANG_MAX_PORTS, sizeof(*devs));
+        if (devs == NULL) {
+                return ERR_ALLOC_FAILED;
+        }
+
+        count = parse_ports(ports, devs);
+        if (count <= 0) {
+                prog_print_err("invalid list of serial ports (up to %d ports allowed)\n",
+                                                                                GANG_MAX_PORTS);
+                ret = ERR_PROG_INVALID_ARGUMENT;
+                goto end;
+        }
+
+        job.baudrate = baudrate;
+        job.attach = attach;
+        job.cmd = cmd;
+        job.argc = argc;
+        job.argv = argv;
+
+        prog_print_log("Running %s on %d devices\n", cmd, count);
+
+        for (i = 0; i < count; i++) {
+                devs[i].job = &job;
+                devs[i].argv = device_args(&job, file_arg, devs[i].port);
+                if (devs[i].argv == NULL) {
+                        devs[i].ret = ERR_ALLOC_FAILED;
+                        continue;
+                }
+                if (file_arg >= 0) {
+                        prog_print_log("Data read from %s is written to %s\n", devs[i].port,
+                                                                devs[i].argv[file_arg]);
+                }
+
+                devs[i].ctx = prog_context_create(devs[i].port);
+                if (devs[i].ctx == NULL) {
+                        devs[i].ret = ERR_ALLOC_FAILED;
+                        continue;
+                }
+
+                devs[i].started = start_thread(&devs[i]);
+                if (!devs[i].started) {
+                        devs[i].ret = ERR_FAILED;
+                }
+        }
+
+        for (i = 0; i < count; i++) {
+                if (devs[i].started) {
+                        join_thread(&devs[i]);
+                }
+                prog_context_destroy(devs[i].ctx);
+                free_device_args(devs[i].argv, file_arg);
+        }
+
+        prog_print_log("\nSummary:\n");
+        for (i = 0; i < count; i++) {
+                if (devs[i].ret == 0) {
+                        prog_print_log("  %-24s OK\n", devs[i].port);
+                        continue;
+                }
+
+                prog_print_log("  %-24s FAILED (%s)\n", devs[i].port,
+                        devs[i].ret < 0 ? prog_get_err_message(devs[i].ret) : "command error");
+                failed++;
+                if (ret == 0) {
+                        ret = devs[i].ret;
+                }
+        }
+        prog_print_log("%s completed on %d of %d devices\n", cmd, count - failed, count);
+
+end:
+        free(devs);
+
+        return ret;
+}
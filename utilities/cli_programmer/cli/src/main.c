@@ -23,6 +23,7 @@
 #include "cli_common.h"
 #include "cli_version.h"
 #include "cli_config_parser.h"
+#include "gang.h"
 
 #define DEFAULT_BOOTLOADER_FNAME_WIN    "uartboot.bin"
 #define DEFAULT_GDB_SERVER_HOST_NAME    "localhost"
@@ -102,6 +103,8 @@ int main(int argc, char *argv[])
         char file_path[MAX_CLI_CONFIG_FILE_PATHNAME_LEN] = {0};
         int close_data = 0;
         bool gdb_server_used = false;
+        const char *gang_ports = NULL;
+        bool attach = false;
 
 #ifdef WIN32
         HANDLE console_handle = GetStdHandle(STD_INPUT_HANDLE);
@@ -229,6 +232,10 @@ int main(int argc, char *argv[])
 
                 gdb_server_used = true;
         }
+        /* list of serial ports, each one is opened by its own worker thread */
+        else if (gang_is_port_list(argv[p_idx])) {
+                gang_ports = argv[p_idx];
+        }
         /* argv[p_idx] should be serial port name, we can try to open it */
         else if (prog_serial_open(argv[p_idx], main_opts.uartboot_config.baudrate)) {
                 prog_print_err("cannot open serial port\n");
@@ -244,6 +251,7 @@ int main(int argc, char *argv[])
 
         if (main_opts.bootloader_fname) {
                 if (!strcmp(main_opts.bootloader_fname, "attach")) {
+                        attach = true;
                         goto handle_cmd;
                 }
 
@@ -263,11 +271,18 @@ int main(int argc, char *argv[])
         }
 
         prog_set_uart_timeout(main_opts.timeout);
+        prog_set_protocol_window(main_opts.window_size);
+        prog_set_flash_diff_write(!main_opts.full_write);
+        prog_set_compressed_transfer(!main_opts.no_compress);
+        prog_set_max_baudrate(main_opts.max_baudrate);
 
         /*
          * Check uartboot and upload if needed
          */
-        if ((strcmp(argv[p_idx], "boot")) && prog_verify_connection() != CONN_ESTABLISHED) {
+        if (gang_ports) {
+                /* uartboot is patched once here, workers check and upload it on their own */
+                prog_uartboot_patch_config(&main_opts.uartboot_config);
+        } else if ((strcmp(argv[p_idx], "boot")) && prog_verify_connection() != CONN_ESTABLISHED) {
                 prog_uartboot_patch_config(&main_opts.uartboot_config);
                 ret = prog_upload_bootloader();
                 if (ret < 0) {
@@ -277,10 +292,15 @@ int main(int argc, char *argv[])
         }
 
 handle_cmd:
-        ret = handle_command(argv[p_idx], argc - p_idx - 1, &argv[p_idx + 1]);
-
-        if (!ret) {
-                prog_print_log("done.\n");
+        if (gang_ports) {
+                ret = gang_handle_command(gang_ports, main_opts.uartboot_config.baudrate, attach,
+                                                argv[p_idx], argc - p_idx - 1, &argv[p_idx + 1]);
+        } else {
+                ret = handle_command(argv[p_idx], argc - p_idx - 1, &argv[p_idx + 1]);
+
+                if (!ret) {
+                        prog_print_log("done.\n");
+                }
         }
 end:
         if (gdb_server_used) {
@@ -54,6 +54,10 @@ struct cli_options main_opts = {
         /*.config_file_path  = */ NULL,
         /* .chip_rev = */ NULL,
         /* .target_reset_cmd  = */ NULL,
+        /* .window_size = */ 8,
+        /* .full_write = */ false,
+        /* .no_compress = */ false,
+        /* .max_baudrate = */ 0,
 };
 
 void set_str_opt(char **opt, const char *val)
@@ -75,7 +79,8 @@ static void opth_help(void)
                 "                      [--tx-port <port_num>] [--tx-pin <pin_num>] \n"
                 "                      [--rx-port <port_num>] [--rx-pin <pin_num] [-w timeout] \n"
                 "                      [--no-kill [mode]] [--gdb-cmd <cmd>] \n"
-                "                      [--trc <cmd>] \n"
+                "                      [--trc <cmd>] [--window <chunks>] [--full-write] \n"
+                "                      [--no-compress] [--max-baudrate <baudrate>] \n"
                 "                      [--save-ini] \n"
                 "                      [--save <config_file>]\n"
                 "                      [--prod-id <id>]\n"
@@ -129,6 +134,19 @@ static void opth_help(void)
                 main_opts.uartboot_config.rx_pin);
         printf("    --prod-id <id>         Chip product id (in the form of DAxxxxx-yy). \n");
         printf("    -w <timeout>           Serial port communication timeout.\n");
+        printf("    --window <chunks>      Number of chunks sent to uartboot without waiting \n"
+                "                           for acknowledgment when writing FLASH. Ignored if \n"
+                "                           not supported by uartboot. 0 or 1 disables it. \n"
+                "                           Default value is %u.\n", main_opts.window_size);
+        printf("    --full-write           Write all FLASH sectors. By default sectors which \n"
+                "                           already contain the data (same CRC32) are skipped.\n");
+        printf("    --no-compress          Don't compress data written to FLASH. By default \n"
+                "                           chunks are compressed if it makes them smaller and \n"
+                "                           uartboot supports it.\n");
+        printf("    --max-baudrate <rate>  Highest baud rate negotiated with uartboot after it \n"
+                "                           is uploaded. The fastest rate which works reliably \n"
+                "                           (up to 3000000) is used for the rest of the session. \n"
+                "                           uartboot keeps it until reset. Disabled by default.\n");
         printf("    -r <host>              Gdb server host (default: localhost).\n");
         printf("    -p <port>              Gdb server port (default: 2331).\n");
         printf("    --gdb-cmd <cmd>        Gdb server start command. Must be used if there is \n"
@@ -161,6 +179,10 @@ static void opth_help(void)
         printf("interface: \n");
         printf("                           It can be \'gdbserver\' or serial port name (COMx on Windows\n");
         printf("                           or /dev/ttyUSBx on Linux)\n");
+        printf("                           Comma separated list of serial ports runs the command on\n");
+        printf("                           all of them in parallel (commands boot and run excluded)\n");
+        printf("                           Read commands add port name to output file name\n");
+        printf("                           (out.bin -> out_ttyUSB0.bin).\n");
         printf("\n");
 
         /* Commands description */
@@ -313,6 +335,10 @@ static void opth_help(void)
         printf("> cli_programmer -i 9600 -s 115200 --tx-port 0 --tx-pin 9 --rx-port 2 --rx-pin 2 \n"
                 "                 COM40 read_qspi 0x0 data_o 0x100\n\n");
 
+        printf("Write the same image to QSPI flash of four devices in parallel:\n");
+        printf("> cli_programmer /dev/ttyUSB0,/dev/ttyUSB1,/dev/ttyUSB2,/dev/ttyUSB3 "
+                "write_qspi 0x0 data_i\n\n");
+
         printf("Read qspi flash/RAM contents (10 bytes at address 0x0) \n ");
         printf("Start gdbserver manually first in another terminal session!\n");
         printf("> cli_programmer gdbserver read_qspi 0 -- 10 \n\n");
@@ -340,6 +366,16 @@ static int opth_timeout(const char *param)
         return get_number(param, &main_opts.timeout);
 }
 
+static int opth_window(const char *param)
+{
+        return get_number(param, &main_opts.window_size);
+}
+
+static int opth_max_baudrate(const char *param)
+{
+        return get_number(param, &main_opts.max_baudrate);
+}
+
 static int opth_gdb_port(const char *param)
 {
         return get_number(param, &main_opts.gdb_server_config.port);
@@ -507,6 +543,32 @@ int handle_long_option(const char * opt, const char * param) {
                 set_str_opt(&main_opts.target_reset_cmd, param);
                 return 1;
         }
+        if (!strcmp(opt, "window")) {
+                if (!param || !opth_window(param)) {
+                        prog_print_err("invalid window size\n");
+                        return -1;
+                }
+
+                return 1;
+        }
+        if (!strcmp(opt, "full-write")) {
+                main_opts.full_write = true;
+
+                return 0;
+        }
+        if (!strcmp(opt, "no-compress")) {
+                main_opts.no_compress = true;
+
+                return 0;
+        }
+        if (!strcmp(opt, "max-baudrate")) {
+                if (!param || !opth_max_baudrate(param)) {
+                        prog_print_err("invalid maximum baudrate\n");
+                        return -1;
+                }
+
+                return 1;
+        }
         if (!strcmp(opt, "save-ini")) {
                 set_str_opt(&main_opts.config_file_path, "cli_programmer.ini");
 
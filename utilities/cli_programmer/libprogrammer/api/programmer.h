@@ -323,6 +323,51 @@ void DLLEXPORT prog_set_initial_baudrate(unsigned int initial_baudrate);
  */
 unsigned int DLLEXPORT prog_get_initial_baudrate(void);
 
+/**
+ * \brief Programmer context
+ *
+ * Holds the state of connection with a single device: opened serial port, selected interface,
+ * parameters negotiated with uartboot and messages buffers. Each thread works on the context it
+ * has selected with prog_context_select(), threads which haven't selected any use the default
+ * context. This allows programming several devices in parallel, one device per thread.
+ *
+ * Global configuration (chip revision, uartboot binary, timeouts, transfer options) is shared by
+ * all contexts and should be set before threads are started.
+ *
+ */
+typedef struct prog_context prog_context_t;
+
+/**
+ * \brief Create programmer context
+ *
+ * \param [in] name device name printed in front of each log message, can be NULL
+ *
+ * \return created context, NULL if memory allocation failed
+ *
+ */
+DLLEXPORT prog_context_t *prog_context_create(const char *name);
+
+/**
+ * \brief Destroy programmer context
+ *
+ * Interface opened in the context should be closed before. Context must not be selected by any
+ * thread.
+ *
+ * \param [in] ctx context created with prog_context_create()
+ *
+ */
+void DLLEXPORT prog_context_destroy(prog_context_t *ctx);
+
+/**
+ * \brief Select programmer context for calling thread
+ *
+ * All following programmer functions called by this thread work on the selected context.
+ *
+ * \param [in] ctx context to select, NULL selects default context
+ *
+ */
+void DLLEXPORT prog_context_select(prog_context_t *ctx);
+
 /**
  * \brief Open serial port for programmer
  *
@@ -905,6 +950,52 @@ int DLLEXPORT prog_uartboot_patch_config(const prog_uartboot_config_t * uartboot
  */
 void DLLEXPORT prog_set_uart_timeout(unsigned int timeoutInMs);
 
+/**
+ * \brief Set number of chunks in flight used for writing FLASH over UART
+ *
+ * Windowed transfer is negotiated with uartboot, older uartboot versions fall back to sending
+ * one chunk at a time. Value 0 or 1 disables windowed transfer.
+ *
+ * \param [in] chunks number of chunks in flight
+ *
+ */
+void DLLEXPORT prog_set_protocol_window(unsigned int chunks);
+
+/**
+ * \brief Set highest baud rate negotiated with uartboot
+ *
+ * After uploading uartboot, the fastest baud rate up to \p baudrate which works reliably is
+ * negotiated with it. uartboot keeps using that rate until it is reset. Negotiation is disabled
+ * by default.
+ *
+ * \param [in] baudrate maximum baud rate, 0 disables negotiation
+ *
+ */
+void DLLEXPORT prog_set_max_baudrate(unsigned int baudrate);
+
+/**
+ * \brief Enable or disable differential FLASH writing
+ *
+ * When enabled (default), digests of FLASH sectors are read from uartboot before writing and
+ * sectors which already contain the requested data are neither erased nor written.
+ *
+ * \param [in] enable true to skip unchanged sectors, false to always write the whole range
+ *
+ */
+void DLLEXPORT prog_set_flash_diff_write(bool enable);
+
+/**
+ * \brief Enable or disable compressed transfer of data written to FLASH over UART
+ *
+ * When enabled (default), chunks are compressed by the host and decompressed by uartboot before
+ * writing to FLASH. Chunks which don't get smaller, and all chunks for uartboot versions which
+ * don't support it, are sent uncompressed.
+ *
+ * \param [in] enable true to compress data
+ *
+ */
+void DLLEXPORT prog_set_compressed_transfer(bool enable);
+
 /**
  * \brief Get waiting time for the UART signal.
  *
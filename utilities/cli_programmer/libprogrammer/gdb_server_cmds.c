@@ -76,6 +76,17 @@
 #define ACK_CHAR                        '+'
 #define NACK_CHAR                       '-'
 #define CHUNK_SIZE                      0x2000
+/*
+ * Packet size used if GDB Server doesn't report it: X packet with CHUNK_SIZE of binary payload,
+ * the largest write packet sent before packet size was negotiated
+ */
+#define DEFAULT_PACKET_SIZE             (X_PACKET_HEADER_LEN + CHUNK_SIZE + PACKET_TRAILER_LEN)
+/* Space reserved for X packet header: "$X", address, ',', length and ':' */
+#define X_PACKET_HEADER_LEN             (2 + 8 + 1 + 8 + 1)
+/* Packet trailer: '#' and checksum */
+#define PACKET_TRAILER_LEN              3
+/* Number of write packets sent without waiting for replies (no-ack mode only) */
+#define WRITE_PIPELINE_DEPTH            8
 
 #define GDB_SERVER_INSTANCES_LIMIT      100
 #define GDB_SERVER_DEFAULT_PORT         2331
@@ -129,6 +140,20 @@ static int gdb_server_sock = INVALID_SOCKET;
 #endif
 /* buffer for GDB Server responses */
 static recv_buf_t gdb_server_recv_buf = {/* .len = */ 0};
+/* buffer for packets sent to GDB Server, reused by write commands */
+static char gdb_server_send_buf[MAX_BUF_LEN];
+/* maximum packet size accepted by GDB Server, negotiated with qSupported */
+static uint32_t gdb_server_packet_size = DEFAULT_PACKET_SIZE;
+/* GDB Server doesn't send and doesn't expect acknowledgements (QStartNoAckMode) */
+static bool gdb_server_no_ack_mode;
+/* replies to write packets sent in no-ack mode which were not received yet */
+static struct {
+        uint32_t pending;               /* number of replies not received yet */
+        bool in_frame;                  /* '$' received, waiting for '#' */
+        uint8_t checksum_chars;         /* checksum characters left after '#' */
+        bool error;                     /* current reply is an error code */
+        bool first_char;                /* next character is the first character of reply */
+} write_replies;
 /* flag indicates that the uartboot code was loaded on platform */
 static bool uartboot_loaded = false;
 /* GDB Server configuration */
@@ -795,7 +820,7 @@ static int gdb_server_recv_with_ack(void)
 //                goto start;
         }
 
-        return gdb_server_ack();
+        return gdb_server_no_ack_mode ? 0 : gdb_server_ack();
 }
 
 /*
@@ -833,6 +858,14 @@ static int gdb_server_send_recv_ack(const char *buf, uint32_t buf_len)
         int status;
         bool ack_nack;
 
+        if (gdb_server_no_ack_mode) {
+                if ((status = gdb_server_send(buf, buf_len)) != 0) {
+                       return status;
+                }
+
+                return gdb_server_recv_with_ack();
+        }
+
         while (repeats_cnt < GDB_SERVER_REPEATS_LIMIT) {
                 if ((status = gdb_server_send(buf, buf_len)) != 0) {
                        return status;
@@ -870,49 +903,264 @@ static int gdb_server_send_read_cmd(uint32_t addr, uint32_t len)
         return gdb_server_send_recv_ack(cmd, strlen(cmd));
 }
 
+/* frame given payload as GDB packet, send it and receive response */
+static int gdb_server_send_packet(const char *payload)
+{
+        uint32_t len = strlen(payload);
+
+        if (len + 1 + PACKET_TRAILER_LEN >= sizeof(gdb_server_send_buf)) {
+                return ERR_PROG_INVALID_ARGUMENT;
+        }
+
+        sprintf(gdb_server_send_buf, "$%s#%02X", payload, checksum(payload, len));
+
+        return gdb_server_send_recv_ack(gdb_server_send_buf, len + 1 + PACKET_TRAILER_LEN);
+}
+
+/*
+ * create X packet in gdb_server_send_buf with as much data as fits in packet size accepted by
+ * GDB Server, return number of data bytes put in the packet
+ */
+static uint32_t gdb_server_build_write_packet(uint32_t addr, uint32_t data_len,
+                                        const uint8_t *data, const char **packet, uint32_t *len)
+{
+        /* data is put after space reserved for the header, header is put just before data */
+        char *out = gdb_server_send_buf + X_PACKET_HEADER_LEN;
+        const char *out_end = gdb_server_send_buf + gdb_server_packet_size - PACKET_TRAILER_LEN;
+        char header[X_PACKET_HEADER_LEN + 1];
+        uint32_t header_len;
+        uint8_t cs = 0;
+        uint32_t i;
+        char *start;
+
+        /* binary data with escaped special characters, escaped byte takes 2 characters */
+        for (i = 0; i < data_len; i++) {
+                uint8_t c = data[i];
+
+                if (c == '#' || c == '$' || c == '}' || c == '*') {
+                        if (out + 2 > out_end) {
+                                break;
+                        }
+                        *out++ = '}';
+                        *out++ = c ^ 0x20;
+                        cs += '}' + (c ^ 0x20);
+                } else {
+                        if (out + 1 > out_end) {
+                                break;
+                        }
+                        *out++ = c;
+                        cs += c;
+                }
+        }
+
+        /* frame example: $X10,2:<binary data>#FF */
+        header_len = sprintf(header, "$X%x,%x:", addr, i);
+        start = gdb_server_send_buf + X_PACKET_HEADER_LEN - header_len;
+        memcpy(start, header, header_len);
+        cs += checksum(header + 1, header_len - 1);
+        out += sprintf(out, "#%02X", cs);
+
+        *packet = start;
+        *len = out - start;
+
+        return i;
+}
+
 /* send write command to GDB Server, command syntax typical for GDB */
 static int gdb_server_send_write_cmd(uint32_t addr, uint32_t data_len, const uint8_t *data)
 {
-        uint32_t tmp_len;
-        uint32_t i;
-        char *cmd;
+        const char *packet;
+        uint32_t packet_len;
+        uint32_t written;
         int ret;
 
-        /*
-         * length calculation: address (up to 8 bytes), data length (up to 8 bytes), checksum
-         * (2 bytes), frame characters (5 bytes), data (up to data_len * 2 bytes) and NULL
-         * terminating (1 byte)
-         */
-        cmd = malloc(data_len * 2 + 8 + 8 + 2 + 5 + 1);
+        do {
+                written = gdb_server_build_write_packet(addr, data_len, data, &packet,
+                                                                                &packet_len);
 
-        if (!cmd) {
-                printf("Failed to malloc\n");
-                return ERR_ALLOC_FAILED;
+                if ((ret = gdb_server_send_recv_ack(packet, packet_len)) != 0) {
+                        return ret;
+                }
+
+                addr += written;
+                data += written;
+                data_len -= written;
+        } while (data_len > 0);
+
+        return 0;
+}
+
+/*
+ * receive replies to pipelined write packets until no more than max_pending are outstanding,
+ * return error if any of received replies is an error code
+ */
+static int gdb_server_recv_write_replies(uint32_t max_pending)
+{
+        char buf[256];
+        int status = 0;
+        int len;
+        int i;
+
+        while (write_replies.pending > max_pending) {
+                if ((len = recv(gdb_server_sock, buf, sizeof(buf), 0)) <= 0) {
+                        write_replies.pending = 0;
+                        return ERR_GDB_SERVER_SOCKET;
+                }
+
+                /* all received characters belong to replies, so whole buffer is parsed */
+                for (i = 0; i < len; i++) {
+                        if (!write_replies.in_frame && !write_replies.checksum_chars) {
+                                if (buf[i] == '$') {
+                                        write_replies.in_frame = true;
+                                        write_replies.first_char = true;
+                                        write_replies.error = false;
+                                }
+                        } else if (write_replies.in_frame) {
+                                if (buf[i] == '#') {
+                                        write_replies.in_frame = false;
+                                        write_replies.checksum_chars = 2;
+                                } else if (write_replies.first_char) {
+                                        /* reply is 'OK' or error code 'Exx' */
+                                        write_replies.error = (buf[i] == 'E');
+                                        write_replies.first_char = false;
+                                }
+                        } else if (--write_replies.checksum_chars == 0) {
+                                if (write_replies.error || write_replies.first_char) {
+                                        status = ERR_GDB_SERVER_CMD_REJECTED;
+                                }
+
+                                if (write_replies.pending > 0) {
+                                        write_replies.pending--;
+                                }
+                        }
+                }
         }
 
-        /*
-         * frame example: $m10,2:01234#FF, data are not a characters - binary data with some
-         * characters escaping
-         */
-        sprintf(cmd, "$X%x,%x:", addr, data_len);
-        tmp_len = strlen(cmd);
+#if DBG_GDB_SERVER
+        printf("--> write replies, %u pending\n", write_replies.pending);
+#endif
 
-        for (i = 0; i < data_len; i++) {
-                /* escape special characters */
-                if (data[i] == '#' || data[i] == '$' || data[i] == '}') {
-                        cmd[tmp_len++] = '}';
-                        cmd[tmp_len++] = data[i] - 0x20;
-                } else {
-                        cmd[tmp_len++] = data[i];
+        return status;
+}
+
+/*
+ * write data to GDB Server using as large packets as possible. In no-ack mode up to
+ * WRITE_PIPELINE_DEPTH packets are sent before the reply to the first of them is awaited.
+ */
+static int gdb_server_write_pipelined(uint32_t addr, uint32_t data_len, const uint8_t *data)
+{
+        const char *packet;
+        uint32_t packet_len;
+        uint32_t written;
+        int status = 0;
+        int ret;
+
+        if (!gdb_server_no_ack_mode) {
+                return gdb_server_send_write_cmd(addr, data_len, data);
+        }
+
+        memset(&write_replies, 0, sizeof(write_replies));
+
+        while (data_len > 0) {
+                written = gdb_server_build_write_packet(addr, data_len, data, &packet,
+                                                                                &packet_len);
+
+                if ((ret = gdb_server_send(packet, packet_len)) != 0) {
+                        return ret;
+                }
+
+                write_replies.pending++;
+                addr += written;
+                data += written;
+                data_len -= written;
+
+                if (write_replies.pending >= WRITE_PIPELINE_DEPTH) {
+                        if ((ret = gdb_server_recv_write_replies(WRITE_PIPELINE_DEPTH - 1)) != 0) {
+                                status = ret;
+                                break;
+                        }
                 }
         }
 
-        sprintf(&cmd[tmp_len], "#%02X", checksum(cmd + 1, tmp_len - 1));
+        /* all replies must be received, even if an error occurred */
+        if ((ret = gdb_server_recv_write_replies(0)) != 0 && status == 0) {
+                status = ret;
+        }
 
-        ret = gdb_server_send_recv_ack(cmd, tmp_len + 3);
-        free(cmd);
+        return status;
+}
 
-        return ret;
+/* copy data of the frame received in gdb_server_recv_buf as C-string, truncate if too long */
+static bool gdb_server_get_reply(char *reply, size_t reply_size)
+{
+        const char *buf = (const char *) gdb_server_recv_buf.buf;
+        const char *start;
+        const char *end;
+        size_t len;
+
+        start = memchr(buf, '$', gdb_server_recv_buf.len);
+        if (!start) {
+                return false;
+        }
+
+        start++;
+        end = memchr(start, '#', gdb_server_recv_buf.len - (start - buf));
+        if (!end) {
+                return false;
+        }
+
+        len = end - start;
+        if (len >= reply_size) {
+                len = reply_size - 1;
+        }
+
+        memcpy(reply, start, len);
+        reply[len] = '\0';
+
+        return true;
+}
+
+/*
+ * negotiate packet size and no-ack mode with GDB Server, servers which don't support it are used
+ * with default settings
+ */
+static void gdb_server_negotiate(void)
+{
+        char reply[512];
+        const char *p;
+
+        gdb_server_packet_size = DEFAULT_PACKET_SIZE;
+        gdb_server_no_ack_mode = false;
+
+        /* reply example: PacketSize=4000;qXfer:memory-map:read+;QStartNoAckMode+ */
+        if (gdb_server_send_packet("qSupported") != 0 || !gdb_server_get_reply(reply,
+                                                                                sizeof(reply))) {
+                return;
+        }
+
+        if ((p = strstr(reply, "PacketSize=")) != NULL) {
+                unsigned long size = strtoul(p + strlen("PacketSize="), NULL, 16);
+
+                if (size > sizeof(gdb_server_send_buf)) {
+                        size = sizeof(gdb_server_send_buf);
+                }
+
+                /* ignore values too small to carry any data */
+                if (size > X_PACKET_HEADER_LEN + PACKET_TRAILER_LEN + 2) {
+                        gdb_server_packet_size = size;
+                }
+        }
+
+        /* acknowledgements are not used after 'OK' reply */
+        if (strstr(reply, "QStartNoAckMode+") && gdb_server_send_packet("QStartNoAckMode") == 0
+                        && gdb_server_get_reply(reply, sizeof(reply)) && !strcmp(reply, "OK")) {
+                gdb_server_no_ack_mode = true;
+        }
+
+#if DBG_GDB_SERVER
+        printf("GDB Server packet size %u, no-ack mode %s\n", gdb_server_packet_size,
+                                                        gdb_server_no_ack_mode ? "on" : "off");
+#endif
 }
 
 /*
@@ -1599,6 +1847,8 @@ int gdb_server_connect(const char *host_name, int port)
                 return status;
         }
 
+        gdb_server_negotiate();
+
         return 0;
 }
 
@@ -1626,12 +1876,14 @@ int gdb_server_cmd_write(const uint8_t *buf, size_t size, uint32_t addr)
 #endif
         const prog_chip_regs_t *regs;
         const char *chip_rev;
-        int status = 0;
-        size_t part_size;
+        int status;
         uint32_t virtual_buf_mask;
 
         prog_get_chip_rev(&chip_rev);
         status = prog_get_chip_regs(chip_rev, &regs);
+        if (status) {
+                return status;
+        }
         virtual_buf_mask = regs->virtual_buf_mask;
 
         /*
@@ -1644,20 +1896,7 @@ int gdb_server_cmd_write(const uint8_t *buf, size_t size, uint32_t addr)
                 addr = (addr & ~virtual_buf_mask) + swd_addr.buf_addr;
         }
 
-        for (part_size = 0; part_size < size;) {
-                size_t write_size = ((CHUNK_SIZE > (size - part_size)) ? (size - part_size) :
-                                                                                        CHUNK_SIZE);
-
-                status = gdb_server_send_write_cmd(addr + part_size, write_size, buf + part_size);
-
-                if (status) {
-                        return status;
-                }
-
-                part_size += write_size;
-        }
-
-        return status;
+        return gdb_server_write_pipelined(addr, size, buf);
 }
 
 /* read from RAM could be direct - without bootloader */
@@ -0,0 +1,213 @@
+/**
+ ****************************************************************************************
+ *
+ * @file lz_block.c
+ *
+ * @brief LZ4 block format compression
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+#include <stdbool.h>
+#include <string.h>
+#include "lz_block.h"
+
+#define LZ_HASH_BITS            12
+#define LZ_MIN_MATCH            4
+#define LZ_MAX_OFFSET           0xFFFF
+/* LZ4 block format: last 5 bytes are always literals, last match starts 12 bytes before end */
+#define LZ_LAST_LITERALS        5
+#define LZ_MF_LIMIT             12
+#define LZ_RUN_MASK             0x0F
+
+static uint32_t read32(const uint8_t *p)
+{
+        uint32_t v;
+
+        memcpy(&v, p, sizeof(v));
+        return v;
+}
+
+static uint32_t hash32(uint32_t v)
+{
+        return (v * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+/* write length extension bytes, returns false if there is no room for them */
+static bool put_length(uint8_t *dst, size_t *op, size_t dst_size, size_t len)
+{
+        while (len >= 0xFF) {
+                if (*op >= dst_size) {
+                        return false;
+                }
+                dst[(*op)++] = 0xFF;
+                len -= 0xFF;
+        }
+
+        if (*op >= dst_size) {
+                return false;
+        }
+        dst[(*op)++] = (uint8_t) len;
+
+        return true;
+}
+
+/* write sequence of literals optionally followed by match (match_len 0 for the last one) */
+static bool put_sequence(uint8_t *dst, size_t *op, size_t dst_size, const uint8_t *literals,
+                                        size_t literals_len, size_t offset, size_t match_len)
+{
+        size_t token_op = *op;
+        uint8_t token;
+
+        if (*op >= dst_size) {
+                return false;
+        }
+        (*op)++;
+
+        token = (uint8_t) ((literals_len < LZ_RUN_MASK ? literals_len : LZ_RUN_MASK) << 4);
+        if (literals_len >= LZ_RUN_MASK &&
+                                !put_length(dst, op, dst_size, literals_len - LZ_RUN_MASK)) {
+                return false;
+        }
+
+        if (dst_size - *op < literals_len) {
+                return false;
+        }
+        memcpy(dst + *op, literals, literals_len);
+        *op += literals_len;
+
+        if (match_len > 0) {
+                match_len -= LZ_MIN_MATCH;
+                token |= (uint8_t) (match_len < LZ_RUN_MASK ? match_len : LZ_RUN_MASK);
+
+                if (dst_size - *op < 2) {
+                        return false;
+                }
+                dst[(*op)++] = (uint8_t) offset;
+                dst[(*op)++] = (uint8_t) (offset >> 8);
+
+                if (match_len >= LZ_RUN_MASK &&
+                                        !put_length(dst, op, dst_size, match_len - LZ_RUN_MASK)) {
+                        return false;
+                }
+        }
+
+        dst[token_op] = token;
+
+        return true;
+}
+
+size_t lz_block_compress(const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_size)
+{
+        /* positions are stored incremented by one, 0 marks empty entry */
+        uint32_t table[1 << LZ_HASH_BITS];
+        size_t anchor = 0;
+        size_t ip = 0;
+        size_t op = 0;
+
+        memset(table, 0, sizeof(table));
+
+        while (src_len >= LZ_MF_LIMIT && ip <= src_len - LZ_MF_LIMIT) {
+                const uint32_t seq = read32(src + ip);
+                const uint32_t h = hash32(seq);
+                size_t ref = table[h];
+                size_t match_len;
+
+                table[h] = (uint32_t) (ip + 1);
+
+                if (ref == 0 || ip - (ref - 1) > LZ_MAX_OFFSET || read32(src + ref - 1) != seq) {
+                        ip++;
+                        continue;
+                }
+                ref--;
+
+                match_len = LZ_MIN_MATCH;
+                while (ip + match_len < src_len - LZ_LAST_LITERALS &&
+                                        src[ref + match_len] == src[ip + match_len]) {
+                        match_len++;
+                }
+
+                if (!put_sequence(dst, &op, dst_size, src + anchor, ip - anchor, ip - ref,
+                                                                                match_len)) {
+                        return 0;
+                }
+
+                ip += match_len;
+                anchor = ip;
+        }
+
+        if (!put_sequence(dst, &op, dst_size, src + anchor, src_len - anchor, 0, 0)) {
+                return 0;
+        }
+
+        return op;
+}
+
+int lz_block_decompress(const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_size)
+{
+        size_t ip = 0;
+        size_t op = 0;
+
+        while (ip < src_len) {
+                const uint8_t token = src[ip++];
+                size_t len = token >> 4;
+                size_t offset;
+
+                if (len == LZ_RUN_MASK) {
+                        do {
+                                if (ip >= src_len) {
+                                        return -1;
+                                }
+                                len += src[ip];
+                        } while (src[ip++] == 0xFF);
+                }
+
+                if (src_len - ip < len || dst_size - op < len) {
+                        return -1;
+                }
+                memcpy(dst + op, src + ip, len);
+                ip += len;
+                op += len;
+
+                /* last sequence has no match */
+                if (ip == src_len) {
+                        break;
+                }
+
+                if (src_len - ip < 2) {
+                        return -1;
+                }
+                offset = src[ip] | (src[ip + 1] << 8);
+                ip += 2;
+
+                if (offset == 0 || offset > op) {
+                        return -1;
+                }
+
+                len = token & LZ_RUN_MASK;
+                if (len == LZ_RUN_MASK) {
+                        do {
+                                if (ip >= src_len) {
+                                        return -1;
+                                }
+                                len += src[ip];
+                        } while (src[ip++] == 0xFF);
+                }
+                len += LZ_MIN_MATCH;
+
+                if (dst_size - op < len) {
+                        return -1;
+                }
+
+                /* byte by byte, match may overlap with data being produced */
+                while (len--) {
+                        dst[op] = dst[op - offset];
+                        op++;
+                }
+        }
+
+        return (int) op;
+}
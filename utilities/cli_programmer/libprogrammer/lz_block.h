@@ -0,0 +1,50 @@
+/**
+ ****************************************************************************************
+ *
+ * @file lz_block.h
+ *
+ * @brief LZ4 block format compression library API
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#ifndef LZ_BLOCK_H_
+#define LZ_BLOCK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * \brief Compress data to LZ4 block
+ *
+ * Greedy single pass compression with small hash table. Output is a valid LZ4 block which can be
+ * decompressed by any LZ4 block decoder.
+ *
+ * \param [in]  src data to compress
+ * \param [in]  src_len length of data
+ * \param [out] dst buffer for compressed data
+ * \param [in]  dst_size size of dst buffer
+ *
+ * \return length of compressed data, 0 if it doesn't fit in dst buffer
+ *
+ */
+size_t lz_block_compress(const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_size);
+
+/*
+ * \brief Decompress LZ4 block
+ *
+ * \param [in]  src compressed data
+ * \param [in]  src_len length of compressed data
+ * \param [out] dst buffer for decompressed data
+ * \param [in]  dst_size size of dst buffer
+ *
+ * \return length of decompressed data, -1 if data is corrupted or doesn't fit in dst buffer
+ *
+ */
+int lz_block_decompress(const uint8_t *src, size_t src_len, uint8_t *dst, size_t dst_size);
+
+#endif /* LZ_BLOCK_H_ */
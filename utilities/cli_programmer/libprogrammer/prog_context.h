@@ -0,0 +1,90 @@
+/**
+ ****************************************************************************************
+ *
+ * @file prog_context.h
+ *
+ * @brief Programmer context - state of connection with single device
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+/**
+ * \addtogroup UTILITIES
+ * \{
+ * \addtogroup PROGRAMMER
+ * \{
+ * \addtogroup LIBRARY
+ * \{
+ */
+
+#ifndef PROG_CONTEXT_H_
+#define PROG_CONTEXT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "programmer.h"
+
+/* Size of buffers for messages read by prog_get_err_message() in GUI mode */
+#define PROG_CONTEXT_MSG_SIZE           128
+
+/* Maximum length of device name printed in front of log messages */
+#define PROG_CONTEXT_NAME_LEN           32
+
+struct target_interface;
+
+/**
+ * \brief Programmer context
+ *
+ * Holds everything which depends on the device being programmed. Configuration which is the same
+ * for all devices (chip revision, timeouts, uartboot binary etc.) is kept global and it should be
+ * set before any worker thread is started.
+ *
+ */
+struct prog_context {
+        /** Device name printed in front of log messages, empty for default context */
+        char name[PROG_CONTEXT_NAME_LEN];
+
+        /* serial port - serial_linux.c, serial_win.c */
+#ifdef WIN32
+        void *serial_handle;                    /**< Serial port HANDLE, NULL if closed */
+#else
+        int serial_fd;                          /**< Serial port descriptor, 0 if closed */
+        int serial_epoll_fd;                    /**< epoll instance waiting on serial_fd */
+        uint32_t serial_epoll_events;           /**< Events serial_fd is registered for */
+        long long serial_tx_end_ns;             /**< Estimated time last written byte is sent */
+#endif
+        int serial_baudrate;                    /**< Current baud rate */
+        int serial_byte_time_ns;                /**< Time in ns of one byte */
+
+        /* uartboot protocol - protocol_cmds.c */
+        unsigned int window_granted;            /**< Chunks in flight, 0 if not negotiated */
+        uint8_t window_caps;                    /**< Windowed mode capabilities of uartboot */
+        bool compression_rejected;              /**< uartboot rejected compressed transfer */
+
+        /* programmer - programmer.c */
+        const struct target_interface *target;  /**< Selected interface, NULL for serial */
+        char stdout_msg[PROG_CONTEXT_MSG_SIZE];
+        char stderr_msg[PROG_CONTEXT_MSG_SIZE];
+        char copy_stdout_msg[PROG_CONTEXT_MSG_SIZE];
+        char copy_stderr_msg[PROG_CONTEXT_MSG_SIZE];
+};
+
+/**
+ * \brief Get context selected by calling thread
+ *
+ * \return context selected with prog_context_select(), default context if none was selected
+ *
+ */
+prog_context_t *prog_context_current(void);
+
+#endif /* PROG_CONTEXT_H_ */
+
+/**
+ * \}
+ * \}
+ * \}
+ */
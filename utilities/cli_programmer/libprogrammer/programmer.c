@@ -24,6 +24,8 @@
 #include <programmer.h>
 
 #include "gdb_server_cmds.h"
+#include "prog_context.h"
+#include "protocol.h"
 #include "protocol_cmds.h"
 #include "serial.h"
 
@@ -35,6 +37,13 @@
 #define ADDRESS_TMP                     (0xFFFFFFFF)
 #define VIRTUAL_BUF_ADDRESS             (0x80000000)
 
+/* Thread local storage qualifier */
+#ifdef _MSC_VER
+#define THREAD_LOCAL                    __declspec(thread)
+#else
+#define THREAD_LOCAL                    __thread
+#endif
+
 /*
  * 680 specific chip registers
  */
@@ -166,6 +175,11 @@ static const prog_memory_sizes_t chip_700_mem_sizes = {
  */
 #define FLASH_ERASE_MASK (0x0FFF)
 
+/*
+ * FLASH range hashed by single CMD_GET_FLASH_DIGESTS command during differential write.
+ */
+#define FLASH_DIGEST_BATCH_SIZE (0x100000)
+
 /*
  * Pointer will hold memory for bootloader code
  *
@@ -185,21 +199,17 @@ static bool block_otp_write = false;
 static char prog_chip_rev[CHIP_REV_STRLEN] = CHIP_REV_680BB;
 
 /*
- *
- * buffers for gui mode
+ * Context used by threads which haven't selected any, it holds buffers for gui mode too
  */
-#define STDOUT_BUF_SIZE 128
-#define STDERR_BUF_SIZE 128
-static char stdout_msg[STDOUT_BUF_SIZE];
-static char stderr_msg[STDERR_BUF_SIZE];
-static char copy_stdout_msg[STDOUT_BUF_SIZE];
-static char copy_stderr_msg[STDERR_BUF_SIZE];
+static prog_context_t default_context;
+static THREAD_LOCAL prog_context_t *current_context;
 
 static unsigned int prog_intial_baudrate;
+static bool flash_diff_write = true;
 static unsigned int uartTimeoutInMs = 5000;
 char *target_reset_cmd;
 
-typedef struct {
+typedef struct target_interface {
         /**
          * \brief Close the target interface
          *
@@ -577,6 +587,48 @@ typedef struct {
          */
         int (*cmd_get_product_info)(uint8_t **buf, uint32_t *len);
 
+        /**
+         * \brief Get number of chunks which could be written in a single window
+         *
+         * \note NULL if the interface doesn't support windowed transfer.
+         *
+         * \return number of chunks in flight, 1 if windowed transfer is not supported by device
+         *
+         */
+        unsigned int (*get_window_size)(void);
+
+        /**
+         * \brief Write window of chunks to the device memory
+         *
+         * \note NULL if the interface doesn't support windowed transfer.
+         *
+         * \param [in] mem destination memory (PROTOCOL_MEM_RAM, PROTOCOL_MEM_QSPI or
+         *                PROTOCOL_MEM_OQSPI)
+         * \param [in] chunks chunks to be written
+         * \param [in] count number of chunks
+         * \param [in] verify true for performing FLASH writing verification
+         *
+         * \returns 0 on success, negative value with error code on failure
+         *
+         */
+        int (*cmd_window_write)(uint8_t mem, const window_chunk_t *chunks, unsigned int count,
+                                                                                bool verify);
+
+        /**
+         * \brief Get CRC32 digests of FLASH range, one for each sector touched by the range
+         *
+         * \note NULL if the interface doesn't support FLASH digests.
+         *
+         * \param [in]  mem FLASH memory (PROTOCOL_MEM_QSPI or PROTOCOL_MEM_OQSPI)
+         * \param [in]  addr start address in FLASH
+         * \param [in]  size size of the range in bytes
+         * \param [out] digests buffer for digests
+         *
+         * \returns 0 on success, negative value with error code on failure
+         *
+         */
+        int (*cmd_get_flash_digests)(uint8_t mem, uint32_t addr, uint32_t size, uint32_t *digests);
+
         /**
          * \brief Maximal size of chunk which could be used for read commands
          */
@@ -619,6 +671,9 @@ static const target_interface_t target_serial = {
         /* .cmd_copy_to_oqspi = */              protocol_cmd_copy_to_oqspi,
         /* .cmd_direct_write_to_oqspi = */      protocol_cmd_direct_write_to_oqspi,
         /* .cmd_get_product_info = */           protocol_cmd_get_product_info,
+        /* .get_window_size = */                protocol_get_window_size,
+        /* .cmd_window_write = */               protocol_cmd_window_write,
+        /* .cmd_get_flash_digests = */          protocol_cmd_get_flash_digests,
         /* .read_chunk_size = */                PROTOCOL_READ_CHUNK_SIZE,
         /* .write_chunk_size = */               PROTOCOL_WRITE_CHUNK_SIZE,
 };
@@ -654,12 +709,48 @@ static const target_interface_t target_gdb_server = {
         /* .cmd_copy_to_oqspi = */              gdb_server_cmd_copy_to_oqspi,
         /* .cmd_direct_write_to_oqspi = */      gdb_server_cmd_direct_write_to_oqspi,
         /* .cmd_get_product_info = */           gdb_server_cmd_get_product_info,
+        /* .get_window_size = */                NULL,
+        /* .cmd_window_write = */               NULL,
+        /* .cmd_get_flash_digests = */          NULL,
         /* .read_chunk_size = */                GDB_SERVER_READ_CHUNK_SIZE,
         /* .write_chunk_size = */               GDB_SERVER_WRITE_CHUNK_SIZE,
 };
 
-/* Selected target interface is now serial port protocol */
-static const target_interface_t *target = &target_serial;
+prog_context_t *prog_context_current(void)
+{
+        return current_context != NULL ? current_context : &default_context;
+}
+
+/* Get target interface selected in current context, serial port protocol by default */
+static const target_interface_t *get_target(void)
+{
+        const target_interface_t *target = prog_context_current()->target;
+
+        return target != NULL ? target : &target_serial;
+}
+
+prog_context_t *prog_context_create(const char *name)
+{
+        prog_context_t *ctx = (prog_context_t *) calloc(1, sizeof(*ctx));
+
+        if (ctx != NULL && name != NULL) {
+                strncpy(ctx->name, name, sizeof(ctx->name) - 1);
+        }
+
+        return ctx;
+}
+
+void prog_context_destroy(prog_context_t *ctx)
+{
+        if (ctx != &default_context) {
+                free(ctx);
+        }
+}
+
+void prog_context_select(prog_context_t *ctx)
+{
+        current_context = ctx;
+}
 
 void prog_set_initial_baudrate(unsigned int initial_baudrate)
 {
@@ -679,7 +770,7 @@ int prog_serial_open(const char *port, int baudrate)
         if (!ret) {
                 return ERR_FILE_OPEN;
         }
-        target = &target_serial;
+        prog_context_current()->target = &target_serial;
 
         return 0;
 }
@@ -698,6 +789,8 @@ void prog_gdb_close(int pid)
 
 int prog_set_uart_boot_loader(uint8_t *buf, size_t size)
 {
+        const target_interface_t *target = get_target();
+
         boot_loader = realloc(boot_loader, size);
 
         if (boot_loader == NULL) {
@@ -712,6 +805,7 @@ int prog_set_uart_boot_loader(uint8_t *buf, size_t size)
 
 int prog_set_uart_boot_loader_from_file(const char *file_name)
 {
+        const target_interface_t *target = get_target();
         FILE *f;
         struct stat st;
         int err = 0;
@@ -745,15 +839,26 @@ end:
         return err;
 }
 
-static void print_log(char buf_msg[], const char *msg, va_list *args)
+static void print_log(bool err, const char *msg, va_list *args)
 {
+        prog_context_t *ctx = prog_context_current();
+
         if (gdb_gui_mode) {
-                vsprintf(buf_msg, msg, *args);
-        } else {
-                FILE *to = (buf_msg == stderr_msg) ? stderr : stdout;
+                vsnprintf(err ? ctx->stderr_msg : ctx->stdout_msg, PROG_CONTEXT_MSG_SIZE, msg,
+                                                                                        *args);
+        } else if (ctx->name[0] == '\0') {
+                FILE *to = err ? stderr : stdout;
 
                 vfprintf(to, msg, *args);
                 fflush(to);
+        } else {
+                /* format whole message first so messages of different devices don't mix */
+                FILE *to = err ? stderr : stdout;
+                char buf[256];
+
+                vsnprintf(buf, sizeof(buf), msg, *args);
+                fprintf(to, "[%s] %s", ctx->name, buf);
+                fflush(to);
         }
 }
 
@@ -762,7 +867,7 @@ void prog_print_log(const char *msg, ...)
         va_list args;
         va_start(args, msg);
 
-        print_log(stdout_msg, msg, &args);
+        print_log(false, msg, &args);
         va_end(args);
 }
 
@@ -771,12 +876,13 @@ void prog_print_err(const char *msg, ...)
         va_list args;
         va_start(args, msg);
 
-        print_log(stderr_msg, msg, &args);
+        print_log(true, msg, &args);
         va_end(args);
 }
 
 int prog_write_to_ram(uint32_t ram_address, const uint8_t *buf, uint32_t size)
 {
+        const target_interface_t *target = get_target();
         const uint8_t MAX_RETRY_COUNT = 10;
         int err = 0;
         uint32_t offset = 0;
@@ -786,7 +892,7 @@ int prog_write_to_ram(uint32_t ram_address, const uint8_t *buf, uint32_t size)
                 uint32_t chunk_size = size - offset;
 
                 if (retry_cnt > MAX_RETRY_COUNT) {
-                        prog_print_err(stderr_msg, "Write to RAM failed. Abort.\r\n");
+                        prog_print_err("Write to RAM failed. Abort.\r\n");
                         return err;
                 }
 
@@ -845,12 +951,166 @@ end:
         return err;
 }
 
-int prog_write_to_qspi(uint32_t flash_address, const uint8_t *buf, uint32_t size)
+static unsigned int get_window_size(void)
+{
+        const target_interface_t *target = get_target();
+
+        if (!target->get_window_size) {
+                return 1;
+        }
+
+        return target->get_window_size();
+}
+
+/*
+ * Write FLASH using windowed transfer. Each chunk ends at the sector boundary, so all chunks of
+ * the window are written to different sectors.
+ */
+static int write_flash_windowed(uint8_t mem, uint32_t flash_address, const uint8_t *buf,
+                                                        uint32_t size, unsigned int window_size)
 {
+        const target_interface_t *target = get_target();
+        window_chunk_t chunks[WINDOW_MAX_CHUNKS];
+        unsigned int count;
+        uint32_t offset = 0;
+        uint32_t window_len;
+        uint8_t retry_cnt = 0;
+        int err = 0;
+
+        while (offset < size) {
+                if (retry_cnt > 1) {
+                        err = (mem == PROTOCOL_MEM_OQSPI) ? ERR_PROG_OQSPI_WRITE :
+                                                                        ERR_PROG_QSPI_WRITE;
+                        prog_print_err("Windowed write to flash failed. Abort. \n");
+                        goto done;
+                }
+
+                window_len = 0;
+                for (count = 0; count < window_size && offset + window_len < size; count++) {
+                        uint32_t address = flash_address + offset + window_len;
+                        uint32_t chunk_size = size - offset - window_len;
+
+                        if ((address & FLASH_ERASE_MASK) + chunk_size >
+                                                                PROTOCOL_WINDOW_CHUNK_SIZE) {
+                                chunk_size = PROTOCOL_WINDOW_CHUNK_SIZE -
+                                                                (address & FLASH_ERASE_MASK);
+                        }
+
+                        chunks[count].buf = buf + offset + window_len;
+                        chunks[count].addr = address;
+                        chunks[count].len = (uint16_t) chunk_size;
+                        window_len += chunk_size;
+                }
+
+                prog_print_log("Writing to address: 0x%08x offset: 0x%08x window size: 0x%08x "
+                                        "(%u chunks)\n", flash_address, offset, window_len, count);
+
+                err = target->cmd_window_write(mem, chunks, count, true);
+                if (err != 0) {
+                        prog_print_log("Writing window to flash address 0x%x failed (%d). "
+                                        "Retrying ...\n", flash_address + offset, err);
+                        retry_cnt++;
+                        continue;
+                }
+                retry_cnt = 0;
+                offset += window_len;
+        }
+
+done:
+        return err;
+}
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len);
+
+/*
+ * Write FLASH skipping sectors which already contain requested data. Digests of sectors touched
+ * by the range are read from the device and compared with the ones calculated for \p buf, only
+ * runs of differing sectors are passed to \p write. Whole range is written if the device doesn't
+ * support FLASH digests.
+ */
+static int write_flash_differential(uint8_t mem, uint32_t flash_address, const uint8_t *buf,
+                        uint32_t size, int (*write)(uint32_t, const uint8_t *, uint32_t))
+{
+        const target_interface_t *target = get_target();
+        uint32_t digests[FLASH_DIGEST_BATCH_SIZE / FLASH_DIGEST_SECTOR_SIZE + 1];
+        uint32_t offset = 0;
+        uint32_t run_offset = 0;
+        uint32_t run_len = 0;
+        uint32_t skipped = 0;
+        int err = 0;
+
+        if (!flash_diff_write || !target->cmd_get_flash_digests || size == 0) {
+                return write(flash_address, buf, size);
+        }
+
+        while (offset < size) {
+                const uint32_t batch_end = offset + (size - offset > FLASH_DIGEST_BATCH_SIZE ?
+                                                        FLASH_DIGEST_BATCH_SIZE : size - offset);
+                uint32_t i = 0;
+
+                err = target->cmd_get_flash_digests(mem, flash_address + offset,
+                                                                batch_end - offset, digests);
+                if (err == ERR_PROT_CMD_REJECTED && offset == 0) {
+                        /* uartboot doesn't support digests, write everything */
+                        return write(flash_address, buf, size);
+                }
+
+                if (err != 0) {
+                        goto done;
+                }
+
+                for (; offset < batch_end; i++) {
+                        uint32_t len = FLASH_DIGEST_SECTOR_SIZE -
+                                        ((flash_address + offset) & (FLASH_DIGEST_SECTOR_SIZE - 1));
+
+                        if (len > batch_end - offset) {
+                                len = batch_end - offset;
+                        }
+
+                        if ((crc32_update(~0, buf + offset, len) ^ ~0) != digests[i]) {
+                                if (run_len == 0) {
+                                        run_offset = offset;
+                                }
+                                run_len += len;
+                        } else {
+                                skipped += len;
+                                if (run_len > 0) {
+                                        err = write(flash_address + run_offset, buf + run_offset,
+                                                                                        run_len);
+                                        if (err != 0) {
+                                                goto done;
+                                        }
+                                        run_len = 0;
+                                }
+                        }
+
+                        offset += len;
+                }
+        }
+
+        if (run_len > 0) {
+                err = write(flash_address + run_offset, buf + run_offset, run_len);
+        }
+
+        prog_print_log("Skipped 0x%08x of 0x%08x bytes already present in flash\n", skipped, size);
+
+done:
+        return err;
+}
+
+static int write_qspi(uint32_t flash_address, const uint8_t *buf, uint32_t size)
+{
+        const target_interface_t *target = get_target();
+        unsigned int window_size = get_window_size();
         int err = 0;
         uint32_t offset = 0;
         uint8_t retry_cnt = 0;
 
+        if (window_size > 1) {
+                return write_flash_windowed(PROTOCOL_MEM_QSPI, flash_address, buf, size,
+                                                                                window_size);
+        }
+
         while (offset < size) {
                 uint32_t chunk_size = size - offset;
 
@@ -891,6 +1151,11 @@ done:
         return err;
 }
 
+int prog_write_to_qspi(uint32_t flash_address, const uint8_t *buf, uint32_t size)
+{
+        return write_flash_differential(PROTOCOL_MEM_QSPI, flash_address, buf, size, write_qspi);
+}
+
 int prog_write_file_to_qspi(uint32_t flash_address, const char *file_name, uint32_t size)
 {
         int err = 0;
@@ -943,11 +1208,12 @@ end:
 
 int prog_erase_qspi(uint32_t flashAddress, uint32_t size)
 {
-        return target->cmd_erase_qspi(flashAddress, size);
+        return get_target()->cmd_erase_qspi(flashAddress, size);
 }
 
 int prog_read_memory(uint32_t mem_address, uint8_t *buf, uint32_t size)
 {
+        const target_interface_t *target = get_target();
         const uint8_t MAX_RETRY_COUNT = 10;
         int err = 0;
         uint32_t offset = 0;
@@ -957,7 +1223,7 @@ int prog_read_memory(uint32_t mem_address, uint8_t *buf, uint32_t size)
                 uint32_t chunk_size = size - offset;
 
                 if (retry_cnt > MAX_RETRY_COUNT) {
-                        prog_print_err(stderr_msg, "Reading from RAM failed. Abort.\r\n");
+                        prog_print_err("Reading from RAM failed. Abort.\r\n");
                         return err;
                 }
 
@@ -1017,11 +1283,12 @@ end:
 
 int prog_copy_to_qspi(uint32_t mem_address, uint32_t flash_address, uint32_t size)
 {
-        return target->cmd_copy_to_qspi(mem_address, size, flash_address);
+        return get_target()->cmd_copy_to_qspi(mem_address, size, flash_address);
 }
 
 int prog_chip_erase_qspi(void)
 {
+        const target_interface_t *target = get_target();
         const char *chip_rev;
 
         prog_get_chip_rev(&chip_rev);
@@ -1037,7 +1304,7 @@ int prog_chip_erase_qspi(void)
 
 int prog_chip_erase_qspi_by_addr(uint32_t flashAddress)
 {
-        return target->cmd_chip_erase_qspi(flashAddress);
+        return get_target()->cmd_chip_erase_qspi(flashAddress);
 }
 
 int prog_write_file_to_otp(uint32_t otp_address, const char *file_name, uint32_t size)
@@ -1098,7 +1365,7 @@ int prog_write_file_to_otp(uint32_t otp_address, const char *file_name, uint32_t
 
 int write_otp_64(uint32_t address, const uint32_t *buf, uint32_t len)
 {
-
+        const target_interface_t *target = get_target();
         unsigned int i;
         int err = 0;
         uint32_t *read_buf = NULL;
@@ -1217,6 +1484,7 @@ int write_otp_64(uint32_t address, const uint32_t *buf, uint32_t len)
 
 int write_otp_32(uint32_t address, const uint32_t *buf, uint32_t len)
 {
+        const target_interface_t *target = get_target();
         unsigned int i;
         int err = 0;
         uint32_t *read_buf = NULL;
@@ -1326,11 +1594,12 @@ int prog_write_otp(uint32_t address, const uint32_t *buf, uint32_t len)
 
 int prog_read_otp(uint32_t address, uint32_t *buf, uint32_t len)
 {
-        return target->cmd_read_otp(address, buf, len);
+        return get_target()->cmd_read_otp(address, buf, len);
 }
 
 int prog_write_tcs(uint32_t *address, const uint32_t *buf, uint32_t len)
 {
+        const target_interface_t *target = get_target();
         int err = 0;
         unsigned int i;
         uint32_t *read_buf;
@@ -1382,6 +1651,7 @@ done:
 
 int prog_read_qspi(uint32_t address, uint8_t *buf, uint32_t len)
 {
+        const target_interface_t *target = get_target();
         uint32_t offset = 0;
         int err = 0;
 
@@ -1433,16 +1703,17 @@ end:
 
 int prog_is_empty_qspi(unsigned int size, unsigned int start_address, int *ret_number)
 {
-        return target->cmd_is_empty_qspi(size, start_address, ret_number);
+        return get_target()->cmd_is_empty_qspi(size, start_address, ret_number);
 }
 
 int prog_read_partition_table(uint8_t **buf, uint32_t *len)
 {
-        return target->cmd_read_partition_table(buf, len);
+        return get_target()->cmd_read_partition_table(buf, len);
 }
 
 int prog_read_partition(nvms_partition_id_t id, uint32_t address, uint8_t *buf, uint32_t len)
 {
+        const target_interface_t *target = get_target();
         uint32_t offset = 0;
         int err = 0;
 
@@ -1499,6 +1770,7 @@ end:
 int prog_write_partition(nvms_partition_id_t id, uint32_t part_address, const uint8_t *buf,
                                                                                 uint32_t size)
 {
+        const target_interface_t *target = get_target();
         int err = 0;
         uint32_t offset = 0;
         uint8_t retry_cnt = 0;
@@ -1604,6 +1876,7 @@ end:
 
 int prog_boot(uint8_t *executable_code, size_t executable_code_size)
 {
+        const target_interface_t *target = get_target();
         const char *chip_rev;
         prog_get_chip_rev(&chip_rev);
 
@@ -1634,6 +1907,7 @@ int prog_boot(uint8_t *executable_code, size_t executable_code_size)
 
 int prog_run(uint8_t *executable_code, size_t executable_code_size)
 {
+        const target_interface_t *target = get_target();
         int err;
 
         if (executable_code_size == 0) {
@@ -1654,7 +1928,7 @@ int prog_run(uint8_t *executable_code, size_t executable_code_size)
 
 int prog_upload_bootloader(void)
 {
-        return target->cmd_upload_bootloader();
+        return get_target()->cmd_upload_bootloader();
 }
 
 int prog_mass_erase_eflash(void)
@@ -1662,12 +1936,19 @@ int prog_mass_erase_eflash(void)
         return ERR_CMD_UNSUPPORTED;
 }
 
-int prog_write_to_oqspi(uint32_t flash_address, const uint8_t *buf, uint32_t size)
+static int write_oqspi(uint32_t flash_address, const uint8_t *buf, uint32_t size)
 {
+        const target_interface_t *target = get_target();
+        unsigned int window_size = get_window_size();
         int err = 0;
         uint32_t offset = 0;
         uint8_t retry_cnt = 0;
 
+        if (window_size > 1) {
+                return write_flash_windowed(PROTOCOL_MEM_OQSPI, flash_address, buf, size,
+                                                                                window_size);
+        }
+
         while (offset < size) {
                 uint32_t chunk_size = size - offset;
 
@@ -1708,6 +1989,11 @@ done:
         return err;
 }
 
+int prog_write_to_oqspi(uint32_t flash_address, const uint8_t *buf, uint32_t size)
+{
+        return write_flash_differential(PROTOCOL_MEM_OQSPI, flash_address, buf, size, write_oqspi);
+}
+
 int prog_write_file_to_oqspi(uint32_t flash_address, const char *file_name, uint32_t size)
 {
         int err = 0;
@@ -1760,21 +2046,22 @@ end:
 
 int prog_erase_oqspi(uint32_t flashAddress, uint32_t size)
 {
-        return target->cmd_erase_oqspi(flashAddress, size);
+        return get_target()->cmd_erase_oqspi(flashAddress, size);
 }
 
 int prog_is_empty_oqspi(unsigned int size, unsigned int start_address, int *ret_number)
 {
-        return target->cmd_is_empty_oqspi(size, start_address, ret_number);
+        return get_target()->cmd_is_empty_oqspi(size, start_address, ret_number);
 }
 
 int prog_copy_to_oqspi(uint32_t mem_address, uint32_t flash_address, uint32_t size)
 {
-        return target->cmd_copy_to_oqspi(mem_address, size, flash_address);
+        return get_target()->cmd_copy_to_oqspi(mem_address, size, flash_address);
 }
 
 int prog_chip_erase_oqspi(void)
 {
+        const target_interface_t *target = get_target();
         const char *chip_rev;
 
         prog_get_chip_rev(&chip_rev);
@@ -1789,11 +2076,12 @@ int prog_chip_erase_oqspi(void)
 
 int prog_chip_erase_oqspi_by_addr(uint32_t flashAddress)
 {
-        return target->cmd_chip_erase_oqspi(flashAddress);
+        return get_target()->cmd_chip_erase_oqspi(flashAddress);
 }
 
 int prog_read_oqspi(uint32_t address, uint8_t *buf, uint32_t len)
 {
+        const target_interface_t *target = get_target();
         uint32_t offset = 0;
         int err = 0;
 
@@ -1845,6 +2133,8 @@ end:
 
 const char* prog_get_err_message(int err_int)
 {
+        prog_context_t *ctx = prog_context_current();
+
         switch (err_int) {
         case ERR_FAILED:
                 return "general error";
@@ -1912,13 +2202,13 @@ const char* prog_get_err_message(int err_int)
                 return "Command unsupported by target";
 
         case MSG_FROM_STDOUT:
-                strcpy(copy_stdout_msg, stdout_msg);
-                stdout_msg[0] = 0;
-                return (const char*) copy_stdout_msg;
+                strcpy(ctx->copy_stdout_msg, ctx->stdout_msg);
+                ctx->stdout_msg[0] = 0;
+                return (const char*) ctx->copy_stdout_msg;
         case MSG_FROM_STDERR:
-                strcpy(copy_stderr_msg, stderr_msg);
-                stderr_msg[0] = 0;
-                return (const char*) copy_stderr_msg;
+                strcpy(ctx->copy_stderr_msg, ctx->stderr_msg);
+                ctx->stderr_msg[0] = 0;
+                return (const char*) ctx->copy_stderr_msg;
 
         default:
                 return "unknown error";
@@ -1976,14 +2266,12 @@ int prog_uartboot_patch_config(const prog_uartboot_config_t * uartboot_config)
 
 void prog_close_interface(int data)
 {
-        if (target) {
-                target->close(data);
-        }
+        get_target()->close(data);
 }
 
 int DLLEXPORT prog_gdb_open(const prog_gdb_server_config_t *gdb_server_conf)
 {
-        target = &target_gdb_server;
+        prog_context_current()->target = &target_gdb_server;
 
         return gdb_server_initialization(gdb_server_conf);
 }
@@ -1996,8 +2284,9 @@ int DLLEXPORT prog_gdb_mode(int mode)
         } else {
                 if (mode & GDB_MODE_GUI) {
                         gdb_gui_mode = true;
-                        stdout_msg[0] = 0;      // empty last known stdout msg buffer
-                        stderr_msg[0] = 0;      // empty last known stderr msg buffer
+                        // empty last known stdout and stderr msg buffers
+                        prog_context_current()->stdout_msg[0] = 0;
+                        prog_context_current()->stderr_msg[0] = 0;
                         if (mode & GDB_MODE_INVALIDATE_STUB) {  // Invalidate downloaded stub
                                 gdb_invalidate_stub();
                         }
@@ -2023,6 +2312,26 @@ unsigned int get_uart_timeout(void)
         return uartTimeoutInMs;
 }
 
+void prog_set_protocol_window(unsigned int chunks)
+{
+        protocol_set_window_size(chunks);
+}
+
+void prog_set_max_baudrate(unsigned int baudrate)
+{
+        protocol_set_max_baudrate(baudrate);
+}
+
+void prog_set_flash_diff_write(bool enable)
+{
+        flash_diff_write = enable;
+}
+
+void prog_set_compressed_transfer(bool enable)
+{
+        protocol_set_compression(enable);
+}
+
 static int fill_chip_id_regs(uint32_t id_regs[5])
 {
         const prog_chip_regs_t *chip_regs;
@@ -2044,6 +2353,7 @@ static int fill_chip_id_regs(uint32_t id_regs[5])
 
 int prog_read_chip_info(chip_info_t *chip_info)
 {
+        const target_interface_t *target = get_target();
         uint32_t id_regs[5];
         uint8_t id[5] = { 0 };
         uint32_t chip_otp_id[OTP_HEADER_CHIP_ID_LEN >> 2] = { 0 };
@@ -2149,6 +2459,7 @@ int prog_read_chip_info(chip_info_t *chip_info)
 
 int prog_read_flash_info(flash_info_t *flash_info)
 {
+        const target_interface_t *target = get_target();
         int err = 0;
 
         err = target->cmd_get_qspi_state(flash_info->qspic_id, &flash_info->qspi_flash_info);
@@ -2163,11 +2474,13 @@ int prog_read_flash_info(flash_info_t *flash_info)
 
 int prog_get_product_info(uint8_t **buf, uint32_t *len)
 {
-        return target->cmd_get_product_info(buf, len);
+        return get_target()->cmd_get_product_info(buf, len);
 }
 
 int prog_gdb_direct_read(uint32_t mem_address, uint8_t *buf, uint32_t size)
 {
+        const target_interface_t *target = get_target();
+
         if (target != &target_gdb_server) {
                 return ERR_FAILED;
         }
@@ -2177,6 +2490,7 @@ int prog_gdb_direct_read(uint32_t mem_address, uint8_t *buf, uint32_t size)
 
 int prog_gdb_read_chip_rev(char *chip_rev)
 {
+        const target_interface_t *target = get_target();
         uint32_t id_regs[5];
         uint8_t id[5] = { 0 };
         int i;
@@ -2663,7 +2977,7 @@ void prog_set_target_reset_cmd(const char *trc)
 
 int prog_gdb_connect(const char *host_name, int port)
 {
-        target = &target_gdb_server;
+        prog_context_current()->target = &target_gdb_server;
 
         return gdb_server_connect(host_name, port);
 }
@@ -2686,5 +3000,5 @@ void prog_get_version(uint32_t *major, uint32_t *minor)
 
 connection_status_t prog_verify_connection(void)
 {
-        return target->verify_connection();
+        return get_target()->verify_connection();
 }
@@ -19,6 +19,8 @@
 #include <string.h>
 #include "protocol.h"
 #include "crc16.h"
+#include "lz_block.h"
+#include "prog_context.h"
 #include "serial.h"
 #include "protocol_cmds.h"
 
@@ -47,9 +49,32 @@ struct write_buf {
         size_t len;
 };
 
+/* Maximum number of windowed transfer rounds needed to deliver a single window */
+#define WINDOW_MAX_ROUNDS       3
+
 static uint8_t *boot_loader_code;
 static size_t boot_loader_size;
 
+/* Number of chunks in flight requested by the user */
+static unsigned int window_requested = PROTOCOL_DEFAULT_WINDOW_SIZE;
+
+/* Compressed transfer is requested by the user */
+static bool compression_enabled = true;
+
+/* Highest baud rate negotiated with uartboot after upload, 0 disables negotiation */
+static unsigned int baudrate_max;
+
+/* Baud rates tried when negotiating with uartboot, fastest first */
+static const unsigned int baudrate_candidates[] = {
+        3000000, 2000000, 1000000, 921600, 500000, 230400, 115200
+};
+
+/* Number of CMD_GET_VERSION exchanges which must pass at a new baud rate */
+#define BAUDRATE_PROBE_COUNT    3
+
+/* First uartboot version (BCD) accepting baud rates above 1 Mbaud and verified rate changes */
+#define UARTBOOT_BAUDRATE_NEGOTIATION_VERSION   (0x0008)
+
 void set_boot_loader_code(uint8_t *code, size_t size)
 {
         boot_loader_code = code;
@@ -431,6 +456,108 @@ done:
         return ret;
 }
 
+/*
+ * Compress data to LZ4 block. Returns length of compressed data, or 0 if data isn't compressible.
+ * Compressed block is decompressed back to make sure that the device will get the same data.
+ */
+static size_t compress_chunk(const uint8_t *buf, size_t size, uint8_t *packed)
+{
+        uint8_t *check_buf;
+        size_t packed_len;
+
+        packed_len = lz_block_compress(buf, size, packed, size - 1);
+        if (packed_len == 0) {
+                return 0;
+        }
+
+        check_buf = (uint8_t *) malloc(size);
+        if (check_buf == NULL) {
+                return 0;
+        }
+
+        if (lz_block_decompress(packed, packed_len, check_buf, size) != (int) size ||
+                                                                memcmp(check_buf, buf, size)) {
+                packed_len = 0;
+        }
+
+        free(check_buf);
+
+        return packed_len;
+}
+
+/*
+ * Write data to FLASH using CMD_WRITE_COMPRESSED. Returns 1 if data should be sent uncompressed
+ * instead (not compressible or command not supported by uartboot).
+ */
+static int write_compressed(uint8_t mem, const uint8_t *buf, size_t size, uint32_t addr,
+                                                                                bool verify)
+{
+        prog_context_t *ctx = prog_context_current();
+        uint8_t header_buf[8];
+        struct write_buf wb[2];
+        uint8_t *packed;
+        size_t packed_len;
+        int err = 1;
+
+        if (!compression_enabled || ctx->compression_rejected || size < 2 || size > UINT16_MAX) {
+                return 1;
+        }
+
+        packed = (uint8_t *) malloc(size);
+        if (packed == NULL) {
+                return 1;
+        }
+
+        packed_len = compress_chunk(buf, size, packed);
+        if (packed_len == 0) {
+                goto done;
+        }
+
+        err = send_cmd_header(CMD_WRITE_COMPRESSED, sizeof(header_buf) + packed_len);
+        if (err == ERR_PROT_CMD_REJECTED) {
+                prog_print_log("Compressed transfer not supported by uartboot\n");
+                ctx->compression_rejected = true;
+                err = 1;
+                goto done;
+        }
+
+        if (err < 0) {
+                goto done;
+        }
+
+        header_buf[0] = mem;
+        header_buf[1] = (uint8_t) (verify);
+        header_buf[2] = (uint8_t) (addr);
+        header_buf[3] = (uint8_t) (addr >> 8);
+        header_buf[4] = (uint8_t) (addr >> 16);
+        header_buf[5] = (uint8_t) (addr >> 24);
+        header_buf[6] = (uint8_t) (size);
+        header_buf[7] = (uint8_t) (size >> 8);
+
+        wb[0].buf = header_buf;
+        wb[0].len = sizeof(header_buf);
+        wb[1].buf = packed;
+        wb[1].len = packed_len;
+        err = send_cmd_data(wb, 2);
+        if (err == ERR_PROT_CMD_REJECTED) {
+                /* decompressed data doesn't fit in uartboot buffer, don't try again */
+                prog_print_log("Compressed chunk rejected by uartboot\n");
+                ctx->compression_rejected = true;
+                err = 1;
+                goto done;
+        }
+
+        if (err < 0) {
+                goto done;
+        }
+
+        err = wait_for_ack(EXECUTION_TIMEOUT);
+
+done:
+        free(packed);
+        return err;
+}
+
 int protocol_cmd_write(const uint8_t *buf, size_t size, uint32_t addr)
 {
         uint8_t header_buf[4];
@@ -539,6 +666,11 @@ int protocol_cmd_direct_write_to_qspi(const uint8_t *buf, size_t size, uint32_t
         struct write_buf wb[2];
         int err;
 
+        err = write_compressed(PROTOCOL_MEM_QSPI, buf, size, addr, verify);
+        if (err <= 0) {
+                return err;
+        }
+
         err = send_cmd_header(CMD_DIRECT_WRITE_TO_QSPI, sizeof(header_buf) + size);
         if (err < 0) {
                 return err;
@@ -1006,15 +1138,206 @@ int protocol_cmd_boot(uint8_t *executable_code, size_t executable_code_size)
         return protocol_upload_executable(executable_code, executable_code_size);
 }
 
+/* discard anything received while host and device were switching baud rate */
+static void discard_input(void)
+{
+        uint8_t buf[64];
+
+        while (serial_read(buf, sizeof(buf), 20) > 0) {
+        }
+}
+
+/* check that link works reliably, CMD_GET_VERSION without payload is supported by any uartboot */
+static int probe_link(void)
+{
+        uint8_t *resp;
+        uint32_t len;
+        int err = 0;
+        int i;
+
+        for (i = 0; i < BAUDRATE_PROBE_COUNT; i++) {
+                err = send_cmd_header(CMD_GET_VERSION, 0);
+                if (err < 0) {
+                        break;
+                }
+
+                err = wait_for_ack(300);
+                if (err < 0) {
+                        break;
+                }
+
+                err = read_cmd_dynamic_length(&resp, &len);
+                if (err < 0) {
+                        break;
+                }
+
+                free(resp);
+        }
+
+        return err;
+}
+
+/**
+ * \brief Switch uartboot and host to new baud rate
+ *
+ * uartboot acknowledges the command at the old rate and sends the final ACK at the new one. Host
+ * can't reliably switch before that ACK arrives, so it is not waited for. The link should be
+ * probed at the new rate afterwards.
+ *
+ * \param [in] baudrate new baud rate
+ *
+ * \return 0 if the command was accepted and host switched to the new rate
+ *         ERR_PROT_CMD_REJECTED if uartboot doesn't support the rate (both stay at the old one)
+ *         other error code if state of uartboot is unknown
+ *
+ */
+static int change_baudrate(unsigned int baudrate)
+{
+        uint8_t header_buf[4];
+        struct write_buf wb[1];
+        int err;
+
+        err = send_cmd_header(CMD_CHANGE_BAUDRATE, sizeof(header_buf));
+        if (err < 0) {
+                return err;
+        }
+
+        header_buf[0] = (uint8_t) (baudrate);
+        header_buf[1] = (uint8_t) (baudrate >> 8);
+        header_buf[2] = (uint8_t) (baudrate >> 16);
+        header_buf[3] = (uint8_t) (baudrate >> 24);
+
+        wb[0].buf = header_buf;
+        wb[0].len = sizeof(header_buf);
+
+        err = send_cmd_data(wb, 1);
+        if (err < 0) {
+                return err;
+        }
+
+        if (serial_set_baudrate(baudrate) < 0) {
+                return ERR_PROT_TRANSMISSION_ERROR;
+        }
+
+        discard_input();
+
+        return 0;
+}
+
+/*
+ * Go back to baud rate which worked after link failed at the new one. uartboot may be using any
+ * of them, depending on which part of the exchange got corrupted, so both are tried.
+ */
+static int restore_baudrate(int baudrate, int failed_baudrate)
+{
+        prog_context_t *ctx = prog_context_current();
+        int i;
+
+        for (i = 0; i < BAUDRATE_PROBE_COUNT; i++) {
+                if (ctx->serial_baudrate != failed_baudrate) {
+                        serial_set_baudrate(failed_baudrate);
+                }
+                discard_input();
+                if (change_baudrate(baudrate) == 0 && probe_link() == 0) {
+                        return 0;
+                }
+
+                if (ctx->serial_baudrate != baudrate) {
+                        serial_set_baudrate(baudrate);
+                }
+                discard_input();
+                if (probe_link() == 0) {
+                        return 0;
+                }
+        }
+
+        return ERR_PROT_NO_RESPONSE;
+}
+
+/*
+ * Find the highest baud rate, up to baudrate_max, which both uartboot and the serial adapter
+ * handle reliably. Rates rejected by uartboot or failing the probe are skipped.
+ */
+static int negotiate_baudrate(void)
+{
+        prog_context_t *ctx = prog_context_current();
+        int baudrate = ctx->serial_baudrate;
+        size_t i;
+        int err;
+
+        for (i = 0; i < sizeof(baudrate_candidates) / sizeof(baudrate_candidates[0]); i++) {
+                const unsigned int candidate = baudrate_candidates[i];
+
+                if (candidate > baudrate_max || candidate <= (unsigned int) baudrate) {
+                        continue;
+                }
+
+                err = change_baudrate(candidate);
+                if (err == ERR_PROT_CMD_REJECTED) {
+                        continue;
+                }
+
+                if (err == 0 && probe_link() == 0) {
+                        prog_print_log("Negotiated baud rate %u with uartboot.\n", candidate);
+                        return 0;
+                }
+
+                prog_print_log("Baud rate %u is not stable.\n", candidate);
+                err = restore_baudrate(baudrate, candidate);
+                if (err < 0) {
+                        prog_print_err("Lost connection with uartboot while changing baud "
+                                                                                "rate.\n");
+                        return err;
+                }
+        }
+
+        prog_print_log("Keeping baud rate %d.\n", baudrate);
+
+        return 0;
+}
+
 int protocol_cmd_upload_bootloader(void)
 {
+        prog_context_t *ctx = prog_context_current();
+        int version;
         int status;
 
+        /* new uartboot instance has to be asked again */
+        ctx->window_granted = 0;
+        ctx->compression_rejected = false;
+
         status = protocol_upload_executable(boot_loader_code, boot_loader_size);
         if (status != 0) {
                 return status;
         }
 
+        /* hello message of started uartboot carries its version */
+        version = get_boot_stage(get_uart_timeout());
+        if (version < 0) {
+                return version;
+        } else if (version == 0) {
+                return ERR_PROT_UNSUPPORTED_VERSION;
+        }
+
+        if (!baudrate_max) {
+                return 0;
+        }
+
+        if (version < UARTBOOT_BAUDRATE_NEGOTIATION_VERSION) {
+                prog_print_log("uartboot version %04X doesn't support baud rate negotiation.\n",
+                                                                                        version);
+                return 0;
+        }
+
+        /* hello messages sent before the first command are not responses */
+        discard_input();
+
+        status = negotiate_baudrate();
+        if (status != 0) {
+                return status;
+        }
+
+        /* uartboot is back to hello messages, at the new baud rate, when no command follows */
         status = get_boot_stage(get_uart_timeout());
         if (status < 0) {
                 return status;
@@ -1086,6 +1409,11 @@ int protocol_cmd_direct_write_to_oqspi(const uint8_t *buf, size_t size, uint32_t
         struct write_buf wb[2];
         int err;
 
+        err = write_compressed(PROTOCOL_MEM_OQSPI, buf, size, addr, verify);
+        if (err <= 0) {
+                return err;
+        }
+
         err = send_cmd_header(CMD_DIRECT_WRITE_TO_OQSPI, sizeof(header_buf) + size);
         if (err < 0) {
                 return err;
@@ -1295,6 +1623,296 @@ int protocol_cmd_get_product_info(uint8_t **buf, uint32_t *len)
         return err;
 }
 
+void protocol_set_compression(bool enable)
+{
+        compression_enabled = enable;
+}
+
+void protocol_set_window_size(unsigned int chunks)
+{
+        prog_context_t *ctx = prog_context_current();
+
+        if (chunks > WINDOW_MAX_CHUNKS) {
+                chunks = WINDOW_MAX_CHUNKS;
+        }
+
+        window_requested = chunks;
+        ctx->window_granted = 0;
+}
+
+unsigned int protocol_get_window_size(void)
+{
+        prog_context_t *ctx = prog_context_current();
+        uint8_t header_buf[3];
+        struct write_buf wb[1];
+        uint8_t *resp = NULL;
+        uint32_t len;
+        size_t str_len;
+        int err;
+
+        if (window_requested <= 1) {
+                return 1;
+        }
+
+        if (ctx->window_granted) {
+                return ctx->window_granted;
+        }
+
+        /* assume legacy uartboot, it rejects CMD_GET_VERSION with payload */
+        ctx->window_granted = 1;
+        ctx->window_caps = 0;
+
+        err = send_cmd_header(CMD_GET_VERSION, sizeof(header_buf));
+        if (err < 0) {
+                goto done;
+        }
+
+        header_buf[0] = (uint8_t) (window_requested);
+        header_buf[1] = (uint8_t) (PROTOCOL_WINDOW_CHUNK_SIZE);
+        header_buf[2] = (uint8_t) (PROTOCOL_WINDOW_CHUNK_SIZE >> 8);
+
+        wb[0].buf = header_buf;
+        wb[0].len = sizeof(header_buf);
+
+        err = send_cmd_data(wb, 1);
+        if (err < 0) {
+                goto done;
+        }
+
+        err = wait_for_ack(EXECUTION_TIMEOUT);
+        if (err < 0) {
+                goto done;
+        }
+
+        err = read_cmd_dynamic_length(&resp, &len);
+        if (err < 0) {
+                goto done;
+        }
+
+        /* version string with '\0' is followed by number of granted chunks and capabilities */
+        str_len = strnlen((const char *) resp, len);
+        if (str_len + 1 < len && resp[str_len + 1] > 1) {
+                ctx->window_granted = resp[str_len + 1];
+        }
+        if (str_len + 2 < len) {
+                ctx->window_caps = resp[str_len + 2];
+        }
+
+        free(resp);
+
+done:
+        prog_print_log("Windowed transfer: %u chunk(s) in flight\n", ctx->window_granted);
+
+        return ctx->window_granted;
+}
+
+void protocol_set_max_baudrate(unsigned int baudrate)
+{
+        baudrate_max = baudrate;
+}
+
+/* send frames of chunks which are marked in pending bitmap */
+static int send_window_frames(const window_chunk_t *chunks, const bool *compressed,
+                                                        unsigned int count, uint16_t pending)
+{
+        uint8_t frame_buf[8];
+        uint8_t crc_buf[2];
+        unsigned int i;
+        uint16_t crc;
+
+        for (i = 0; i < count; i++) {
+                const window_chunk_t *c = &chunks[i];
+
+                if (!(pending & (1 << i))) {
+                        continue;
+                }
+
+                frame_buf[0] = SOH;
+                frame_buf[1] = (uint8_t) (i | (compressed[i] ? WINDOW_SEQ_COMPRESSED : 0));
+                frame_buf[2] = (uint8_t) (c->len);
+                frame_buf[3] = (uint8_t) (c->len >> 8);
+                frame_buf[4] = (uint8_t) (c->addr);
+                frame_buf[5] = (uint8_t) (c->addr >> 8);
+                frame_buf[6] = (uint8_t) (c->addr >> 16);
+                frame_buf[7] = (uint8_t) (c->addr >> 24);
+
+                /* SOH is not covered by CRC */
+                crc16_init(&crc);
+                crc16_update(&crc, frame_buf + 1, sizeof(frame_buf) - 1);
+                crc16_update(&crc, c->buf, c->len);
+
+                crc_buf[0] = (uint8_t) (crc);
+                crc_buf[1] = (uint8_t) (crc >> 8);
+
+                if (serial_write(frame_buf, sizeof(frame_buf)) < 0 ||
+                                        serial_write(c->buf, c->len) < 0 ||
+                                        serial_write(crc_buf, sizeof(crc_buf)) < 0) {
+                        return ERR_PROT_TRANSMISSION_ERROR;
+                }
+        }
+
+        return 0;
+}
+
+int protocol_cmd_window_write(uint8_t mem, const window_chunk_t *chunks, unsigned int count,
+                                                                                        bool verify)
+{
+        prog_context_t *ctx = prog_context_current();
+        const uint16_t all_chunks = (uint16_t) ((1 << count) - 1);
+        window_chunk_t frames_data[WINDOW_MAX_CHUNKS];
+        bool compressed[WINDOW_MAX_CHUNKS] = { false };
+        uint8_t *packed = NULL;
+        uint16_t pending = all_chunks;
+        uint8_t header_buf[5];
+        uint8_t status_buf[3];
+        struct write_buf wb[1];
+        unsigned int round;
+        unsigned int frames;
+        unsigned int i;
+        int err = ERR_PROT_TRANSMISSION_ERROR;
+
+        if (count == 0 || count > ctx->window_granted) {
+                return ERR_PROT_COMMAND_ERROR;
+        }
+
+        memcpy(frames_data, chunks, count * sizeof(chunks[0]));
+
+        /* chunks which get smaller are sent compressed, the others are sent as they are */
+        if (compression_enabled && (ctx->window_caps & WINDOW_CAP_COMPRESSION)) {
+                packed = (uint8_t *) malloc(count * PROTOCOL_WINDOW_CHUNK_SIZE);
+        }
+
+        if (packed != NULL) {
+                for (i = 0; i < count; i++) {
+                        uint8_t *dst = packed + i * PROTOCOL_WINDOW_CHUNK_SIZE;
+                        size_t packed_len = compress_chunk(chunks[i].buf, chunks[i].len, dst);
+
+                        if (packed_len > 0) {
+                                frames_data[i].buf = dst;
+                                frames_data[i].len = (uint16_t) packed_len;
+                                compressed[i] = true;
+                        }
+                }
+        }
+
+        for (round = 0; round < WINDOW_MAX_ROUNDS; round++) {
+                frames = 0;
+                for (i = 0; i < count; i++) {
+                        if (pending & (1 << i)) {
+                                frames++;
+                        }
+                }
+
+                err = send_cmd_header(CMD_WINDOW_WRITE, sizeof(header_buf));
+                if (err < 0) {
+                        goto done;
+                }
+
+                header_buf[0] = mem;
+                header_buf[1] = (round == 0) ? WINDOW_FLAG_NEW : 0;
+                header_buf[2] = (uint8_t) (verify);
+                header_buf[3] = (uint8_t) (count);
+                header_buf[4] = (uint8_t) (frames);
+
+                wb[0].buf = header_buf;
+                wb[0].len = sizeof(header_buf);
+
+                err = send_cmd_data(wb, 1);
+                if (err < 0) {
+                        goto done;
+                }
+
+                err = send_window_frames(frames_data, compressed, count, pending);
+                if (err < 0) {
+                        goto done;
+                }
+
+                /* whole window is written to FLASH once the last chunk is received */
+                err = wait_for_ack(EXECUTION_TIMEOUT + 50 * count * PROTOCOL_WINDOW_CHUNK_SIZE /
+                                                                        QSPI_FLASH_PAGE_SIZE);
+                if (err < 0) {
+                        goto done;
+                }
+
+                err = read_cmd_data(status_buf, sizeof(status_buf));
+                if (err < 0) {
+                        goto done;
+                }
+
+                if (status_buf[2]) {
+                        goto done;
+                }
+
+                /* selective retransmission - only chunks which didn't pass CRC check */
+                pending = all_chunks & ~(status_buf[0] | (status_buf[1] << 8));
+                prog_print_log("Retransmitting window chunks 0x%04x\n", pending);
+                err = ERR_PROT_CRC_MISMATCH;
+        }
+
+done:
+        free(packed);
+        return err;
+}
+
+int protocol_cmd_get_flash_digests(uint8_t mem, uint32_t addr, uint32_t size, uint32_t *digests)
+{
+        const uint32_t count = (addr + size - 1) / FLASH_DIGEST_SECTOR_SIZE -
+                                                        addr / FLASH_DIGEST_SECTOR_SIZE + 1;
+        uint8_t header_buf[9];
+        struct write_buf wb[1];
+        uint8_t *buf;
+        uint32_t i;
+        int err;
+
+        buf = (uint8_t *) malloc(count * sizeof(uint32_t));
+        if (buf == NULL) {
+                return ERR_ALLOC_FAILED;
+        }
+
+        err = send_cmd_header(CMD_GET_FLASH_DIGESTS, sizeof(header_buf));
+        if (err < 0) {
+                goto done;
+        }
+
+        header_buf[0] = mem;
+        header_buf[1] = (uint8_t) (addr);
+        header_buf[2] = (uint8_t) (addr >> 8);
+        header_buf[3] = (uint8_t) (addr >> 16);
+        header_buf[4] = (uint8_t) (addr >> 24);
+        header_buf[5] = (uint8_t) (size);
+        header_buf[6] = (uint8_t) (size >> 8);
+        header_buf[7] = (uint8_t) (size >> 16);
+        header_buf[8] = (uint8_t) (size >> 24);
+
+        wb[0].buf = header_buf;
+        wb[0].len = sizeof(header_buf);
+
+        err = send_cmd_data(wb, 1);
+        if (err < 0) {
+                goto done;
+        }
+
+        /* whole range is read and hashed before the response is sent */
+        err = wait_for_ack(EXECUTION_TIMEOUT + size / 1024);
+        if (err < 0) {
+                goto done;
+        }
+
+        err = read_cmd_data(buf, count * sizeof(uint32_t));
+        if (err < 0) {
+                goto done;
+        }
+
+        for (i = 0; i < count; i++) {
+                digests[i] = buf[4 * i] | (buf[4 * i + 1] << 8) | (buf[4 * i + 2] << 16) |
+                                                                ((uint32_t) buf[4 * i + 3] << 24);
+        }
+
+done:
+        free(buf);
+        return err;
+}
+
 connection_status_t protocol_verify_connection(void)
 {
         int status;
@@ -40,8 +40,31 @@
  */
 #define PROTOCOL_WRITE_CHUNK_SIZE       (0x6000)
 
+/**
+ * Chunk size used by windowed transfer.
+ * Windowed chunk size limitations:
+ * - uartboot keeps all chunks of the window (plus one for verification) in its input buffer
+ * - FLASH erase size, so chunks of a window don't share the sector
+ */
+#define PROTOCOL_WINDOW_CHUNK_SIZE      (0x1000)
+
+/**
+ * Number of chunks in flight requested from uartboot by default.
+ */
+#define PROTOCOL_DEFAULT_WINDOW_SIZE    (8)
+
 #include "programmer.h"
 
+/**
+ * \brief Single chunk of windowed transfer
+ *
+ */
+typedef struct {
+        const uint8_t *buf;     /**< Chunk data */
+        uint32_t addr;          /**< Destination address (RAM address or offset in FLASH) */
+        uint16_t len;           /**< Chunk length, up to PROTOCOL_WINDOW_CHUNK_SIZE */
+} window_chunk_t;
+
 /**
  * \brief Set uart bootloader code for firmware update
  *
@@ -408,6 +431,83 @@ int protocol_cmd_get_oqspi_state(flash_dev_info_t *oqspi_flash_info);
  */
 int protocol_cmd_get_product_info(uint8_t **buf, uint32_t *len);
 
+/**
+ * \brief Enable or disable compressed transfer
+ *
+ * When enabled (default), data written directly to FLASH is compressed (LZ4 block format) if it
+ * makes it smaller and uartboot supports it.
+ *
+ * \param [in] enable true to compress data written to FLASH
+ *
+ */
+void protocol_set_compression(bool enable);
+
+/**
+ * \brief Set number of chunks in flight for windowed transfer
+ *
+ * Takes effect on next negotiation with uartboot. Value 0 or 1 disables windowed transfer.
+ *
+ * \param [in] chunks requested number of chunks, up to WINDOW_MAX_CHUNKS
+ *
+ */
+void protocol_set_window_size(unsigned int chunks);
+
+/**
+ * \brief Set highest baud rate negotiated with uartboot
+ *
+ * After uartboot is uploaded, host and uartboot switch to the fastest rate up to \p baudrate at
+ * which the link passes a probe. Rates which uartboot or serial adapter don't support are
+ * skipped. uartboot keeps using the negotiated rate until it is reset.
+ *
+ * \param [in] baudrate maximum baud rate, 0 disables negotiation
+ *
+ */
+void protocol_set_max_baudrate(unsigned int baudrate);
+
+/**
+ * \brief Get number of chunks in flight for windowed transfer
+ *
+ * Negotiates windowed mode with uartboot using CMD_GET_VERSION on first call. uartboot which
+ * doesn't support windowed mode rejects the request and 1 is returned (legacy transfer).
+ *
+ * \return number of chunks which can be passed to protocol_cmd_window_write()
+ *
+ */
+unsigned int protocol_get_window_size(void);
+
+/**
+ * \brief Write window of chunks to RAM, QSPI or OQSPI FLASH
+ *
+ * All chunks are streamed back-to-back. Chunks which are reported by uartboot as corrupted are
+ * retransmitted, and the whole window is written to memory once all of them are received.
+ *
+ * \param [in] mem destination memory (PROTOCOL_MEM_RAM, PROTOCOL_MEM_QSPI or PROTOCOL_MEM_OQSPI)
+ * \param [in] chunks chunks to be written
+ * \param [in] count number of chunks, up to value returned by protocol_get_window_size()
+ * \param [in] verify true for performing FLASH writing verification
+ *
+ * \return 0 on success, error code on failure
+ *
+ */
+int protocol_cmd_window_write(uint8_t mem, const window_chunk_t *chunks, unsigned int count,
+                                                                                bool verify);
+
+/**
+ * \brief Get CRC32 digests of FLASH range
+ *
+ * One digest is returned for each FLASH_DIGEST_SECTOR_SIZE sector touched by the range. Digest
+ * covers only the part of the sector which belongs to the range.
+ *
+ * \param [in]  mem FLASH memory (PROTOCOL_MEM_QSPI or PROTOCOL_MEM_OQSPI)
+ * \param [in]  addr start address in FLASH
+ * \param [in]  size size of the range in bytes, must not be 0
+ * \param [out] digests buffer for digests, one for each sector touched by the range
+ *
+ * \return 0 on success, error code on failure
+ *
+ */
+int protocol_cmd_get_flash_digests(uint8_t mem, uint32_t addr, uint32_t size, uint32_t *digests);
+
 /**
  * \brief Verify connection with device
  *
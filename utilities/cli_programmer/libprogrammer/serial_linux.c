@@ -13,176 +13,252 @@
  */
 
 #include <stdint.h>
+#include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
-#include <termios.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
 #include <time.h>
 #include <stdio.h>
 #include "crc16.h"
 #include "serial.h"
 #include "protocol_cmds.h"
+#include "prog_context.h"
 
-static int serial_fd = 0;
-static int serial_byte_time_ns; // Time in ns of one byte
+/* Time given to the port to accept more data when its output buffer is full */
+#define SERIAL_WRITE_TIMEOUT_MS         1000
 
-int get_baudrate_flag(int baudrate)
+static long long now_ns(void)
 {
-        int baudrate_flag = B57600;
-
-        switch (baudrate) {
-        case 9600:
-                baudrate_flag = B9600;
-                break;
-        case 57600:
-                baudrate_flag = B57600;
-                break;
-        case 19200:
-                baudrate_flag = B19200;
-                break;
-        case 115200:
-                baudrate_flag = B115200;
-                break;
-        case 230400:
-                baudrate_flag = B230400;
-                break;
-        case 500000:
-                baudrate_flag = B500000;
-                break;
-        case 1000000:
-                baudrate_flag = B1000000;
-                break;
-        }
-
-        return baudrate_flag;
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
 }
 
-static void serial_flush(int fd)
+/**
+ * \brief Wait for the serial port to become readable or writable
+ *
+ * The port stays registered in the epoll set of the context, only its events are modified when
+ * they differ from the ones requested last time.
+ *
+ * \param [in] events EPOLLIN or EPOLLOUT
+ * \param [in] timeout time to wait in ms
+ *
+ * \return 1 if port is ready, 0 on timeout, -1 on error
+ *
+ */
+static int serial_wait(uint32_t events, int timeout)
 {
-        uint8_t buf[100];
+        prog_context_t *ctx = prog_context_current();
+        struct epoll_event ev = { 0 };
+        int ret;
 
-        while (serial_read(buf, sizeof(buf), 1) > 0) {
+        if (ctx->serial_epoll_events != events) {
+                ev.events = events;
+                ev.data.fd = ctx->serial_fd;
+                if (epoll_ctl(ctx->serial_epoll_fd, EPOLL_CTL_MOD, ctx->serial_fd, &ev) < 0) {
+                        return -1;
+                }
+                ctx->serial_epoll_events = events;
         }
+
+        do {
+                ret = epoll_wait(ctx->serial_epoll_fd, &ev, 1, timeout);
+        } while (ret < 0 && errno == EINTR);
+
+        return ret;
 }
 
-int serial_open(const char *port, int baudrate)
+/**
+ * \brief Configure port as raw 8N1 at any baud rate
+ *
+ * termios2 with BOTHER passes the rate to the driver as a number, so rates which don't have
+ * a Bxxx constant (e.g. 2000000 or 3000000 on all architectures) can be used.
+ *
+ */
+static int serial_configure(int fd, int baudrate)
 {
-        int baudrate_flag = B57600;
-        serial_byte_time_ns = 1000000000 / baudrate * 10;
-        struct termios tios;
+        struct termios2 tios;
 
-        serial_fd = open(port, O_RDWR);
-
-        if (serial_fd < 0) {
-                return 0;
+        if (ioctl(fd, TCGETS2, &tios) < 0) {
+                return -1;
         }
-        serial_flush(serial_fd);
-
-        tcgetattr(serial_fd, &tios);
-        cfmakeraw(&tios);
 
+        tios.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON |
+                                                                                        IXANY);
         /*
-         * cfmakeraw() clears IXON flag but it's IXOFF which enables flow control in FTDI driver so
-         * we need to clear it explicitly here in order to disable XON/XOFF flow control.
+         * It's IXOFF which enables flow control in FTDI driver so it must be cleared explicitly in
+         * order to disable XON/XOFF flow control.
          */
         tios.c_iflag &= ~IXOFF;
+        tios.c_oflag &= ~OPOST;
+        tios.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
         /*
          * disable hardware flow control
          */
-        tios.c_cflag &= ~CRTSCTS;
+        tios.c_cflag &= ~(CSIZE | PARENB | CSTOPB | CRTSCTS | CBAUD | (CBAUD << IBSHIFT));
+        tios.c_cflag |= CS8 | CLOCAL | CREAD | BOTHER | (BOTHER << IBSHIFT);
+        tios.c_ispeed = baudrate;
+        tios.c_ospeed = baudrate;
+        tios.c_cc[VMIN] = 1;
+        tios.c_cc[VTIME] = 0;
+
+        if (ioctl(fd, TCSETS2, &tios) < 0) {
+                return -1;
+        }
+
+        /* Driver may round the rate to what its divider can do */
+        if (ioctl(fd, TCGETS2, &tios) == 0 && tios.c_ospeed != (speed_t) baudrate) {
+                prog_print_log("Serial port uses baud rate %u instead of %d.\n", tios.c_ospeed,
+                                                                                        baudrate);
+        }
+
+        return 0;
+}
+
+/**
+ * \brief Wait until all written data left the wire
+ *
+ * tcdrain() returns as soon as USB adapters accepted the data, so the estimated end of
+ * transmission is waited for as well.
+ *
+ */
+static void serial_wait_tx_end(void)
+{
+        prog_context_t *ctx = prog_context_current();
+        struct timespec ts;
+
+        ioctl(ctx->serial_fd, TCSBRK, 1);
+
+        if (ctx->serial_tx_end_ns > now_ns()) {
+                ts.tv_sec = ctx->serial_tx_end_ns / 1000000000LL;
+                ts.tv_nsec = ctx->serial_tx_end_ns % 1000000000LL;
+                while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+                }
+        }
+}
+
+int serial_open(const char *port, int baudrate)
+{
+        prog_context_t *ctx = prog_context_current();
+        struct epoll_event ev = { 0 };
+        int fd;
+        int epoll_fd;
+
+        fd = open(port, O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (fd < 0) {
+                return 0;
+        }
+
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) {
+                close(fd);
+                return 0;
+        }
+
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                goto fail;
+        }
+
         prog_print_log("Using serial port %s at baud rate %d.\n", port, baudrate);
-        baudrate_flag = get_baudrate_flag(baudrate);
-        cfsetspeed(&tios, baudrate_flag);
-        tcsetattr(serial_fd, TCSANOW, &tios);
+        if (serial_configure(fd, baudrate) < 0) {
+                prog_print_err("Unable to configure serial port.\n");
+                goto fail;
+        }
+        ioctl(fd, TCFLSH, TCIOFLUSH);
+
+        ctx->serial_fd = fd;
+        ctx->serial_epoll_fd = epoll_fd;
+        ctx->serial_epoll_events = EPOLLIN;
+        ctx->serial_baudrate = baudrate;
+        ctx->serial_byte_time_ns = 1000000000 / baudrate * 10;
+        ctx->serial_tx_end_ns = 0;
 
         return 1;
+
+fail:
+        close(epoll_fd);
+        close(fd);
+
+        return 0;
 }
 
 int serial_set_baudrate(int baudrate)
 {
-        int baudrate_flag = B57600;
-        struct termios tios;
-        int prev_baudrate = 57600;
-        speed_t speed;
-        /* Open loop wait here to make sure that last transaction is complete. */
-        usleep(200000);
-        tcgetattr(serial_fd, &tios);
-        speed = cfgetispeed(&tios);
-        switch (speed) {
-        case B9600:
-                prev_baudrate = 9600;
-                break;
-        case B57600:
-                prev_baudrate = 57600;
-                break;
-        case B19200:
-                prev_baudrate = 19200;
-                break;
-        case B115200:
-                prev_baudrate = 115200;
-                break;
-        case B230400:
-                prev_baudrate = 230400;
-                break;
-        case B500000:
-                prev_baudrate = 500000;
-                break;
-        case B1000000:
-                prev_baudrate = 1000000;
-                break;
-        }
-        cfmakeraw(&tios);
-        tios.c_iflag &= ~IXOFF;
+        prog_context_t *ctx = prog_context_current();
+        int prev_baudrate = ctx->serial_baudrate;
+
+        /* Make sure that last transaction is complete. */
+        serial_wait_tx_end();
 
         prog_print_log("Setting serial port baud rate to %d.\n", baudrate);
-        baudrate_flag = get_baudrate_flag(baudrate);
-        cfsetspeed(&tios, baudrate_flag);
-        tcsetattr(serial_fd, TCSANOW, &tios);
-        serial_byte_time_ns = 1000000000 / baudrate * 10;
+        if (serial_configure(ctx->serial_fd, baudrate) < 0) {
+                prog_print_err("Unable to configure serial port.\n");
+                return -1;
+        }
+
+        ctx->serial_baudrate = baudrate;
+        ctx->serial_byte_time_ns = 1000000000 / baudrate * 10;
+
         return prev_baudrate;
 }
 
 int serial_write(const uint8_t *buffer, size_t length)
 {
+        prog_context_t *ctx = prog_context_current();
         int written = 0;
         int total = 0;
-        struct timespec ts1;
-        struct timespec ts2;
-        long int expected_time_us = length * (serial_byte_time_ns / 1000);
-        long int time_taken_us;
-        clock_gettime(CLOCK_REALTIME, &ts1);
+        long long start_ns;
 
         while (length > 0) {
-                written = write(serial_fd, buffer + total, length);
-                if (written < 0) {
-                        return written;
-                } else {
+                written = write(ctx->serial_fd, buffer + total, length);
+                if (written > 0) {
                         total += written;
                         length -= written;
+                } else if (written < 0 && errno == EINTR) {
+                        continue;
+                } else if (written < 0 && errno != EAGAIN) {
+                        return written;
+                } else if (serial_wait(EPOLLOUT, SERIAL_WRITE_TIMEOUT_MS) <= 0) {
+                        return -1;
                 }
         }
-        tcdrain(serial_fd);
-        clock_gettime(CLOCK_REALTIME, &ts2);
-        time_taken_us = (ts2.tv_sec - ts1.tv_sec) * 1000000 + (ts2.tv_nsec - ts1.tv_nsec) / 1000;
-        if (time_taken_us + 10000 < expected_time_us) {
-                usleep(expected_time_us - time_taken_us);
+
+        /* Bytes queued behind earlier writes start after those left the wire */
+        start_ns = now_ns();
+        if (ctx->serial_tx_end_ns > start_ns) {
+                start_ns = ctx->serial_tx_end_ns;
         }
+        ctx->serial_tx_end_ns = start_ns + (long long) total * ctx->serial_byte_time_ns;
 
         return total;
 }
 
 int serial_read(uint8_t *buffer, size_t length, uint32_t timeout)
 {
-        struct timespec ts;
-        fd_set rfds;
+        prog_context_t *ctx = prog_context_current();
+        long long tx_pending_ns;
+        int ret;
+
+        ret = read(ctx->serial_fd, buffer, length);
+        if (ret > 0 || (ret < 0 && errno != EAGAIN && errno != EINTR)) {
+                return ret;
+        }
 
-        ts.tv_sec = timeout / 1000;
-        ts.tv_nsec = (timeout % 1000) * 1000000;
-        FD_ZERO(&rfds);
-        FD_SET(serial_fd, &rfds);
+        /* Reply can't come before the request left the wire, so timeout starts from there */
+        tx_pending_ns = ctx->serial_tx_end_ns - now_ns();
+        if (tx_pending_ns > 0) {
+                timeout += (tx_pending_ns + 999999) / 1000000;
+        }
 
-        if (pselect(serial_fd + 1, &rfds, NULL, NULL, &ts, NULL) > 0) {
-                return read(serial_fd, buffer, length);
+        if (serial_wait(EPOLLIN, timeout) > 0) {
+                ret = read(ctx->serial_fd, buffer, length);
+                return ret < 0 && (errno == EAGAIN || errno == EINTR) ? 0 : ret;
         }
 
         return 0;
@@ -190,8 +266,11 @@ int serial_read(uint8_t *buffer, size_t length, uint32_t timeout)
 
 void serial_close(void)
 {
-        if (serial_fd != 0) {
-                close(serial_fd);
-                serial_fd = 0;
+        prog_context_t *ctx = prog_context_current();
+        if (ctx->serial_fd != 0) {
+                close(ctx->serial_epoll_fd);
+                close(ctx->serial_fd);
+                ctx->serial_fd = 0;
+                ctx->serial_epoll_fd = 0;
         }
 }
@@ -17,9 +17,7 @@
 #include <stdint.h>
 #include "serial.h"
 #include "protocol_cmds.h"
-
-static HANDLE h_serial_port = NULL;
-static int serial_byte_time_ns; // Time in ns of one byte
+#include "prog_context.h"
 
 static void serial_flush(HANDLE h)
 {
@@ -31,9 +29,11 @@ static void serial_flush(HANDLE h)
 
 int serial_open(const char *port, int baudrate)
 {
+        prog_context_t *ctx = prog_context_current();
         char serial_port[20];
         DCB dcb_port;
-        serial_byte_time_ns = 1000000000 / baudrate * 10;
+        ctx->serial_baudrate = baudrate;
+        ctx->serial_byte_time_ns = 1000000000 / baudrate * 10;
 
         if (!strncmp("\\\\.\\", port, 7)) {
                 strcpy(serial_port, port);
@@ -43,19 +43,19 @@ int serial_open(const char *port, int baudrate)
 
         prog_print_log("Using serial port %s at baud rate %d.\n", port, baudrate);
 
-        h_serial_port = CreateFile(serial_port, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+        ctx->serial_handle = CreateFile(serial_port, GENERIC_READ | GENERIC_WRITE, 0, NULL,
                 OPEN_EXISTING, 0, NULL);
 
-        if (h_serial_port == INVALID_HANDLE_VALUE) {
+        if (ctx->serial_handle == INVALID_HANDLE_VALUE) {
                 return 0;
         }
 
-        serial_flush(h_serial_port);
+        serial_flush(ctx->serial_handle);
 
         // Length initialization of DCB
         dcb_port.DCBlength = sizeof(dcb_port);
         // Get the default settings of port configuration
-        GetCommState(h_serial_port, &dcb_port);
+        GetCommState(ctx->serial_handle, &dcb_port);
 
         dcb_port.BaudRate = baudrate;
         dcb_port.ByteSize = 8;
@@ -76,7 +76,7 @@ int serial_open(const char *port, int baudrate)
         dcb_port.fRtsControl = RTS_CONTROL_ENABLE;
         dcb_port.fAbortOnError = FALSE;
 
-        if (!SetCommState(h_serial_port, &dcb_port)) {
+        if (!SetCommState(ctx->serial_handle, &dcb_port)) {
                 prog_print_err("Unable to configure serial port.\n");
                 return -1;
         }
@@ -86,10 +86,11 @@ int serial_open(const char *port, int baudrate)
 
 int serial_set_baudrate(int baudrate)
 {
+        prog_context_t *ctx = prog_context_current();
         DCB dcb_port;
         int prev_baudrate;
 
-        GetCommState(h_serial_port, &dcb_port);
+        GetCommState(ctx->serial_handle, &dcb_port);
 
         prev_baudrate = (int) dcb_port.BaudRate;
 
@@ -115,19 +116,21 @@ int serial_set_baudrate(int baudrate)
         dcb_port.fRtsControl = RTS_CONTROL_ENABLE;
         dcb_port.fAbortOnError = FALSE;
 
-        if (!SetCommState(h_serial_port, &dcb_port)) {
+        if (!SetCommState(ctx->serial_handle, &dcb_port)) {
                 prog_print_err("Unable to configure serial port.\n");
                 return -1;
         }
-        serial_byte_time_ns = 1000000000 / baudrate * 10;
+        ctx->serial_baudrate = baudrate;
+        ctx->serial_byte_time_ns = 1000000000 / baudrate * 10;
         return prev_baudrate;
 }
 
 static int serial_timeouts(DWORD timeout)
 {
+        prog_context_t *ctx = prog_context_current();
         COMMTIMEOUTS comm_timeouts;
 
-        if (!GetCommTimeouts(h_serial_port, &comm_timeouts)) {
+        if (!GetCommTimeouts(ctx->serial_handle, &comm_timeouts)) {
                 prog_print_err("Unable to get timeouts.\n");
                 return -1;
         }
@@ -136,7 +139,7 @@ static int serial_timeouts(DWORD timeout)
         comm_timeouts.ReadTotalTimeoutMultiplier = 0;
         comm_timeouts.ReadIntervalTimeout = 0;
 
-        if (!SetCommTimeouts(h_serial_port, &comm_timeouts)) {
+        if (!SetCommTimeouts(ctx->serial_handle, &comm_timeouts)) {
                 prog_print_err("Unable to set timeouts.\n");
                 return -1;
         }
@@ -146,13 +149,14 @@ static int serial_timeouts(DWORD timeout)
 
 int serial_write(const uint8_t *buffer, size_t length)
 {
+        prog_context_t *ctx = prog_context_current();
         DWORD bytes_written, t_start, t_end;
-        long int expected_time_us = length * (serial_byte_time_ns / 1000);
+        long int expected_time_us = length * (ctx->serial_byte_time_ns / 1000);
         long int time_taken_ms;
 
         t_start = GetTickCount();
 
-        if (!WriteFile(h_serial_port, buffer, length, &bytes_written, NULL)) {
+        if (!WriteFile(ctx->serial_handle, buffer, length, &bytes_written, NULL)) {
                 return -1;
         }
 
@@ -168,11 +172,12 @@ int serial_write(const uint8_t *buffer, size_t length)
 
 int serial_read(uint8_t *buffer, size_t length, uint32_t timeout)
 {
+        prog_context_t *ctx = prog_context_current();
         DWORD bytes_transferred;
 
         serial_timeouts(timeout);
 
-        if (!ReadFile(h_serial_port, buffer, length, &bytes_transferred, NULL)) {
+        if (!ReadFile(ctx->serial_handle, buffer, length, &bytes_transferred, NULL)) {
                 return -1;
         }
 
@@ -181,8 +186,9 @@ int serial_read(uint8_t *buffer, size_t length, uint32_t timeout)
 
 void serial_close(void)
 {
-        if (h_serial_port != NULL) {
-                CloseHandle(h_serial_port);
-                h_serial_port = NULL;
+        prog_context_t *ctx = prog_context_current();
+        if (ctx->serial_handle != NULL) {
+                CloseHandle(ctx->serial_handle);
+                ctx->serial_handle = NULL;
         }
 }
\ No newline at end of file
@@ -0,0 +1,246 @@
+/**
+ ****************************************************************************************
+ *
+ * @file crc16_test.c
+ *
+ * @brief Host unit test and benchmark of table driven CRC16
+ *
+ * CRC16 of table driven implementation is compared bit for bit with bit-wise calculation for
+ * the check string, all single bytes, random lengths and alignments and data split in random
+ * chunks passed to crc16_update(). Throughput of both is reported at the end.
+ *
+ * The same test covers slice-by-8 calculation of libprogrammer and firmware sdk_crc16.c with
+ * every dg_configCRC16_TABLE_SIZE (host sdk_defs.h of ad_flash simulator is used for firmware
+ * build). Build and run from utilities/cli_programmer:
+ *
+ *     gcc -Wall -Wextra -O2 -Ilibprogrammer test/crc16_test.c libprogrammer/crc16.c \
+ *                                                                      -o crc16_test
+ *     ./crc16_test
+ *
+ *     for size in 0 16 256; do
+ *             gcc -Wall -Wextra -O2 -DCRC16_SDK -Ddg_configCRC16_TABLE_SIZE=$size \
+ *                     -I../../sdk/bsp/util/include -I../../sdk/middleware/adapters/sim/include \
+ *                     test/crc16_test.c \
+ *                     ../../sdk/bsp/util/src/sdk_crc16.c -o sdk_crc16_test && ./sdk_crc16_test
+ *     done
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef CRC16_SDK
+#include "sdk_crc16.h"
+#else
+#include "crc16.h"
+#endif
+
+#define CRC16_POLYNOMIAL        0x1021
+#define TEST_BUF_SIZE           0x1000
+#define BENCH_BUF_SIZE          0x100000
+#define BENCH_ROUNDS            16
+
+static int failures;
+
+#define CHECK(cond, ...) \
+        do { \
+                if (!(cond)) { \
+                        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+                        printf(__VA_ARGS__); \
+                        printf("\n"); \
+                        failures++; \
+                        return false; \
+                } \
+        } while (0)
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+        /* xorshift32, fixed seed keeps test reproducible */
+        rnd_state ^= rnd_state << 13;
+        rnd_state ^= rnd_state >> 17;
+        rnd_state ^= rnd_state << 5;
+        return rnd_state;
+}
+
+/* Reference bit-wise CRC16-CCITT, as calculated before lookup tables were introduced */
+static void crc16_update_bitwise(uint16_t *crc16, const uint8_t *buf, size_t len)
+{
+        uint16_t crc = *crc16;
+        size_t i, j;
+
+        for (i = 0; i < len; i++) {
+                crc ^= (uint16_t) (buf[i] << 8);
+
+                for (j = 0; j < 8; j++) {
+                        crc = (crc & 0x8000) ? (uint16_t) (crc << 1) ^ CRC16_POLYNOMIAL :
+                                                                        (uint16_t) (crc << 1);
+                }
+        }
+
+        *crc16 = crc;
+}
+
+static bool test_check_value(void)
+{
+        const uint8_t check[] = "123456789";
+        uint16_t crc;
+
+        /* CRC-16/CCITT-FALSE check value */
+        crc = crc16_calculate(check, sizeof(check) - 1);
+        CHECK(crc == 0x29B1, "check value %04X, expected 29B1", crc);
+
+        crc16_init(&crc);
+        CHECK(crc == 0xFFFF, "initial value %04X", crc);
+        crc16_update(&crc, check, 0);
+        CHECK(crc == 0xFFFF, "empty update changed CRC to %04X", crc);
+
+        return true;
+}
+
+/* Every byte value with every initial CRC high byte hits every table entry */
+static bool test_single_bytes(void)
+{
+        uint16_t crc, ref;
+        unsigned int b, init;
+        uint8_t byte;
+
+        for (init = 0; init < 0x10000; init += 0x0101) {
+                for (b = 0; b < 256; b++) {
+                        byte = (uint8_t) b;
+                        crc = ref = (uint16_t) init;
+                        crc16_update(&crc, &byte, 1);
+                        crc16_update_bitwise(&ref, &byte, 1);
+                        CHECK(crc == ref, "byte %02X init %04X: %04X, expected %04X", b, init,
+                                                                                crc, ref);
+                }
+        }
+
+        return true;
+}
+
+/* Random lengths, alignments and initial values, covers both slice and byte loops */
+static bool test_random(void)
+{
+        static uint8_t buf[TEST_BUF_SIZE];
+        uint16_t crc, ref;
+        size_t off, len, i;
+        int t;
+
+        for (i = 0; i < sizeof(buf); i++) {
+                buf[i] = (uint8_t) rnd();
+        }
+
+        for (t = 0; t < 100000; t++) {
+                off = rnd() % 64;
+                len = (t & 1) ? rnd() % 32 : rnd() % (sizeof(buf) - 64);
+                crc = ref = (uint16_t) rnd();
+                crc16_update(&crc, buf + off, len);
+                crc16_update_bitwise(&ref, buf + off, len);
+                CHECK(crc == ref, "offset %zu length %zu: %04X, expected %04X", off, len, crc,
+                                                                                        ref);
+        }
+
+        return true;
+}
+
+/* Data passed in chunks gives the same CRC as in one call */
+static bool test_chunks(void)
+{
+        static uint8_t buf[TEST_BUF_SIZE];
+        uint16_t crc, ref;
+        size_t pos, chunk, i;
+        int t;
+
+        for (t = 0; t < 1000; t++) {
+                for (i = 0; i < sizeof(buf); i++) {
+                        buf[i] = (t & 1) ? 0xFF : (uint8_t) rnd();
+                }
+
+                ref = crc16_calculate(buf, sizeof(buf));
+                crc16_init(&crc);
+                for (pos = 0; pos < sizeof(buf); pos += chunk) {
+                        chunk = rnd() % 20;
+                        if (chunk > sizeof(buf) - pos) {
+                                chunk = sizeof(buf) - pos;
+                        }
+                        crc16_update(&crc, buf + pos, chunk);
+                }
+                CHECK(crc == ref, "test %d: chunked CRC %04X, expected %04X", t, crc, ref);
+        }
+
+        return true;
+}
+
+static double throughput(void (*update)(uint16_t *, const uint8_t *, size_t), const uint8_t *buf,
+                                                                                uint16_t *crc)
+{
+        clock_t start;
+        double secs;
+        int r;
+
+        start = clock();
+        for (r = 0; r < BENCH_ROUNDS; r++) {
+                crc16_init(crc);
+                update(crc, buf, BENCH_BUF_SIZE);
+        }
+        secs = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+        return secs > 0 ? BENCH_ROUNDS * (BENCH_BUF_SIZE / (1024.0 * 1024.0)) / secs : 0;
+}
+
+static void benchmark(void)
+{
+        static uint8_t buf[BENCH_BUF_SIZE];
+        double bitwise, table;
+        uint16_t crc, ref;
+        size_t i;
+
+        for (i = 0; i < sizeof(buf); i++) {
+                buf[i] = (uint8_t) rnd();
+        }
+
+        bitwise = throughput(crc16_update_bitwise, buf, &ref);
+        table = throughput(crc16_update, buf, &crc);
+
+        printf("bit-wise: %8.1f MB/s\n", bitwise);
+        printf("table:    %8.1f MB/s (x%.1f)\n", table, bitwise > 0 ? table / bitwise : 0);
+        if (crc != ref) {
+                printf("FAIL: benchmark CRC %04X, expected %04X\n", crc, ref);
+                failures++;
+        }
+}
+
+int main(void)
+{
+#ifdef CRC16_SDK
+        printf("sdk_crc16.c, dg_configCRC16_TABLE_SIZE %d\n", dg_configCRC16_TABLE_SIZE);
+#else
+        printf("libprogrammer crc16.c\n");
+#endif
+
+        test_check_value();
+        test_single_bytes();
+        test_random();
+        test_chunks();
+
+        if (failures) {
+                printf("%d test(s) failed\n", failures);
+                return 1;
+        }
+
+        benchmark();
+        if (failures) {
+                return 1;
+        }
+
+        printf("All tests passed\n");
+        return 0;
+}
@@ -0,0 +1,571 @@
+/**
+ ****************************************************************************************
+ *
+ * @file gdb_server_test.c
+ *
+ * @brief Host test of GDB Server communication of libprogrammer against local mock server
+ *
+ * Mock GDB Server runs in a thread on a local TCP port and serves qSupported, QStartNoAckMode,
+ * X (binary write) and m (hex read) packets with RAM kept in a buffer. Replies are sent only when
+ * no more packets arrive for MOCK_IDLE_MS, so pipelined packets are counted as in flight.
+ * Tests check:
+ * - packet size negotiated with qSupported and default size when PacketSize is not reported
+ * - no-ack mode entered only when server supports it, no acknowledgements sent afterwards
+ * - escaping of special characters in X packets
+ * - pipelined writes, including error reply in the middle of the window
+ *
+ * Build and run from utilities/cli_programmer:
+ *
+ *     gcc -Wall -O2 -Ilibprogrammer -Ilibprogrammer/api -I../../sdk/middleware/adapters/include \
+ *             -I../../sdk/bsp/include -I../../sdk/bsp/system/loaders/uartboot/include \
+ *             test/gdb_server_test.c libprogrammer/crc16.c libprogrammer/lz_block.c \
+ *             libprogrammer/programmer.c libprogrammer/protocol_cmds.c \
+ *             libprogrammer/serial_linux.c libprogrammer/gdb_server_cmds.c -lpthread \
+ *             -o gdb_server_test
+ *     ./gdb_server_test
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <programmer.h>
+#include "gdb_server_cmds.h"
+
+#define MOCK_MEM_BASE           0x20000000
+#define MOCK_MEM_SIZE           0x40000
+#define MOCK_IDLE_MS            10
+#define MOCK_MAX_PACKET         0x21000
+
+/* Same values as in gdb_server_cmds.c */
+#define CHUNK_SIZE              0x2000
+#define X_PACKET_HEADER_LEN     (2 + 8 + 1 + 8 + 1)
+#define PACKET_TRAILER_LEN      3
+#define WRITE_PIPELINE_DEPTH    8
+
+#define SUPPORTED_FULL          "PacketSize=1000;qXfer:memory-map:read+;QStartNoAckMode+"
+#define SUPPORTED_NO_NOACK      "PacketSize=1000"
+#define SUPPORTED_LEGACY        ""
+
+typedef struct {
+        /* configuration */
+        const char *supported;          /* reply to qSupported */
+        uint32_t error_addr;            /* X packets writing this address get error reply */
+
+        /* statistics, valid after mock_stop() */
+        unsigned int packets;           /* packets received */
+        unsigned int x_packets;         /* X packets received */
+        unsigned int replies;           /* replies sent */
+        size_t max_packet_len;          /* longest packet including '$' and checksum */
+        unsigned int acks;              /* acknowledgements received */
+        unsigned int no_ack_acks;       /* acknowledgements received in no-ack mode */
+        unsigned int max_in_flight;     /* packets received before replies were sent */
+        unsigned int bad_packets;       /* bad checksum, unescaped characters, bad length */
+        bool no_ack_requested;          /* QStartNoAckMode received */
+
+        /* internal */
+        int listen_sock;
+        int port;
+        pthread_t thread;
+        bool no_ack;
+        bool no_ack_pending;
+        uint8_t mem[MOCK_MEM_SIZE];
+} mock_server_t;
+
+static mock_server_t mock;
+static int failures;
+
+#define CHECK(cond, ...) \
+        do { \
+                if (!(cond)) { \
+                        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+                        printf(__VA_ARGS__); \
+                        printf("\n"); \
+                        failures++; \
+                        return false; \
+                } \
+        } while (0)
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+        /* xorshift32, fixed seed keeps test reproducible */
+        rnd_state ^= rnd_state << 13;
+        rnd_state ^= rnd_state >> 17;
+        rnd_state ^= rnd_state << 5;
+        return rnd_state;
+}
+
+static uint8_t packet_checksum(const char *buf, size_t len)
+{
+        uint8_t cs = 0;
+
+        while (len--) {
+                cs += (uint8_t) *buf++;
+        }
+
+        return cs;
+}
+
+static void mock_send(int sock, const char *buf, size_t len)
+{
+        ssize_t ret;
+
+        while (len > 0 && (ret = send(sock, buf, len, 0)) > 0) {
+                buf += ret;
+                len -= ret;
+        }
+}
+
+/* frame reply and append it to replies which are sent when client waits for them */
+static void mock_queue_reply(char *replies, size_t *replies_len, const char *payload,
+                                                                        size_t payload_len)
+{
+        char *out = replies + *replies_len;
+
+        *out++ = '$';
+        memcpy(out, payload, payload_len);
+        out += payload_len;
+        out += sprintf(out, "#%02x", packet_checksum(payload, payload_len));
+        *replies_len = out - replies;
+        mock.replies++;
+}
+
+/* handle X packet: address, length, ':' and escaped binary data */
+static const char *mock_write(const char *payload, size_t len)
+{
+        const char *data = memchr(payload, ':', len);
+        unsigned long addr, size;
+        const char *p;
+        size_t count = 0;
+        uint8_t c;
+
+        if (data == NULL || sscanf(payload + 1, "%lx,%lx:", &addr, &size) != 2) {
+                mock.bad_packets++;
+                return "E02";
+        }
+
+        for (p = data + 1; p < payload + len; p++) {
+                c = (uint8_t) *p;
+                if (c == '$' || c == '#' || c == '*') {
+                        mock.bad_packets++;
+                        return "E03";
+                }
+                if (c == '}') {
+                        c = (uint8_t) *++p ^ 0x20;
+                }
+                if (addr >= MOCK_MEM_BASE && addr + count < MOCK_MEM_BASE + MOCK_MEM_SIZE) {
+                        mock.mem[addr - MOCK_MEM_BASE + count] = c;
+                }
+                count++;
+        }
+
+        if (count != size) {
+                mock.bad_packets++;
+                return "E04";
+        }
+
+        if (mock.error_addr >= addr && mock.error_addr < addr + size) {
+                return "E01";
+        }
+
+        return "OK";
+}
+
+/* handle complete packet, reply is queued */
+static void mock_handle_packet(int sock, const char *payload, size_t len, char *replies,
+                                                                        size_t *replies_len)
+{
+        static char hex[MOCK_MAX_PACKET];
+        unsigned long addr, size, i;
+        const char *reply = "";
+
+        mock.packets++;
+
+        if (mock.no_ack_pending) {
+                /* acknowledgement of 'OK' reply to QStartNoAckMode was the last one */
+                mock.no_ack_pending = false;
+                mock.no_ack = true;
+        }
+
+        if (!mock.no_ack && !mock.no_ack_requested) {
+                mock_send(sock, "+", 1);
+        }
+
+        if (len >= strlen("qSupported") && !strncmp(payload, "qSupported", strlen("qSupported"))) {
+                reply = mock.supported;
+        } else if (len == strlen("QStartNoAckMode") && !strncmp(payload, "QStartNoAckMode", len)) {
+                mock.no_ack_requested = true;
+                mock.no_ack_pending = true;
+                reply = "OK";
+        } else if (len > 0 && payload[0] == 'X') {
+                mock.x_packets++;
+                reply = mock_write(payload, len);
+        } else if (len > 0 && payload[0] == 'm' &&
+                                        sscanf(payload + 1, "%lx,%lx", &addr, &size) == 2 &&
+                                        addr >= MOCK_MEM_BASE && size * 2 < sizeof(hex) &&
+                                        addr + size <= MOCK_MEM_BASE + MOCK_MEM_SIZE) {
+                for (i = 0; i < size; i++) {
+                        sprintf(hex + i * 2, "%02x", mock.mem[addr - MOCK_MEM_BASE + i]);
+                }
+                mock_queue_reply(replies, replies_len, hex, size * 2);
+                return;
+        }
+
+        mock_queue_reply(replies, replies_len, reply, strlen(reply));
+}
+
+static void *mock_thread(void *arg)
+{
+        static char packet[MOCK_MAX_PACKET];
+        static char replies[MOCK_MAX_PACKET * 2];
+        struct pollfd pfd;
+        size_t packet_len = 0;
+        size_t replies_len = 0;
+        unsigned int in_flight = 0;
+        int checksum_chars = 0;
+        bool in_packet = false;
+        char buf[4096];
+        char cs[3];
+        ssize_t len;
+        ssize_t i;
+        int sock;
+
+        (void) arg;
+
+        sock = accept(mock.listen_sock, NULL, NULL);
+        if (sock < 0) {
+                return NULL;
+        }
+
+        pfd.fd = sock;
+        pfd.events = POLLIN;
+
+        for (;;) {
+                if (poll(&pfd, 1, MOCK_IDLE_MS) == 0) {
+                        /* client waits, send all replies */
+                        if (replies_len > 0) {
+                                mock_send(sock, replies, replies_len);
+                                replies_len = 0;
+                        }
+                        if (in_flight > mock.max_in_flight) {
+                                mock.max_in_flight = in_flight;
+                        }
+                        in_flight = 0;
+                        continue;
+                }
+
+                if ((len = recv(sock, buf, sizeof(buf), 0)) <= 0) {
+                        break;
+                }
+
+                for (i = 0; i < len; i++) {
+                        if (checksum_chars > 0) {
+                                cs[2 - checksum_chars] = buf[i];
+                                if (--checksum_chars > 0) {
+                                        continue;
+                                }
+                                cs[2] = '\0';
+                                if (strtoul(cs, NULL, 16) != packet_checksum(packet, packet_len)) {
+                                        mock.bad_packets++;
+                                }
+                                packet[packet_len] = '\0';
+                                if (packet_len + 4 > mock.max_packet_len) {
+                                        mock.max_packet_len = packet_len + 4;
+                                }
+                                mock_handle_packet(sock, packet, packet_len, replies,
+                                                                                &replies_len);
+                                in_flight++;
+                        } else if (in_packet) {
+                                if (buf[i] == '#') {
+                                        in_packet = false;
+                                        checksum_chars = 2;
+                                } else if (packet_len < sizeof(packet) - 1) {
+                                        packet[packet_len++] = buf[i];
+                                }
+                        } else if (buf[i] == '$') {
+                                in_packet = true;
+                                packet_len = 0;
+                        } else if (buf[i] == '+') {
+                                mock.acks++;
+                                if (mock.no_ack) {
+                                        mock.no_ack_acks++;
+                                }
+                        }
+                }
+        }
+
+        close(sock);
+
+        return NULL;
+}
+
+static bool mock_start(const char *supported, uint32_t error_addr)
+{
+        struct sockaddr_in addr;
+        socklen_t addr_len = sizeof(addr);
+        const int reuse = 1;
+
+        memset(&mock, 0, sizeof(mock));
+        mock.supported = supported;
+        mock.error_addr = error_addr;
+
+        mock.listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (mock.listen_sock < 0) {
+                return false;
+        }
+        setsockopt(mock.listen_sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+
+        if (bind(mock.listen_sock, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+                                        listen(mock.listen_sock, 1) != 0 ||
+                                        getsockname(mock.listen_sock, (struct sockaddr *) &addr,
+                                                                                &addr_len) != 0) {
+                close(mock.listen_sock);
+                return false;
+        }
+        mock.port = ntohs(addr.sin_port);
+
+        if (pthread_create(&mock.thread, NULL, mock_thread, NULL) != 0) {
+                close(mock.listen_sock);
+                return false;
+        }
+
+        return gdb_server_connect("127.0.0.1", mock.port) == 0;
+}
+
+static void mock_stop(void)
+{
+        gdb_server_disconnect();
+        pthread_join(mock.thread, NULL);
+        close(mock.listen_sock);
+}
+
+/* random data with runs of characters which must be escaped */
+static void fill(uint8_t *buf, size_t len)
+{
+        static const uint8_t special[] = { '$', '#', '}', '*' };
+        size_t i;
+
+        for (i = 0; i < len; i++) {
+                buf[i] = (uint8_t) rnd();
+        }
+        for (i = 0; i + 64 < len; i += 0x400) {
+                memset(buf + i, special[(i / 0x400) % sizeof(special)], 64);
+        }
+}
+
+/* write data and check it both in mock memory and read back through GDB Server */
+static bool write_and_verify(const uint8_t *data, size_t len, uint32_t addr)
+{
+        static uint8_t readback[MOCK_MEM_SIZE];
+        int ret;
+
+        ret = gdb_server_cmd_write(data, len, addr);
+        CHECK(ret == 0, "write of %zu bytes failed (%d)", len, ret);
+
+        ret = gdb_server_cmd_read(readback, len, addr);
+        CHECK(ret == 0, "read of %zu bytes failed (%d)", len, ret);
+        CHECK(memcmp(readback, data, len) == 0, "read data differs");
+
+        return true;
+}
+
+static bool check_mem(const uint8_t *data, size_t len, uint32_t addr)
+{
+        CHECK(mock.bad_packets == 0, "%u bad packets", mock.bad_packets);
+        CHECK(memcmp(mock.mem + addr - MOCK_MEM_BASE, data, len) == 0, "written data differs");
+
+        return true;
+}
+
+/* PacketSize reported with no-ack mode: packets fill negotiated size and are pipelined */
+static bool test_negotiated_packet_size(void)
+{
+        static uint8_t data[0x10000];
+        bool ok;
+
+        fill(data, sizeof(data));
+        CHECK(mock_start(SUPPORTED_FULL, 0), "mock server not connected");
+        ok = write_and_verify(data, sizeof(data), MOCK_MEM_BASE);
+        mock_stop();
+        if (!ok || !check_mem(data, sizeof(data), MOCK_MEM_BASE)) {
+                return false;
+        }
+
+        CHECK(mock.max_packet_len <= 0x1000, "packet of %zu bytes exceeds PacketSize",
+                                                                        mock.max_packet_len);
+        CHECK(mock.max_packet_len > 0x1000 - 8, "packets of %zu bytes don't use PacketSize",
+                                                                        mock.max_packet_len);
+        CHECK(mock.no_ack_requested, "QStartNoAckMode not requested");
+        CHECK(mock.no_ack_acks == 0, "%u acknowledgements sent in no-ack mode",
+                                                                        mock.no_ack_acks);
+        CHECK(mock.max_in_flight > 1 && mock.max_in_flight <= WRITE_PIPELINE_DEPTH,
+                                        "%u packets in flight", mock.max_in_flight);
+
+        return true;
+}
+
+/* nothing reported: old packet size, acknowledgements and one packet at a time */
+static bool test_default_packet_size(void)
+{
+        static uint8_t data[0x10000];
+        bool ok;
+
+        fill(data, sizeof(data));
+        CHECK(mock_start(SUPPORTED_LEGACY, 0), "mock server not connected");
+        ok = write_and_verify(data, sizeof(data), MOCK_MEM_BASE);
+        mock_stop();
+        if (!ok || !check_mem(data, sizeof(data), MOCK_MEM_BASE)) {
+                return false;
+        }
+
+        CHECK(mock.max_packet_len <= X_PACKET_HEADER_LEN + CHUNK_SIZE + PACKET_TRAILER_LEN,
+                        "packet of %zu bytes exceeds default size", mock.max_packet_len);
+        CHECK(mock.max_packet_len > CHUNK_SIZE, "packets of %zu bytes don't use default size",
+                                                                        mock.max_packet_len);
+        CHECK(!mock.no_ack_requested, "QStartNoAckMode requested");
+        CHECK(mock.acks == mock.replies, "%u acknowledgements for %u replies", mock.acks,
+                                                                                mock.replies);
+        CHECK(mock.max_in_flight == 1, "%u packets in flight", mock.max_in_flight);
+
+        return true;
+}
+
+/* PacketSize without no-ack mode: negotiated size, acknowledgements kept */
+static bool test_no_ack_not_supported(void)
+{
+        static uint8_t data[0x8000];
+        bool ok;
+
+        fill(data, sizeof(data));
+        CHECK(mock_start(SUPPORTED_NO_NOACK, 0), "mock server not connected");
+        ok = write_and_verify(data, sizeof(data), MOCK_MEM_BASE + 0x100);
+        mock_stop();
+        if (!ok || !check_mem(data, sizeof(data), MOCK_MEM_BASE + 0x100)) {
+                return false;
+        }
+
+        CHECK(mock.max_packet_len <= 0x1000, "packet of %zu bytes exceeds PacketSize",
+                                                                        mock.max_packet_len);
+        CHECK(!mock.no_ack_requested, "QStartNoAckMode requested");
+        CHECK(mock.acks == mock.replies, "%u acknowledgements for %u replies", mock.acks,
+                                                                                mock.replies);
+        CHECK(mock.max_in_flight == 1, "%u packets in flight", mock.max_in_flight);
+
+        return true;
+}
+
+/* every byte value and data made only of escaped characters, split at any packet boundary */
+static bool test_escaping(void)
+{
+        static const uint8_t special[] = { '$', '#', '}', '*' };
+        static uint8_t data[0x4000];
+        uint32_t addr = MOCK_MEM_BASE;
+        size_t i, s;
+        bool ok = true;
+
+        CHECK(mock_start(SUPPORTED_FULL, 0), "mock server not connected");
+
+        for (i = 0; i < sizeof(data); i++) {
+                data[i] = (uint8_t) i;
+        }
+        ok = write_and_verify(data, sizeof(data), addr);
+
+        for (s = 0; ok && s < sizeof(special); s++) {
+                memset(data, special[s], sizeof(data));
+                addr += sizeof(data);
+                ok = write_and_verify(data, sizeof(data), addr);
+        }
+
+        /* escaped character as last one which fits in packet, with odd data offsets */
+        for (i = 0; ok && i < 8; i++) {
+                fill(data, sizeof(data));
+                data[0x1000 - X_PACKET_HEADER_LEN - PACKET_TRAILER_LEN - i] = '}';
+                addr = MOCK_MEM_BASE + 0x20000 + i;
+                ok = write_and_verify(data, 0x3001 + i, addr);
+        }
+
+        mock_stop();
+        if (!ok) {
+                return false;
+        }
+
+        CHECK(mock.bad_packets == 0, "%u bad packets", mock.bad_packets);
+
+        return true;
+}
+
+/* error reply in the middle of pipelined window is reported and the rest of replies drained */
+static bool test_pipelined_error(void)
+{
+        static uint8_t data[0x10000];
+        unsigned int replies;
+        int ret;
+        bool ok;
+
+        fill(data, sizeof(data));
+        CHECK(mock_start(SUPPORTED_FULL, MOCK_MEM_BASE + 0x5000), "mock server not connected");
+
+        ret = gdb_server_cmd_write(data, sizeof(data), MOCK_MEM_BASE);
+        if (ret != ERR_GDB_SERVER_CMD_REJECTED) {
+                mock_stop();
+                CHECK(false, "write with error reply returned %d", ret);
+        }
+
+        /* next commands get their own replies, not leftovers of the pipelined write */
+        ok = write_and_verify(data + 0x100, 0x100, MOCK_MEM_BASE + 0x30000);
+        if (ok) {
+                /* error in the last packet of short write */
+                mock.error_addr = MOCK_MEM_BASE + 0x39000;
+                ok = gdb_server_cmd_write(data, 0x2000, mock.error_addr - 0x100) ==
+                                                                ERR_GDB_SERVER_CMD_REJECTED;
+        }
+        ok = ok && write_and_verify(data, 0x3000, MOCK_MEM_BASE + 0x3C000);
+
+        mock_stop();
+        CHECK(ok, "GDB Server communication out of sync after error reply");
+
+        replies = mock.replies;
+        CHECK(mock.bad_packets == 0, "%u bad packets", mock.bad_packets);
+        CHECK(replies == mock.packets, "%u replies to %u packets", replies, mock.packets);
+        CHECK(mock.max_in_flight > 1, "writes not pipelined");
+
+        return true;
+}
+
+int main(void)
+{
+        prog_set_chip_rev(CHIP_REV_700AB);
+
+        test_negotiated_packet_size();
+        test_default_packet_size();
+        test_no_ack_not_supported();
+        test_escaping();
+        test_pipelined_error();
+
+        if (failures) {
+                printf("%d test(s) failed\n", failures);
+                return 1;
+        }
+
+        printf("All tests passed\n");
+        return 0;
+}
@@ -0,0 +1,303 @@
+/**
+ ****************************************************************************************
+ *
+ * @file lz_block_test.c
+ *
+ * @brief Host unit test of LZ4 block compression of libprogrammer
+ *
+ * Data is compressed with lz_block_compress() and decompressed with lz_block_decompress() for
+ * incompressible, compressible and short blocks, checking that it comes back unchanged. Limits
+ * of destination buffers are checked on both sides: output never goes past dst_size and
+ * compression/decompression fails if data doesn't fit. Corrupted blocks must be rejected.
+ *
+ * Build and run from utilities/cli_programmer:
+ *
+ *     gcc -Wall -Wextra -O2 -Ilibprogrammer test/lz_block_test.c libprogrammer/lz_block.c \
+ *                                                                      -o lz_block_test
+ *     ./lz_block_test
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lz_block.h"
+
+#define MAX_BLOCK_SIZE          0x10000
+/* Guard bytes after destination buffers, must stay untouched */
+#define GUARD_SIZE              64
+#define GUARD_BYTE              0xA5
+
+/* LZ4 worst case: incompressible data grows by one length byte per 255 bytes and a token */
+#define COMPRESS_BOUND(n)       ((n) + (n) / 255 + 16)
+
+typedef enum {
+        PATTERN_RANDOM,         /* incompressible */
+        PATTERN_PADDING,        /* 0xFF padding, like unused part of FLASH image */
+        PATTERN_REPEATS,        /* short repeated runs, matches overlap with output */
+        PATTERN_TEXT,           /* few symbols, many short matches */
+        PATTERN_MIXED,          /* random data followed by padding */
+        PATTERN_COUNT
+} pattern_t;
+
+static const char *pattern_names[PATTERN_COUNT] = {
+        "random", "padding", "repeats", "text", "mixed"
+};
+
+static int failures;
+
+#define CHECK(cond, ...) \
+        do { \
+                if (!(cond)) { \
+                        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+                        printf(__VA_ARGS__); \
+                        printf("\n"); \
+                        failures++; \
+                        return false; \
+                } \
+        } while (0)
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+        /* xorshift32, fixed seed keeps test reproducible */
+        rnd_state ^= rnd_state << 13;
+        rnd_state ^= rnd_state >> 17;
+        rnd_state ^= rnd_state << 5;
+        return rnd_state;
+}
+
+static void fill(uint8_t *buf, size_t len, pattern_t pattern)
+{
+        size_t i;
+
+        for (i = 0; i < len; i++) {
+                switch (pattern) {
+                case PATTERN_RANDOM:
+                        buf[i] = (uint8_t) rnd();
+                        break;
+                case PATTERN_PADDING:
+                        buf[i] = 0xFF;
+                        break;
+                case PATTERN_REPEATS:
+                        buf[i] = (i % 7 && i > 0) ? buf[i - 1] : (uint8_t) rnd();
+                        break;
+                case PATTERN_TEXT:
+                        buf[i] = "abcd"[rnd() % 4];
+                        break;
+                default:
+                        buf[i] = (i < len / 2) ? (uint8_t) rnd() : 0xFF;
+                        break;
+                }
+        }
+}
+
+static bool guard_intact(const uint8_t *guard)
+{
+        size_t i;
+
+        for (i = 0; i < GUARD_SIZE; i++) {
+                if (guard[i] != GUARD_BYTE) {
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+/* Compress and decompress block, check result and limits of both destination buffers */
+static bool round_trip(const uint8_t *src, size_t len, const char *what)
+{
+        static uint8_t packed[COMPRESS_BOUND(MAX_BLOCK_SIZE) + GUARD_SIZE];
+        static uint8_t unpacked[MAX_BLOCK_SIZE + GUARD_SIZE];
+        size_t packed_len, small_len;
+        int unpacked_len;
+
+        memset(packed, GUARD_BYTE, sizeof(packed));
+        packed_len = lz_block_compress(src, len, packed, COMPRESS_BOUND(len));
+        CHECK(packed_len > 0, "%s: %zu bytes not compressed", what, len);
+        CHECK(packed_len <= COMPRESS_BOUND(len), "%s: %zu bytes compressed to %zu", what, len,
+                                                                                packed_len);
+        CHECK(guard_intact(packed + COMPRESS_BOUND(len)), "%s: compression overflow", what);
+
+        memset(unpacked, GUARD_BYTE, sizeof(unpacked));
+        unpacked_len = lz_block_decompress(packed, packed_len, unpacked, len);
+        CHECK(unpacked_len == (int) len, "%s: %zu bytes decompressed to %d", what, len,
+                                                                                unpacked_len);
+        CHECK(memcmp(src, unpacked, len) == 0, "%s: %zu bytes differ after round trip", what,
+                                                                                        len);
+        CHECK(guard_intact(unpacked + len), "%s: decompression overflow", what);
+
+        /* Compressed data doesn't fit in smaller buffer, nothing is written past it */
+        for (small_len = packed_len > 16 ? packed_len - 16 : 0; small_len < packed_len;
+                                                                                small_len++) {
+                memset(packed + small_len, GUARD_BYTE, GUARD_SIZE);
+                CHECK(lz_block_compress(src, len, packed, small_len) == 0,
+                                "%s: %zu bytes compressed into %zu byte buffer", what, len,
+                                                                                small_len);
+                CHECK(guard_intact(packed + small_len), "%s: compression overflow at dst_size %zu",
+                                                                                what, small_len);
+        }
+
+        /* Exact size is enough */
+        CHECK(lz_block_compress(src, len, packed, packed_len) == packed_len,
+                                "%s: %zu bytes not compressed into exact buffer", what, len);
+
+        /* Decompressed data doesn't fit in smaller buffer */
+        if (len > 0) {
+                memset(unpacked, GUARD_BYTE, sizeof(unpacked));
+                CHECK(lz_block_decompress(packed, packed_len, unpacked, len - 1) == -1,
+                                "%s: %zu bytes decompressed into %zu byte buffer", what, len,
+                                                                                len - 1);
+                CHECK(guard_intact(unpacked + len - 1), "%s: decompression overflow", what);
+        }
+
+        return true;
+}
+
+static bool test_blocks(void)
+{
+        static uint8_t src[MAX_BLOCK_SIZE];
+        static const size_t sizes[] = {
+                64, 255, 256, 270, 1000, 4095, 4096, 4097, 0x2000, 0x3FFF, 0x8000, MAX_BLOCK_SIZE
+        };
+        char what[64];
+        size_t i;
+        int p;
+
+        for (p = 0; p < PATTERN_COUNT; p++) {
+                for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+                        fill(src, sizes[i], p);
+                        snprintf(what, sizeof(what), "%s block", pattern_names[p]);
+                        if (!round_trip(src, sizes[i], what)) {
+                                return false;
+                        }
+                }
+        }
+
+        return true;
+}
+
+/* Blocks shorter than minimal match and around the limits of the last sequence */
+static bool test_short_blocks(void)
+{
+        uint8_t src[64];
+        char what[64];
+        size_t len;
+        int p;
+
+        for (p = 0; p < PATTERN_COUNT; p++) {
+                for (len = 0; len <= sizeof(src); len++) {
+                        fill(src, len, p);
+                        snprintf(what, sizeof(what), "short %s block", pattern_names[p]);
+                        if (!round_trip(src, len, what)) {
+                                return false;
+                        }
+                }
+        }
+
+        return true;
+}
+
+/* Incompressible data must not grow more than by LZ4 worst case */
+static bool test_incompressible(void)
+{
+        static uint8_t src[MAX_BLOCK_SIZE];
+        static uint8_t packed[COMPRESS_BOUND(MAX_BLOCK_SIZE)];
+        size_t packed_len;
+
+        fill(src, sizeof(src), PATTERN_RANDOM);
+        packed_len = lz_block_compress(src, sizeof(src), packed, sizeof(packed));
+        CHECK(packed_len >= sizeof(src), "random data compressed to %zu bytes", packed_len);
+        printf("incompressible: %zu -> %zu bytes\n", sizeof(src), packed_len);
+
+        fill(src, sizeof(src), PATTERN_PADDING);
+        packed_len = lz_block_compress(src, sizeof(src), packed, sizeof(packed));
+        CHECK(packed_len > 0 && packed_len < 300, "padding compressed to %zu bytes", packed_len);
+        printf("padding: %zu -> %zu bytes\n", sizeof(src), packed_len);
+
+        return true;
+}
+
+/* Random sizes and patterns */
+static bool test_random(void)
+{
+        static uint8_t src[MAX_BLOCK_SIZE];
+        char what[64];
+        size_t len;
+        int i, p;
+
+        for (i = 0; i < 500; i++) {
+                len = rnd() % (0x3000 + 1);
+                p = rnd() % PATTERN_COUNT;
+                fill(src, len, p);
+                snprintf(what, sizeof(what), "random test %d (%s)", i, pattern_names[p]);
+                if (!round_trip(src, len, what)) {
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+/* Corrupted or truncated blocks are rejected without writing past destination buffer */
+static bool test_corrupted(void)
+{
+        static uint8_t src[0x1000];
+        static uint8_t packed[COMPRESS_BOUND(sizeof(src))];
+        static uint8_t unpacked[sizeof(src) + GUARD_SIZE];
+        /* literal 'a', then match with offset 0 */
+        static const uint8_t zero_offset[] = { 0x10, 'a', 0x00, 0x00 };
+        /* match with offset past start of output */
+        static const uint8_t far_offset[] = { 0x10, 'a', 0x02, 0x00 };
+        /* literal length extension missing */
+        static const uint8_t no_length[] = { 0xF0 };
+        size_t packed_len, len;
+        int ret;
+
+        CHECK(lz_block_decompress(zero_offset, sizeof(zero_offset), unpacked, sizeof(src)) == -1,
+                                                                "zero offset accepted");
+        CHECK(lz_block_decompress(far_offset, sizeof(far_offset), unpacked, sizeof(src)) == -1,
+                                                                "offset out of output accepted");
+        CHECK(lz_block_decompress(no_length, sizeof(no_length), unpacked, sizeof(src)) == -1,
+                                                                "truncated length accepted");
+
+        fill(src, sizeof(src), PATTERN_TEXT);
+        packed_len = lz_block_compress(src, sizeof(src), packed, sizeof(packed));
+        CHECK(packed_len > 0, "text block not compressed");
+
+        /* Truncated block either fails or produces less data, never more */
+        for (len = 0; len < packed_len; len++) {
+                memset(unpacked, GUARD_BYTE, sizeof(unpacked));
+                ret = lz_block_decompress(packed, len, unpacked, sizeof(src));
+                CHECK(ret < (int) sizeof(src), "block truncated to %zu bytes decompressed to %d",
+                                                                                len, ret);
+                CHECK(guard_intact(unpacked + sizeof(src)), "overflow of truncated block");
+        }
+
+        return true;
+}
+
+int main(void)
+{
+        test_short_blocks();
+        test_blocks();
+        test_incompressible();
+        test_random();
+        test_corrupted();
+
+        if (failures) {
+                printf("%d test(s) failed\n", failures);
+                return 1;
+        }
+
+        printf("All tests passed\n");
+        return 0;
+}
@@ -0,0 +1,321 @@
+/**
+ ****************************************************************************************
+ *
+ * @file uartboot_bench.c
+ *
+ * @brief Serial programming throughput benchmark on top of uartboot simulator
+ *
+ * Starts uartboot_sim on a pseudo terminal and programs its OQSPI FLASH through libprogrammer,
+ * the same way cli_programmer does: erase, write of incompressible and compressible data, read
+ * back and emptiness check. Throughput of each step is reported in bytes/s as seen by the host on
+ * stderr, the simulator adds its own per command report on stdout when the port is closed.
+ *
+ * Build from utilities/cli_programmer, together with uartboot_sim (see uartboot_sim.c):
+ *
+ *     gcc -O2 -Wall -Ilibprogrammer -Ilibprogrammer/api -I../../sdk/middleware/adapters/include \
+ *             -I../../sdk/bsp/include -I../../sdk/bsp/system/loaders/uartboot/include \
+ *             uartboot_sim/uartboot_bench.c libprogrammer/crc16.c libprogrammer/lz_block.c \
+ *             libprogrammer/programmer.c libprogrammer/protocol_cmds.c \
+ *             libprogrammer/serial_linux.c libprogrammer/gdb_server_cmds.c -lpthread \
+ *             -o uartboot_bench
+ *     ./uartboot_bench --sim ./uartboot_sim --size 1048576 --max-baudrate 3000000
+ *
+ * Options after "--" are passed to the simulator, e.g. "-- --latency-us 4000".
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <programmer.h>
+
+#define INITIAL_BAUDRATE        115200
+#define UARTBOOT_BAUDRATE       1000000
+#define SIM_START_TIMEOUT_MS    2000
+#define UART_TIMEOUT_MS         5000
+
+static struct {
+        const char *sim;                /* simulator executable */
+        uint32_t size;                  /* bytes written and read by each step */
+        uint32_t address;               /* OQSPI FLASH address, 2 * size bytes are used */
+        unsigned int max_baudrate;      /* baud rate negotiated with uartboot, 0 for none */
+        unsigned int window;            /* chunks in flight */
+        bool no_compress;               /* don't use compressed transfer */
+} cfg = {
+        /* .sim = */                    "./uartboot_sim",
+        /* .size = */                   0x100000,
+        /* .address = */                0,
+        /* .max_baudrate = */           0,
+        /* .window = */                 8,
+        /* .no_compress = */            false,
+};
+
+static double now_s(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *step, uint32_t bytes, double start)
+{
+        const double t = now_s() - start;
+
+        /* stdout is shared with debug output of libprogrammer and simulator report */
+        fprintf(stderr, "%-24s %10u bytes %8.3f s %12.0f bytes/s\n", step, bytes, t,
+                                                                        t > 0 ? bytes / t : 0);
+}
+
+static void usage(const char *name)
+{
+        printf("usage: %s [options] [-- simulator options]\n"
+                "options:\n"
+                "    --sim <path>             uartboot_sim executable (default %s)\n"
+                "    --size <bytes>           data size of each step (default %u)\n"
+                "    --address <address>      OQSPI FLASH address (default 0x%x)\n"
+                "    --max-baudrate <rate>    negotiate baud rate with uartboot\n"
+                "    --window <chunks>        chunks in flight (default %u)\n"
+                "    --no-compress            don't compress written data\n",
+                name, cfg.sim, cfg.size, cfg.address, cfg.window);
+}
+
+static bool parse_args(int argc, char **argv)
+{
+        static const struct option options[] = {
+                { "sim",          required_argument, NULL, 's' },
+                { "size",         required_argument, NULL, 'S' },
+                { "address",      required_argument, NULL, 'a' },
+                { "max-baudrate", required_argument, NULL, 'b' },
+                { "window",       required_argument, NULL, 'w' },
+                { "no-compress",  no_argument,       NULL, 'n' },
+                { "help",         no_argument,       NULL, 'h' },
+                { NULL, 0, NULL, 0 },
+        };
+        int opt;
+
+        while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+                switch (opt) {
+                case 's':
+                        cfg.sim = optarg;
+                        break;
+                case 'S':
+                        cfg.size = strtoul(optarg, NULL, 0);
+                        break;
+                case 'a':
+                        cfg.address = strtoul(optarg, NULL, 0);
+                        break;
+                case 'b':
+                        cfg.max_baudrate = strtoul(optarg, NULL, 0);
+                        break;
+                case 'w':
+                        cfg.window = strtoul(optarg, NULL, 0);
+                        break;
+                case 'n':
+                        cfg.no_compress = true;
+                        break;
+                default:
+                        usage(argv[0]);
+                        return false;
+                }
+        }
+
+        if (cfg.size == 0) {
+                fprintf(stderr, "Size must not be 0\n");
+                return false;
+        }
+
+        return true;
+}
+
+/* run simulator on pty linked to given path, remaining arguments are passed to it */
+static pid_t start_sim(const char *link, int argc, char **argv)
+{
+        char **args;
+        struct stat st;
+        double start;
+        pid_t pid;
+        int i;
+
+        args = calloc(argc + 5, sizeof(*args));
+        if (!args) {
+                return -1;
+        }
+        args[0] = (char *) cfg.sim;
+        args[1] = "--once";
+        args[2] = "--link";
+        args[3] = (char *) link;
+        for (i = 0; i < argc; i++) {
+                args[4 + i] = argv[i];
+        }
+
+        unlink(link);
+
+        pid = fork();
+        if (pid == 0) {
+                execv(cfg.sim, args);
+                perror(cfg.sim);
+                _exit(127);
+        }
+        free(args);
+
+        if (pid < 0) {
+                return -1;
+        }
+
+        /* link is created when pty is ready */
+        start = now_s();
+        while (lstat(link, &st) != 0) {
+                if (now_s() - start > SIM_START_TIMEOUT_MS / 1000.0 ||
+                                                        waitpid(pid, NULL, WNOHANG) == pid) {
+                        fprintf(stderr, "Simulator didn't start\n");
+                        kill(pid, SIGTERM);
+                        waitpid(pid, NULL, 0);
+                        return -1;
+                }
+                usleep(10000);
+        }
+
+        return pid;
+}
+
+static int run_benchmark(const char *port)
+{
+        /* ROM bootloader of the simulator starts uartboot with any executable */
+        static uint8_t uartboot_code[256];
+        uint8_t *data = malloc(cfg.size);
+        uint8_t *readback = malloc(cfg.size);
+        int empty = 0;
+        double start;
+        uint32_t i;
+        int err;
+
+        if (!data || !readback) {
+                err = ERR_ALLOC_FAILED;
+                goto done;
+        }
+
+        prog_set_chip_rev(CHIP_REV_700AB);
+        prog_set_initial_baudrate(INITIAL_BAUDRATE);
+        prog_set_uart_boot_loader(uartboot_code, sizeof(uartboot_code));
+        prog_set_protocol_window(cfg.window);
+        prog_set_compressed_transfer(!cfg.no_compress);
+        prog_set_max_baudrate(cfg.max_baudrate);
+
+        err = prog_serial_open(port, UARTBOOT_BAUDRATE);
+        if (err) {
+                goto done;
+        }
+
+        /* uartboot upload and baud rate negotiation are not part of any step */
+        prog_set_uart_timeout(UART_TIMEOUT_MS);
+        start = now_s();
+        if (prog_verify_connection() != CONN_ESTABLISHED &&
+                                                (err = prog_upload_bootloader()) != 0) {
+                goto close;
+        }
+        report("connect", 0, start);
+
+        start = now_s();
+        if ((err = prog_erase_oqspi(cfg.address, cfg.size)) != 0) {
+                goto close;
+        }
+        report("erase", cfg.size, start);
+
+        start = now_s();
+        if ((err = prog_is_empty_oqspi(cfg.size, cfg.address, &empty)) != 0) {
+                goto close;
+        }
+        report("is_empty", cfg.size, start);
+
+        /* incompressible data */
+        srand(1);
+        for (i = 0; i < cfg.size; i++) {
+                data[i] = (uint8_t) rand();
+        }
+        start = now_s();
+        if ((err = prog_write_to_oqspi(cfg.address, data, cfg.size)) != 0) {
+                goto close;
+        }
+        report("write (random)", cfg.size, start);
+
+        start = now_s();
+        if ((err = prog_read_oqspi(cfg.address, readback, cfg.size)) != 0) {
+                goto close;
+        }
+        report("read", cfg.size, start);
+
+        if (memcmp(data, readback, cfg.size)) {
+                fprintf(stderr, "Read data differs from written\n");
+                err = ERR_FAILED;
+                goto close;
+        }
+
+        /* image-like data: code followed by padding, written to erased area after the first one */
+        memset(data + cfg.size / 4, 0xFF, cfg.size - cfg.size / 4);
+        start = now_s();
+        if ((err = prog_write_to_oqspi(cfg.address + cfg.size, data, cfg.size)) != 0) {
+                goto close;
+        }
+        report("write (3/4 padding)", cfg.size, start);
+
+        if ((err = prog_read_oqspi(cfg.address + cfg.size, readback, cfg.size)) != 0) {
+                goto close;
+        }
+        if (memcmp(data, readback, cfg.size)) {
+                fprintf(stderr, "Read data differs from written\n");
+                err = ERR_FAILED;
+        }
+
+close:
+        prog_serial_close(0);
+done:
+        free(data);
+        free(readback);
+
+        return err;
+}
+
+int main(int argc, char **argv)
+{
+        char link[64];
+        int status;
+        pid_t pid;
+        int err;
+
+        if (!parse_args(argc, argv)) {
+                return 1;
+        }
+
+        snprintf(link, sizeof(link), "/tmp/uartboot_bench.%d", (int) getpid());
+        pid = start_sim(link, argc - optind, argv + optind);
+        if (pid < 0) {
+                return 1;
+        }
+
+        err = run_benchmark(link);
+        if (err) {
+                fprintf(stderr, "Benchmark failed: %s (%d)\n", prog_get_err_message(err), err);
+                kill(pid, SIGTERM);
+        }
+
+        /* simulator prints its report and exits when the port is closed */
+        waitpid(pid, &status, 0);
+        unlink(link);
+
+        return err ? 1 : 0;
+}
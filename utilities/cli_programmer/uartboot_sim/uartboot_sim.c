@@ -0,0 +1,1991 @@
+/**
+ ****************************************************************************************
+ *
+ * @file uartboot_sim.c
+ *
+ * @brief Host simulator of DA1470x ROM bootloader and uartboot
+ *
+ * Device is simulated on a pseudo terminal, cli_programmer (or any other libprogrammer client)
+ * uses its slave side as a serial port. ROM bootloader accepts any executable and starts the
+ * simulated uartboot, which implements CMD_* handlers of uartboot main.c on top of in-memory
+ * QSPI and OQSPI FLASH models. UART wire time (taken from baud rate set by the host), adapter
+ * latency and FLASH erase/program timings are simulated, so throughput of each command class is
+ * close to the one of real hardware. It is reported when the host closes the port.
+ *
+ * Build from utilities/cli_programmer:
+ *
+ *     gcc -O2 -Wall -Ilibprogrammer -I../../sdk/middleware/adapters/include \
+ *             -I../../sdk/bsp/include -I../../sdk/bsp/system/loaders/uartboot/include \
+ *             uartboot_sim/uartboot_sim.c libprogrammer/crc16.c libprogrammer/lz_block.c \
+ *             -o uartboot_sim
+ *
+ * uartboot_bench.c runs a throughput benchmark against it.
+ *
+ * Copyright (C) 2026 Dialog Semiconductor.
+ * This computer program includes Confidential, Proprietary Information
+ * of Dialog Semiconductor. All Rights Reserved.
+ *
+ ****************************************************************************************
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+#include "protocol.h"
+#include "partition_def.h"
+#include "uartboot_types.h"
+#include "crc16.h"
+#include "lz_block.h"
+
+#define ADDRESS_TMP             (0xFFFFFFFF)
+#define VIRTUAL_BUF_ADDRESS     (0x80000000)
+#define VIRTUAL_BUF_MASK        (0xFFF00000)
+#define IS_EMPTY_CHECK_SIZE     2048
+#define WINDOW_SLOT_SIZE(chunk_size)    (((chunk_size) + sizeof(uint16_t) + 3) & ~3)
+#define OTP_CELL_NUM            (0x400)
+#define UARTBOOT_LIVE_MARKER    "Live"
+
+/* uartboot timeouts, in ms */
+#define TMO_COMMAND             2000
+#define TMO_DATA                5000
+#define TMO_ACK                 3000
+
+#define INPUT_BUFFER_SIZE       (0x40000)
+#define FLASH_SECTOR_SIZE       (0x1000)
+#define FLASH_PAGE_SIZE         (0x100)
+
+/* ROM bootloader announces itself with STX, uartboot sends hello message once per second */
+#define ROM_ANNOUNCE_PERIOD_MS  100
+#define HELLO_PERIOD_MS         1000
+
+/* memory identifiers for FLASH models, same values as PROTOCOL_MEM_* */
+#define MEM_QSPI                PROTOCOL_MEM_QSPI
+#define MEM_OQSPI               PROTOCOL_MEM_OQSPI
+
+#define MIN(a, b)               ((a) < (b) ? (a) : (b))
+#define MAX(a, b)               ((a) > (b) ? (a) : (b))
+#define ARRAY_LENGTH(a)         (sizeof(a) / sizeof((a)[0]))
+
+typedef enum {
+        HOP_INIT,
+        HOP_HEADER,
+        HOP_DATA,
+        HOP_EXEC,
+        HOP_SEND_LEN,
+        HOP_SEND_DATA,
+} HANDLER_OP;
+
+/* command classes throughput is reported for */
+typedef enum {
+        STAT_WRITE,
+        STAT_READ,
+        STAT_ERASE,
+        STAT_IS_EMPTY,
+        STAT_PARTITION,
+        STAT_OTHER,
+        STAT_COUNT,
+} stat_class_t;
+
+static const char *const stat_names[STAT_COUNT] = {
+        "write", "read", "erase", "is_empty", "partition", "other",
+};
+
+typedef struct {
+        unsigned int count;             /* number of commands */
+        unsigned int failed;            /* number of NAKed commands */
+        uint64_t bytes;                 /* data bytes written, read, erased or checked */
+        long long time_ns;              /* time from command header to its completion */
+} stat_t;
+
+/* simulation parameters */
+static struct {
+        uint32_t oqspi_size;            /* OQSPI FLASH size in bytes */
+        uint32_t qspi_size;             /* QSPI FLASH size in bytes, 0 if not connected */
+        unsigned int latency_us;        /* delay before device response reaches the host */
+        unsigned int erase_us;          /* sector erase time */
+        unsigned int program_us;        /* page program time */
+        unsigned int chip_erase_ms;     /* chip erase time */
+        bool start_uartboot;            /* skip ROM bootloader stage */
+        bool once;                      /* exit when host closes the port */
+        const char *link;               /* symlink created to pty slave */
+        const char *report;             /* file the report is appended to */
+} cfg = {
+        /* .oqspi_size = */             8 * 1024 * 1024,
+        /* .qspi_size = */              0,
+        /* .latency_us = */             1000,
+        /* .erase_us = */               30000,
+        /* .program_us = */             250,
+        /* .chip_erase_ms = */          3000,
+        /* .start_uartboot = */         false,
+        /* .once = */                   false,
+        /* .link = */                   NULL,
+        /* .report = */                 NULL,
+};
+
+/* pty and simulated UART wire */
+static struct {
+        int fd;                         /* pty master */
+        bool hangup;                    /* host closed the port */
+        bool turnaround;                /* host transmitted since device's last response */
+        long long rx_end_ns;            /* time last received byte finished on the wire */
+        long long tx_end_ns;            /* time last sent byte finishes on the wire */
+        uint64_t rx_bytes;
+        uint64_t tx_bytes;
+} line;
+
+/* device memories */
+static uint8_t input_buffer[INPUT_BUFFER_SIZE];
+static uint8_t sink_buffer[INPUT_BUFFER_SIZE];  /* RAM outside of input buffer, not kept */
+static uint8_t *flash[3];                       /* indexed by MEM_QSPI or MEM_OQSPI */
+static uint32_t flash_size[3];
+static uint32_t otp[OTP_CELL_NUM];
+
+static stat_t stats[STAT_COUNT];
+static long long session_start_ns;
+static volatile sig_atomic_t terminate;
+
+/* state of incoming command handler, as in uartboot */
+static struct cmd_state {
+        uint8_t type;
+        uint16_t len;
+        uint8_t hdr[16];
+        uint16_t hdr_len;
+        uint8_t *data;
+        uint16_t data_len;
+        bool (*handler)(HANDLER_OP);
+        stat_class_t stat;
+        uint64_t bytes;                 /* data bytes processed, for statistics */
+        uint16_t crc;
+} cmd_state;
+
+/* state of windowed transfer, kept between commands */
+static struct window_state {
+        uint8_t max;
+        uint16_t chunk_size;
+        uint8_t mem;
+        uint8_t total;
+        uint16_t received;
+        window_frame_hdr_t frame[WINDOW_MAX_CHUNKS];
+        window_status_t status;
+} window;
+
+static bool uartboot_running;
+static bool reboot_requested;
+
+/* partition layout of 8M OQSPI FLASH configuration */
+static const struct {
+        uint8_t type;
+        const char *name;
+        uint32_t start;
+        uint32_t size;
+} partitions[] = {
+        { NVMS_PRODUCT_HEADER_PART, "NVMS_PRODUCT_HEADER_PART", 0x00000000, 0x00002000 },
+        { NVMS_PARTITION_TABLE,     "NVMS_PARTITION_TABLE",     0x00002000, 0x00001000 },
+        { NVMS_FIRMWARE_PART,       "NVMS_FIRMWARE_PART",       0x00003000, 0x006FD000 },
+        { NVMS_GENERIC_PART,        "NVMS_GENERIC_PART",        0x00400000, 0x00080000 },
+        { NVMS_LOG_PART,            "NVMS_LOG_PART",            0x00480000, 0x00280000 },
+        { NVMS_BIN_PART,            "NVMS_BIN_PART",            0x00700000, 0x000FF000 },
+        { NVMS_PARAM_PART,          "NVMS_PARAM_PART",          0x007FF000, 0x00001000 },
+};
+
+static long long now_ns(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleep_until(long long t_ns)
+{
+        struct timespec ts;
+
+        if (t_ns <= now_ns()) {
+                return;
+        }
+
+        ts.tv_sec = t_ns / 1000000000LL;
+        ts.tv_nsec = t_ns % 1000000000LL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR &&
+                                                                                !terminate) {
+        }
+}
+
+static void busy(long long duration_ns)
+{
+        sleep_until(now_ns() + duration_ns);
+}
+
+static inline uint16_t get_u16(const uint8_t *p)
+{
+        return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/* time of one byte on the wire at the baud rate host has set on the slave side */
+static long long byte_time_ns(void)
+{
+        struct termios2 tios;
+
+        if (ioctl(line.fd, TCGETS2, &tios) < 0 || tios.c_ospeed == 0) {
+                return 0;
+        }
+
+        return 10 * 1000000000LL / tios.c_ospeed;
+}
+
+/*
+ * Receive exactly len bytes, returns false on timeout or when the host closed the port. Bytes are
+ * delivered no sooner than they would be received over the wire.
+ */
+static bool recv_with_tmo(uint8_t *buf, size_t len, int timeout_ms)
+{
+        const long long deadline = now_ns() + (long long) timeout_ms * 1000000LL;
+        size_t got = 0;
+
+        while (got < len) {
+                struct pollfd pfd = { line.fd, POLLIN, 0 };
+                const long long left_ns = deadline - now_ns();
+                ssize_t r;
+                int ret;
+
+                if (terminate || line.hangup) {
+                        return false;
+                }
+
+                ret = poll(&pfd, 1, left_ns > 0 ? (int) ((left_ns + 999999) / 1000000) : 0);
+                if (ret < 0 && errno == EINTR) {
+                        continue;
+                }
+                if (ret <= 0) {
+                        return false;
+                }
+                if (!(pfd.revents & POLLIN)) {
+                        line.hangup = (pfd.revents & POLLHUP) != 0;
+                        continue;
+                }
+
+                r = read(line.fd, buf + got, len - got);
+                if (r < 0) {
+                        if (errno == EAGAIN || errno == EINTR) {
+                                continue;
+                        }
+                        /* EIO - slave side closed */
+                        line.hangup = true;
+                        return false;
+                }
+
+                line.rx_end_ns = MAX(line.rx_end_ns, now_ns()) + r * byte_time_ns();
+                line.rx_bytes += r;
+                line.turnaround = true;
+                got += r;
+        }
+
+        sleep_until(line.rx_end_ns);
+
+        return true;
+}
+
+/* drop anything the host sends until the line is quiet for timeout_ms */
+static void drain_input(int timeout_ms)
+{
+        uint8_t c;
+
+        while (recv_with_tmo(&c, 1, timeout_ms)) {
+        }
+}
+
+static void xmit_raw(const void *_buf, size_t len)
+{
+        const uint8_t *buf = _buf;
+        const long long bt = byte_time_ns();
+
+        if (line.hangup) {
+                return;
+        }
+
+        /* response reaches the host after adapter's latency */
+        if (line.turnaround) {
+                line.turnaround = false;
+                line.tx_end_ns = MAX(line.tx_end_ns, now_ns()) + cfg.latency_us * 1000LL;
+        }
+
+        while (len > 0) {
+                const size_t n = MIN(len, 64);
+                size_t off = 0;
+
+                line.tx_end_ns = MAX(line.tx_end_ns, now_ns()) + n * bt;
+                sleep_until(line.tx_end_ns);
+
+                while (off < n) {
+                        ssize_t w = write(line.fd, buf + off, n - off);
+
+                        if (w < 0 && errno == EAGAIN) {
+                                struct pollfd pfd = { line.fd, POLLOUT, 0 };
+
+                                if (poll(&pfd, 1, 1000) <= 0) {
+                                        line.hangup = true;
+                                        return;
+                                }
+                                continue;
+                        }
+                        if (w < 0) {
+                                if (errno != EINTR) {
+                                        line.hangup = true;
+                                        return;
+                                }
+                                continue;
+                        }
+                        off += w;
+                }
+
+                line.tx_bytes += n;
+                buf += n;
+                len -= n;
+        }
+}
+
+static void xmit_ack(void)
+{
+        const uint8_t c = ACK;
+
+        xmit_raw(&c, 1);
+}
+
+static void xmit_nak(void)
+{
+        const uint8_t c = NAK;
+
+        xmit_raw(&c, 1);
+}
+
+static void xmit_crc16(uint16_t crc)
+{
+        const uint8_t buf[2] = { (uint8_t) crc, (uint8_t) (crc >> 8) };
+
+        xmit_raw(buf, sizeof(buf));
+}
+
+static void xmit_data(const void *buf, uint16_t len)
+{
+        crc16_update(&cmd_state.crc, buf, len);
+        xmit_raw(buf, len);
+}
+
+static void xmit_u16(uint16_t val)
+{
+        const uint8_t buf[2] = { (uint8_t) val, (uint8_t) (val >> 8) };
+
+        xmit_data(buf, sizeof(buf));
+}
+
+/*
+ * RAM model - only the input buffer keeps data. Raw addresses (SysRAM, registers) accept writes
+ * and read as zeros.
+ */
+static bool check_ram_addr(uint32_t addr, uint32_t size)
+{
+        if (addr == ADDRESS_TMP) {
+                addr = 0;
+        } else if ((addr & VIRTUAL_BUF_MASK) == VIRTUAL_BUF_ADDRESS) {
+                addr &= ~VIRTUAL_BUF_MASK;
+        } else {
+                return size <= sizeof(sink_buffer);
+        }
+
+        return addr + size <= INPUT_BUFFER_SIZE;
+}
+
+static bool is_input_buffer_addr(uint32_t addr)
+{
+        return addr == ADDRESS_TMP || (addr & VIRTUAL_BUF_MASK) == VIRTUAL_BUF_ADDRESS;
+}
+
+static uint8_t *translate_ram_addr(uint32_t addr)
+{
+        if (addr == ADDRESS_TMP) {
+                return input_buffer;
+        } else if ((addr & VIRTUAL_BUF_MASK) == VIRTUAL_BUF_ADDRESS) {
+                return input_buffer + (addr & ~VIRTUAL_BUF_MASK);
+        }
+
+        memset(sink_buffer, 0, sizeof(sink_buffer));
+
+        return sink_buffer;
+}
+
+/* NOR FLASH model, bits can only be cleared by programming */
+static bool flash_range_valid(uint8_t mem, uint32_t addr, uint32_t len)
+{
+        return flash[mem] && addr <= flash_size[mem] && len <= flash_size[mem] - addr;
+}
+
+static bool flash_read(uint8_t mem, uint32_t addr, uint8_t *buf, uint32_t len)
+{
+        if (!flash_range_valid(mem, addr, len)) {
+                return false;
+        }
+
+        memcpy(buf, flash[mem] + addr, len);
+
+        return true;
+}
+
+static void flash_program(uint8_t mem, uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+        const uint32_t pages = (addr + len - 1) / FLASH_PAGE_SIZE - addr / FLASH_PAGE_SIZE + 1;
+        uint32_t i;
+
+        for (i = 0; i < len; i++) {
+                flash[mem][addr + i] &= buf[i];
+        }
+
+        busy((long long) pages * cfg.program_us * 1000);
+}
+
+static bool flash_erase_region(uint8_t mem, uint32_t addr, uint32_t len)
+{
+        const uint32_t start = addr & ~(FLASH_SECTOR_SIZE - 1);
+        const uint32_t end = (addr + len + FLASH_SECTOR_SIZE - 1) & ~(FLASH_SECTOR_SIZE - 1);
+
+        if (len == 0 || !flash_range_valid(mem, start, end - start)) {
+                return false;
+        }
+
+        memset(flash[mem] + start, 0xFF, end - start);
+        busy((long long) (end - start) / FLASH_SECTOR_SIZE * cfg.erase_us * 1000);
+
+        return true;
+}
+
+/*
+ * Same as ad_flash_update_possible() - offset of first byte to write, len if data is the same,
+ * -1 if erase is needed.
+ */
+static int flash_update_possible(uint8_t mem, uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+        const uint8_t *old = flash[mem] + addr;
+        int first = -1;
+        uint32_t i;
+
+        for (i = 0; i < len; i++) {
+                if (old[i] == buf[i]) {
+                        continue;
+                }
+                if ((old[i] & buf[i]) != buf[i]) {
+                        return -1;
+                }
+                if (first < 0) {
+                        first = i;
+                }
+        }
+
+        return first < 0 ? (int) len : first;
+}
+
+/* port of uartboot's safe_flash_write(), erases sectors only if needed */
+static bool flash_write(uint8_t mem, uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+        static uint8_t sector[FLASH_SECTOR_SIZE];
+
+        if (!flash_range_valid(mem, addr, len)) {
+                return false;
+        }
+
+        cmd_state.bytes += len;
+
+        while (len > 0) {
+                const uint32_t sector_start = addr & ~(FLASH_SECTOR_SIZE - 1);
+                const uint32_t sector_offset = addr - sector_start;
+                const uint32_t chunk = MIN(len, FLASH_SECTOR_SIZE - sector_offset);
+                const int off = flash_update_possible(mem, addr, buf, chunk);
+
+                if (off >= 0) {
+                        if (off < (int) chunk) {
+                                flash_program(mem, addr + off, buf + off, chunk - off);
+                        }
+                } else {
+                        memcpy(sector, flash[mem] + sector_start, FLASH_SECTOR_SIZE);
+                        memcpy(sector + sector_offset, buf, chunk);
+                        flash_erase_region(mem, sector_start, FLASH_SECTOR_SIZE);
+                        flash_program(mem, sector_start, sector, FLASH_SECTOR_SIZE);
+                }
+
+                addr += chunk;
+                buf += chunk;
+                len -= chunk;
+        }
+
+        return true;
+}
+
+static const uint32_t crc32_tab[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158,
+        0x5005713c, 0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4,
+        0xa00ae278, 0xbdbdf21c,
+};
+
+static uint32_t crc32_calc(const uint8_t *buf, size_t len)
+{
+        uint32_t crc = ~0;
+
+        while (len--) {
+                crc = crc32_tab[(crc ^ *buf) & 0x0F] ^ (crc >> 4);
+                crc = crc32_tab[(crc ^ (*buf >> 4)) & 0x0F] ^ (crc >> 4);
+                buf++;
+        }
+
+        return ~crc;
+}
+
+static bool cmd_send_to_ram(HANDLER_OP hop)
+{
+        const uint32_t ptr = get_u32(cmd_state.hdr);
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len > 0;
+        case HOP_HEADER:
+                if (!check_ram_addr(ptr, cmd_state.data_len)) {
+                        return false;
+                }
+                cmd_state.data = translate_ram_addr(ptr);
+                return true;
+        case HOP_DATA:
+                return true;
+        case HOP_EXEC:
+                cmd_state.bytes = cmd_state.data_len;
+                return true;
+        default:
+                return false;
+        }
+}
+
+static bool cmd_read_from_ram(HANDLER_OP hop)
+{
+        const uint32_t ptr = get_u32(cmd_state.hdr);
+        const uint16_t len = get_u16(cmd_state.hdr + 4);
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+        case HOP_DATA:
+        case HOP_EXEC:
+                return true;
+        case HOP_SEND_LEN:
+                xmit_u16(len);
+                return true;
+        case HOP_SEND_DATA:
+                if (!check_ram_addr(ptr, len)) {
+                        return false;
+                }
+                xmit_data(translate_ram_addr(ptr), len);
+                cmd_state.bytes = len;
+                return true;
+        }
+
+        return false;
+}
+
+/* CMD_COPY_QSPI and CMD_COPY_OQSPI */
+static bool copy_to_flash(HANDLER_OP hop, uint8_t mem)
+{
+        const uint32_t ptr = get_u32(cmd_state.hdr);
+        const uint16_t len = get_u16(cmd_state.hdr + 4);
+        const uint32_t addr = get_u32(cmd_state.hdr + 6);
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+                return true;
+        case HOP_DATA:
+                return check_ram_addr(ptr, len);
+        case HOP_EXEC:
+                return flash_write(mem, addr, translate_ram_addr(ptr), len);
+        default:
+                return false;
+        }
+}
+
+static bool cmd_write_ram_to_qspi(HANDLER_OP hop)
+{
+        return copy_to_flash(hop, MEM_QSPI);
+}
+
+static bool cmd_write_ram_to_oqspi(HANDLER_OP hop)
+{
+        return copy_to_flash(hop, MEM_OQSPI);
+}
+
+static bool erase_flash(HANDLER_OP hop, uint8_t mem)
+{
+        const uint32_t addr = get_u32(cmd_state.hdr);
+        const uint32_t len = get_u32(cmd_state.hdr + 4);
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+                return true;
+        case HOP_DATA:
+                return len > 0;
+        case HOP_EXEC:
+                cmd_state.bytes = len;
+                return flash_erase_region(mem, addr, len);
+        default:
+                return false;
+        }
+}
+
+static bool cmd_erase_qspi(HANDLER_OP hop)
+{
+        return erase_flash(hop, MEM_QSPI);
+}
+
+static bool cmd_erase_oqspi(HANDLER_OP hop)
+{
+        return erase_flash(hop, MEM_OQSPI);
+}
+
+static bool chip_erase_flash(HANDLER_OP hop, uint8_t mem)
+{
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+        case HOP_DATA:
+                return true;
+        case HOP_EXEC:
+                if (!flash[mem]) {
+                        return false;
+                }
+                memset(flash[mem], 0xFF, flash_size[mem]);
+                busy(cfg.chip_erase_ms * 1000000LL);
+                cmd_state.bytes = flash_size[mem];
+                return true;
+        default:
+                return false;
+        }
+}
+
+static bool cmd_chip_erase_qspi(HANDLER_OP hop)
+{
+        return chip_erase_flash(hop, MEM_QSPI);
+}
+
+static bool cmd_chip_erase_oqspi(HANDLER_OP hop)
+{
+        return chip_erase_flash(hop, MEM_OQSPI);
+}
+
+static bool cmd_execute_code(HANDLER_OP hop)
+{
+        const uint32_t addr = get_u32(cmd_state.hdr);
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+        case HOP_DATA:
+                return true;
+        case HOP_EXEC:
+                if (!check_ram_addr(addr, 1)) {
+                        return false;
+                }
+                xmit_ack();
+                /* executable in input buffer is started after reset, ROM bootloader runs then */
+                if (translate_ram_addr(addr) == input_buffer) {
+                        reboot_requested = true;
+                }
+                return true;
+        default:
+                return false;
+        }
+}
+
+static bool cmd_write_otp(HANDLER_OP hop)
+{
+        const uint32_t addr = get_u32(cmd_state.hdr);
+        uint32_t i;
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len > 0 && (cmd_state.data_len & 0x03) == 0;
+        case HOP_HEADER:
+                return true;
+        case HOP_DATA:
+                return addr < OTP_CELL_NUM && cmd_state.data_len / 4 <= OTP_CELL_NUM - addr;
+        case HOP_EXEC:
+                for (i = 0; i < cmd_state.data_len / 4u; i++) {
+                        otp[addr + i] |= get_u32(cmd_state.data + i * 4);
+                }
+                return true;
+        default:
+                return false;
+        }
+}
+
+static bool cmd_read_otp(HANDLER_OP hop)
+{
+        const uint32_t addr = get_u32(cmd_state.hdr);
+        const uint16_t len = get_u16(cmd_state.hdr + 4);
+        uint32_t i;
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+                return true;
+        case HOP_DATA:
+                return addr < OTP_CELL_NUM && len <= OTP_CELL_NUM - addr;
+        case HOP_EXEC:
+                for (i = 0; i < len; i++) {
+                        memcpy(cmd_state.data + i * 4, &otp[addr + i], 4);
+                }
+                return true;
+        case HOP_SEND_LEN:
+                xmit_u16(len * 4);
+                return true;
+        case HOP_SEND_DATA:
+                xmit_data(cmd_state.data, len * 4);
+                return true;
+        }
+
+        return false;
+}
+
+static bool read_flash(HANDLER_OP hop, uint8_t mem)
+{
+        const uint32_t addr = get_u32(cmd_state.hdr);
+        const uint16_t len = get_u16(cmd_state.hdr + 4);
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+        case HOP_DATA:
+                return true;
+        case HOP_EXEC:
+                cmd_state.bytes = len;
+                return flash_read(mem, addr, cmd_state.data, len);
+        case HOP_SEND_LEN:
+                xmit_u16(len);
+                return true;
+        case HOP_SEND_DATA:
+                xmit_data(cmd_state.data, len);
+                return true;
+        }
+
+        return false;
+}
+
+static bool cmd_read_qspi(HANDLER_OP hop)
+{
+        return read_flash(hop, MEM_QSPI);
+}
+
+static bool cmd_read_oqspi(HANDLER_OP hop)
+{
+        return read_flash(hop, MEM_OQSPI);
+}
+
+static void window_negotiate(const uint8_t *req)
+{
+        const uint8_t requested = req[0];
+        const uint16_t chunk_size = get_u16(req + 1);
+        uint32_t slots;
+
+        memset(&window, 0, sizeof(window));
+
+        if (chunk_size == 0) {
+                return;
+        }
+
+        slots = INPUT_BUFFER_SIZE / WINDOW_SLOT_SIZE(chunk_size);
+        if (slots < 3) {
+                return;
+        }
+
+        window.max = MIN(MIN(requested, WINDOW_MAX_CHUNKS), slots - 2);
+        window.chunk_size = chunk_size;
+}
+
+static bool cmd_get_version(HANDLER_OP hop)
+{
+        static const uint8_t window_caps = WINDOW_CAP_COMPRESSION;
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0 || cmd_state.data_len == sizeof(window_request_t);
+        case HOP_HEADER:
+        case HOP_DATA:
+                return true;
+        case HOP_EXEC:
+                if (cmd_state.data_len) {
+                        window_negotiate(cmd_state.data);
+                }
+                return true;
+        case HOP_SEND_LEN:
+                if (cmd_state.data_len) {
+                        xmit_u16(sizeof(UARTBOOT_VERSION_STR) + sizeof(window.max) + 1);
+                } else {
+                        xmit_u16(sizeof(UARTBOOT_VERSION_STR) - 1);
+                }
+                return true;
+        case HOP_SEND_DATA:
+                if (cmd_state.data_len) {
+                        xmit_data(UARTBOOT_VERSION_STR, sizeof(UARTBOOT_VERSION_STR));
+                        xmit_data(&window.max, sizeof(window.max));
+                        xmit_data(&window_caps, sizeof(window_caps));
+                } else {
+                        xmit_data(UARTBOOT_VERSION_STR, sizeof(UARTBOOT_VERSION_STR) - 1);
+                }
+                return true;
+        }
+
+        return false;
+}
+
+static bool is_empty_flash(HANDLER_OP hop, uint8_t mem)
+{
+        static int32_t return_val;
+        const uint32_t size = get_u32(cmd_state.hdr);
+        const uint32_t start = get_u32(cmd_state.hdr + 4);
+        uint32_t i;
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+                return true;
+        case HOP_DATA:
+                return size != 0;
+        case HOP_EXEC:
+                if (!flash_range_valid(mem, start, size)) {
+                        return false;
+                }
+                cmd_state.bytes = size;
+                return_val = (int32_t) size;
+                for (i = 0; i < size; i++) {
+                        if (flash[mem][start + i] != 0xFF) {
+                                return_val = -(int32_t) i;
+                                break;
+                        }
+                }
+                return true;
+        case HOP_SEND_LEN:
+                xmit_u16(sizeof(return_val));
+                return true;
+        case HOP_SEND_DATA:
+                xmit_data(&return_val, sizeof(return_val));
+                return true;
+        }
+
+        return false;
+}
+
+static bool cmd_is_empty_qspi(HANDLER_OP hop)
+{
+        return is_empty_flash(hop, MEM_QSPI);
+}
+
+static bool cmd_is_empty_oqspi(HANDLER_OP hop)
+{
+        return is_empty_flash(hop, MEM_OQSPI);
+}
+
+/* same layout as built by uartboot's piggy_back_partition_table() */
+static void build_partition_table(uint8_t *ram)
+{
+        cmd_partition_table_t *table = (cmd_partition_table_t *) ram;
+        uint8_t *entry_ptr = (uint8_t *) &table->entry;
+        size_t i;
+
+        table->len = 0;
+
+        for (i = 0; i < ARRAY_LENGTH(partitions); i++) {
+                cmd_partition_entry_t *entry = (cmd_partition_entry_t *) entry_ptr;
+                const size_t name_len = strlen(partitions[i].name) + 1;
+                uint16_t entry_size;
+
+                entry->start_address = partitions[i].start;
+                entry->size = partitions[i].size;
+                entry->sector_size = FLASH_SECTOR_SIZE;
+                entry->type = partitions[i].type;
+                memcpy(&entry->name.str, partitions[i].name, name_len);
+                entry->name.len = (name_len + 3) & ~3;
+
+                entry_size = sizeof(cmd_partition_entry_t) + entry->name.len;
+                entry_ptr += entry_size;
+                table->len += entry_size;
+        }
+
+        table->len += sizeof(cmd_partition_table_t);
+}
+
+static bool cmd_read_partition_table(HANDLER_OP hop)
+{
+        const cmd_partition_table_t *table = (const cmd_partition_table_t *) cmd_state.data;
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+        case HOP_DATA:
+                return true;
+        case HOP_EXEC:
+                build_partition_table(cmd_state.data);
+                cmd_state.bytes = table->len;
+                return true;
+        case HOP_SEND_LEN:
+                xmit_u16(table->len);
+                return true;
+        case HOP_SEND_DATA:
+                xmit_data(cmd_state.data, table->len);
+                return true;
+        }
+
+        return false;
+}
+
+/* find OQSPI FLASH range of partition, false if it doesn't exist or range doesn't fit */
+static bool partition_range(uint8_t id, uint32_t offset, uint32_t len, uint32_t *addr)
+{
+        size_t i;
+
+        for (i = 0; i < ARRAY_LENGTH(partitions); i++) {
+                if (partitions[i].type != id) {
+                        continue;
+                }
+
+                if (offset > partitions[i].size || len > partitions[i].size - offset) {
+                        return false;
+                }
+
+                *addr = partitions[i].start + offset;
+                return true;
+        }
+
+        return false;
+}
+
+static bool cmd_read_partition(HANDLER_OP hop)
+{
+        const uint32_t offset = get_u32(cmd_state.hdr);
+        const uint16_t len = get_u16(cmd_state.hdr + 4);
+        const uint8_t id = cmd_state.hdr[6];
+        uint32_t addr;
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+        case HOP_DATA:
+                return true;
+        case HOP_EXEC:
+                cmd_state.bytes = len;
+                return partition_range(id, offset, len, &addr) &&
+                                        flash_read(MEM_OQSPI, addr, cmd_state.data, len);
+        case HOP_SEND_LEN:
+                xmit_u16(len);
+                return true;
+        case HOP_SEND_DATA:
+                xmit_data(cmd_state.data, len);
+                return true;
+        }
+
+        return false;
+}
+
+static bool cmd_write_partition(HANDLER_OP hop)
+{
+        const uint32_t ptr = get_u32(cmd_state.hdr);
+        const uint16_t len = get_u16(cmd_state.hdr + 4);
+        const uint32_t offset = get_u32(cmd_state.hdr + 6);
+        const uint8_t id = cmd_state.hdr[10];
+        uint32_t addr;
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+                return true;
+        case HOP_DATA:
+                return check_ram_addr(ptr, len);
+        case HOP_EXEC:
+                return partition_range(id, offset, len, &addr) &&
+                                flash_write(MEM_OQSPI, addr, translate_ram_addr(ptr), len);
+        default:
+                return false;
+        }
+}
+
+/* driver_configured, manufacturer_id, device_type, density - Macronix octa FLASH */
+static bool get_flash_state(uint8_t mem)
+{
+        if (!flash[mem]) {
+                return false;
+        }
+
+        cmd_state.data[0] = 1;
+        cmd_state.data[1] = 0xC2;
+        cmd_state.data[2] = 0x80;
+        cmd_state.data[3] = (uint8_t) (31 - __builtin_clz(flash_size[mem]));
+        cmd_state.data_len = 4;
+
+        return true;
+}
+
+static bool cmd_get_qspi_state(HANDLER_OP hop)
+{
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+        case HOP_DATA:
+                return true;
+        case HOP_EXEC:
+                return cmd_state.hdr[0] == 0 && get_flash_state(MEM_QSPI);
+        case HOP_SEND_LEN:
+                xmit_u16(cmd_state.data_len);
+                return true;
+        case HOP_SEND_DATA:
+                xmit_data(cmd_state.data, cmd_state.data_len);
+                return true;
+        }
+
+        return false;
+}
+
+static bool cmd_get_oqspi_state(HANDLER_OP hop)
+{
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+        case HOP_DATA:
+                return true;
+        case HOP_EXEC:
+                return get_flash_state(MEM_OQSPI);
+        case HOP_SEND_LEN:
+                xmit_u16(cmd_state.data_len);
+                return true;
+        case HOP_SEND_DATA:
+                xmit_data(cmd_state.data, cmd_state.data_len);
+                return true;
+        }
+
+        return false;
+}
+
+static bool cmd_gpio_wd(HANDLER_OP hop)
+{
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+        case HOP_DATA:
+        case HOP_EXEC:
+                return true;
+        default:
+                return false;
+        }
+}
+
+static bool direct_write_flash(HANDLER_OP hop, uint8_t mem)
+{
+        const uint32_t addr = get_u32(cmd_state.hdr + 1);
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len > 0;
+        case HOP_HEADER:
+        case HOP_DATA:
+                return true;
+        case HOP_EXEC:
+                return flash_write(mem, addr, cmd_state.data, cmd_state.data_len);
+        default:
+                return false;
+        }
+}
+
+static bool cmd_direct_write_to_qspi(HANDLER_OP hop)
+{
+        return direct_write_flash(hop, MEM_QSPI);
+}
+
+static bool cmd_direct_write_to_oqspi(HANDLER_OP hop)
+{
+        return direct_write_flash(hop, MEM_OQSPI);
+}
+
+static bool cmd_write_compressed(HANDLER_OP hop)
+{
+        const uint8_t mem = cmd_state.hdr[0];
+        const uint32_t addr = get_u32(cmd_state.hdr + 2);
+        const uint16_t len = get_u16(cmd_state.hdr + 6);
+        /* decompressed data is placed just after payload, word aligned */
+        uint8_t *unpack_buf = cmd_state.data + ((cmd_state.data_len + 3) & ~3);
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len > 0;
+        case HOP_HEADER:
+                return true;
+        case HOP_DATA:
+                if (mem != MEM_QSPI && mem != MEM_OQSPI) {
+                        return false;
+                }
+                return unpack_buf + len * 2 <= input_buffer + INPUT_BUFFER_SIZE;
+        case HOP_EXEC:
+                if (lz_block_decompress(cmd_state.data, cmd_state.data_len, unpack_buf,
+                                                                                len) != len) {
+                        return false;
+                }
+                return flash_write(mem, addr, unpack_buf, len);
+        default:
+                return false;
+        }
+}
+
+static uint8_t *window_slot(uint8_t seq)
+{
+        return input_buffer + seq * WINDOW_SLOT_SIZE(window.chunk_size);
+}
+
+static bool window_recv_frame(uint16_t *burst)
+{
+        uint8_t buf[sizeof(window_frame_hdr_t)];
+        window_frame_hdr_t frame;
+        uint8_t seq;
+
+        if (!recv_with_tmo(buf, sizeof(buf), TMO_DATA)) {
+                return false;
+        }
+
+        frame.soh = buf[0];
+        frame.seq = buf[1];
+        frame.len = get_u16(buf + 2);
+        frame.addr = get_u32(buf + 4);
+        seq = frame.seq & ~WINDOW_SEQ_COMPRESSED;
+
+        if (frame.soh != SOH || seq >= window.total || frame.len == 0 ||
+                                                                frame.len > window.chunk_size) {
+                return false;
+        }
+
+        window.received &= ~(1 << seq);
+        window.frame[seq] = frame;
+        *burst |= 1 << seq;
+
+        return recv_with_tmo(window_slot(seq), frame.len + sizeof(uint16_t), TMO_DATA);
+}
+
+static void window_check_burst(uint16_t burst)
+{
+        uint8_t seq;
+
+        for (seq = 0; seq < window.total; seq++) {
+                const window_frame_hdr_t *frame = &window.frame[seq];
+                const uint8_t *slot = window_slot(seq);
+                uint8_t hdr[sizeof(window_frame_hdr_t) - 1];
+                uint16_t crc;
+
+                if (!(burst & (1 << seq))) {
+                        continue;
+                }
+
+                hdr[0] = frame->seq;
+                hdr[1] = (uint8_t) frame->len;
+                hdr[2] = (uint8_t) (frame->len >> 8);
+                hdr[3] = (uint8_t) frame->addr;
+                hdr[4] = (uint8_t) (frame->addr >> 8);
+                hdr[5] = (uint8_t) (frame->addr >> 16);
+                hdr[6] = (uint8_t) (frame->addr >> 24);
+
+                crc16_init(&crc);
+                crc16_update(&crc, hdr, sizeof(hdr));
+                crc16_update(&crc, slot, frame->len);
+
+                if (get_u16(slot + frame->len) == crc) {
+                        window.received |= 1 << seq;
+                }
+        }
+}
+
+static bool window_commit(void)
+{
+        uint8_t *unpack_buf = window_slot(window.max + 1);
+        uint8_t seq;
+
+        for (seq = 0; seq < window.total; seq++) {
+                const uint8_t *slot = window_slot(seq);
+                const uint32_t addr = window.frame[seq].addr;
+                int len = window.frame[seq].len;
+
+                if (window.frame[seq].seq & WINDOW_SEQ_COMPRESSED) {
+                        len = lz_block_decompress(slot, len, unpack_buf, window.chunk_size);
+                        if (len <= 0) {
+                                return false;
+                        }
+                        slot = unpack_buf;
+                }
+
+                switch (window.mem) {
+                case PROTOCOL_MEM_RAM:
+                        if (!check_ram_addr(addr, len)) {
+                                return false;
+                        }
+                        /* chunks are stored in input buffer, they must not be overwritten */
+                        if (is_input_buffer_addr(addr)) {
+                                return false;
+                        }
+                        cmd_state.bytes += len;
+                        break;
+                case PROTOCOL_MEM_QSPI:
+                case PROTOCOL_MEM_OQSPI:
+                        if (!flash_write(window.mem, addr, slot, len)) {
+                                return false;
+                        }
+                        break;
+                default:
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+static bool cmd_window_write(HANDLER_OP hop)
+{
+        const uint8_t mem = cmd_state.hdr[0];
+        const uint8_t flags = cmd_state.hdr[1];
+        const uint8_t total = cmd_state.hdr[3];
+        const uint8_t count = cmd_state.hdr[4];
+        const uint16_t all_received = (1 << window.total) - 1;
+        uint16_t burst = 0;
+        uint8_t i;
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0 && window.max > 0;
+        case HOP_HEADER:
+                return true;
+        case HOP_DATA:
+                if (total == 0 || total > window.max || count > total) {
+                        return false;
+                }
+                if (flags & WINDOW_FLAG_NEW) {
+                        window.mem = mem;
+                        window.total = total;
+                        window.received = 0;
+                        return true;
+                }
+                return window.total == total && window.mem == mem;
+        case HOP_EXEC:
+                for (i = 0; i < count; i++) {
+                        if (!window_recv_frame(&burst)) {
+                                drain_input(1);
+                                break;
+                        }
+                }
+
+                window_check_burst(burst);
+
+                window.status.received = window.received;
+                window.status.done = 0;
+
+                if (window.received != all_received) {
+                        return true;
+                }
+
+                window.status.done = window_commit();
+                window.received = 0;
+                window.total = 0;
+
+                return window.status.done;
+        case HOP_SEND_LEN:
+                xmit_u16(sizeof(window.status));
+                return true;
+        case HOP_SEND_DATA:
+                xmit_u16(window.status.received);
+                xmit_data(&window.status.done, sizeof(window.status.done));
+                return true;
+        }
+
+        return false;
+}
+
+static bool cmd_get_flash_digests(HANDLER_OP hop)
+{
+        const uint8_t mem = cmd_state.hdr[0];
+        const uint32_t start = get_u32(cmd_state.hdr + 1);
+        const uint32_t size = get_u32(cmd_state.hdr + 5);
+        uint32_t addr;
+        uint32_t count;
+        uint8_t *digest = cmd_state.data;
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+                return true;
+        case HOP_DATA:
+                if (mem != MEM_QSPI && mem != MEM_OQSPI) {
+                        return false;
+                }
+                if (size == 0 || start + size < start) {
+                        return false;
+                }
+                count = (start + size - 1) / FLASH_DIGEST_SECTOR_SIZE -
+                                                        start / FLASH_DIGEST_SECTOR_SIZE + 1;
+                return count * sizeof(uint32_t) <= MIN(INPUT_BUFFER_SIZE, UINT16_MAX);
+        case HOP_EXEC:
+                if (!flash_range_valid(mem, start, size)) {
+                        return false;
+                }
+                for (addr = start; addr < start + size; digest += sizeof(uint32_t)) {
+                        const uint32_t len = MIN(start + size - addr, FLASH_DIGEST_SECTOR_SIZE -
+                                                        (addr & (FLASH_DIGEST_SECTOR_SIZE - 1)));
+                        const uint32_t crc = crc32_calc(flash[mem] + addr, len);
+
+                        memcpy(digest, &crc, sizeof(crc));
+                        addr += len;
+                }
+                cmd_state.data_len = digest - cmd_state.data;
+                return true;
+        case HOP_SEND_LEN:
+                xmit_u16(cmd_state.data_len);
+                return true;
+        case HOP_SEND_DATA:
+                xmit_data(cmd_state.data, cmd_state.data_len);
+                return true;
+        }
+
+        return false;
+}
+
+static bool cmd_get_product_info(HANDLER_OP hop)
+{
+        cmd_product_info_t *info = (cmd_product_info_t *) cmd_state.data;
+        int len;
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+        case HOP_DATA:
+                return true;
+        case HOP_EXEC:
+                len = snprintf(&info->str, INPUT_BUFFER_SIZE - sizeof(info->len),
+                                "PRODUCT INFORMATION:\nDevice classification attributes:\n"
+                                "Device family = DA1470x\nDevice chip ID = D2798\n"
+                                "Device variant = Simulated\n");
+                info->len = len + 1 + sizeof(info->len);
+                return true;
+        case HOP_SEND_LEN:
+                xmit_u16(info->len);
+                return true;
+        case HOP_SEND_DATA:
+                xmit_data(info, info->len);
+                return true;
+        }
+
+        return false;
+}
+
+static bool cmd_change_baudrate(HANDLER_OP hop)
+{
+        static const uint32_t supported[] = {
+                4800, 9600, 14400, 19200, 28800, 38400, 57600, 115200, 230400, 500000, 921600,
+                1000000, 2000000, 3000000,
+        };
+        const uint32_t baudrate = get_u32(cmd_state.hdr);
+        size_t i;
+
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+                return true;
+        case HOP_DATA:
+                for (i = 0; i < ARRAY_LENGTH(supported); i++) {
+                        if (supported[i] == baudrate) {
+                                return true;
+                        }
+                }
+                return false;
+        case HOP_EXEC:
+                /* pty has no baud rate, the one set by the host is used for wire time */
+                return true;
+        default:
+                return false;
+        }
+}
+
+static bool cmd_dummy(HANDLER_OP hop)
+{
+        switch (hop) {
+        case HOP_INIT:
+                return cmd_state.data_len == 0;
+        case HOP_HEADER:
+        case HOP_DATA:
+                return true;
+        case HOP_EXEC:
+                memcpy(input_buffer, UARTBOOT_LIVE_MARKER, sizeof(UARTBOOT_LIVE_MARKER));
+                return true;
+        default:
+                return false;
+        }
+}
+
+static const struct {
+        uint8_t type;
+        uint8_t hdr_len;
+        stat_class_t stat;
+        bool (*handler)(HANDLER_OP);
+} commands[] = {
+        { CMD_WRITE,                 4,  STAT_WRITE,     cmd_send_to_ram },
+        { CMD_READ,                  6,  STAT_READ,      cmd_read_from_ram },
+        { CMD_COPY_QSPI,             10, STAT_WRITE,     cmd_write_ram_to_qspi },
+        { CMD_ERASE_QSPI,            8,  STAT_ERASE,     cmd_erase_qspi },
+        { CMD_RUN,                   4,  STAT_OTHER,     cmd_execute_code },
+        { CMD_WRITE_OTP,             4,  STAT_WRITE,     cmd_write_otp },
+        { CMD_READ_OTP,              6,  STAT_READ,      cmd_read_otp },
+        { CMD_READ_QSPI,             6,  STAT_READ,      cmd_read_qspi },
+        { CMD_READ_PARTITION_TABLE,  0,  STAT_PARTITION, cmd_read_partition_table },
+        { CMD_GET_VERSION,           0,  STAT_OTHER,     cmd_get_version },
+        { CMD_CHIP_ERASE_QSPI,       4,  STAT_ERASE,     cmd_chip_erase_qspi },
+        { CMD_IS_EMPTY_QSPI,         8,  STAT_IS_EMPTY,  cmd_is_empty_qspi },
+        { CMD_READ_PARTITION,        7,  STAT_PARTITION, cmd_read_partition },
+        { CMD_WRITE_PARTITION,       11, STAT_PARTITION, cmd_write_partition },
+        { CMD_GET_QSPI_STATE,        1,  STAT_OTHER,     cmd_get_qspi_state },
+        { CMD_GPIO_WD,               2,  STAT_OTHER,     cmd_gpio_wd },
+        { CMD_DIRECT_WRITE_TO_QSPI,  5,  STAT_WRITE,     cmd_direct_write_to_qspi },
+        { CMD_COPY_OQSPI,            10, STAT_WRITE,     cmd_write_ram_to_oqspi },
+        { CMD_ERASE_OQSPI,           8,  STAT_ERASE,     cmd_erase_oqspi },
+        { CMD_READ_OQSPI,            6,  STAT_READ,      cmd_read_oqspi },
+        { CMD_CHIP_ERASE_OQSPI,      4,  STAT_ERASE,     cmd_chip_erase_oqspi },
+        { CMD_IS_EMPTY_OQSPI,        8,  STAT_IS_EMPTY,  cmd_is_empty_oqspi },
+        { CMD_GET_OQSPI_STATE,       0,  STAT_OTHER,     cmd_get_oqspi_state },
+        { CMD_DIRECT_WRITE_TO_OQSPI, 5,  STAT_WRITE,     cmd_direct_write_to_oqspi },
+        { CMD_GET_PRODUCT_INFO,      0,  STAT_OTHER,     cmd_get_product_info },
+        { CMD_WINDOW_WRITE,          5,  STAT_WRITE,     cmd_window_write },
+        { CMD_GET_FLASH_DIGESTS,     9,  STAT_OTHER,     cmd_get_flash_digests },
+        { CMD_WRITE_COMPRESSED,      8,  STAT_WRITE,     cmd_write_compressed },
+        { CMD_CHANGE_BAUDRATE,       4,  STAT_OTHER,     cmd_change_baudrate },
+        { CMD_DUMMY,                 0,  STAT_OTHER,     cmd_dummy },
+};
+
+static void process_header(const uint8_t *buf)
+{
+        size_t i;
+
+        memset(&cmd_state, 0, sizeof(cmd_state));
+        cmd_state.data = input_buffer;
+        cmd_state.type = buf[0];
+        cmd_state.len = get_u16(buf + 1);
+        cmd_state.stat = STAT_OTHER;
+
+        for (i = 0; i < ARRAY_LENGTH(commands); i++) {
+                if (commands[i].type == cmd_state.type) {
+                        cmd_state.hdr_len = commands[i].hdr_len;
+                        cmd_state.handler = commands[i].handler;
+                        cmd_state.stat = commands[i].stat;
+                        break;
+                }
+        }
+
+        /* Other commands may overwrite slots of partially received window, as on device */
+        if (cmd_state.type != CMD_WINDOW_WRITE) {
+                window.total = 0;
+                window.received = 0;
+        }
+
+        cmd_state.data_len = cmd_state.len - cmd_state.hdr_len;
+}
+
+static bool load_data(void)
+{
+        uint8_t c;
+        bool ret;
+
+        if (!recv_with_tmo(cmd_state.hdr, cmd_state.hdr_len, TMO_DATA)) {
+                return false;
+        }
+
+        if (!cmd_state.handler(HOP_HEADER)) {
+                /* payload is still received, command is rejected afterwards */
+                cmd_state.data = sink_buffer;
+        }
+
+        if (cmd_state.data_len > INPUT_BUFFER_SIZE - (cmd_state.data - input_buffer) &&
+                                                                cmd_state.data != sink_buffer) {
+                return false;
+        }
+
+        if (!recv_with_tmo(cmd_state.data, cmd_state.data_len, TMO_DATA)) {
+                return false;
+        }
+
+        crc16_init(&cmd_state.crc);
+        crc16_update(&cmd_state.crc, cmd_state.hdr, cmd_state.hdr_len);
+        crc16_update(&cmd_state.crc, cmd_state.data, cmd_state.data_len);
+
+        if (cmd_state.data == sink_buffer || !cmd_state.handler(HOP_DATA)) {
+                xmit_nak();
+                return false;
+        }
+
+        xmit_ack();
+        xmit_crc16(cmd_state.crc);
+
+        ret = recv_with_tmo(&c, 1, TMO_ACK) && c == ACK;
+        if (ret) {
+                ret = cmd_state.handler(HOP_EXEC);
+        }
+
+        ret ? xmit_ack() : xmit_nak();
+
+        return ret;
+}
+
+static void stat_command(long long start_ns, bool ok)
+{
+        stat_t *s = &stats[cmd_state.stat];
+
+        s->count++;
+        s->failed += !ok;
+        s->bytes += cmd_state.bytes;
+        s->time_ns += now_ns() - start_ns;
+}
+
+/* handle single command, flow is the same as in uartboot main() */
+static void handle_command(const uint8_t *hdr)
+{
+        const long long start_ns = now_ns();
+        uint8_t buf[2];
+
+        if (!session_start_ns) {
+                session_start_ns = start_ns;
+        }
+
+        process_header(hdr);
+
+        if (!cmd_state.handler || !cmd_state.handler(HOP_INIT)) {
+                xmit_nak();
+                stat_command(start_ns, false);
+                return;
+        }
+
+        xmit_ack();
+
+        if (cmd_state.len) {
+                if (!load_data()) {
+                        stat_command(start_ns, false);
+                        return;
+                }
+        } else {
+                if (!cmd_state.handler(HOP_EXEC)) {
+                        xmit_nak();
+                        stat_command(start_ns, false);
+                        return;
+                }
+                xmit_ack();
+        }
+
+        if (reboot_requested || !cmd_state.handler(HOP_SEND_LEN)) {
+                stat_command(start_ns, true);
+                return;
+        }
+        if (!recv_with_tmo(buf, 1, TMO_ACK) || buf[0] != ACK) {
+                stat_command(start_ns, false);
+                return;
+        }
+
+        crc16_init(&cmd_state.crc);
+        if (!cmd_state.handler(HOP_SEND_DATA)) {
+                stat_command(start_ns, false);
+                return;
+        }
+
+        if (!recv_with_tmo(buf, 2, TMO_ACK)) {
+                stat_command(start_ns, false);
+                return;
+        }
+
+        if (get_u16(buf) == cmd_state.crc) {
+                xmit_ack();
+        } else {
+                xmit_nak();
+        }
+
+        stat_command(start_ns, true);
+}
+
+/* ROM bootloader - receive executable and start uartboot, whatever the executable is */
+static void rom_bootloader(void)
+{
+        static const uint8_t stx = STX;
+        static uint8_t image[0x20000];
+        uint8_t buf[5];
+        uint32_t size;
+        uint8_t sum = 0;
+        uint32_t i;
+
+        xmit_raw(&stx, 1);
+
+        if (!recv_with_tmo(buf, 1, ROM_ANNOUNCE_PERIOD_MS) || buf[0] != SOH) {
+                return;
+        }
+
+        if (!recv_with_tmo(buf, 2, TMO_DATA)) {
+                return;
+        }
+
+        size = get_u16(buf);
+        if (size == 0) {
+                /* extended header - 24-bit length follows */
+                if (!recv_with_tmo(buf, 3, TMO_DATA)) {
+                        return;
+                }
+                size = buf[0] | (buf[1] << 8) | (buf[2] << 16);
+        }
+
+        if (size == 0 || size > sizeof(image)) {
+                xmit_nak();
+                return;
+        }
+
+        xmit_ack();
+
+        if (!recv_with_tmo(image, size, TMO_DATA + size / 10)) {
+                return;
+        }
+
+        for (i = 0; i < size; i++) {
+                sum ^= image[i];
+        }
+        xmit_raw(&sum, 1);
+
+        if (!recv_with_tmo(buf, 1, TMO_ACK) || buf[0] != ACK) {
+                return;
+        }
+
+        printf("ROM bootloader: %u bytes executable loaded, starting uartboot\n", size);
+        uartboot_running = true;
+}
+
+/* uartboot - announce itself until SOH is received, then handle commands */
+static void uartboot(void)
+{
+        static const uint8_t hello[] = { STX, SOH, UARTBOOT_VERSION >> 8, UARTBOOT_VERSION & 0xFF };
+        uint8_t buf[4];
+
+        xmit_raw(hello, sizeof(hello));
+
+        if (!recv_with_tmo(buf, 1, HELLO_PERIOD_MS) || buf[0] != SOH) {
+                return;
+        }
+
+        /* SOH of the first command was consumed as response to hello message */
+        if (!recv_with_tmo(buf + 1, 3, TMO_COMMAND)) {
+                return;
+        }
+
+        for (;;) {
+                handle_command(buf + 1);
+
+                if (reboot_requested) {
+                        reboot_requested = false;
+                        uartboot_running = false;
+                        memset(&window, 0, sizeof(window));
+                        return;
+                }
+
+                if (!recv_with_tmo(buf, 4, TMO_COMMAND)) {
+                        return;
+                }
+        }
+}
+
+static void print_report(FILE *f)
+{
+        const double session_s = session_start_ns ? (now_ns() - session_start_ns) / 1e9 : 0;
+        int i;
+
+        fprintf(f, "%-10s %8s %7s %12s %10s %12s\n", "command", "count", "failed", "bytes",
+                                                                        "time [s]", "bytes/s");
+        for (i = 0; i < STAT_COUNT; i++) {
+                const stat_t *s = &stats[i];
+                const double t = s->time_ns / 1e9;
+
+                if (!s->count) {
+                        continue;
+                }
+
+                fprintf(f, "%-10s %8u %7u %12llu %10.3f %12.0f\n", stat_names[i], s->count,
+                                s->failed, (unsigned long long) s->bytes, t,
+                                t > 0 ? s->bytes / t : 0);
+        }
+        fprintf(f, "session %.3f s, %llu bytes received, %llu bytes sent\n", session_s,
+                        (unsigned long long) line.rx_bytes, (unsigned long long) line.tx_bytes);
+}
+
+static void end_session(void)
+{
+        FILE *f;
+
+        if (!session_start_ns) {
+                return;
+        }
+
+        print_report(stdout);
+        fflush(stdout);
+
+        if (cfg.report) {
+                f = fopen(cfg.report, "a");
+                if (f) {
+                        print_report(f);
+                        fclose(f);
+                } else {
+                        fprintf(stderr, "Can't open report file %s\n", cfg.report);
+                }
+        }
+
+        memset(stats, 0, sizeof(stats));
+        session_start_ns = 0;
+        line.rx_bytes = 0;
+        line.tx_bytes = 0;
+}
+
+/*
+ * Put line discipline of pty to raw mode, otherwise slave side echoes everything device sends
+ * until the host configures the port.
+ */
+static void line_set_raw(void)
+{
+        struct termios2 tios;
+
+        if (ioctl(line.fd, TCGETS2, &tios) < 0) {
+                return;
+        }
+
+        tios.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON |
+                                                                                IXANY | IXOFF);
+        tios.c_oflag &= ~OPOST;
+        tios.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+        tios.c_cflag &= ~(CSIZE | PARENB);
+        tios.c_cflag |= CS8;
+        ioctl(line.fd, TCSETS2, &tios);
+}
+
+/* wait until the host opens slave side of the pty again */
+static void wait_for_host(void)
+{
+        struct pollfd pfd = { line.fd, 0, 0 };
+
+        do {
+                usleep(20000);
+                pfd.revents = 0;
+                poll(&pfd, 1, 0);
+        } while ((pfd.revents & POLLHUP) && !terminate);
+
+        line_set_raw();
+        line.hangup = false;
+}
+
+static void on_signal(int sig)
+{
+        (void) sig;
+        terminate = 1;
+}
+
+static void usage(const char *name)
+{
+        printf("usage: %s [options]\n"
+                "options:\n"
+                "    --oqspi-size <bytes>     OQSPI FLASH size (default %u)\n"
+                "    --qspi-size <bytes>      QSPI FLASH size, 0 if not connected (default %u)\n"
+                "    --latency-us <us>        serial adapter latency (default %u)\n"
+                "    --erase-us <us>          FLASH sector erase time (default %u)\n"
+                "    --program-us <us>        FLASH page program time (default %u)\n"
+                "    --chip-erase-ms <ms>     FLASH chip erase time (default %u)\n"
+                "    --uartboot               start with uartboot running, skip ROM bootloader\n"
+                "    --once                   exit when the host closes the port\n"
+                "    --link <path>            create symlink to the simulated serial port\n"
+                "    --report <file>          append throughput report to file\n",
+                name, cfg.oqspi_size, cfg.qspi_size, cfg.latency_us, cfg.erase_us,
+                cfg.program_us, cfg.chip_erase_ms);
+}
+
+static bool parse_args(int argc, char **argv)
+{
+        static const struct option options[] = {
+                { "oqspi-size",    required_argument, NULL, 'o' },
+                { "qspi-size",     required_argument, NULL, 'q' },
+                { "latency-us",    required_argument, NULL, 'l' },
+                { "erase-us",      required_argument, NULL, 'e' },
+                { "program-us",    required_argument, NULL, 'p' },
+                { "chip-erase-ms", required_argument, NULL, 'c' },
+                { "uartboot",      no_argument,       NULL, 'u' },
+                { "once",          no_argument,       NULL, '1' },
+                { "link",          required_argument, NULL, 'L' },
+                { "report",        required_argument, NULL, 'r' },
+                { "help",          no_argument,       NULL, 'h' },
+                { NULL, 0, NULL, 0 },
+        };
+        int opt;
+
+        while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+                switch (opt) {
+                case 'o':
+                        cfg.oqspi_size = strtoul(optarg, NULL, 0);
+                        break;
+                case 'q':
+                        cfg.qspi_size = strtoul(optarg, NULL, 0);
+                        break;
+                case 'l':
+                        cfg.latency_us = strtoul(optarg, NULL, 0);
+                        break;
+                case 'e':
+                        cfg.erase_us = strtoul(optarg, NULL, 0);
+                        break;
+                case 'p':
+                        cfg.program_us = strtoul(optarg, NULL, 0);
+                        break;
+                case 'c':
+                        cfg.chip_erase_ms = strtoul(optarg, NULL, 0);
+                        break;
+                case 'u':
+                        cfg.start_uartboot = true;
+                        break;
+                case '1':
+                        cfg.once = true;
+                        break;
+                case 'L':
+                        cfg.link = optarg;
+                        break;
+                case 'r':
+                        cfg.report = optarg;
+                        break;
+                default:
+                        usage(argv[0]);
+                        return false;
+                }
+        }
+
+        if (cfg.oqspi_size % FLASH_SECTOR_SIZE || cfg.qspi_size % FLASH_SECTOR_SIZE) {
+                fprintf(stderr, "FLASH size must be multiple of %u\n", FLASH_SECTOR_SIZE);
+                return false;
+        }
+
+        return true;
+}
+
+static bool alloc_flash(uint8_t mem, uint32_t size)
+{
+        flash_size[mem] = size;
+
+        if (!size) {
+                return true;
+        }
+
+        flash[mem] = malloc(size);
+        if (!flash[mem]) {
+                fprintf(stderr, "Can't allocate %u bytes of FLASH\n", size);
+                return false;
+        }
+        memset(flash[mem], 0xFF, size);
+
+        return true;
+}
+
+int main(int argc, char **argv)
+{
+        struct sigaction sa;
+        const char *slave;
+        int ret = 1;
+
+        if (!parse_args(argc, argv)) {
+                return 1;
+        }
+
+        if (!alloc_flash(MEM_OQSPI, cfg.oqspi_size) || !alloc_flash(MEM_QSPI, cfg.qspi_size)) {
+                return 1;
+        }
+
+        line.fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (line.fd < 0 || grantpt(line.fd) < 0 || unlockpt(line.fd) < 0) {
+                perror("pty");
+                goto done;
+        }
+
+        line_set_raw();
+        slave = ptsname(line.fd);
+        if (cfg.link) {
+                unlink(cfg.link);
+                if (symlink(slave, cfg.link) < 0) {
+                        perror("symlink");
+                        goto done;
+                }
+        }
+        printf("Simulated device on %s\n", cfg.link ? cfg.link : slave);
+        fflush(stdout);
+
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = on_signal;
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+
+        uartboot_running = cfg.start_uartboot;
+
+        while (!terminate) {
+                if (line.hangup) {
+                        end_session();
+                        if (cfg.once) {
+                                break;
+                        }
+                        wait_for_host();
+                        continue;
+                }
+
+                if (uartboot_running) {
+                        uartboot();
+                } else {
+                        rom_bootloader();
+                }
+        }
+
+        end_session();
+        ret = 0;
+
+done:
+        if (cfg.link) {
+                unlink(cfg.link);
+        }
+        free(flash[MEM_QSPI]);
+        free(flash[MEM_OQSPI]);
+
+        return ret;
+}
@@ -74,6 +74,11 @@ typedef struct {
         uint8_t *value;
 } crypto_buffer_t;
 
+/**
+ * Per-worker crypto context, see crypto_context_create()
+ */
+typedef struct crypto_context crypto_context_t;
+
 /**
  * \brief Initialize random number generator
  *
@@ -84,15 +89,50 @@ int DLLEXPORT crypto_rng_init(void);
 /**
  * \brief Wrapper for libsodium randombytes_buf function used in mbedTLS library
  *
+ * If calling thread selected a crypto context, random data is taken from generator of that
+ * context instead.
+ *
  * \param [in] ud               NULL, required by mbedTLS API, e.g. mbedtls_ecp_gen_key()
  * \param [in] buf              buffer with generated random data
  * \param [in] len              requested buffer length
  *
- * \return 0                    Required by mbedTLS API, e.g. mbedtls_ecp_gen_key()
+ * \return 0 on success, -1 if generator of selected context failed
  *
  */
 int DLLEXPORT crypto_rng_bytes(void *ud, unsigned char *buff, size_t len);
 
+/**
+ * \brief Create crypto context
+ *
+ * Crypto context holds state which must not be shared between threads. Currently this is random
+ * number generator (CTR-DRBG) seeded from libsodium, so workers don't contend on common generator.
+ * Context must be selected with crypto_context_select() by thread which uses it.
+ *
+ * \return context, NULL if it couldn't be allocated or seeded
+ *
+ * \note Context should be freed with crypto_context_destroy().
+ *
+ */
+crypto_context_t * DLLEXPORT crypto_context_create(void);
+
+/**
+ * \brief Destroy crypto context
+ *
+ * \param [in] ctx              context created by crypto_context_create(), could be NULL
+ *
+ */
+void DLLEXPORT crypto_context_destroy(crypto_context_t *ctx);
+
+/**
+ * \brief Select crypto context used by calling thread
+ *
+ * All functions of this library called later by the same thread use given context.
+ *
+ * \param [in] ctx              context to use, NULL to use global libsodium generator
+ *
+ */
+void DLLEXPORT crypto_context_select(crypto_context_t *ctx);
+
 /**
  * \brief Allocate and initialize crypto_buffer_t instance
  *
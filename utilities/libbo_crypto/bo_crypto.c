@@ -16,6 +16,7 @@
 #include <string.h>
 #include <sys/time.h>
 #include "aes.h"
+#include "ctr_drbg.h"
 #include "ecdsa.h"
 #include "ecp.h"
 #include "md.h"
@@ -31,6 +32,19 @@
 #define GENERATION_TRY_NUM      30
 #define MAX_SHA_LEN             64
 
+/* Thread local storage qualifier */
+#ifdef _MSC_VER
+#define THREAD_LOCAL            __declspec(thread)
+#else
+#define THREAD_LOCAL            __thread
+#endif
+
+/* Per-worker crypto context */
+struct crypto_context {
+        /* Random number generator seeded from libsodium */
+        mbedtls_ctr_drbg_context drbg;
+};
+
 /* Elliptic curve basic info */
 typedef struct {
         /* Curves's id */
@@ -62,12 +76,15 @@ static const elliptic_curve_info_t supported_elliptic_curves[] = {
         { ELLIPTIC_CURVE_EDWARDS25519,  MBEDTLS_ECP_DP_NONE,            32,     32,     "EDWARDS25519" },
 };
 
+/* Context selected by calling thread, NULL if libsodium generator should be used directly */
+static THREAD_LOCAL crypto_context_t *current_context;
+
 int crypto_rng_init(void)
 {
         return sodium_init();
 }
 
-int crypto_rng_bytes(void *ud, unsigned char *buff, size_t len)
+static int sodium_rng_bytes(void *ud, unsigned char *buff, size_t len)
 {
         randombytes_buf(buff, len);
 
@@ -75,6 +92,74 @@ int crypto_rng_bytes(void *ud, unsigned char *buff, size_t len)
         return 0;
 }
 
+int crypto_rng_bytes(void *ud, unsigned char *buff, size_t len)
+{
+        crypto_context_t *ctx = current_context;
+        size_t chunk;
+
+        if (!ctx) {
+                return sodium_rng_bytes(ud, buff, len);
+        }
+
+        /* DRBG limits size of single request */
+        while (len > 0) {
+                chunk = len < MBEDTLS_CTR_DRBG_MAX_REQUEST ? len : MBEDTLS_CTR_DRBG_MAX_REQUEST;
+
+                if (mbedtls_ctr_drbg_random(&ctx->drbg, buff, chunk)) {
+                        return -1;
+                }
+
+                buff += chunk;
+                len -= chunk;
+        }
+
+        return 0;
+}
+
+crypto_context_t *crypto_context_create(void)
+{
+        static const unsigned char personalization[] = "bo_crypto";
+        crypto_context_t *ctx;
+
+        if (crypto_rng_init() == -1) {
+                return NULL;
+        }
+
+        ctx = malloc(sizeof(*ctx));
+        if (!ctx) {
+                return NULL;
+        }
+
+        mbedtls_ctr_drbg_init(&ctx->drbg);
+
+        if (mbedtls_ctr_drbg_seed(&ctx->drbg, sodium_rng_bytes, NULL, personalization,
+                                                                sizeof(personalization) - 1)) {
+                crypto_context_destroy(ctx);
+                return NULL;
+        }
+
+        return ctx;
+}
+
+void crypto_context_destroy(crypto_context_t *ctx)
+{
+        if (!ctx) {
+                return;
+        }
+
+        if (current_context == ctx) {
+                current_context = NULL;
+        }
+
+        mbedtls_ctr_drbg_free(&ctx->drbg);
+        free(ctx);
+}
+
+void crypto_context_select(crypto_context_t *ctx)
+{
+        current_context = ctx;
+}
+
 static const elliptic_curve_info_t get_elliptic_curve_info(elliptic_curve_t elliptic_curve)
 {
         const size_t supported_elliptic_curves_num = sizeof(supported_elliptic_curves) /
@@ -171,6 +171,32 @@ typedef struct {
         uint32_t minimum_fw_version;
 } mkimage_device_adm_data_da1470x_t;
 
+/** DA1470x image creation job, see mkimage_create_da1470x_images() */
+typedef struct {
+        /** Input data size */
+        size_t in_size;
+        /** Input data (binary file content) */
+        const uint8_t *in;
+        /** Version data size */
+        size_t ver_size;
+        /** Version data (text file content) */
+        const uint8_t *ver;
+        /** FW version number */
+        uint32_t fw_version;
+        /** Security configuration, could be NULL */
+        const mkimage_security_data_da1470x_t *data;
+        /** Device administration configuration, could be NULL */
+        const mkimage_device_adm_data_da1470x_t *opt_data;
+        /** Image offset, used to determine if extra padding is needed */
+        size_t offset;
+        /** Allocated buffer with image data, set by the library */
+        uint8_t *out;
+        /** Output buffer size, set by the library */
+        size_t out_size;
+        /** Status of this job, set by the library */
+        mkimage_status_t status;
+} mkimage_da1470x_job_t;
+
 /**
  * \brief Convert status code to the status message
  *
@@ -356,6 +382,26 @@ mkimage_status_t DLLEXPORT mkimage_create_da1470x_image(size_t in_size, const ui
                                                         const mkimage_device_adm_data_da1470x_t *opt_data,
                                                         uint8_t **out, size_t *out_size, size_t offset);
 
+/**
+ * \brief Create several DA1470x device images in parallel
+ *
+ * Function does the same as \sa mkimage_create_da1470x_image() for each job from \p jobs. Jobs
+ * are distributed between \p thread_count worker threads, each worker uses its own crypto context.
+ * Results are stored in the job which requested them, so output doesn't depend on the order in
+ * which jobs were completed. Each job's status is set, failure of one job doesn't stop others.
+ *
+ * \param [in/out] jobs                 jobs to execute
+ * \param [in]     job_count            number of jobs
+ * \param [in]     thread_count         number of worker threads, 0 to use number of CPUs
+ *
+ * \note \p out buffer of each job should be freed after use.
+ *
+ * \return MKIMAGE_STATUS_OK if all jobs succeeded, status of the first failed job otherwise
+ *
+ */
+mkimage_status_t DLLEXPORT mkimage_create_da1470x_images(mkimage_da1470x_job_t *jobs,
+                                                        size_t job_count, unsigned int thread_count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -18,6 +18,12 @@
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
 #include "suota.h"
 #include "suota_security_ext.h"
 #include "bo_crypto.h"
@@ -43,6 +49,9 @@
 /* Size of FW version length */
 #define FW_VERSION_SIZE         4
 
+/* Maximum number of worker threads used by batch functions */
+#define MAX_WORKER_THREADS      64
+
 static crypto_buffer_t *aes_key;
 static uint8_t aes_iv[16];
 
@@ -1200,13 +1209,11 @@ mkimage_status_t mkimage_create_da1469x_image(size_t in_size, const uint8_t *in,
         suota_1_1_image_header_da1469x_t header;
         suota_security_header_da1469x_t hdr;
         mkimage_status_t status = MKIMAGE_STATUS_OK;
-        uint32_t crc32 = 0xFFFFFFFF;
         uint8_t dev_adm_section[2048] = { 0 };
         uint8_t security_section[2048] = { 0 };
         uint8_t signature[ED25519_SIG_LENGTH] = { 0 };
-        uint8_t *data_buffer = NULL;
-        uint8_t *in_aligned = NULL;
-        uint8_t *out_ptr;
+        uint8_t *tlv;
+        uint8_t *payload;
         size_t signature_len = sizeof(signature);
         size_t in_aligned_size = in_size;
         unsigned int tlv_length;
@@ -1248,16 +1255,6 @@ mkimage_status_t mkimage_create_da1469x_image(size_t in_size, const uint8_t *in,
                 if (in_aligned_size % AES_BLOCKSIZE) {
                         in_aligned_size += AES_BLOCKSIZE - in_aligned_size % AES_BLOCKSIZE;
                 }
-
-                /* Allocate new buffer for aligned input. Last bytes should have 0 value */
-                in_aligned = malloc(in_aligned_size);
-
-                if (!in_aligned) {
-                        return MKIMAGE_STATUS_ALLOCATION_ERROR;
-                }
-
-                memset(in_aligned, 0, in_aligned_size);
-                memcpy(in_aligned, in, in_size);
         }
         else {
                 memset(&hdr, 0, sizeof(hdr));
@@ -1271,86 +1268,63 @@ mkimage_status_t mkimage_create_da1469x_image(size_t in_size, const uint8_t *in,
         dev_adm_section_size = fill_device_adm_section_da1469x(dev_adm_section, opt_data);
 
         if (dev_adm_section_size == 0) {
-                status = MKIMAGE_STATUS_INVALID_DATA;
-                goto done;
+                return MKIMAGE_STATUS_INVALID_DATA;
         }
 
         /* Calculate pattern size */
         pattern_size = calculate_pattern_size(sizeof(header), dev_adm_section_size, 0,
                                                                         security_section_size);
+        tlv_length = security_section_size + dev_adm_section_size + pattern_size;
+
+        /*
+         * Output = DA1469x header + security section + device administration section + pattern +
+         *          app binary. It is built in place, so the binary is copied only once.
+         */
+        *out_size =  sizeof(header) + tlv_length + in_aligned_size;
+        *out = malloc(*out_size);
 
-        if (!secure_image) {
-                /* Non-secure images are not encrypted and not signed */
-                goto common_part;
+        if (!*out) {
+                return MKIMAGE_STATUS_ALLOCATION_ERROR;
         }
 
-        /* Store encrypted executable in the same buffer */
-        aes_ctr_encrypt(hdr.nonce, data->sym_key, in_aligned_size, in_aligned, in_aligned);
+        tlv = *out + sizeof(header);
+        payload = tlv + tlv_length;
 
-        /* Glue aligned device administration section and the input (application binary) */
-        data_buffer = malloc(dev_adm_section_size + pattern_size + in_aligned_size);
+        memcpy(tlv, security_section, security_section_size);
+        memcpy(tlv + security_section_size, dev_adm_section, dev_adm_section_size);
+        memset(tlv + security_section_size + dev_adm_section_size, 0xFF, pattern_size);
 
-        if (!data_buffer) {
-                status = MKIMAGE_STATUS_ALLOCATION_ERROR;
-                goto done;
-        }
+        /* Input could be shorter than aligned size - the last bytes should have 0 value */
+        memcpy(payload, in, in_size);
+        memset(payload + in_size, 0, in_aligned_size - in_size);
 
-        memcpy(data_buffer, dev_adm_section, dev_adm_section_size);
-        memset(data_buffer + dev_adm_section_size, 0xFF, pattern_size);
-        memcpy(data_buffer + dev_adm_section_size + pattern_size, in_aligned, in_aligned_size);
+        /* Non-secure images are not encrypted and not signed */
+        if (secure_image) {
+                /* Encrypt executable in place */
+                aes_ctr_encrypt(hdr.nonce, data->sym_key, in_aligned_size, payload, payload);
 
-        /* Generate signature (it covers aligned device administration section and the input */
-        status = create_signature(dev_adm_section_size + pattern_size + in_aligned_size, data_buffer,
+                /*
+                 * Generate signature. It covers aligned device administration section, pattern
+                 * and the encrypted input which follow the security section in the output.
+                 */
+                status = create_signature(dev_adm_section_size + pattern_size + in_aligned_size,
+                                        tlv + security_section_size,
                                         MKIMAGE_ELLIPTIC_CURVE_EDWARDS25519,
                                         MKIMAGE_HASH_METHOD_SHA512, ED25519_PRIV_KEY_LENGTH,
                                                         data->priv_key, &signature_len, signature);
 
-        /* This buffer is not needed anymore - could be freed here */
-        free(data_buffer);
-        data_buffer = NULL;
-
-        if (status != MKIMAGE_STATUS_OK) {
-                goto done;
-        }
-
-        /* Overwrite the signature. It is placed at the and of the security section */
-        memcpy(security_section + (security_section_size - signature_len), signature, signature_len);
-
-common_part:
-
-        /* Calculate CRC-32 */
-        crc32 = compute_crc32(in_aligned_size, in_aligned ? in_aligned : in);
-
-        /* Glue security section, device administration section and pattern */
-        tlv_length = security_section_size + dev_adm_section_size + pattern_size;
-        data_buffer = malloc(tlv_length);
-
-        if (!data_buffer) {
-                status = MKIMAGE_STATUS_ALLOCATION_ERROR;
-                goto done;
-        }
-
-        memcpy(data_buffer, security_section, security_section_size);
-        memcpy(data_buffer + security_section_size, dev_adm_section, dev_adm_section_size);
-        memset(data_buffer + security_section_size + dev_adm_section_size, 0xFF, pattern_size);
-
-        /*
-         * Output = DA1469x header + security section + device administration section + pattern +
-         *          app binary
-         */
-        *out_size =  sizeof(header) + tlv_length + in_aligned_size;
-        *out = malloc(*out_size);
-        out_ptr = *out;
+                if (status != MKIMAGE_STATUS_OK) {
+                        goto done;
+                }
 
-        if (!*out) {
-                status = MKIMAGE_STATUS_ALLOCATION_ERROR;
-                goto done;
+                /* Overwrite the signature. It is placed at the and of the security section */
+                memcpy(tlv + (security_section_size - signature_len), signature, signature_len);
         }
 
         header.image_identifier[0] = SUOTA_1_1_IMAGE_DA1469x_HEADER_SIGNATURE_B1;
         header.image_identifier[1] = SUOTA_1_1_IMAGE_DA1469x_HEADER_SIGNATURE_B2;
         store32((uint8_t *) &header.size, in_aligned_size);
-        store32((uint8_t *) &header.crc, crc32);
+        store32((uint8_t *) &header.crc, compute_crc32(in_aligned_size, payload));
         store32((uint8_t *) &header.pointer_to_ivt, sizeof(header) + tlv_length);
 
         if (!get_version(ver_size, (char *) ver, header.version_string)) {
@@ -1363,18 +1337,13 @@ common_part:
                 goto done;
         }
 
-        /* Copy data to output buffer */
-        memcpy(out_ptr, &header, sizeof(header));
-        out_ptr += sizeof(header);
-        memcpy(out_ptr, data_buffer, tlv_length);
-        out_ptr += tlv_length;
-        memcpy(out_ptr, in_aligned ? in_aligned : in, in_aligned_size);
-
-        status = MKIMAGE_STATUS_OK;
+        memcpy(*out, &header, sizeof(header));
 
 done:
-        free(data_buffer);
-        free(in_aligned);
+        if (status != MKIMAGE_STATUS_OK) {
+                free(*out);
+                *out = NULL;
+        }
 
         return status;
 }
@@ -1388,13 +1357,11 @@ mkimage_status_t mkimage_create_da1470x_image(size_t in_size, const uint8_t *in,
         suota_1_1_image_header_da1469x_t header;
         suota_security_header_da1469x_t hdr;
         mkimage_status_t status = MKIMAGE_STATUS_OK;
-        uint32_t crc32 = 0xFFFFFFFF;
         uint8_t dev_adm_section[2048] = { 0 };
         uint8_t security_section[2048] = { 0 };
         uint8_t signature[ED25519_SIG_LENGTH] = { 0 };
-        uint8_t *data_buffer = NULL;
-        uint8_t *in_aligned = NULL;
-        uint8_t *out_ptr;
+        uint8_t *tlv;
+        uint8_t *payload;
         size_t signature_len = sizeof(signature);
         size_t in_aligned_size = in_size;
         size_t fw_ver_size = FW_VERSION_SIZE;
@@ -1438,16 +1405,6 @@ mkimage_status_t mkimage_create_da1470x_image(size_t in_size, const uint8_t *in,
                 if (in_aligned_size % AES_BLOCKSIZE) {
                         in_aligned_size += AES_BLOCKSIZE - in_aligned_size % AES_BLOCKSIZE;
                 }
-
-                /* Allocate new buffer for aligned input. Last bytes should have 0 value */
-                in_aligned = malloc(in_aligned_size);
-
-                if (!in_aligned) {
-                        return MKIMAGE_STATUS_ALLOCATION_ERROR;
-                }
-
-                memset(in_aligned, 0, in_aligned_size);
-                memcpy(in_aligned, in, in_size);
         }
         else {
                 memset(&hdr, 0, sizeof(hdr));
@@ -1461,134 +1418,272 @@ mkimage_status_t mkimage_create_da1470x_image(size_t in_size, const uint8_t *in,
         dev_adm_section_size = fill_device_adm_section_da1470x(dev_adm_section, opt_data);
 
         if (dev_adm_section_size == 0) {
-                status = MKIMAGE_STATUS_INVALID_DATA;
-                goto done;
+                return MKIMAGE_STATUS_INVALID_DATA;
         }
 
         /* Calculate pattern size */
         pattern_size = calculate_pattern_size(sizeof(header), dev_adm_section_size, fw_ver_size,
                                                                         security_section_size);
+        tlv_length = security_section_size + fw_ver_size + dev_adm_section_size + pattern_size;
+        padding = calculate_image_padding(in_aligned_size, offset, sizeof(header) + tlv_length);
 
-        if (!secure_image) {
-                /* Non-secure images are not encrypted and not signed */
-                goto common_part;
+        /*
+         * Output = DA1470x header + security section + signed firmware version section + device
+         *          administration section + pattern + app binary + padding. It is built in place,
+         *          so the binary is copied only once.
+         */
+        *out_size =  sizeof(header) + tlv_length + in_aligned_size + padding;
+        *out = malloc(*out_size);
+
+        if (!*out) {
+                return MKIMAGE_STATUS_ALLOCATION_ERROR;
         }
 
-        /* Store encrypted executable in the same buffer */
-        aes_ctr_encrypt(hdr.nonce, data->sym_key, in_aligned_size, in_aligned, in_aligned);
+        tlv = *out + sizeof(header);
+        payload = tlv + tlv_length;
 
-        /* Glue aligned device administration section, firmware size and the input (application
-         * binary) */
-        data_buffer = malloc(dev_adm_section_size + fw_ver_size + pattern_size + in_aligned_size);
+        /* Input could be shorter than aligned size - the last bytes should have 0 value */
+        memcpy(payload, in, in_size);
+        memset(payload + in_size, 0, in_aligned_size + padding - in_size);
 
-        if (!data_buffer) {
-                status = MKIMAGE_STATUS_ALLOCATION_ERROR;
-                goto done;
-        }
+        /* Non-secure images are not encrypted and not signed */
+        if (secure_image) {
+                uint8_t *signed_data = tlv + security_section_size;
 
-        memcpy(data_buffer, dev_adm_section, dev_adm_section_size);
-        store32(data_buffer + dev_adm_section_size, fw_version);
-        memset(data_buffer + dev_adm_section_size + fw_ver_size, 0xFF, pattern_size);
-        memcpy(data_buffer + dev_adm_section_size + fw_ver_size + pattern_size, in_aligned,
-                                                                                in_aligned_size);
-
-        /* Generate signature (it covers aligned device administration section and the input */
-        status = create_signature(dev_adm_section_size + fw_ver_size + pattern_size + in_aligned_size,
-                                        data_buffer, MKIMAGE_ELLIPTIC_CURVE_EDWARDS25519,
+                /* Encrypt executable in place */
+                aes_ctr_encrypt(hdr.nonce, data->sym_key, in_aligned_size, payload, payload);
+
+                /*
+                 * Signature covers device administration section, firmware version, pattern and
+                 * the encrypted input (without padding). Device administration section and
+                 * firmware version are put in this order in front of the pattern temporarily, so
+                 * that the signed data is contiguous. They are swapped back below.
+                 */
+                memcpy(signed_data, dev_adm_section, dev_adm_section_size);
+                store32(signed_data + dev_adm_section_size, fw_version);
+                memset(signed_data + dev_adm_section_size + fw_ver_size, 0xFF, pattern_size);
+
+                status = create_signature(dev_adm_section_size + fw_ver_size + pattern_size +
+                                        in_aligned_size, signed_data,
+                                        MKIMAGE_ELLIPTIC_CURVE_EDWARDS25519,
                                         MKIMAGE_HASH_METHOD_SHA512, ED25519_PRIV_KEY_LENGTH,
                                                         data->priv_key, &signature_len, signature);
 
-        /* This buffer is not needed anymore - could be freed here */
-        free(data_buffer);
-        data_buffer = NULL;
+                if (status != MKIMAGE_STATUS_OK) {
+                        goto done;
+                }
 
-        if (status != MKIMAGE_STATUS_OK) {
+                /* Overwrite the signature. It is placed at the and of the security section */
+                memcpy(security_section + (security_section_size - signature_len), signature,
+                                                                                signature_len);
+        }
+
+        memcpy(tlv, security_section, security_section_size);
+        store32(tlv + security_section_size, fw_version);
+        memcpy(tlv + security_section_size + fw_ver_size, dev_adm_section, dev_adm_section_size);
+        memset(tlv + security_section_size + fw_ver_size + dev_adm_section_size, 0xFF,
+                                                                                pattern_size);
+
+        header.image_identifier[0] = SUOTA_1_1_IMAGE_DA1469x_HEADER_SIGNATURE_B1;
+        header.image_identifier[1] = SUOTA_1_1_IMAGE_DA1469x_HEADER_SIGNATURE_B2;
+        store32((uint8_t *) &header.size, in_aligned_size + padding);
+        store32((uint8_t *) &header.crc, compute_crc32(in_aligned_size + padding, payload));
+        store32((uint8_t *) &header.pointer_to_ivt, sizeof(header) + tlv_length);
+
+        if (!get_version(ver_size, (char *) ver, header.version_string)) {
+                status = MKIMAGE_STATUS_INVALID_DATA;
                 goto done;
         }
 
-        /* Overwrite the signature. It is placed at the and of the security section */
-        memcpy(security_section + (security_section_size - signature_len), signature, signature_len);
+        if (!get_date(ver_size, (char *) ver, (uint8_t *) &header.timestamp)) {
+                status = MKIMAGE_STATUS_INVALID_DATA;
+                goto done;
+        }
 
-common_part:
-        tlv_length = security_section_size + fw_ver_size + dev_adm_section_size + pattern_size;
-        padding = calculate_image_padding(in_aligned_size, offset, sizeof(header) + tlv_length);
-        if (padding) {
-                uint8_t * padded_in_aligned = malloc(in_aligned_size + padding);
-                if (!padded_in_aligned) {
-                        free(in_aligned);
-                        return MKIMAGE_STATUS_ALLOCATION_ERROR;
-                }
+        memcpy(*out, &header, sizeof(header));
 
-                if (secure_image) {
-                        memcpy(padded_in_aligned, in_aligned, in_aligned_size);
-                } else {
-                        memcpy(padded_in_aligned, in, in_aligned_size);
+done:
+        if (status != MKIMAGE_STATUS_OK) {
+                free(*out);
+                *out = NULL;
+        }
+
+        return status;
+}
+
+/* Worker of mkimage_create_da1470x_images() */
+typedef struct {
+        mkimage_da1470x_job_t *jobs;
+        size_t job_count;
+        /* Worker handles jobs first, first + stride, first + 2 * stride... */
+        size_t first;
+        size_t stride;
+#ifdef _WIN32
+        HANDLE thread;
+#else
+        pthread_t thread;
+#endif
+        bool started;
+} da1470x_worker_t;
+
+static void run_da1470x_worker(da1470x_worker_t *worker)
+{
+        crypto_context_t *ctx;
+        mkimage_da1470x_job_t *job;
+        size_t i;
+
+        /* Random data (NONCE) must not be taken from generator shared with other workers */
+        ctx = crypto_context_create();
+        crypto_context_select(ctx);
+
+        for (i = worker->first; i < worker->job_count; i += worker->stride) {
+                job = &worker->jobs[i];
+
+                if (!ctx) {
+                        job->status = MKIMAGE_STATUS_CRYPTO_LIBRARY_ERROR;
+                        continue;
                 }
-                memset(padded_in_aligned + in_aligned_size, 0, padding);
-                in_aligned = padded_in_aligned;
-                in_aligned_size += padding;
+
+                job->status = mkimage_create_da1470x_image(job->in_size, job->in, job->ver_size,
+                                                        job->ver, job->fw_version, job->data,
+                                                        job->opt_data, &job->out, &job->out_size,
+                                                                                job->offset);
         }
 
-        /* Calculate CRC-32 */
-        crc32 = compute_crc32(in_aligned_size, in_aligned ? in_aligned : in);
+        crypto_context_select(NULL);
+        crypto_context_destroy(ctx);
+}
 
-        /* Glue security section, device administration section and pattern */
-        data_buffer = malloc(tlv_length);
+#ifdef _WIN32
+static DWORD WINAPI da1470x_worker_thread(LPVOID param)
+{
+        run_da1470x_worker(param);
 
-        if (!data_buffer) {
-                status = MKIMAGE_STATUS_ALLOCATION_ERROR;
-                goto done;
+        return 0;
+}
+
+static bool start_worker(da1470x_worker_t *worker)
+{
+        worker->thread = CreateThread(NULL, 0, da1470x_worker_thread, worker, 0, NULL);
+
+        return worker->thread != NULL;
+}
+
+static void join_worker(da1470x_worker_t *worker)
+{
+        WaitForSingleObject(worker->thread, INFINITE);
+        CloseHandle(worker->thread);
+}
+
+static unsigned int get_cpu_count(void)
+{
+        SYSTEM_INFO info;
+
+        GetSystemInfo(&info);
+
+        return info.dwNumberOfProcessors;
+}
+#else
+static void *da1470x_worker_thread(void *param)
+{
+        run_da1470x_worker(param);
+
+        return NULL;
+}
+
+static bool start_worker(da1470x_worker_t *worker)
+{
+        return pthread_create(&worker->thread, NULL, da1470x_worker_thread, worker) == 0;
+}
+
+static void join_worker(da1470x_worker_t *worker)
+{
+        pthread_join(worker->thread, NULL);
+}
+
+static unsigned int get_cpu_count(void)
+{
+        long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+        return count > 0 ? (unsigned int) count : 1;
+}
+#endif
+
+mkimage_status_t mkimage_create_da1470x_images(mkimage_da1470x_job_t *jobs, size_t job_count,
+                                                                        unsigned int thread_count)
+{
+        da1470x_worker_t *workers;
+        mkimage_status_t status = MKIMAGE_STATUS_OK;
+        size_t i;
+
+        if (!jobs) {
+                return MKIMAGE_STATUS_INVALID_PARAMETER;
         }
 
-        memcpy(data_buffer, security_section, security_section_size);
-        store32(data_buffer + security_section_size, fw_version);
-        memcpy(data_buffer + security_section_size + fw_ver_size, dev_adm_section,
-                                                                        dev_adm_section_size);
-        memset(data_buffer + security_section_size + fw_ver_size + dev_adm_section_size, 0xFF,
-                                                                        pattern_size);
+        for (i = 0; i < job_count; i++) {
+                jobs[i].out = NULL;
+                jobs[i].out_size = 0;
+                jobs[i].status = MKIMAGE_STATUS_OK;
+        }
 
-        /*
-         * Output = DA1470x header + security section + signed firmware version section + device
-         *          administration section + pattern + app binary
-         */
-        *out_size =  sizeof(header) + tlv_length + in_aligned_size;
-        *out = malloc(*out_size);
+        if (thread_count == 0) {
+                thread_count = get_cpu_count();
+        }
 
-        if (!*out) {
-                status = MKIMAGE_STATUS_ALLOCATION_ERROR;
-                goto done;
+        if (thread_count > MAX_WORKER_THREADS) {
+                thread_count = MAX_WORKER_THREADS;
         }
 
-        out_ptr = *out;
+        if (thread_count > job_count) {
+                thread_count = job_count;
+        }
 
-        header.image_identifier[0] = SUOTA_1_1_IMAGE_DA1469x_HEADER_SIGNATURE_B1;
-        header.image_identifier[1] = SUOTA_1_1_IMAGE_DA1469x_HEADER_SIGNATURE_B2;
-        store32((uint8_t *) &header.size, in_aligned_size);
-        store32((uint8_t *) &header.crc, crc32);
-        store32((uint8_t *) &header.pointer_to_ivt, sizeof(header) + tlv_length);
+        if (thread_count == 0) {
+                return MKIMAGE_STATUS_OK;
+        }
 
-        if (!get_version(ver_size, (char *) ver, header.version_string)) {
-                status = MKIMAGE_STATUS_INVALID_DATA;
-                goto done;
+        /* libsodium must be initialized once, before any worker seeds its generator */
+        if (crypto_rng_init() == -1) {
+                return MKIMAGE_STATUS_CRYPTO_LIBRARY_ERROR;
         }
 
-        if (!get_date(ver_size, (char *) ver, (uint8_t *) &header.timestamp)) {
-                status = MKIMAGE_STATUS_INVALID_DATA;
-                goto done;
+        workers = calloc(thread_count, sizeof(*workers));
+        if (!workers) {
+                return MKIMAGE_STATUS_ALLOCATION_ERROR;
         }
 
-        /* Copy data to output buffer */
-        memcpy(out_ptr, &header, sizeof(header));
-        out_ptr += sizeof(header);
-        memcpy(out_ptr, data_buffer, tlv_length);
-        out_ptr += tlv_length;
-        memcpy(out_ptr, in_aligned ? in_aligned : in, in_aligned_size);
+        for (i = 0; i < thread_count; i++) {
+                workers[i].jobs = jobs;
+                workers[i].job_count = job_count;
+                workers[i].first = i;
+                workers[i].stride = thread_count;
+        }
 
-        status = MKIMAGE_STATUS_OK;
+        /* The first worker is run by calling thread */
+        for (i = 1; i < thread_count; i++) {
+                workers[i].started = start_worker(&workers[i]);
+        }
 
-done:
-        free(data_buffer);
-        free(in_aligned);
+        run_da1470x_worker(&workers[0]);
+
+        for (i = 1; i < thread_count; i++) {
+                if (workers[i].started) {
+                        join_worker(&workers[i]);
+                } else {
+                        /* Thread couldn't be started - do its jobs here */
+                        run_da1470x_worker(&workers[i]);
+                }
+        }
+
+        free(workers);
+
+        /* Result doesn't depend on scheduling - report failure of the first job which failed */
+        for (i = 0; i < job_count; i++) {
+                if (jobs[i].status != MKIMAGE_STATUS_OK) {
+                        status = jobs[i].status;
+                        break;
+                }
+        }
 
         return status;
 }
@@ -24,6 +24,9 @@
 #else
 #include <unistd.h>
 #endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 #ifdef __linux__
 #include <endian.h>
 #endif
@@ -49,6 +52,9 @@
 #define O_BINARY        0
 #endif
 
+/* Size of buffer used for copying files */
+#define COPY_BUF_SIZE   0x10000
+
 /* pre-determined cryptography key and IV */
 static uint8_t def_key[16] = {
         0x06, 0xa9, 0x21, 0x40, 0x36, 0xb8, 0xa1, 0x5b,
@@ -67,6 +73,9 @@ static uint8_t def_iv[16] = {
 /* Max key length (in bytes) */
 #define MAX_KEY_LENGTH   32
 
+/* Max number of arguments in single line of batch manifest */
+#define BATCH_MAX_ARGS  32
+
 static void usage(const char* my_name)
 {
         fprintf(stderr,
@@ -82,6 +91,7 @@ static void usage(const char* my_name)
                 "#5 secure           - generate signed image file\n"
                 "#6 da1469x          - generate DA1469x device image file in secure or non-secure mode\n"
                 "#7 da1470x          - generate DA1470x device image file in secure or non-secure mode\n"
+                "#8 batch            - generate several DA1470x device image files in parallel\n"
                 "\n"
                 "\n"
                 "Usage case #1:\n"
@@ -301,6 +311,32 @@ static void usage(const char* my_name)
                 "        8E05FA7509F4D3B8F96B08DEFAA204A9BCEFF67AD28306B6D4A2DBAB3C238DCA 0\n"
                 "        7CAE0D855049BF06FCBCE2F274CAB39EAFF53AF9F818F171311EBD764FE95ACB 0\n"
                 "        min_fw 1 nonce 46C6874DC1EE8575 rev \"1 2 s1 d2\"\n"
+                "\n"
+                "\n"
+                "Usage case #8:\n"
+                "mkimage batch <manifest_file> [threads <count>]\n"
+                "\n"
+                "parameters:\n"
+                "  manifest_file   text file which describes images to create. Each line contains\n"
+                "                  parameters of 'da1470x' command (usage case #7) for one image.\n"
+                "                  Empty lines and text following '#' sign are ignored.\n"
+                "  threads         set number of worker threads\n"
+                "   count          number of threads (optional, default is number of CPUs)\n"
+                "\n"
+                "Images are signed and encrypted in parallel, output files are written in the\n"
+                "order of manifest lines when all images are ready. Output doesn't depend on the\n"
+                "number of threads.\n"
+                "\n"
+                "example:\n"
+                "  batch images.txt threads 4\n"
+                "\n"
+                "  images.txt (the last image is described in single line, wrapped here):\n"
+                "        app1.bin sw_version.h app1.img 1\n"
+                "        app2.bin sw_version.h app2.img 2 img_offset 0x4000\n"
+                "        app3.bin sw_version.h app3.img 2\n"
+                "          8E05FA7509F4D3B8F96B08DEFAA204A9BCEFF67AD28306B6D4A2DBAB3C238DCA 0\n"
+                "          7CAE0D855049BF06FCBCE2F274CAB39EAFF53AF9F818F171311EBD764FE95ACB 0\n"
+                "          min_fw 1 rev \"1 s1\"\n"
                 );
 }
 
@@ -383,7 +419,7 @@ static int append_file_csum(int outf, int inf, uint8_t* _csum)
 {
         RW_RET_TYPE n;
         uint8_t csum = 0;
-        uint8_t copy_buf_clr[16];
+        static uint8_t copy_buf_clr[COPY_BUF_SIZE];
 
         do {
                 size_t count;
@@ -485,6 +521,63 @@ static bool read_whole_file(const char *path, int flags, size_t *buffer_size, ui
         return true;
 }
 
+/*
+ * Map whole file from a given path to memory for reading. On Windows the file is read to allocated
+ * buffer instead. 'buffer' should be released with release_mapped_file() after use.
+ */
+static bool map_whole_file(const char *path, size_t *buffer_size, uint8_t **buffer)
+{
+#ifdef _WIN32
+        return read_whole_file(path, O_RDONLY | O_BINARY, buffer_size, buffer);
+#else
+        struct stat stat_data;
+        void *addr;
+        int fd;
+
+        *buffer = NULL;
+        fd = open(path, O_RDONLY | O_BINARY);
+
+        if (fd < 0) {
+                /* Cannot open file */
+                return false;
+        }
+
+        /* Empty files cannot be mapped */
+        if (fstat(fd, &stat_data) || stat_data.st_size == 0) {
+                close(fd);
+                return false;
+        }
+
+        addr = mmap(NULL, stat_data.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        /* Mapping stays valid after closing the descriptor */
+        close(fd);
+
+        if (addr == MAP_FAILED) {
+                return false;
+        }
+
+        /* File is read once from the beginning to the end */
+        posix_madvise(addr, stat_data.st_size, POSIX_MADV_SEQUENTIAL);
+
+        *buffer = addr;
+        *buffer_size = stat_data.st_size;
+
+        return true;
+#endif
+}
+
+static void release_mapped_file(uint8_t *buffer, size_t buffer_size)
+{
+#ifdef _WIN32
+        free(buffer);
+#else
+        if (buffer) {
+                munmap(buffer, buffer_size);
+        }
+#endif
+}
+
 static int create_single_image(int argc, const char* argv[])
 {
         int argix = 5;
@@ -535,8 +628,7 @@ static int create_single_image(int argc, const char* argv[])
         }
 
         /* Read input file */
-        if (!read_whole_file(argv[2], O_RDONLY | O_BINARY, &in_size, &in_buf) || in_size == 0 ||
-                                                                                        !in_buf) {
+        if (!map_whole_file(argv[2], &in_size, &in_buf) || in_size == 0 || !in_buf) {
                 fprintf(stderr, "cannot read file - %s\r\n", argv[2]);
                 goto done;
         }
@@ -578,7 +670,7 @@ done:
         }
 
         /* Free buffers */
-        free(in_buf);
+        release_mapped_file(in_buf, in_size);
         free(ver_buf);
         free(out_buf);
 
@@ -617,15 +709,17 @@ static int parse_offset(const char* s, unsigned* offset)
 
 static int add_padding(int outf, const unsigned count, const uint8_t pad)
 {
-        unsigned i;
-        RW_RET_TYPE n;
+        uint8_t pad_buf[4096];
+        unsigned left = count;
 
-        for (i = 0; i < count; i++) {
-                do {
-                        n = write(outf, &pad, 1);
-                        if (n < 0  &&  errno != EINTR)
-                                return -1;
-                } while (n < 1);
+        memset(pad_buf, pad, sizeof(pad_buf));
+
+        while (left) {
+                unsigned n = left < sizeof(pad_buf) ? left : sizeof(pad_buf);
+
+                if (safe_write(outf, pad_buf, n))
+                        return -1;
+                left -= n;
         }
 
         return 0;
@@ -1244,8 +1338,7 @@ static int create_single_secure_image(int argc, const char *argv[])
         }
 
         /* Read input file */
-        if (!read_whole_file(argv[2], O_RDONLY | O_BINARY, &in_size, &in_buf) || in_size == 0 ||
-                                                                                        !in_buf) {
+        if (!map_whole_file(argv[2], &in_size, &in_buf) || in_size == 0 || !in_buf) {
                 fprintf(stderr, "cannot read file - %s\r\n", argv[2]);
                 goto done;
         }
@@ -1289,7 +1382,7 @@ done:
         }
 
         /* Free buffers */
-        free(in_buf);
+        release_mapped_file(in_buf, in_size);
         free(ver_buf);
         free(out_buf);
 
@@ -1472,8 +1565,7 @@ copy_data:
 
 create_image:
         /* Read input file */
-        if (!read_whole_file(argv[2], O_RDONLY | O_BINARY, &in_size, &in_buf) || in_size == 0 ||
-                                                                                        !in_buf) {
+        if (!map_whole_file(argv[2], &in_size, &in_buf) || in_size == 0 || !in_buf) {
                 fprintf(stderr, "cannot read file - %s\r\n", argv[2]);
                 goto done;
         }
@@ -1516,7 +1608,7 @@ done:
         }
 
         /* Free buffers */
-        free(in_buf);
+        release_mapped_file(in_buf, in_size);
         free(ver_buf);
         free(out_buf);
         free(arg_dup);
@@ -1524,7 +1616,28 @@ done:
         return status;
 }
 
-static int create_da1470x_image(int argc, const char *argv[])
+/* DA1470x image parameters given in command line */
+typedef struct {
+        const char *in_file;
+        const char *ver_file;
+        const char *out_file;
+        uint32_t fw_version;
+        size_t img_offset;
+        bool secure_mode;
+        bool nonce_passed;
+        uint8_t nonce[8];
+        uint8_t priv_key[32];
+        uint8_t sym_key[32];
+        mkimage_key_id_t rev_array[100];
+        mkimage_security_data_da1470x_t data;
+        mkimage_device_adm_data_da1470x_t opt_data;
+} da1470x_args_t;
+
+/*
+ * Parse arguments of 'da1470x' command. Pointers in 'args->data' and 'args->opt_data' point to
+ * 'args' itself, so it must not be copied after this call.
+ */
+static bool parse_da1470x_args(int argc, const char *argv[], da1470x_args_t *args)
 {
         /*
          * Common mandatory arguments:
@@ -1546,36 +1659,31 @@ static int create_da1470x_image(int argc, const char *argv[])
          *       *:        [nonce <payload>]
          *       *:        [rev <revocation command>]
          */
-        uint32_t fw_version = 0;
         int argix = 6;
-        mkimage_key_id_t rev_array[100] = { };
-        mkimage_security_data_da1470x_t data = { };
-        mkimage_device_adm_data_da1470x_t opt_data = { };
-        mkimage_status_t lib_status;
-        uint8_t nonce[8];
-        uint8_t priv_key[32];
-        uint8_t sym_key[32];
         uint8_t pub_key_idx;
         uint8_t sym_key_idx;
-        uint8_t *in_buf = NULL, *ver_buf = NULL, *out_buf = NULL;
-        size_t in_size, ver_size, out_size;
         char *end_ptr;
         char *arg_dup = NULL;
-        int status = EXIT_FAILURE;
-        int out_fd = -1;
-        bool secure_mode = false;
-        bool nonce_passed = false;
-        int i;
-        size_t img_offset = 0x3000;
+        bool ret = false;
         bool override_img_offset = false;
+        int i;
+
+        memset(args, 0, sizeof(*args));
+        args->img_offset = 0x3000;
 
         if (argc < argix) {
                 /* Not enough arguments */
                 usage(argv[0]);
-                return EXIT_FAILURE;
-        } else if (argc == argix) {
+                return false;
+        }
+
+        args->in_file = argv[2];
+        args->ver_file = argv[3];
+        args->out_file = argv[4];
+
+        if (argc == argix) {
                 /* Non-secure image */
-                goto create_image;
+                goto fw_version;
         }
 
         /* check for optional img_offset */
@@ -1585,7 +1693,7 @@ static int create_da1470x_image(int argc, const char *argv[])
                         goto done;
                 }
 
-                img_offset = strtoll(argv[argix], &end_ptr, 16);
+                args->img_offset = strtoll(argv[argix], &end_ptr, 16);
                 if (*end_ptr != '\0' || end_ptr == argv[argix]) {
                         fprintf(stderr, "invalid image offset\r\n");
                         goto done;
@@ -1596,18 +1704,18 @@ static int create_da1470x_image(int argc, const char *argv[])
 
         if (argc == argix) {
                 /* Non-secure image */
-                goto create_image;
+                goto fw_version;
         }
 
-        secure_mode = true;
+        args->secure_mode = true;
 
         /* Private key must have 32 bytes in length */
         if (strlen(argv[argix]) != 64) {
                 fprintf(stderr, "invalid private key hex-string length\r\n");
-                return EXIT_FAILURE;
+                goto done;
         }
 
-        if (parse_hex_string(argv[argix], priv_key, sizeof(priv_key))) {
+        if (parse_hex_string(argv[argix], args->priv_key, sizeof(args->priv_key))) {
                 fprintf(stderr, "invalid private key hex-string\r\n");
                 goto done;
         }
@@ -1633,10 +1741,10 @@ static int create_da1470x_image(int argc, const char *argv[])
         /* Symmetric key must have 32 bytes in length */
         if (strlen(argv[argix]) != 64) {
                 fprintf(stderr, "invalid symmetric key hex-string length\r\n");
-                return EXIT_FAILURE;
+                goto done;
         }
 
-        if (parse_hex_string(argv[argix], sym_key, sizeof(sym_key))) {
+        if (parse_hex_string(argv[argix], args->sym_key, sizeof(args->sym_key))) {
                 fprintf(stderr, "invalid symmetric key hex-string\r\n");
                 goto done;
         }
@@ -1668,28 +1776,29 @@ static int create_da1470x_image(int argc, const char *argv[])
                                 goto done;
                         }
 
-                        opt_data.set_minimum_fw_version = true;
-                        opt_data.minimum_fw_version = strtoll(argv[i], &end_ptr, 10);
+                        args->opt_data.set_minimum_fw_version = true;
+                        args->opt_data.minimum_fw_version = strtoll(argv[i], &end_ptr, 10);
 
                         if (*end_ptr != '\0' || end_ptr == argv[i]) {
                                 fprintf(stderr, "invalid minimum firmware version value\r\n");
                                 goto done;
                         }
                 } else if (!strcmp(argv[i], "nonce")) {
-                        ++i;
-
-                        if (strlen(argv[i]) != 16) {
+                        if (++i >= argc || strlen(argv[i]) != 16) {
                                 fprintf(stderr, "invalid nonce hex-string length\r\n");
                                 goto done;
                         }
 
-                        if (parse_hex_string(argv[i], nonce, sizeof(nonce))) {
+                        if (parse_hex_string(argv[i], args->nonce, sizeof(args->nonce))) {
                                 fprintf(stderr, "invalid nonce hex-string\r\n");
                                 goto done;
                         }
 
-                        nonce_passed = true;
+                        args->nonce_passed = true;
                 } else if (!strcmp(argv[i], "rev")) {
+                        mkimage_key_id_t *rev_array = args->rev_array;
+                        const size_t rev_array_len = sizeof(args->rev_array) /
+                                                                sizeof(args->rev_array[0]);
                         char *token;
                         int j;
 
@@ -1702,7 +1811,7 @@ static int create_da1470x_image(int argc, const char *argv[])
                         arg_dup = strdup(argv[i]);
                         token = strtok(arg_dup, " ");
 
-                        for (j = 0; token && j < sizeof(rev_array) / sizeof(rev_array[0]); j++) {
+                        for (j = 0; token && j < rev_array_len; j++) {
                                 if (token[0] == 's') {
                                         rev_array[j].type = MKIMAGE_KEY_TYPE_SYMMETRIC;
                                         ++token;
@@ -1733,45 +1842,87 @@ static int create_da1470x_image(int argc, const char *argv[])
                                 }
                         }
 
-                        opt_data.key_rev_number = j;
-                        opt_data.key_rev_array = (j > 0) ? rev_array : NULL;
+                        args->opt_data.key_rev_number = j;
+                        args->opt_data.key_rev_array = (j > 0) ? rev_array : NULL;
                 }
         }
 
-        data.priv_key = priv_key;
-        data.sym_key = sym_key;
-        data.ecc_key_idx = pub_key_idx;
-        data.sym_key_idx = sym_key_idx;
-        data.nonce = nonce_passed ? nonce : NULL;
+        args->data.priv_key = args->priv_key;
+        args->data.sym_key = args->sym_key;
+        args->data.ecc_key_idx = pub_key_idx;
+        args->data.sym_key_idx = sym_key_idx;
+        args->data.nonce = args->nonce_passed ? args->nonce : NULL;
 
-create_image:
-        /* Read input file */
-        if (!read_whole_file(argv[2], O_RDONLY | O_BINARY, &in_size, &in_buf) || in_size == 0 ||
-                                                                                        !in_buf) {
-                fprintf(stderr, "cannot read file - %s\r\n", argv[2]);
+fw_version:
+        args->fw_version = strtoll(argv[5], &end_ptr, 10);
+        if (*end_ptr != '\0' || end_ptr == argv[5]) {
+                fprintf(stderr, "invalid fw_version\r\n");
                 goto done;
         }
 
-        /* Read version file */
-        if (!read_whole_file(argv[3], O_RDONLY | O_BINARY, &ver_size, &ver_buf) || ver_size == 0 ||
-                                                                                        !ver_buf) {
-                fprintf(stderr, "cannot read file - %s\r\n", argv[3]);
+        if (args->fw_version < args->opt_data.minimum_fw_version) {
+                fprintf(stderr, "passed fw_version is less than the minimum firmware version\r\n");
                 goto done;
         }
 
-        fw_version = strtoll(argv[5], &end_ptr, 10);
-        if (*end_ptr != '\0' || end_ptr == argv[5]) {
-                fprintf(stderr, "invalid fw_version\r\n");
+        ret = true;
+
+done:
+        free(arg_dup);
+
+        return ret;
+}
+
+static bool write_whole_file(const char *path, size_t buffer_size, const uint8_t *buffer)
+{
+        int fd;
+        bool ret;
+
+        fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_BINARY, S_IRUSR | S_IWUSR);
+        if (fd < 0) {
+                fprintf(stderr, "cannot open file - %s\r\n", path);
+                return false;
+        }
+
+        ret = !safe_write(fd, buffer, buffer_size);
+        if (!ret) {
+                fprintf(stderr, "cannot write to file - %s\r\n", path);
+        }
+
+        close(fd);
+
+        return ret;
+}
+
+static int create_da1470x_image(int argc, const char *argv[])
+{
+        da1470x_args_t args;
+        mkimage_status_t lib_status;
+        uint8_t *in_buf = NULL, *ver_buf = NULL, *out_buf = NULL;
+        size_t in_size = 0, ver_size, out_size;
+        int status = EXIT_FAILURE;
+
+        if (!parse_da1470x_args(argc, argv, &args)) {
+                return EXIT_FAILURE;
+        }
+
+        /* Read input file */
+        if (!map_whole_file(args.in_file, &in_size, &in_buf) || in_size == 0 || !in_buf) {
+                fprintf(stderr, "cannot read file - %s\r\n", args.in_file);
                 goto done;
         }
 
-        if (fw_version < opt_data.minimum_fw_version) {
-                fprintf(stderr, "passed fw_version is less than the minimum firmware version\r\n");
+        /* Read version file */
+        if (!read_whole_file(args.ver_file, O_RDONLY | O_BINARY, &ver_size, &ver_buf) ||
+                                                                ver_size == 0 || !ver_buf) {
+                fprintf(stderr, "cannot read file - %s\r\n", args.ver_file);
                 goto done;
         }
-        lib_status = mkimage_create_da1470x_image(in_size, in_buf, ver_size, ver_buf, fw_version,
-                                                        secure_mode ? &data : NULL, secure_mode ?
-                                                        &opt_data : NULL, &out_buf, &out_size, img_offset);
+
+        lib_status = mkimage_create_da1470x_image(in_size, in_buf, ver_size, ver_buf,
+                                        args.fw_version, args.secure_mode ? &args.data : NULL,
+                                        args.secure_mode ? &args.opt_data : NULL, &out_buf,
+                                                                &out_size, args.img_offset);
 
         if (lib_status != MKIMAGE_STATUS_OK) {
                 fprintf(stderr, "cannot create secure single image - %s\r\n",
@@ -1779,31 +1930,210 @@ create_image:
                 goto done;
         }
 
-        /* Open output file */
-        out_fd = open(argv[4], O_RDWR | O_CREAT | O_TRUNC | O_BINARY, S_IRUSR | S_IWUSR);
-        if (out_fd < 0) {
-                fprintf(stderr, "cannot open file - %s\r\n", argv[4]);
+        if (write_whole_file(args.out_file, out_size, out_buf)) {
+                status = EXIT_SUCCESS;
+        }
+
+done:
+        /* Free buffers */
+        release_mapped_file(in_buf, in_size);
+        free(ver_buf);
+        free(out_buf);
+
+        return status;
+}
+
+/*
+ * Split manifest line to arguments. Arguments are separated by white spaces, argument given in
+ * quotation marks could contain spaces. Line is modified in place. Returns number of arguments
+ * or -1 if there are too many of them.
+ */
+static int split_manifest_line(char *line, const char *argv[], int max_args)
+{
+        int argc = 0;
+        char *p = line;
+
+        while (*p != '\0') {
+                while (*p == ' ' || *p == '\t' || *p == '\r') {
+                        p++;
+                }
+
+                if (*p == '\0' || *p == '#') {
+                        break;
+                }
+
+                if (argc == max_args) {
+                        return -1;
+                }
+
+                if (*p == '"') {
+                        argv[argc++] = ++p;
+                        while (*p != '\0' && *p != '"') {
+                                p++;
+                        }
+                } else {
+                        argv[argc++] = p;
+                        while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r') {
+                                p++;
+                        }
+                }
+
+                if (*p != '\0') {
+                        *p++ = '\0';
+                }
+        }
+
+        return argc;
+}
+
+static int create_batch_images(int argc, const char *argv[])
+{
+        /*
+         * Arguments:
+         *        0:        application name (e.g mkimage)
+         *        1:        option (batch)
+         *        2:        manifest file path
+         * Optional arguments:
+         *      3,4:        [threads <count>]
+         */
+        const char *line_argv[BATCH_MAX_ARGS + 2];
+        da1470x_args_t *args = NULL;
+        mkimage_da1470x_job_t *jobs = NULL;
+        uint8_t **ver_bufs = NULL;
+        uint8_t *manifest = NULL;
+        size_t manifest_size;
+        size_t job_count = 0;
+        size_t max_jobs = 1;
+        unsigned long thread_count = 0;
+        char *line, *next;
+        char *end_ptr;
+        int status = EXIT_FAILURE;
+        int line_argc;
+        int line_num = 0;
+        size_t i;
+
+        if (argc != 3 && !(argc == 5 && !strcmp(argv[3], "threads"))) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        if (argc == 5) {
+                thread_count = strtoul(argv[4], &end_ptr, 10);
+                if (*end_ptr != '\0' || end_ptr == argv[4]) {
+                        fprintf(stderr, "invalid number of threads\r\n");
+                        return EXIT_FAILURE;
+                }
+        }
+
+        if (!read_whole_file(argv[2], O_RDONLY | O_BINARY, &manifest_size, &manifest)) {
+                fprintf(stderr, "cannot read file - %s\r\n", argv[2]);
+                return EXIT_FAILURE;
+        }
+
+        /* Make manifest a C-string, job arguments will point to it */
+        line = realloc(manifest, manifest_size + 1);
+        if (!line) {
                 goto done;
         }
+        manifest = (uint8_t *) line;
+        manifest[manifest_size] = '\0';
 
-        if (safe_write(out_fd, out_buf, out_size)) {
-                fprintf(stderr, "cannot write to file - %s\r\n", argv[4]);
+        /* Each line could describe one image */
+        for (i = 0; i < manifest_size; i++) {
+                if (manifest[i] == '\n') {
+                        max_jobs++;
+                }
+        }
+
+        args = calloc(max_jobs, sizeof(*args));
+        jobs = calloc(max_jobs, sizeof(*jobs));
+        ver_bufs = calloc(max_jobs, sizeof(*ver_bufs));
+        if (!args || !jobs || !ver_bufs) {
+                fprintf(stderr, "cannot allocate memory\r\n");
                 goto done;
         }
 
+        /* Each line contains the same arguments as 'da1470x' command */
+        line_argv[0] = argv[0];
+        line_argv[1] = "da1470x";
+
+        for (line = (char *) manifest; line; line = next) {
+                next = strchr(line, '\n');
+                if (next) {
+                        *next++ = '\0';
+                }
+                line_num++;
+
+                line_argc = split_manifest_line(line, line_argv + 2, BATCH_MAX_ARGS);
+                if (line_argc == 0) {
+                        /* Empty line or comment */
+                        continue;
+                }
+
+                /* Too short line is reported here, so usage isn't printed for each line */
+                if (line_argc < 4 || !parse_da1470x_args(line_argc + 2, line_argv,
+                                                                        &args[job_count])) {
+                        fprintf(stderr, "%s:%d: invalid image description\r\n", argv[2], line_num);
+                        goto done;
+                }
+
+                job_count++;
+        }
+
+        /* Read all input files, jobs are run when everything is in memory */
+        for (i = 0; i < job_count; i++) {
+                mkimage_da1470x_job_t *job = &jobs[i];
+
+                if (!map_whole_file(args[i].in_file, &job->in_size, (uint8_t **) &job->in) ||
+                                                                job->in_size == 0 || !job->in) {
+                        fprintf(stderr, "cannot read file - %s\r\n", args[i].in_file);
+                        goto done;
+                }
+
+                if (!read_whole_file(args[i].ver_file, O_RDONLY | O_BINARY, &job->ver_size,
+                                                &ver_bufs[i]) || job->ver_size == 0 || !ver_bufs[i]) {
+                        fprintf(stderr, "cannot read file - %s\r\n", args[i].ver_file);
+                        goto done;
+                }
+
+                job->ver = ver_bufs[i];
+                job->fw_version = args[i].fw_version;
+                job->data = args[i].secure_mode ? &args[i].data : NULL;
+                job->opt_data = args[i].secure_mode ? &args[i].opt_data : NULL;
+                job->offset = args[i].img_offset;
+        }
+
+        mkimage_create_da1470x_images(jobs, job_count, thread_count);
+
+        /* Output files are written in manifest order */
         status = EXIT_SUCCESS;
 
+        for (i = 0; i < job_count; i++) {
+                if (jobs[i].status != MKIMAGE_STATUS_OK) {
+                        fprintf(stderr, "cannot create image %s - %s\r\n", args[i].out_file,
+                                                        mkimage_status_message(jobs[i].status));
+                        status = EXIT_FAILURE;
+                        continue;
+                }
+
+                if (!write_whole_file(args[i].out_file, jobs[i].out_size, jobs[i].out)) {
+                        status = EXIT_FAILURE;
+                }
+        }
+
 done:
-        /* Close output file */
-        if (out_fd >= 0) {
-                close(out_fd);
+        if (jobs) {
+                for (i = 0; i < job_count; i++) {
+                        release_mapped_file((uint8_t *) jobs[i].in, jobs[i].in_size);
+                        free(ver_bufs[i]);
+                        free(jobs[i].out);
+                }
         }
 
-        /* Free buffers */
-        free(in_buf);
-        free(ver_buf);
-        free(out_buf);
-        free(arg_dup);
+        free(jobs);
+        free(ver_bufs);
+        free(args);
+        free(manifest);
 
         return status;
 }
@@ -1831,6 +2161,8 @@ int main(int argc, const char* argv[])
                 res = create_da1469x_image(argc, argv);
         else if (!strcmp(argv[1], "da1470x"))
                 res = create_da1470x_image(argc, argv);
+        else if (!strcmp(argv[1], "batch"))
+                res = create_batch_images(argc, argv);
         else
                 usage(argv[0]);
 
@@ -0,0 +1,283 @@
+#!/usr/bin/env python3
+#########################################################################################
+# Copyright (C) 2026 Dialog Semiconductor.
+# This computer program includes Confidential, Proprietary Information
+# of Dialog Semiconductor. All Rights Reserved.
+#########################################################################################
+
+"""
+Decoder of logs written in LOGGING_MODE_DEFERRED (see sdk/middleware/logging/src/logging.c).
+
+Each record holds the offset of the format string in log_fmt section of the ELF file of the
+application, the OS tick, tag, severity and the raw arguments. Records are read from a file,
+a serial port (configured e.g. with stty) or standard input, and printed as text in the same
+form as in other logging modes:
+
+    [<tick>] <S> <T> <message>
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+SYNC = 0xA5
+SEVERITY_CHARS = 'DNWECCCC'
+
+CONVERSION = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|L)?(.)')
+
+FORMAT_SECTION = b'log_fmt'
+
+
+class ElfImage(object):
+    """ Format strings and type sizes of ELF file """
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+
+        if self.data[:4] != b'\x7fELF':
+            raise ValueError(path + ' is not an ELF file')
+
+        self.is_64 = self.data[4] == 2
+        endian = '<' if self.data[5] == 1 else '>'
+        self.long_size = 8 if self.is_64 else 4
+
+        if self.is_64:
+            shoff, = struct.unpack_from(endian + 'Q', self.data, 0x28)
+            shentsize, shnum, shstrndx = struct.unpack_from(endian + 'HHH', self.data, 0x3A)
+            fmt = endian + 'IIQQQQ'
+        else:
+            shoff, = struct.unpack_from(endian + 'I', self.data, 0x20)
+            shentsize, shnum, shstrndx = struct.unpack_from(endian + 'HHH', self.data, 0x2E)
+            fmt = endian + 'IIIIII'
+
+        sections = [struct.unpack_from(fmt, self.data, shoff + i * shentsize)
+                    for i in range(shnum)]
+        names = sections[shstrndx][4]
+
+        self.formats = None
+        for name, _, _, _, offset, size in sections:
+            if self.data[names + name:names + name + len(FORMAT_SECTION) + 1] == \
+                    FORMAT_SECTION + b'\0':
+                self.formats = self.data[offset:offset + size]
+
+        if self.formats is None:
+            raise ValueError(path + ' has no log_fmt section, was it built in '
+                                    'LOGGING_MODE_DEFERRED?')
+
+        self.strings = {}
+
+    def format_at(self, offset):
+        """ Return format string at given offset or None if it's not start of string """
+        if offset in self.strings:
+            return self.strings[offset]
+
+        s = None
+        if offset < len(self.formats) and (offset == 0 or self.formats[offset - 1] == 0):
+            end = self.formats.find(b'\0', offset)
+            if end >= 0:
+                s = self.formats[offset:end].decode('latin-1')
+
+        self.strings[offset] = s
+        return s
+
+
+class Record(object):
+    """ Reader of fields of single record """
+
+    def __init__(self, payload):
+        self.data = payload
+        self.pos = 0
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            if self.pos >= len(self.data):
+                raise IndexError
+            b = self.data[self.pos]
+            self.pos += 1
+            value |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                return value
+
+    def signed(self):
+        value = self.varint()
+        return (value >> 1) ^ -(value & 1)
+
+    def double(self):
+        if self.pos + 8 > len(self.data):
+            raise IndexError
+        value, = struct.unpack_from('<d', self.data, self.pos)
+        self.pos += 8
+        return value
+
+    def string(self):
+        end = self.data.find(b'\0', self.pos)
+        if end < 0:
+            raise IndexError
+        value = self.data[self.pos:end].decode('latin-1')
+        self.pos = end + 1
+        return value
+
+
+def int_bits(length, elf):
+    if length == 'hh':
+        return 8
+    if length == 'h':
+        return 16
+    if length in ('ll', 'j'):
+        return 64
+    if length in ('l', 'z', 't'):
+        return elf.long_size * 8
+    return 32
+
+
+def format_message(fmt, rec, elf):
+    """ Format message as printf() would do, missing arguments are shown as <?> """
+    out = []
+    pos = 0
+    missing = False
+
+    for m in CONVERSION.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, precision, length, conv = m.groups()
+
+        if conv == '%':
+            out.append('%')
+            continue
+
+        try:
+            if missing:
+                raise IndexError
+            if width == '*':
+                width = str(rec.signed())
+                if width.startswith('-'):
+                    flags += '-'
+                    width = width[1:]
+            if precision == '*':
+                precision = str(rec.signed())
+                if precision.startswith('-'):
+                    precision = None
+
+            spec = '%' + flags + (width or '') + ('.' + precision if precision is not None else '')
+
+            if conv in 'di':
+                bits = int_bits(length, elf)
+                value = rec.signed() & ((1 << bits) - 1)
+                if value >> (bits - 1):
+                    value -= 1 << bits
+                out.append((spec + 'd') % value)
+            elif conv in 'uxXo':
+                value = rec.varint() & ((1 << int_bits(length, elf)) - 1)
+                if conv == 'o' and '#' in flags:
+                    spec = spec.replace('#', '')
+                    out.append(((spec + 'o') % value) if value == 0 else '0' + (spec + 'o') % value)
+                else:
+                    out.append((spec + conv) % value)
+            elif conv == 'c':
+                out.append((spec + 's') % chr(rec.varint() & 0xFF))
+            elif conv == 'p':
+                out.append((spec.replace('#', '') + 's') % hex(rec.varint()))
+            elif conv == 's':
+                out.append((spec + 's') % rec.string())
+            elif conv in 'fFeEgG':
+                out.append((spec + conv) % rec.double())
+            elif conv in 'aA':
+                value = float.hex(rec.double())
+                out.append(value.upper() if conv == 'A' else value)
+            elif conv == 'n':
+                pass
+            else:
+                out.append(m.group(0))
+        except IndexError:
+            missing = True
+            out.append('<?>')
+
+    out.append(fmt[pos:])
+    return ''.join(out)
+
+
+def decode_record(payload, elf):
+    """ Return text of record or None if it's not valid """
+    rec = Record(payload)
+    try:
+        fmt = elf.format_at(rec.varint())
+        tick = rec.varint()
+        tag_severity = rec.varint()
+    except IndexError:
+        return None
+
+    if fmt is None:
+        return None
+
+    tag = tag_severity >> 3
+    if tag & 0x10000000:
+        tag -= 0x20000000
+
+    return '[%u] %c %d %s' % (tick, SEVERITY_CHARS[tag_severity & 0x07], tag,
+                              format_message(fmt, rec, elf))
+
+
+def decode_stream(stream, elf, output):
+    buf = bytearray()
+    skipped = 0
+
+    while True:
+        chunk = stream.read1(4096) if hasattr(stream, 'read1') else stream.read(4096)
+        if not chunk:
+            break
+        buf += chunk
+
+        while True:
+            start = buf.find(bytes([SYNC]))
+            if start < 0:
+                skipped += len(buf)
+                del buf[:]
+                break
+            skipped += start
+            del buf[:start]
+
+            if len(buf) < 2 or len(buf) < 2 + buf[1]:
+                break
+
+            text = decode_record(bytes(buf[2:2 + buf[1]]), elf)
+            if text is None:
+                # not a record boundary, look for next sync byte
+                skipped += 1
+                del buf[:1]
+                continue
+
+            if skipped:
+                output.write('<%d bytes skipped>\n' % skipped)
+                skipped = 0
+            output.write(text)
+            output.flush()
+            del buf[:2 + buf[1]]
+
+    if skipped or buf:
+        output.write('<%d bytes skipped>\n' % (skipped + len(buf)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode deferred binary log using ELF file of '
+                                                 'the application.')
+    parser.add_argument('elf', help='ELF file of application which wrote the log')
+    parser.add_argument('input', nargs='?', default='-',
+                        help='file or serial port to read log from (default: standard input)')
+    args = parser.parse_args()
+
+    elf = ElfImage(args.elf)
+
+    if args.input == '-':
+        decode_stream(sys.stdin.buffer, elf, sys.stdout)
+    else:
+        with open(args.input, 'rb', buffering=0) as stream:
+            decode_stream(stream, elf, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+#########################################################################################
+# Copyright (C) 2026 Dialog Semiconductor.
+# This computer program includes Confidential, Proprietary Information
+# of Dialog Semiconductor. All Rights Reserved.
+#########################################################################################
+
+"""
+Viewer of task monitoring snapshots (see sdk/middleware/monitoring/task_monitoring.h).
+
+Snapshots sent by tm_send_snapshot() over DGTL or RTT are DGTL application response packets:
+
+    0x07, code, length (u16), 'T', 'M', version, ...
+
+They are read from a file, a serial port (configured e.g. with stty) or standard input, and
+each one is printed as a table with CPU load, context switches, scheduling latency, stack
+and heap of every task. Other data in the stream (e.g. other DGTL packets) is skipped.
+"""
+
+import argparse
+import struct
+import sys
+
+PKT_TYPE_APP_RSP = 0x07
+MAGIC = b'TM'
+VERSION = 1
+
+HEADER = struct.Struct('<2sBBHBBIIII')
+RECORD = struct.Struct('<HHHIHHHiI')
+
+STATES = ['Running', 'Ready', 'Blocked', 'Suspended', 'Deleted']
+
+
+def decode_snapshot(payload):
+    """ Snapshot as text, None if payload is not a snapshot """
+    if len(payload) < HEADER.size:
+        return None
+
+    magic, version, count, period_ms, windows, _, clock_hz, uptime, free_heap, min_free_heap = \
+        HEADER.unpack_from(payload)
+    if magic != MAGIC or version != VERSION or clock_hz == 0:
+        return None
+
+    def us(ticks):
+        return ticks * 1000000 // clock_hz
+
+    def percent(permille):
+        return '%d.%d' % (permille // 10, permille % 10)
+
+    lines = ['--- uptime %.3f s, sampling period %d ms, load over %d periods, heap free %d '
+             '(min %d)' % (uptime / clock_hz, period_ms, windows, free_heap, min_free_heap),
+             '%-16s %-9s %4s %7s %7s %7s %9s %9s %9s %6s %8s %8s' %
+             ('Task', 'State', 'Prio', 'Load%', 'Avg%', 'Peak%', 'Switches', 'Lat(us)',
+              'LatMax', 'Stack', 'Heap', 'HeapMax')]
+
+    pos = HEADER.size
+    for _ in range(count):
+        if pos + 3 > len(payload):
+            return None
+        state, prio, name_len = payload[pos:pos + 3]
+        pos += 3
+        name = payload[pos:pos + name_len].decode('ascii', 'replace')
+        pos += name_len
+        if pos + RECORD.size > len(payload):
+            return None
+        load, load_avg, load_peak, switches, lat_avg, lat_max, stack, heap, heap_max = \
+            RECORD.unpack_from(payload, pos)
+        pos += RECORD.size
+
+        lines.append('%-16s %-9s %4d %7s %7s %7s %9d %9d %9d %6d %8d %8d' %
+                     (name, STATES[state] if state < len(STATES) else 'Unknown', prio,
+                      percent(load), percent(load_avg), percent(load_peak), switches,
+                      us(lat_avg), us(lat_max), stack, heap, heap_max))
+
+    return '\n'.join(lines) + '\n'
+
+
+def decode_stream(stream, code, output):
+    buf = bytearray()
+    start_bytes = bytes([PKT_TYPE_APP_RSP, code])
+
+    while True:
+        chunk = stream.read1(4096) if hasattr(stream, 'read1') else stream.read(4096)
+        if not chunk:
+            break
+        buf += chunk
+
+        while True:
+            start = buf.find(start_bytes)
+            if start < 0:
+                # keep last byte, it may be start of packet
+                del buf[:-1]
+                break
+            del buf[:start]
+
+            if len(buf) < 4:
+                break
+            length, = struct.unpack_from('<H', buf, 2)
+            if len(buf) >= 6 and buf[4:6] != MAGIC:
+                del buf[:1]
+                continue
+            if len(buf) < 4 + length:
+                break
+
+            text = decode_snapshot(bytes(buf[4:4 + length]))
+            if text is None:
+                del buf[:1]
+                continue
+
+            output.write(text)
+            output.flush()
+            del buf[:4 + length]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Print task monitoring snapshots.')
+    parser.add_argument('input', nargs='?', default='-',
+                        help='file or serial port to read snapshots from (default: standard '
+                             'input)')
+    parser.add_argument('--code', type=lambda x: int(x, 0), default=0x54,
+                        help='code of DGTL application response packet (TM_SNAPSHOT_DGTL_CODE, '
+                             'default: 0x54)')
+    args = parser.parse_args()
+
+    if args.input == '-':
+        decode_stream(sys.stdin.buffer, args.code, sys.stdout)
+    else:
+        with open(args.input, 'rb', buffering=0) as stream:
+            decode_stream(stream, args.code, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()